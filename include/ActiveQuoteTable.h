@@ -2,7 +2,10 @@
 
 #include <numeric>
 #include <cstdint>
+#include <optional>
+#include <vector>
 #include <Utils/FixTypes.h>
+#include <Utils/FlatHashMap.h>
 
 
 namespace CORE {
@@ -13,128 +16,144 @@ public:
 	/** Struct of information assigned to a quote in the table */
 	struct QuoteInfo
 	{
-		int64_t key; //!< Key (unique timestamp)
+		int64_t key { 0 }; //!< Key (unique timestamp)
 		UTILS::CurrencyPair cp; //!< Currency pair
 		UTILS::QuoteType entryType; //!< bid/ask
-		size_t hashValue; //!< hash value built from volume, price, and minQty
-		int64_t oriKey; //!< original key
-		uint64_t sequenceTag;
+		size_t hashValue { 0 }; //!< hash value built from volume, price, and minQty
+		int64_t oriKey { 0 }; //!< original key
+		uint64_t sequenceTag { 0 };
 	};
-	
-	/** Alias for unique pointer to a QuoteInfo object */
-	using QuoteInfoPtr = std::unique_ptr<QuoteInfo>;
-	
+
+	/** Identity of a quote: instrument, side and price in cpips, packed into 128 bits
+	 *
+	 * Quotes are levels of the venue's book, so a level is identified by its
+	 * price, which is why the key of a quote restored from the order book
+	 * matches the key of the level in the feed.
+	 */
+	struct QuoteId
+	{
+		uint64_t instrument { 0 }; //!< base currency << 32 | quote currency << 1 | bid
+		int64_t price { 0 }; //!< price in cpips
+
+		bool operator==(const QuoteId &other) const { return instrument == other.instrument && price == other.price; }
+
+		bool operator!=(const QuoteId &other) const { return !(*this == other); }
+
+		struct Hash
+		{
+			uint64_t operator()(const QuoteId &id) const { return uint64_t(id.price) ^ (id.instrument * 0xC2B2AE3D27D4EB4Full); }
+		};
+	};
+
+	/** Builds the identity of a quote */
+	static QuoteId MakeQuoteId(UTILS::CurrencyPair cp, UTILS::QuoteType entryType, int64_t price)
+	{
+		return { (uint64_t(uint32_t(cp.BaseCCY())) << 32u) | (uint64_t(uint32_t(cp.QuoteCCY())) << 1u) | (entryType.Bid() ? 1u : 0u), price };
+	}
+
 	static size_t CalculateHashValue(const UTILS::NormalizedMDData::Entry &entry);
-	
+
 	bool Empty() const;
-	
-	/** Find a quote info assigned to a reference ID
+
+	/** Find a quote info assigned to a quote
 	 *
-	 * @param refId ID to be looked for
+	 * @param id Quote to be looked for
 	 * @param quoteInfo Reference to a quote info structure to receive the assigned data
-	 * @return @a true if @a refId was found and the quote info data was copied
+	 * @return @a true if @a id was found and the quote info data was copied
 	 */
-	bool FindQuoteInfo(const std::string &refId, QuoteInfo &quoteInfo);
-	
-	/** Replaces a quote info assigned to a reference ID with a new one
+	bool FindQuoteInfo(const QuoteId &id, QuoteInfo &quoteInfo) const;
+
+	/** Assigns a new quote info to a quote
 	 *
-	 * @param refId ID to be looked for. If empty -> create a new entry
-	 * @param newId New ID for the quote info
+	 * @param id Quote whose info is set (inserted if not active yet)
 	 * @param args Arguments used to construct a new QuoteInfo struct
-	 * @return Unique pointer to the previous quote info (that was replaced
-	 * by the new one)
+	 * @return The previous quote info (that was replaced by the new one), if any
 	 */
 	template <typename ...Args>
-	QuoteInfoPtr ReplaceQuoteInfo(const std::string &refId, const std::string &newId, Args &&...args)
+	std::optional<QuoteInfo> ReplaceQuoteInfo(const QuoteId &id, Args &&...args)
 	{
-		QuoteInfoPtr newQuote { QuoteInfoPtr(new QuoteInfo { std::forward<Args>(args)..., 0 }) };
-		newQuote->oriKey = newQuote->key; // new quote -> oriKey = key
-		
+		QuoteInfo newQuote { std::forward<Args>(args)..., 0 };
+		newQuote.oriKey = newQuote.key; // new quote -> oriKey = key
+
 		std::unique_lock lock { m_activeQuoteMap.Mutex() };
-		return ReplaceQuoteInfoAt((!refId.empty() ? m_activeQuoteMap->find(refId) : m_activeQuoteMap->end()), newId, std::move(newQuote));
+		return ReplaceQuoteInfoAt(id, newQuote);
 	}
-	
-	/** Replaces a quote info assigned to a reference ID with a new one
+
+	/** Assigns a new quote info to a quote
 	 *
-	 * This version replaces an existing quote info only if the hash value of
-	 * the new quote info differs from the old one.
+	 * This version keeps the original key of an existing quote info if the
+	 * hash value of the new quote info equals the old one.
 	 *
 	 * @param forceKey @a true -> always store new key, @a false -> store new key only if hash value has changed
-	 * @param refId ID to be looked for. If empty -> create a new entry
-	 * @param newId New ID for the quote info
-	 * @param volume Volume of the new quote (used to calculate the hash value)
-	 * @param price Price of the new quote (used to calculate the hash value)
-	 * @param minQty Minimum qty of the new quote (used to calculate the hash value)
+	 * @param id Quote whose info is set (inserted if not active yet)
+	 * @param hashValue Hash value of the new quote (see CalculateHashValue())
 	 * @param args Arguments used to construct a new QuoteInfo struct
-	 * @return Unique pointer to the previous quote info (that was replaced
-	 * by the new one)
+	 * @return The previous quote info (that was replaced by the new one), if any,
+	 * and whether the original key was kept
 	 */
 	template <typename ...Args>
-	std::pair<QuoteInfoPtr, bool> ReplaceQuoteInfo(bool forceKey, const std::string &refId, const std::string &newId, size_t hashValue,
-												   uint64_t sequenceTag, Args &&...args)
+	std::pair<std::optional<QuoteInfo>, bool> ReplaceQuoteInfo(bool forceKey, const QuoteId &id, size_t hashValue,
+															   uint64_t sequenceTag, Args &&...args)
 	{
-		QuoteInfoPtr newQuote { QuoteInfoPtr(new QuoteInfo { std::forward<Args>(args)..., hashValue, int64_t(0), sequenceTag }) };
-		
+		QuoteInfo newQuote { std::forward<Args>(args)..., hashValue, int64_t(0), sequenceTag };
+
 		std::unique_lock lock { m_activeQuoteMap.Mutex() };
-		const auto &it { !refId.empty() ? m_activeQuoteMap->find(refId) : m_activeQuoteMap->end() };
-		
-		const bool skipKey { !forceKey && it != m_activeQuoteMap->end() && it->second->hashValue == hashValue && refId == newId };
-		newQuote->oriKey = skipKey ? it->second->oriKey : newQuote->key;
-		return { ReplaceQuoteInfoAt(it, newId, std::move(newQuote)), skipKey };
+		const QuoteInfo *current { m_activeQuoteMap->Find(id) };
+		const bool skipKey { !forceKey && current && current->hashValue == hashValue };
+		newQuote.oriKey = skipKey ? current->oriKey : newQuote.key;
+		return { ReplaceQuoteInfoAt(id, newQuote), skipKey };
 	}
-	
-	/** Removes a quote info assigned to a reference ID
+
+	/** Removes the quote info of a quote
 	 *
-	 * @param refId ID of the quote to be removed
-	 * @return Unique pointer to the removed quote info
+	 * @param id Quote to be removed
+	 * @return The removed quote info, if the quote was active
 	 */
-	QuoteInfoPtr RemoveQuoteInfo(const std::string &refId);
-	
+	std::optional<QuoteInfo> RemoveQuoteInfo(const QuoteId &id);
+
 	/** Removes all active quotes older than a given key
 	 *
 	 * @param limitKey All quotes older than @a limitKey are removed
-	 * @param action Action to be executed for each reoved quote
+	 * @param action Action to be executed for each removed quote: void action(const QuoteId &id, QuoteInfo &&info)
 	 */
 	template <typename A>
 	void RemoveOldQuoteInfos(int64_t limitKey, A action)
 	{
 		std::unique_lock lock { m_activeQuoteMap.Mutex() };
-		auto it = m_activeQuoteMap->begin();
-		while (it != m_activeQuoteMap->end())
+		std::vector<QuoteId> old;
+		m_activeQuoteMap->ForEach([limitKey, &old](const QuoteId &id, const QuoteInfo &info)
 		{
-			if (it->second->key < limitKey)
+			if (info.key < limitKey)
 			{
-				action(it->first, std::move(it->second));
-				it = m_activeQuoteMap->erase(it);
-			}
-			else
-			{
-				++it;
+				old.push_back(id);
 			}
+		});
+		for (const auto &id: old) // erasing moves elements, so not while iterating
+		{
+			action(id, std::move(*m_activeQuoteMap->Find(id)));
+			m_activeQuoteMap->Erase(id);
 		}
 	}
 
 
 protected:
-	
-	using QuoteMap = std::map<std::string, QuoteInfoPtr>; //!< Type alias for the quote map
-	
-	/** Shared lockable map (ID -> QuoteInfo struct) */
+
+	/** Open-addressing table with the quote infos stored inline: no allocation once it has grown to the number of active levels */
+	using QuoteMap = UTILS::FlatHashMap<QuoteId, QuoteInfo, QuoteId::Hash>; //!< Type alias for the quote map
+
+	/** Shared lockable map (quote -> QuoteInfo struct) */
 	UTILS::SharedLockable<QuoteMap> m_activeQuoteMap;
-	
-	/** Replaces a quote info pointed to by an iterator
+
+	/** Replaces or inserts the quote info of a quote
 	 *
 	 * This function DOES NOT LOCK the quote info map (@a m_activeQuoteMap).
 	 * Locking must be handled by the calling function.
 	 *
-	 * @param it Iterator pointing to the quote info to be replaced. If the
-	 * iterator is not valid, the new quote is inserted with @a emplace.
-	 * @param newId New ID for the quote info
-	 * @param newQuote R-Value reference to the new quote info pointer
-	 * @return Unique pointer to the previous quote info (that was replaced
-	 * with the new one)
+	 * @param id Quote whose info is set
+	 * @param newQuote The new quote info
+	 * @return The previous quote info (that was replaced with the new one), if any
 	 */
-	QuoteInfoPtr ReplaceQuoteInfoAt(QuoteMap::iterator it, const std::string &newId, QuoteInfoPtr &&newQuote);
+	std::optional<QuoteInfo> ReplaceQuoteInfoAt(const QuoteId &id, const QuoteInfo &newQuote);
 };
 
-}
\ No newline at end of file
+}
@@ -19,6 +19,7 @@
 #include "Config.h"
 #include "Crypto.h"
 #include "JSONDocument.h"
+#include "ReceiveRing.h"
 #include "MessageProcessor.h"
 #include "Tools.h"
 #include "CryptoCommon.h"
@@ -54,6 +55,7 @@ public:
 	
 	void Disconnect() override;
 	
+	/*! \brief Publishes the entries of one message to the order book as one change (see BOOK::OrderBook::ApplyBatch()) */
 	void PublishQuotes(UTILS::NormalizedMDData::Ptr nmd);
 	
 	bool IsConnected() const override
@@ -82,6 +84,12 @@ public:
 	/*! \brief Returns a set of instruments from configuration */
 	TInstruments GetInstruments() const;
 	
+	/*! \brief Registers instruments with the order book, so they get their id before the first quote arrives */
+	void RegisterInstruments(const TInstruments &instruments) const;
+	
+	/*! \brief Registers the session as a venue of the order book, so its quotes can be told apart */
+	void RegisterVenue();
+	
 	/*! \brief Returns depth from configuration */
 	unsigned int GetDepth() const
 	{
@@ -92,7 +100,10 @@ public:
 	
 	UTILS::BoolResult UnsubscribeInstrument(const std::string &symbol);
 	
-	UTILS::NormalizedMDData::Ptr ParseQuote(PriceMessage::Levels &levels, const char side, const std::string &instrument);
+	UTILS::NormalizedMDData::Ptr ParseQuote(const PriceMessage::Levels &levels, const char side, const std::string &instrument);
+	
+	/*! \brief Parses the bids and asks of a message into one set of entries (bids first), to be published together */
+	UTILS::NormalizedMDData::Ptr ParseQuotes(const PriceMessage &msg, const std::string &instrument);
 	
 	virtual std::string TranslateSymbol(const std::string &symbol) const
 	{
@@ -104,11 +115,11 @@ public:
 		return symbol;
 	}
 	
+	/*! \brief Registers the venue and starts the instruments from configuration (called by Connect()) */
 	void Start() override
 	{
-		const auto instruments = GetInstruments();
-		Snapshot(instruments);
-		Subscribe(instruments);
+		RegisterVenue();
+		StartInstruments(GetInstruments());
 	}
 	
 	/*! \brief Processing snapshot for each instrument
@@ -123,24 +134,23 @@ public:
 	//------------------------------------------------------------------------------
 	virtual void SideTranslator(const char *side, PriceMessage::Levels &depth, const std::shared_ptr<JSONDocument> jd) const
 	{
-		if (auto levels = jd->GetArray(side))
+		const auto levels = jd->Root()[side];
+		depth.reserve(depth.size() + levels.Size());
+		for (const auto level: levels)
 		{
-			Poco::Dynamic::Array da = *levels;
-			for (size_t i = 0; i < levels->size(); ++i)
-			{
-				depth.emplace_back(std::make_shared<Level>());
-				depth.back()->price = da[i][0].toString();
-				depth.back()->size = da[i][1].toString();
-			}
+			depth.emplace_back(level[0].Text(), level[1].Text());
 		}
 	}
 	
-	//Parse Snapshot or incremental msg..
-	virtual std::unique_ptr<PriceMessage> ParseMessage(const std::shared_ptr<JSONDocument> jd, const std::string &bidName, const std::string &askName) const
+	/*! \brief Parse Snapshot or incremental msg..
+	 *
+	 * The levels are allocated from the arena of @a jd and refer to its text, so they are valid as long as @a jd.
+	 */
+	virtual PriceMessage ParseMessage(const std::shared_ptr<JSONDocument> jd, const std::string &bidName, const std::string &askName) const
 	{
-		auto msg = std::make_unique<PriceMessage>();
-		SideTranslator(bidName.c_str(), msg->Bids, jd);
-		SideTranslator(askName.c_str(), msg->Asks, jd);
+		PriceMessage msg(&jd->GetArena());
+		SideTranslator(bidName.c_str(), msg.Bids, jd);
+		SideTranslator(askName.c_str(), msg.Asks, jd);
 		return msg;
 	}
 
@@ -171,6 +181,31 @@ protected:
 	UTILS::BoolResult PublishQuote(int64_t key, int64_t refKey, int64_t timestamp,
 															 int64_t receiveTime, UTILS::CurrencyPair cp, const UTILS::NormalizedMDData::Entry &entry);
 	
+	/*! \brief Records the last update id of the feed whose quotes have been published (saved with the order book) */
+	void SetUpdateId(UTILS::CurrencyPair cp, int64_t updateId) const;
+	
+	/*! \brief Takes over the quotes of the session in the order book, e.g. restored from a snapshot file (see BOOK::OrderBook::ClaimRestoredQuotes())
+	* @param cp: currency pair
+	* @return: update id the quotes are current to (0 -> no quotes or no update id)
+	* */
+	int64_t RestoreQuotes(UTILS::CurrencyPair cp);
+	
+	/*! \brief Removes all quotes of the session for an instrument from the order book (e.g. before a new snapshot is applied) */
+	void RemoveQuotes(UTILS::CurrencyPair cp);
+	
+	/*! \brief Registers instruments, prepares them, subscribes them and requests their snapshots */
+	void StartInstruments(const TInstruments &instruments);
+	
+	/*! \brief Resubscribes all instruments, so their books are rebuilt (e.g. after a message had to be dropped) */
+	void Resubscribe();
+	
+	/*! \brief Sets up the state of instruments before they are subscribed
+	* Runs on the message processor thread, so it may use the state the message handlers use.
+	* By default the quotes the session has in the order book (e.g. restored from a snapshot file) are removed.
+	* @param instruments: set of instruments
+	* */
+	virtual void PrepareInstruments(const TInstruments &instruments);
+	
 	Settings m_settings;
 	Logger m_logger; //Session logger..
 private:
@@ -183,16 +218,26 @@ private:
 	/*! \brief Flag indicating that connection is connected or disconnected */
 	std::atomic<bool> m_connected { false };
 	
+	/*! \brief Venue id of the session in the order book (0 -> not registered) */
+	std::atomic<int> m_venue { 0 };
+	
 	/*! \brief Last received message time (in ns). Used to track inactivity */
 	std::atomic<int64_t> m_lastMessageTime { 0 };
 	
 	/*! \brief Hash to make quicker search the currency pairs by symbols */
 	UTILS::CurrencyPairHash m_cpHash;
 	
+	/*! \brief Appends the entries of the levels of one side to @a nmd */
+	void AppendQuotes(UTILS::NormalizedMDData &nmd, const PriceMessage::Levels &levels, const char side, UTILS::CurrencyPair cp);
+	
 	using MessageQueue = std::queue<std::shared_ptr<JSONDocument>>;
 	MessageQueue m_messageQueue;
 	
-	char m_buffer[MAX_BUFF] { };
+	/*! \brief Receive buffers of the listener thread (declared before the message processor: queued documents refer to them) */
+	ReceiveRing m_receiveRing { ReceiveRing::DFLT_SLOTS, MAX_BUFF };
+	
+	/*! \brief Receive buffer used while all slots of the ring are in use (allocated on first use) */
+	std::unique_ptr<char[]> m_spareBuffer;
 
 	std::unique_ptr<std::thread> m_listenerThread;
 	
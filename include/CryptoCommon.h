@@ -4,26 +4,40 @@
 //
 #pragma once
 
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
 #include "JSONDocument.h"
 
 namespace CORE {
 namespace CRYPTO {
+/*! \brief Level of a price message: views of its price and size text
+ *
+ * The views refer to the message (or to whatever the level was built from),
+ * so a level is only valid as long as its message.
+ */
 struct Level
 {
 	Level() { }
 	
-	Level(std::string &p, std::string &s)
+	Level(std::string_view p, std::string_view s)
 			: price(p), size(s) { }
 	
-	std::string price;
-	std::string size;
+	std::string_view price;
+	std::string_view size;
 };
 
 // Price msg, can be snapshot or incremental update
 class PriceMessage
 {
 public:
-	using Levels = std::vector<std::shared_ptr<Level>>;
+	using Levels = std::pmr::vector<Level>;
+	
+	/*! \brief Levels allocated from @a resource, e.g. the arena of the JSON document they are read from */
+	explicit PriceMessage(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+			: Bids(resource), Asks(resource) { }
+	
 	Levels Bids;
 	Levels Asks;
 };
@@ -5,13 +5,19 @@
 #pragma once
 
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <Poco/JSON/JSON.h>
+#include <Poco/JSON/JSONException.h>
 #include <Poco/JSON/Object.h>
 #include <Poco/JSON/Parser.h>
 #include <Poco/Dynamic/Var.h>
+#include <Utils/Arena.h>
 #include <Utils/Result.h>
 
+#include "JsonView.h"
+
 namespace CORE {
 namespace CRYPTO {
 
@@ -28,48 +34,128 @@ struct JSONError
 	long code;
 };
 
+/*! \brief JSON message
+ *
+ * The text is indexed on construction (see JsonIndex) and read through
+ * Root() without building a DOM, which is what the market data handlers use.
+ * The Poco DOM behind GetValue(), GetArray(), GetSubObject() and
+ * GetJsonObject() is only built the first time one of them is called.
+ *
+ * A document either owns its text or, after Reset(), refers to a buffer
+ * owned by someone else (see ReceiveRing), which lets a receive buffer be
+ * indexed without copying and the document be reused for the next frame.
+ *
+ * What the handlers build from a message (levels, normalized entries) is
+ * allocated from the arena of the document, which is released at once when
+ * the document is reused or destroyed.
+ *
+ * The constructor throws Poco::JSON::JSONException if the text is not valid JSON.
+ */
 class JSONDocument
 {
 public:
-	explicit JSONDocument(const std::string &document)
+	explicit JSONDocument(std::string document)
+			: m_document(std::move(document))
+	{
+		Index(m_document);
+	}
+	
+	/*! \brief Empty document, to be filled by Reset() */
+	JSONDocument() = default;
+	
+	/*! \brief The index refers to the text, so the document can be neither copied nor moved */
+	JSONDocument(const JSONDocument &) = delete;
+	
+	JSONDocument &operator=(const JSONDocument &) = delete;
+	
+	/*! \brief Root value, read straight from the text */
+	JsonValue Root() const
+	{
+		return m_index.Root();
+	}
+	
+	/*! \brief Text of the document */
+	std::string_view Text() const
 	{
-		m_parser.parse(document);
-		auto result = m_parser.result();
-		m_jsonObject = result.extract<Poco::JSON::Object::Ptr>();
+		return m_text;
+	}
+	
+	/*! \brief Arena for the data built from this message (see class description) */
+	UTILS::Arena &GetArena() const
+	{
+		return m_arena;
+	}
+	
+	/*! \brief Replaces the document by @a text, which is indexed in place (not copied)
+	 *
+	 * @a text must stay unchanged while the document is used. Not thread-safe:
+	 * nobody else may use the document meanwhile. Throws Poco::JSON::JSONException
+	 * if the text is not valid JSON. The arena is reset.
+	 */
+	void Reset(std::string_view text)
+	{
+		m_document.clear();
+		m_arena.Reset();
+		{
+			std::lock_guard lock { m_domMtx };
+			m_jsonObject = nullptr;
+		}
+		Index(text);
 	}
 	
 	template <typename T>
 	T GetValue(const std::string &name) const
 	{
-		Poco::Dynamic::Var var = m_jsonObject->get(name); // Get the member Variable
+		Poco::Dynamic::Var var = GetJsonObject()->get(name); // Get the member Variable
 		return var.isEmpty() ? T() : var.convert<T>();
 	}
 	
 	Poco::JSON::Array::Ptr GetArray(const std::string &name) const
 	{
-		return m_jsonObject->getArray(name); // Get the member Variable;
+		return GetJsonObject()->getArray(name); // Get the member Variable;
 	}
 	
 	/*! \brief returns subobject by name */
 	Poco::JSON::Object::Ptr GetSubObject(const std::string &name) const
 	{
-		return m_jsonObject->get(name).extract<Poco::JSON::Object::Ptr>();
+		return GetJsonObject()->get(name).extract<Poco::JSON::Object::Ptr>();
 	}
 	
 	/*! \brief returns true if field exists */
 	bool Has(const std::string &name) const
 	{
-		return m_jsonObject->has(name);
+		return Root().Has(name);
 	}
 	
+	/*! \brief Returns the Poco DOM of the document (built on the first call) */
 	Poco::JSON::Object::Ptr GetJsonObject() const
 	{
+		std::lock_guard lock { m_domMtx };
+		if (!m_jsonObject)
+		{
+			Poco::JSON::Parser parser;
+			m_jsonObject = parser.parse(std::string(m_text)).extract<Poco::JSON::Object::Ptr>();
+		}
 		return m_jsonObject;
 	}
 
 private:
-	Poco::JSON::Parser m_parser;
-	Poco::JSON::Object::Ptr m_jsonObject;
+	std::string m_document; //!< owned text (empty if the text is owned by someone else)
+	std::string_view m_text; //!< indexed text
+	JsonIndex m_index;
+	mutable UTILS::Arena m_arena;
+	mutable std::mutex m_domMtx;
+	mutable Poco::JSON::Object::Ptr m_jsonObject;
+	
+	void Index(std::string_view text)
+	{
+		m_text = text;
+		const auto result = m_index.Parse(m_text);
+		if (!result)
+		{
+			throw Poco::JSON::JSONException(result.ErrorMessage());
+		}
+	}
 };
 
 
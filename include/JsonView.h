@@ -0,0 +1,194 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Utils/Result.h>
+
+namespace CORE {
+namespace CRYPTO {
+
+/*! \brief Kind of a JSON value */
+enum class JsonType : uint8_t
+{
+	Invalid, //!< missing member, element out of range or wrong kind of parent
+	Null,
+	False,
+	True,
+	Number,
+	String,
+	Array,
+	Object
+};
+
+class JsonIndex;
+
+/*! \brief Read-only view of a value of an indexed JSON document
+ *
+ * A value is an index into the tape of its JsonIndex, so it is as cheap to
+ * copy as a pointer. Scalars are returned as views of the document text; a
+ * missing member or element yields an invalid value, whose accessors return
+ * empty results, so lookups can be chained without checks:
+ * @code jd->Root()["data"][0]["checksum"].GetInt64() @endcode
+ */
+class JsonValue
+{
+public:
+	JsonValue() = default;
+
+	JsonType Type() const;
+
+	bool Valid() const { return m_index != nullptr; }
+
+	explicit operator bool() const { return Valid(); }
+
+	bool IsNull() const { return Type() == JsonType::Null; }
+
+	bool IsBool() const { return Type() == JsonType::True || Type() == JsonType::False; }
+
+	bool IsNumber() const { return Type() == JsonType::Number; }
+
+	bool IsString() const { return Type() == JsonType::String; }
+
+	bool IsArray() const { return Type() == JsonType::Array; }
+
+	bool IsObject() const { return Type() == JsonType::Object; }
+
+	/*! \brief Text of the value in the document.
+	 *
+	 * Strings without the quotes and with their escape sequences as they are,
+	 * other values as written (arrays and objects including their brackets).
+	 * Empty for an invalid value.
+	 */
+	std::string_view Text() const;
+
+	/*! \brief Value as string: strings with their escape sequences decoded, numbers and literals as written,
+	 * empty for null and invalid values (like Poco::Dynamic::Var::toString()). */
+	std::string ToString() const;
+
+	/*! \brief Integer value of a number or of a string holding a number (std::nullopt if there is none). */
+	std::optional<int64_t> Int64() const;
+
+	/*! \brief Integer value of a number or of a string holding a number (@a dflt if there is none). */
+	int64_t GetInt64(int64_t dflt = 0) const { return Int64().value_or(dflt); }
+
+	/*! \brief Floating point value of a number or of a string holding a number (std::nullopt if there is none). */
+	std::optional<double> Double() const;
+
+	/*! \brief Number of elements of an array or members of an object (0 for other values). */
+	size_t Size() const;
+
+	/*! \brief Member of an object (invalid if missing or if this is not an object). */
+	JsonValue operator[](std::string_view name) const;
+
+	/*! \brief Element of an array (invalid if out of range or if this is not an array); O(idx). */
+	JsonValue operator[](size_t idx) const;
+
+	/*! \brief Does an object have a member of this name? */
+	bool Has(std::string_view name) const { return (*this)[name].Valid(); }
+
+	/*! \brief Forward iterator over the elements of an array or the member values of an object */
+	class Iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = JsonValue;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const JsonValue *;
+		using reference = JsonValue;
+
+		Iterator(const JsonIndex *index, uint32_t node, bool object)
+				: m_index(index), m_node(node), m_object(object) { }
+
+		JsonValue operator*() const { return JsonValue(m_index, m_object ? m_node + 1 : m_node); }
+
+		/*! \brief Name of the member (objects only). */
+		std::string_view Name() const;
+
+		Iterator &operator++();
+
+		bool operator==(const Iterator &other) const { return m_node == other.m_node; }
+
+		bool operator!=(const Iterator &other) const { return m_node != other.m_node; }
+
+	private:
+		const JsonIndex *m_index;
+		uint32_t m_node; //!< element (arrays) or member name (objects)
+		bool m_object;
+	};
+
+	/*! \brief First element or member (begin() == end() for values other than arrays and objects). */
+	Iterator begin() const;
+
+	Iterator end() const;
+
+private:
+	friend class JsonIndex;
+
+	JsonValue(const JsonIndex *index, uint32_t node)
+			: m_index(index), m_node(node) { }
+
+	const JsonIndex *m_index { nullptr };
+	uint32_t m_node { 0 };
+};
+
+/*! \brief Structural index of a JSON document, read on demand through JsonValue views
+ *
+ * Parse() makes a single pass over the text and records each value as a
+ * fixed-size node of a flat tape (kind, position of its text, and the node
+ * following it, so a lookup skips over whole arrays and objects). No value is
+ * converted and nothing is copied out of the text; fields are converted only
+ * when they are read. Quoted contents, which make up most of a market data
+ * message, are scanned 16 bytes at a time where SSE2 is available.
+ *
+ * The text is not copied: it must stay unchanged while the index is used.
+ * The tape is kept between calls of Parse(), so an index reused for many
+ * messages does not allocate once it has grown to the largest message.
+ */
+class JsonIndex
+{
+public:
+	/*! \brief Maximum nesting of arrays and objects */
+	static constexpr size_t MAX_DEPTH { 64 };
+
+	/*! \brief Indexes a document (the previous one is discarded).
+	 *
+	 * @return @a true if the text is one complete JSON value (numbers as defined by RFC 8259), error otherwise
+	 */
+	UTILS::BoolResult Parse(std::string_view json);
+
+	/*! \brief Root value (invalid if nothing has been parsed successfully). */
+	JsonValue Root() const { return m_nodes.empty() ? JsonValue() : JsonValue(this, 0); }
+
+	/*! \brief Text of the indexed document */
+	std::string_view Document() const { return m_json; }
+
+private:
+	friend class JsonValue;
+
+	struct Node
+	{
+		JsonType type;
+		bool escaped; //!< string containing escape sequences
+		uint32_t start; //!< offset of the text (strings: after the opening quote)
+		uint32_t length; //!< length of the text (strings: without the quotes)
+		uint32_t next; //!< node following the value including its elements or members
+		uint32_t count; //!< elements of an array or members of an object
+	};
+
+	std::string_view m_json;
+	std::vector<Node> m_nodes;
+
+	const Node &node(uint32_t idx) const { return m_nodes[idx]; }
+};
+
+}
+}
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <memory>
+#include <string_view>
 
 #include "Poco/Logger.h"
 #include "Poco/FileChannel.h"
@@ -83,9 +84,12 @@ public:
 		m_logger.setChannel(pfc);
 	}
 	
-	void Incoming(const std::string &msg) const
+	void Incoming(std::string_view msg) const
 	{
-		m_logger.information("\"in\":%s", msg);
+		if (m_logger.information()) // the message is only copied if it is logged
+		{
+			m_logger.information("\"in\":%s", std::string(msg));
+		}
 	}
 	
 	void Outging(const std::string &msg) const
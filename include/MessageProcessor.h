@@ -3,9 +3,15 @@
 #include "Utils/Logging.h"
 #include "Utils/ErrorHandler.h"
 #include "Utils/Result.h"
-#include "Utils/BackgroundWorker.hpp"
+#include "Utils/MpscQueue.h"
 #include "IConnection.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "JSONDocument.h"
 
 namespace CORE {
@@ -37,8 +43,9 @@ public:
 	UTILS::BoolResult Register(const std::string &msgType, const TMessageHandler handler);
 	
 	/*! \brief This method should be called to process incoming messages
+	* If the queue is full, the caller (i.e. the listener thread) waits up to MAX_QUEUE_WAIT for the processor to make room.
 	* @param message: JSON document
-	* @return: true in success, error in error case
+	* @return: true in success, error if the message is not supported or had to be dropped (see DroppedCount())
 	* */
 	UTILS::BoolResult ProcessMessage(const std::shared_ptr<JSONDocument> message);
 	
@@ -51,6 +58,12 @@ public:
 	/*! \brief Returns a number of registered message handlers */
 	size_t Size() const;
 	
+	/*! \brief Returns the number of messages dropped so far because the queue was full */
+	uint64_t DroppedCount() const
+	{
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+	
 	/*! \brief Starts message processor. It must be started before processing any messages */
 	void Start();
 	
@@ -61,12 +74,45 @@ public:
 	* This is convenient when caller knows the handler and wants process message directly in the queue
 	* @param message: JSON document
 	* @param handler: message handler
-	* @return: true in success, error if message or handler is nullptr
+	* @return: true in success, error if message or handler is nullptr, the processor is not running or the queue is full
 	* */
 	UTILS::BoolResult Enqueue(const std::shared_ptr<JSONDocument> message, const TMessageHandler handler);
+	
+	/*! \brief Runs a task on the processor thread, after the messages queued before, and waits for it
+	* State owned by the processor thread (e.g. the sync state of the instruments) is set up this way.
+	* The task runs directly if the processor is not running or this is called on the processor thread.
+	* @param task: task
+	* @return: true in success, error if the processor stopped before the task ran
+	* */
+	UTILS::BoolResult Run(const std::function<void()> &task);
 
 private:
-	UTILS::BackgroundWorker<const std::shared_ptr<JSONDocument>, TMessageHandler> m_messageQueue;
+	/*! \brief Maximum number of queued messages */
+	static constexpr size_t MAX_QUEUED_MESSAGES { 16384 };
+	
+	/*! \brief Maximum time ProcessMessage() waits for room in a full queue before the message is dropped */
+	static constexpr std::chrono::milliseconds MAX_QUEUE_WAIT { 1000 };
+	
+	struct Item
+	{
+		std::shared_ptr<JSONDocument> message;
+		TMessageHandler handler;
+	};
+	
+	// preallocated queue, so queuing a message does not allocate
+	UTILS::MpscQueue<Item> m_messageQueue { MAX_QUEUED_MESSAGES };
+	std::thread m_thread;
+	std::atomic_bool m_running { false };
+	std::atomic_bool m_sleeping { false };
+	std::mutex m_wakeMtx;
+	std::condition_variable m_wakeCond;
+	std::atomic<uint64_t> m_dropped { 0 };
+	
+	void Loop();
+	
+	/*! \brief Enqueues an item, waiting for room in a full queue until @a deadline, and wakes up the processor thread */
+	UTILS::BoolResult Push(Item &item, std::chrono::steady_clock::time_point deadline);
+	
 	using TMessageHandlers = std::unordered_map<std::string, std::function<void(const std::shared_ptr<JSONDocument>)>>;
 	TMessageHandlers m_messageHandlers;
 	TMessageTypeDetector m_messageTypeDetector;
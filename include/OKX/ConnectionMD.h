@@ -1,5 +1,11 @@
 #pragma once
 
+#include <array>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
 #include "ConnectionBase.h"
 #include "OKX/Definitions.h"
 
@@ -41,7 +47,66 @@ namespace OKX {
 
         void Subscribe(const CRYPTO::ConnectionBase::TInstruments& instruments, const std::string& method);
 
+		/*! \brief Removes the quotes of the session and the level books of instruments (message processor thread) */
+		void PrepareInstruments(const CRYPTO::ConnectionBase::TInstruments &instruments) override;
+
 		void SideTranslator(const char *side, CRYPTO::PriceMessage::Levels &depth, const std::shared_ptr<CRYPTO::JSONDocument> jd) const override;
+	
+	private:
+		/*! \brief Level kept in a level book (copies its text into a buffer of its own, unlike the levels of a message) */
+		struct BookLevel
+		{
+			static constexpr size_t TEXT_SIZE { 64 }; //!< price and size text
+			
+			int64_t cpipPrice { 0 }; //!< sort key
+			std::array<char, TEXT_SIZE> text { };
+			uint8_t priceLength { 0 };
+			uint8_t sizeLength { 0 };
+			
+			std::string_view Price() const { return { text.data(), priceLength }; }
+			
+			std::string_view Size() const { return { text.data() + priceLength, sizeLength }; }
+			
+			/*! \brief Copies the text of a level (false if it does not fit) */
+			bool SetText(std::string_view price, std::string_view size)
+			{
+				if (price.size() + size.size() > TEXT_SIZE)
+				{
+					return false;
+				}
+				std::memcpy(text.data(), price.data(), price.size());
+				std::memcpy(text.data() + price.size(), size.data(), size.size());
+				priceLength = uint8_t(price.size());
+				sizeLength = uint8_t(size.size());
+				return true;
+			}
+		};
+		
+		/*! \brief Levels of one instrument as sent by OKX (price and size strings), used to verify the checksums
+		* The levels are sorted best first; the vectors keep their capacity, so updating a level does not allocate.
+		* */
+		struct LevelBook
+		{
+			std::vector<BookLevel> bids;
+			std::vector<BookLevel> asks;
+			bool resyncing { false }; //!< resubscribed, updates are dropped until the new snapshot arrives
+		};
+		
+		std::unordered_map<std::string, LevelBook> m_levelBooks; //!< OKX instId -> levels (message processor thread only)
+		
+		/*! \brief Applies a snapshot or update to the levels of an instrument and publishes it
+		* @param instId: OKX instrument id
+		* @param update: levels of the message
+		* @param jd: json document (carries the checksum)
+		* @return: false if the checksum does not match or a level cannot be kept
+		* */
+		bool ApplyLevels(const std::string &instId, const CRYPTO::PriceMessage &update, const std::shared_ptr<CRYPTO::JSONDocument> jd);
+		
+		/*! \brief Removes the levels of one instrument from the order book and from its level book */
+		void ClearLevels(const std::string &instId, LevelBook &book);
+		
+		/*! \brief Clears one instrument and resubscribes it to get a new snapshot (the others keep streaming) */
+		void Resync(const std::string &instId);
     };
 	
 } // ns OKX
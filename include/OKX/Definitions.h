@@ -16,6 +16,9 @@ const std::string MSGTYPE_Update       = "update";
 const std::string MSGTYPE_Subscribe    = "subscribe";
 const std::string MSGTYPE_Unsubscribe    = "unsubscribe";
 
+// Number of levels per side covered by the checksum of the 'books' channel
+const size_t CHECKSUM_DEPTH = 25;
+
 // Parameters attributes
 const std::string PARAM_ATTR_Passphrase        = "passphrase";
 const std::string PARAM_ATTR_SimulatedTrading  = "x-simulated-trading";
@@ -0,0 +1,79 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "JSONDocument.h"
+
+namespace CORE {
+namespace CRYPTO {
+
+/*! \brief Preallocated receive buffers of a websocket listener
+ *
+ * Frames are received straight into a slot and indexed in place by the
+ * slot's JSONDocument, so neither the text nor the document is copied or
+ * allocated per frame. The listener hands the slot's document (a copy of its
+ * shared pointer) to the message processor; the slot is free again as soon as
+ * the handler, and whoever else kept the document (e.g. diffs buffered until
+ * a snapshot arrives), has released it.
+ *
+ * Acquire() and Commit() must be called by one thread (the listener); the
+ * documents may be released on any thread.
+ */
+class ReceiveRing
+{
+public:
+	/*! \brief Default number of slots */
+	static constexpr size_t DFLT_SLOTS { 32 };
+
+	/*!
+	 * @param slots: number of slots
+	 * @param slotSize: maximum size of a frame
+	 */
+	ReceiveRing(size_t slots, size_t slotSize);
+
+	ReceiveRing(const ReceiveRing &) = delete;
+
+	ReceiveRing &operator=(const ReceiveRing &) = delete;
+
+	/*! \brief Returns a free slot, searching from the one after the slot used last
+	 * @return slot index, std::nullopt if all documents are still in use
+	 */
+	std::optional<size_t> Acquire();
+
+	/*! \brief Receive buffer of a slot (SlotSize() bytes) */
+	char *Buffer(size_t slot) { return m_slots[slot].buffer.get(); }
+
+	size_t SlotSize() const { return m_slotSize; }
+
+	size_t Slots() const { return m_slots.size(); }
+
+	/*! \brief Indexes the frame received into a slot and returns its document
+	 *
+	 * The slot stays in use until the returned document and all its copies are released.
+	 * Throws Poco::JSON::JSONException if the frame is not valid JSON (the slot stays free).
+	 * @param slot: slot returned by Acquire()
+	 * @param bytes: size of the frame
+	 */
+	std::shared_ptr<JSONDocument> Commit(size_t slot, size_t bytes);
+
+private:
+	struct Slot
+	{
+		std::unique_ptr<char[]> buffer;
+		std::shared_ptr<JSONDocument> document; //!< the slot is free while this is the only reference
+	};
+
+	const size_t m_slotSize;
+	std::vector<Slot> m_slots;
+	size_t m_next { 0 }; //!< slot to be tried first
+};
+
+}
+}
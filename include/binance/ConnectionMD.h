@@ -4,6 +4,7 @@
 #include "ConnectionBase.h"
 #include "JSONDocument.h"
 #include "binance/ConnectionSS.h"
+#include "Utils/Timer.h"
 
 namespace CORE {
 namespace BINANCE {
@@ -12,6 +13,9 @@ namespace BINANCE {
 const std::string MSGTYPE_DepthUpdate = "depthUpdate";
 const std::string MSGTYPE_DepthNUpdate = "depthNUpdate"; // the top 'n' depth
 
+const size_t SNAPSHOT_FETCH_THREADS = 4; // snapshots fetched in parallel
+const std::chrono::seconds SNAPSHOT_RETRY_DELAY { 1 }; // delay before a failed snapshot is fetched again
+
 ////////////////////////////////////////////////////////////////////////////
 /*! \brief Binance connection class */
 ////////////////////////////////////////////////////////////////////////////
@@ -42,7 +46,22 @@ public:
 	}
 
 protected:
-	int64_t m_lastUpdateId;
+	/*! \brief Synchronisation state of the book of one instrument with the diff stream */
+	enum class SyncState
+	{
+		Buffering,       //!< diffs are buffered until the snapshot has been fetched
+		SnapshotApplied, //!< snapshot (or restored book) applied, waiting for the first diff following it
+		Live,            //!< diffs are applied in sequence
+		Resyncing        //!< a gap was detected: diffs are buffered until a new snapshot has been fetched
+	};
+	
+	struct InstrumentSync
+	{
+		SyncState state { SyncState::Buffering };
+		int64_t lastUpdateId { 0 }; //!< last update id applied to the book
+		std::deque<std::shared_ptr<CRYPTO::JSONDocument>> buffered; //!< diffs received while (re)synchronising
+	};
+	
 	std::unique_ptr<CORE::BINANCE::ConnectionSS> m_connectionSS; //REST Connector for Snapshot.
 	
 	/*! \brief called when Result message received
@@ -59,20 +78,29 @@ protected:
 	* */
 	virtual void OnMsgError(const int errCode, const std::string &errMsg, const UTILS::BoolResult &res);
 	
-	 void Start() override
-	{
-		const auto instruments = GetInstruments();
-		Subscribe(instruments); //Binance we need to subscribe to stream and enqueue msgs until Snapshot is completed..
-		Snapshot(instruments);
-	}
-	
+	/*! \brief Requests the snapshots of all instruments not restored from the order book (does not wait for them) */
 	void Snapshot(const CRYPTO::ConnectionBase::TInstruments &instruments) override;
 	
+	/*! \brief Creates the sync states, restoring the books saved with the order book (message processor thread)
+	* The stream is subscribed afterwards; its diffs are buffered until the snapshot is applied.
+	* */
+	void PrepareInstruments(const CRYPTO::ConnectionBase::TInstruments &instruments) override;
+	
 	/*! \brief subscribe/unsubscribe helper
 	* @param instruments: list of instruments separated by comma
 	* @param method: SUBSCRIBE or UNSUBSCRIBE
 	* */
 	void Subscribe(const CRYPTO::ConnectionBase::TInstruments &instruments, const std::string &method, unsigned int levels = 0);
+	
+	/*! \brief Fetches the snapshot of an instrument on a fetcher thread and hands it to the message processor
+	* Virtual, so the tests can record the requests and hand in the snapshots themselves.
+	* @param instrument: instrument (exchange symbol)
+	* @param delay: delay before the request is sent
+	* */
+	virtual void FetchSnapshot(const std::string &instrument, std::chrono::nanoseconds delay = std::chrono::nanoseconds::zero());
+	
+	/*! \brief Applies a fetched snapshot and replays the diffs buffered meanwhile (message processor thread) */
+	void OnSnapshot(const std::string &instrument, const std::shared_ptr<CRYPTO::JSONDocument> jd);
 
 private:
 	void DepthUpdate(const std::shared_ptr<CRYPTO::JSONDocument> jd);
@@ -80,8 +108,11 @@ private:
 	//Parse Incremental update of 'n' diff depth...
 	void DepthNUpdate(const std::shared_ptr<CRYPTO::JSONDocument> jd);
 	
-	std::unordered_map<UTILS::CurrencyPair, bool> m_snapshot;
-	std::deque<std::shared_ptr<CRYPTO::JSONDocument>> m_messages;
+	/*! \brief Handles a gap in the diffs of an instrument: buffers @a jd and fetches a new snapshot (message processor thread) */
+	void Resync(const std::string &instrument, InstrumentSync &sync, const std::shared_ptr<CRYPTO::JSONDocument> jd);
+	
+	std::unordered_map<std::string, InstrumentSync> m_sync; //!< exchange symbol -> sync state
+	UTILS::Timer m_snapshotFetcher; //!< runs the snapshot requests, so a slow one does not hold up the others
 };
 
 } // ns BINANCE
@@ -3,42 +3,42 @@
 #include "JSONDocument.h"
 #include <algorithm>
 #include <memory>
+#include <memory_resource>
+#include <string_view>
 
 namespace CORE {
 namespace COINBASE {
+    /*! \brief Change of an L2 update: views of the message text */
     struct change
     {
-        using Ptr = std::shared_ptr<change>;
-        std::string side;
-        std::string price;
-        std::string size;
+        std::string_view side;
+        std::string_view price;
+        std::string_view size;
     };
 
     class L2Update
     {
     public:
-        L2Update(const std::shared_ptr<CRYPTO::JSONDocument> msg) : m_json(msg)
+        // the changes are allocated from the arena of the message and refer to its text (kept by m_json)
+        L2Update(const std::shared_ptr<CRYPTO::JSONDocument> msg) : m_changes(&msg->GetArena()), m_json(msg)
         {
-            auto changes = m_json->GetArray("changes");
-            Poco::Dynamic::Array da = *changes;
+            const auto changes = m_json->Root()["changes"];
+            m_changes.reserve(changes.Size());
 
-            for (size_t i=0; i < changes->size(); i++)
+            for (const auto item: changes)
             {
-                m_changes.emplace_back(std::make_shared<COINBASE::change>());
-                m_changes.back()->side = da[i][0].toString();
-                m_changes.back()->price= da[i][1].toString();
-                m_changes.back()->size = da[i][2].toString();
+                m_changes.push_back({ item[0].Text(), item[1].Text(), item[2].Text() });
             }
             //Note we are reading the changes only, non need to read the full book...
         }
 
-        const std::vector<change::Ptr>& GetChanges() const
+        const std::pmr::vector<change>& GetChanges() const
         {
             return m_changes;
         }
 
     private:
-        std::vector<change::Ptr> m_changes;
+        std::pmr::vector<change> m_changes;
         const std::shared_ptr<CRYPTO::JSONDocument> m_json;
     };
 } // ns COINBASE
@@ -0,0 +1,144 @@
+//
+// Created by james on 16/10/2026.
+//
+// Compares the PriceLadder against the sorted quote vector the order book used
+// before (one side, replace/delete/insert mix skewed towards the top of the
+// book, like exchange depth updates).
+//
+// Usage: bench_ladder [operations]
+//
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cstdlib>
+
+#include "OrderBook/PriceLadder.h"
+
+using namespace CORE::BOOK;
+
+namespace {
+
+/*! \brief One side of the previous order book implementation (sorted vector, linear search) */
+class VectorSide
+{
+public:
+	explicit VectorSide(bool bid)
+			: m_bid(bid) { }
+
+	void Insert(const Quote &quote)
+	{
+		m_quotes.insert(std::find_if(m_quotes.begin(), m_quotes.end(), [this, &quote](const Quote &q)
+		{
+			if (quote.Price() != q.Price())
+			{
+				return m_bid ? quote.Price() > q.Price() : quote.Price() < q.Price();
+			}
+			return quote.Volume() >= q.Volume();
+		}), quote);
+	}
+
+	std::optional<Quote> Remove(int64_t key)
+	{
+		const auto it { std::find_if(m_quotes.begin(), m_quotes.end(), [key](const Quote &q) { return q.Key() == key; }) };
+		if (it == m_quotes.end())
+		{
+			return std::nullopt;
+		}
+		const Quote result { *it };
+		m_quotes.erase(it);
+		return result;
+	}
+
+	int64_t BestPrice() const { return m_quotes.empty() ? 0 : m_quotes.front().Price(); }
+
+private:
+	bool m_bid;
+	std::vector<Quote> m_quotes;
+};
+
+int64_t BestPrice(const PriceLadder &ladder)
+{
+	const PriceLadder::Level *level { ladder.BestLevel() };
+	return level ? level->price : 0;
+}
+
+int64_t BestPrice(const VectorSide &side)
+{
+	return side.BestPrice();
+}
+
+Quote MakeQuote(int64_t price, int64_t volume, int64_t key)
+{
+	return Quote(QuoteHandle(), price, volume, 0, key, 0, 0, 0, 0);
+}
+
+/*! \brief Pre-generated operation (the quotes are created before the timed loop) */
+struct Operation
+{
+	size_t level; //!< level (distance from the touch, in ticks) to replace
+	Quote quote; //!< replacement quote
+};
+
+template <typename S>
+double Run(size_t depth, const std::vector<Operation> &ops, int64_t &checksum)
+{
+	constexpr int64_t touch { 6'500'000'000 }; // 65000.00 in cpips
+	constexpr int64_t tick { 100 };
+	S side { true };
+	std::vector<int64_t> keys(depth);
+	for (size_t i { 0 }; i < depth; ++i)
+	{
+		keys[i] = int64_t(i + 1);
+		side.Insert(MakeQuote(touch - int64_t(i) * tick, 100'000'000, keys[i]));
+	}
+	const auto start { std::chrono::steady_clock::now() };
+	for (const Operation &op: ops)
+	{
+		side.Remove(keys[op.level]);
+		side.Insert(op.quote);
+		keys[op.level] = op.quote.Key();
+		checksum += BestPrice(side);
+	}
+	const auto stop { std::chrono::steady_clock::now() };
+	return double(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()) / double(ops.size());
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const size_t count { argc > 1 ? size_t(std::strtoull(argv[1], nullptr, 10)) : 200'000 };
+
+	std::cout << std::setw(8) << "depth" << std::setw(16) << "vector ns/op" << std::setw(16) << "ladder ns/op"
+			  << std::setw(10) << "speedup" << std::endl;
+	for (size_t depth: { 10, 1000, 5000 })
+	{
+		// updates are concentrated near the touch (geometric distribution over the levels)
+		std::mt19937_64 rng { depth };
+		std::geometric_distribution<size_t> levelDist { depth > 10 ? 0.02 : 0.3 };
+		std::uniform_int_distribution<int64_t> volumeDist { 1, 1'000'000'000 };
+		std::vector<Operation> ops;
+		ops.reserve(count);
+		int64_t key { int64_t(depth) + 1 };
+		for (size_t i { 0 }; i < count; ++i)
+		{
+			const size_t level { std::min(levelDist(rng), depth - 1) };
+			ops.push_back({ level, MakeQuote(6'500'000'000 - int64_t(level) * 100, volumeDist(rng), key++) });
+		}
+
+		int64_t vectorChecksum { 0 };
+		int64_t ladderChecksum { 0 };
+		const double vectorNs { Run<VectorSide>(depth, ops, vectorChecksum) };
+		const double ladderNs { Run<PriceLadder>(depth, ops, ladderChecksum) };
+		if (vectorChecksum != ladderChecksum)
+		{
+			std::cerr << "checksum mismatch at depth " << depth << std::endl;
+			return 1;
+		}
+		std::cout << std::setw(8) << depth << std::setw(16) << std::fixed << std::setprecision(1) << vectorNs
+				  << std::setw(16) << ladderNs << std::setw(9) << vectorNs / ladderNs << "x" << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,528 @@
+//
+// Created by james on 16/10/2026.
+//
+// Benchmarks the OrderBook API with synthetic Binance-like depth updates
+// (level updates concentrated near the touch; a level is replaced while it
+// exists and deleted now and then, an empty level is filled again).
+//
+// Update runs replay the updates through AddEntry() from one feed thread per
+// shard while reader threads poll GetBestPrices(), for several depths,
+// instrument counts and thread counts. Query runs time GetBestPrices(),
+// GetDepth(n), the depth queries (GetAvgPriceForVolume(), GetPriceForVolume(),
+// GetVolumeWithinBps()), the deprecated GetLevels(n) and IterateQuoteGroups(),
+// and BookView::AggregateLevel() on a book that is not changing.
+//
+// Exits with 1 if a top-20 read through GetDepth() allocates (it must not
+// while the side is unchanged).
+//
+// Reported per run:
+//   ns/op     wall time / operations (for updates: including the time the
+//             shards take to apply them, see OrderBook::Sync())
+//   allocs/op heap allocations of all threads / operations
+//   p50..p999 latency of single calls (for updates: of AddEntry() itself);
+//             each call is timed separately, so these include the overhead
+//             of reading the clock twice
+//
+// Usage: bench_orderbook [updates per run] [queries per run]
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "Utils/FixDefs.h"
+#include "OrderBook/OrderBook.h"
+
+using namespace CORE::BOOK;
+using namespace UTILS;
+
+namespace {
+
+std::atomic<uint64_t> g_allocations { 0 };
+
+} // namespace
+
+void *operator new(size_t size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *p { std::malloc(size ? size : 1) })
+	{
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void *p, size_t /* size */) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void *p, size_t /* size */) noexcept
+{
+	std::free(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int64_t CENTER { 10'000 }; // 100.00, prices in ticks of 0.01
+
+int64_t ElapsedNs(Clock::time_point start, Clock::time_point stop)
+{
+	return int64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+}
+
+/*! \brief Per-call latencies of a run and the percentiles taken from them */
+class Latencies
+{
+public:
+	void Reserve(size_t count) { m_samples.reserve(count); }
+
+	void Add(int64_t ns) { m_samples.push_back(ns); }
+
+	void Append(const Latencies &other) { m_samples.insert(m_samples.end(), other.m_samples.begin(), other.m_samples.end()); }
+
+	/*! \brief Sorts the samples (must be called before Percentile()). */
+	void Finish() { std::sort(m_samples.begin(), m_samples.end()); }
+
+	int64_t Percentile(double p) const
+	{
+		return m_samples.empty() ? 0 : m_samples[size_t(p * double(m_samples.size() - 1))];
+	}
+
+	bool Empty() const { return m_samples.empty(); }
+
+private:
+	std::vector<int64_t> m_samples;
+};
+
+/*! \brief Distinct currency pairs for the instruments of a run */
+std::vector<CurrencyPair> MakeInstruments(size_t count)
+{
+	std::vector<CurrencyPair> result;
+	for (int base { Currency::USD }; base < Currency::END_OF_FX && result.size() < count; ++base)
+	{
+		for (int quote { base + 1 }; quote < Currency::END_OF_FX && result.size() < count; ++quote)
+		{
+			result.emplace_back(Currency(Currency::Value(base)), Currency(Currency::Value(quote)));
+		}
+	}
+	return result;
+}
+
+/*! \brief Pre-generated depth update (the entry is filled in before AddEntry()) */
+struct Update
+{
+	uint32_t instrument; //!< index into the instruments of the run
+	bool bid;
+	int64_t updateType; //!< QT_NEW, QT_UPDATE or QT_DELETE
+	int64_t price; //!< ticks
+	double volume;
+	int64_t key;
+	int64_t refKey;
+};
+
+/*! \brief Key of the quote at each level of each side of an instrument (0 -> level is empty) */
+struct LevelKeys
+{
+	std::vector<int64_t> bid;
+	std::vector<int64_t> ask;
+
+	std::vector<int64_t> &Get(bool isBid) { return isBid ? bid : ask; }
+};
+
+int64_t LevelPrice(bool bid, size_t level)
+{
+	return bid ? CENTER - 1 - int64_t(level) : CENTER + int64_t(level);
+}
+
+/*! \brief Generates the updates of one feed thread
+ *
+ * The level is drawn from a geometric distribution (most updates hit the
+ * first levels, like on Binance). An existing level is replaced (70%) or
+ * deleted (30%), an empty level is filled with a new quote.
+ */
+std::vector<Update> MakeUpdates(const std::vector<uint32_t> &instruments, std::vector<LevelKeys> &keys, size_t depth, size_t count,
+								int64_t &nextKey, uint64_t seed)
+{
+	std::mt19937_64 rng { seed };
+	std::uniform_int_distribution<size_t> instrumentDist { 0, instruments.size() - 1 };
+	std::geometric_distribution<size_t> levelDist { depth > 20 ? 0.02 : 0.2 };
+	std::uniform_real_distribution<double> actionDist { 0.0, 1.0 };
+	std::uniform_int_distribution<int> volumeDist { 1, 10'000 };
+	std::vector<Update> result;
+	result.reserve(count);
+	for (size_t i { 0 }; i < count; ++i)
+	{
+		const uint32_t instrument { instruments[instrumentDist(rng)] };
+		const bool bid { (rng() & 1) != 0 };
+		const size_t level { std::min(levelDist(rng), depth - 1) };
+		int64_t &levelKey { keys[instrument].Get(bid)[level] };
+		Update update { instrument, bid, QT_NEW, LevelPrice(bid, level), double(volumeDist(rng)) / 100.0, nextKey++, 0 };
+		if (levelKey != 0)
+		{
+			update.updateType = actionDist(rng) < 0.7 ? QT_UPDATE : QT_DELETE;
+			update.refKey = levelKey;
+		}
+		levelKey = update.updateType == QT_DELETE ? 0 : update.key;
+		result.push_back(update);
+	}
+	return result;
+}
+
+void Apply(OrderBook &book, const std::vector<CurrencyPair> &instruments, NormalizedMDData::Entry &entry, const Update &update)
+{
+	entry.entryType = update.bid ? QuoteType::BID : QuoteType::OFFER;
+	entry.updateType = update.updateType;
+	entry.price = double(update.price) / 100.0;
+	entry.volume = update.volume;
+	book.AddEntry(update.key, update.refKey, 0, instruments[update.instrument], entry);
+}
+
+/*! \brief Fills every level of both sides of each instrument with one quote. */
+std::vector<LevelKeys> Populate(OrderBook &book, const std::vector<CurrencyPair> &instruments, size_t depth, int64_t &nextKey)
+{
+	std::vector<LevelKeys> keys(instruments.size());
+	NormalizedMDData::Entry entry;
+	for (uint32_t i { 0 }; i < instruments.size(); ++i)
+	{
+		book.RegisterInstrument(instruments[i]);
+		for (bool bid: { true, false })
+		{
+			std::vector<int64_t> &sideKeys { keys[i].Get(bid) };
+			sideKeys.resize(depth);
+			for (size_t level { 0 }; level < depth; ++level)
+			{
+				sideKeys[level] = nextKey;
+				Apply(book, instruments, entry, { i, bid, QT_NEW, LevelPrice(bid, level), 1.0 + double(level % 7), nextKey++, 0 });
+			}
+		}
+	}
+	book.Sync();
+	return keys;
+}
+
+struct UpdateResult
+{
+	double nsPerOp { 0.0 };
+	double allocsPerOp { 0.0 };
+	Latencies writes;
+	Latencies reads;
+};
+
+UpdateResult RunUpdates(size_t depth, size_t instrumentCount, size_t shards, size_t readers, size_t count)
+{
+	OrderBook book { shards };
+	const std::vector<CurrencyPair> instruments { MakeInstruments(instrumentCount) };
+	int64_t nextKey { 1 };
+	std::vector<LevelKeys> keys { Populate(book, instruments, depth, nextKey) };
+
+	// one feed thread per shard, each with its own instruments (as with one session per venue)
+	const size_t feeds { std::min(shards, instruments.size()) };
+	std::vector<std::vector<Update>> updates(feeds);
+	std::vector<Latencies> feedLatencies(feeds);
+	for (size_t f { 0 }; f < feeds; ++f)
+	{
+		std::vector<uint32_t> own;
+		for (uint32_t i { uint32_t(f) }; i < instruments.size(); i += uint32_t(feeds))
+		{
+			own.push_back(i);
+		}
+		updates[f] = MakeUpdates(own, keys, depth, count / feeds, nextKey, depth * 1000 + instrumentCount * 10 + f);
+		feedLatencies[f].Reserve(updates[f].size());
+	}
+
+	UpdateResult result;
+	std::atomic<bool> done { false };
+	std::atomic<size_t> ready { 0 };
+	std::vector<Latencies> readLatencies(readers);
+	std::vector<std::thread> readerThreads;
+	for (size_t r { 0 }; r < readers; ++r)
+	{
+		readLatencies[r].Reserve(count);
+		readerThreads.emplace_back([&, r]()
+		{
+			int64_t checksum { 0 };
+			size_t i { r };
+			++ready;
+			while (!done.load(std::memory_order_relaxed))
+			{
+				const auto callStart { Clock::now() };
+				checksum += book.GetBestPrices(instruments[i++ % instruments.size()]).Bid();
+				const auto callStop { Clock::now() };
+				if (i <= count) // the samples have been reserved for
+				{
+					readLatencies[r].Add(ElapsedNs(callStart, callStop));
+				}
+			}
+			if (checksum == 42) // keeps the reads from being optimized away
+			{
+				std::cout << "";
+			}
+		});
+	}
+	while (ready < readers)
+	{
+		std::this_thread::yield();
+	}
+
+	const uint64_t allocations { g_allocations.load() };
+	const auto start { Clock::now() };
+	std::vector<std::thread> feedThreads;
+	for (size_t f { 0 }; f < feeds; ++f)
+	{
+		feedThreads.emplace_back([&, f]()
+		{
+			NormalizedMDData::Entry entry;
+			for (const Update &update: updates[f])
+			{
+				const auto callStart { Clock::now() };
+				Apply(book, instruments, entry, update);
+				feedLatencies[f].Add(ElapsedNs(callStart, Clock::now()));
+			}
+		});
+	}
+	size_t total { 0 };
+	for (size_t f { 0 }; f < feeds; ++f)
+	{
+		feedThreads[f].join();
+		total += updates[f].size();
+	}
+	book.Sync();
+	const auto stop { Clock::now() };
+	result.allocsPerOp = double(g_allocations.load() - allocations) / double(total);
+	result.nsPerOp = double(ElapsedNs(start, stop)) / double(total);
+
+	done = true;
+	for (std::thread &thread: readerThreads)
+	{
+		thread.join();
+	}
+	for (size_t f { 0 }; f < feeds; ++f)
+	{
+		result.writes.Append(feedLatencies[f]);
+	}
+	for (size_t r { 0 }; r < readers; ++r)
+	{
+		result.reads.Append(readLatencies[r]);
+	}
+	result.writes.Finish();
+	result.reads.Finish();
+	return result;
+}
+
+/*! \brief View of one side of an instrument of an OrderBook (for BookView::AggregateLevel()) */
+class SideView : public BookView
+{
+public:
+	SideView(const OrderBook &book, CurrencyPair cp, bool bid)
+			: BookView("bench"), m_book(book), m_cp(cp), m_bid(bid) { }
+
+	bool Valid() const override { return true; }
+
+	void AppendFilter(std::stringstream &ss, bool /* skipSortView */, const std::string & /* delimiter */) const override { ss << Name(); }
+
+	CurrencyPair Instrument() const override { return m_cp; }
+
+	QuoteType Type() const override { return m_bid ? QuoteType::BID : QuoteType::OFFER; }
+
+	void IterateQuoteGroups(const QuoteGroupFunc &action, const QuotePred &quotePred = nullptr) const override
+	{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+		m_book.IterateQuoteGroups(m_cp, m_bid, action, quotePred);
+#pragma GCC diagnostic pop
+	}
+
+private:
+	const OrderBook &m_book;
+	const CurrencyPair m_cp;
+	const bool m_bid;
+};
+
+struct QueryResult
+{
+	double nsPerOp { 0.0 };
+	double allocsPerOp { 0.0 };
+	Latencies calls;
+};
+
+template <typename Q>
+QueryResult RunQuery(size_t count, Q query)
+{
+	QueryResult result;
+	result.calls.Reserve(count);
+	int64_t checksum { 0 };
+	const uint64_t allocations { g_allocations.load() };
+	const auto start { Clock::now() };
+	for (size_t i { 0 }; i < count; ++i)
+	{
+		const auto callStart { Clock::now() };
+		checksum += query(i);
+		result.calls.Add(ElapsedNs(callStart, Clock::now()));
+	}
+	const auto stop { Clock::now() };
+	result.allocsPerOp = double(g_allocations.load() - allocations) / double(count);
+	result.nsPerOp = double(ElapsedNs(start, stop)) / double(count);
+	result.calls.Finish();
+	if (checksum == 42) // keeps the queries from being optimized away
+	{
+		std::cout << "";
+	}
+	return result;
+}
+
+void PrintStats(double nsPerOp, double allocsPerOp, const Latencies &latencies)
+{
+	std::cout << std::fixed << std::setprecision(1) << std::setw(10) << nsPerOp << std::setprecision(2) << std::setw(11) << allocsPerOp
+			  << std::setw(8) << latencies.Percentile(0.5) << std::setw(8) << latencies.Percentile(0.99)
+			  << std::setw(8) << latencies.Percentile(0.999);
+}
+
+void RunUpdateSuite(size_t count)
+{
+	std::cout << "AddEntry (new/update/delete)" << std::endl
+			  << std::setw(6) << "depth" << std::setw(7) << "instr" << std::setw(7) << "shards" << std::setw(8) << "readers"
+			  << std::setw(10) << "ns/op" << std::setw(11) << "allocs/op" << std::setw(8) << "p50" << std::setw(8) << "p99"
+			  << std::setw(8) << "p999" << std::setw(10) << "read p50" << std::setw(10) << "read p99" << std::endl;
+	for (size_t depth: { 20, 1000, 5000 })
+	{
+		for (size_t instruments: { 1, 16, 128 })
+		{
+			for (size_t shards: { 1, 4 })
+			{
+				for (size_t readers: { 0, 2 })
+				{
+					const UpdateResult result { RunUpdates(depth, instruments, shards, readers, count) };
+					std::cout << std::setw(6) << depth << std::setw(7) << instruments << std::setw(7) << shards << std::setw(8) << readers;
+					PrintStats(result.nsPerOp, result.allocsPerOp, result.writes);
+					if (!result.reads.Empty())
+					{
+						std::cout << std::setw(10) << result.reads.Percentile(0.5) << std::setw(10) << result.reads.Percentile(0.99);
+					}
+					std::cout << std::endl;
+				}
+			}
+		}
+	}
+}
+
+/*! \brief Runs the queries; returns @a false if a top-20 read through GetDepth() allocated. */
+bool RunQuerySuite(size_t count)
+{
+	bool success { true };
+	std::cout << std::endl << "Queries (book not changing)" << std::endl
+			  << std::setw(30) << "query" << std::setw(6) << "depth" << std::setw(10) << "ns/op" << std::setw(11) << "allocs/op"
+			  << std::setw(8) << "p50" << std::setw(8) << "p99" << std::setw(8) << "p999" << std::endl;
+	for (size_t depth: { 20, 1000, 5000 })
+	{
+		OrderBook book { 1 };
+		const std::vector<CurrencyPair> instruments { MakeInstruments(1) };
+		int64_t nextKey { 1 };
+		Populate(book, instruments, depth, nextKey);
+		const CurrencyPair cp { instruments.front() };
+		const SideView view { book, cp, true };
+		const int64_t halfDepthVolume { book.GetDepth(cp, true).snapshot->CumulativeVolume(depth / 2) };
+		const int64_t tenthDepthVolume { book.GetDepth(cp, true).snapshot->CumulativeVolume(depth / 10) };
+		const int64_t sideVolume { book.GetDepth(cp, true).snapshot->CumulativeVolume() };
+
+		const auto print = [depth](const char *name, const QueryResult &result)
+		{
+			std::cout << std::setw(30) << name << std::setw(6) << depth;
+			PrintStats(result.nsPerOp, result.allocsPerOp, result.calls);
+			std::cout << std::endl;
+		};
+		print("GetBestPrices", RunQuery(count, [&book, cp](size_t) { return book.GetBestPrices(cp).Bid(); }));
+
+		// the first read of the best levels makes the writer follow them
+		book.GetDepth(cp, true, 20);
+		book.GetDepth(cp, false, 20);
+		const QueryResult top { RunQuery(count, [&book, cp](size_t i)
+		{
+			const BookDepth top20 { book.GetDepth(cp, (i & 1) != 0, 20) };
+			return top20.levels.empty() ? 0 : top20.levels[0].totalVolume;
+		}) };
+		print("GetDepth(20)", top);
+		if (top.allocsPerOp > 0.0)
+		{
+			std::cout << "FAILED: GetDepth(20) allocates at depth " << depth << std::endl;
+			success = false;
+		}
+		print("GetDepth (all)", RunQuery(count / 10, [&book, cp](size_t i)
+		{
+			return int64_t(book.GetDepth(cp, (i & 1) != 0).levels.size());
+		}));
+
+		// volumes reaching 1/10 of the side and the whole side (beyond the ladder window at depth 5000)
+		for (const auto &[name, volume]: { std::pair { "GetAvgPriceForVolume (1/10)", tenthDepthVolume },
+										   std::pair { "GetAvgPriceForVolume (all)", sideVolume } })
+		{
+			print(name, RunQuery(count, [&book, cp, volume = volume](size_t i)
+			{
+				return book.GetAvgPriceForVolume(cp, (i & 1) != 0, volume);
+			}));
+		}
+		print("GetPriceForVolume (half)", RunQuery(count, [&book, cp, halfDepthVolume](size_t i)
+		{
+			return book.GetPriceForVolume(cp, (i & 1) != 0, halfDepthVolume);
+		}));
+		print("GetVolumeWithinBps (10)", RunQuery(count, [&book, cp](size_t i)
+		{
+			return book.GetVolumeWithinBps(cp, (i & 1) != 0, 10);
+		}));
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+		print("GetLevels(10)", RunQuery(count, [&book, cp](size_t i)
+		{
+			return int64_t(book.GetLevels(cp, (i & 1) != 0, 10).size());
+		}));
+		print("IterateQuoteGroups (all)", RunQuery(count / 10, [&book, cp](size_t i)
+		{
+			int64_t levels { 0 };
+			book.IterateQuoteGroups(cp, (i & 1) != 0, [&levels](int, QuoteGroup::Ptr &, bool &) { ++levels; });
+			return levels;
+		}));
+#pragma GCC diagnostic pop
+		print("AggregateLevel (half)", RunQuery(count / 10, [&view, halfDepthVolume](size_t)
+		{
+			return view.AggregateLevel(halfDepthVolume)->TotalVolume();
+		}));
+	}
+	return success;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const size_t updates { argc > 1 ? size_t(std::strtoull(argv[1], nullptr, 10)) : 400'000 };
+	const size_t queries { argc > 2 ? size_t(std::strtoull(argv[2], nullptr, 10)) : 200'000 };
+
+	RunUpdateSuite(updates);
+	return RunQuerySuite(queries) ? 0 : 1;
+}
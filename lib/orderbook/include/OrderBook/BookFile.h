@@ -0,0 +1,129 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#ifndef COROUT_BOOKFILE_H
+#define COROUT_BOOKFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Utils/Result.h"
+
+namespace CORE {
+namespace BOOK {
+
+/*! \brief Layout of a binary order book snapshot file
+ *
+ * The file holds plain fixed-size records in host byte order, so it is
+ * written and read through a memory mapping without any parsing:
+ *
+ *     FileHeader
+ *     VenueRecord      x venueCount         (venue 0 first)
+ *     for each instrument (instrumentCount):
+ *         InstrumentRecord
+ *         QuoteRecord  x quoteCount[0]      (bid, best level first)
+ *         QuoteRecord  x quoteCount[1]      (ask, best level first)
+ *
+ * Only the fields needed to rebuild the ladders are saved; the cold details
+ * of a quote (quote id, settlement date, originator) are not.
+ */
+namespace BOOKFILE {
+
+constexpr char MAGIC[8] { 'S', 'G', 'B', 'O', 'O', 'K', '1', '\0' };
+constexpr uint32_t VERSION { 1 };
+constexpr size_t NAME_SIZE { 32 }; //!< incl. terminating zero
+
+struct FileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t venueCount;
+	uint32_t instrumentCount;
+	uint32_t reserved;
+	int64_t savedAt; //!< ns
+};
+
+struct VenueRecord
+{
+	char name[NAME_SIZE]; //!< session name
+};
+
+struct InstrumentRecord
+{
+	char cp[NAME_SIZE]; //!< currency pair as string
+	int64_t updateId; //!< last update id of the feed applied to the saved quotes
+	uint32_t quoteCount[2]; //!< bid, ask
+};
+
+struct QuoteRecord
+{
+	int64_t price;
+	int64_t volume;
+	int64_t minQty;
+	int64_t key;
+	int64_t sendingTime;
+	uint32_t venue; //!< index into the venue records
+	int32_t positionNo;
+};
+
+static_assert(sizeof(FileHeader) == 32 && sizeof(VenueRecord) == 32 && sizeof(InstrumentRecord) == 48 && sizeof(QuoteRecord) == 48,
+			  "book file records must not contain padding");
+
+/*! \brief Copies a string into a fixed-size name field (truncated, zero-terminated). */
+void SetName(char (&field)[NAME_SIZE], const std::string &name);
+
+/*! \brief Reads a name field (stops at the first zero or the end of the field). */
+std::string GetName(const char (&field)[NAME_SIZE]);
+
+} // namespace BOOKFILE
+
+/*! \brief Memory mapping of a whole file (move-only)
+ *
+ * Create() maps a new file of a given size for writing; Commit() flushes it
+ * to disk and moves it to its final path, so readers never see a partly
+ * written file. Open() maps an existing file read-only.
+ */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+
+	MappedFile(MappedFile &&other) noexcept;
+
+	MappedFile &operator=(MappedFile &&other) noexcept;
+
+	MappedFile(const MappedFile &) = delete;
+
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	~MappedFile();
+
+	/*! \brief Creates a temporary file next to @a path, sized @a size, and maps it for writing. */
+	UTILS::BoolResult Create(const std::string &path, size_t size);
+
+	/*! \brief Maps an existing file read-only. */
+	UTILS::BoolResult Open(const std::string &path);
+
+	/*! \brief Flushes a file created by Create() and renames it to its final path. */
+	UTILS::BoolResult Commit();
+
+	/*! \brief Unmaps the file (a file created but not committed is deleted). */
+	void Close();
+
+	char *Data() const { return m_data; }
+
+	size_t Size() const { return m_size; }
+
+private:
+	char *m_data { nullptr };
+	size_t m_size { 0 };
+	std::string m_path; //!< final path
+	std::string m_tmpPath; //!< path written to (Create() only)
+};
+
+} // namespace BOOK
+} // namespace CORE
+
+#endif //COROUT_BOOKFILE_H
@@ -0,0 +1,156 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#ifndef COROUT_BOOKSHARD_H
+#define COROUT_BOOKSHARD_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "Utils/MpscQueue.h"
+#include "OrderBook/Quote.h"
+
+#define DFLT_SHARD_QUEUE_SIZE 16384 // max. number of pending updates per shard
+#define DFLT_SHARD_BATCH_SIZE 256 // max. number of updates applied between two flushes
+
+namespace CORE {
+namespace BOOK {
+
+/*! \brief Writer thread owning a subset of the instruments of an order book
+ *
+ * Updates are posted to a lock-free queue and applied by the shard thread,
+ * which is the only thread that ever modifies the books of its instruments.
+ * Other work that needs to see those books in a consistent state (snapshots,
+ * clearing, expiry) is run on the shard thread as a task, either waiting for
+ * it (see Run()) or not (see Post(std::function)). Sync() waits for the
+ * updates queued so far without queuing anything itself.
+ *
+ * Updates are applied in batches: the shard calls the flush callback when its
+ * queue has run empty, after DFLT_SHARD_BATCH_SIZE updates in a row and before
+ * a task is run, so the owner can report the changes of a batch at once.
+ *
+ * The updates of one exchange message can be posted together (see
+ * PostBatch()); they are applied back to back, with no task or flush in
+ * between, and only the last one is applied with the @a last flag set.
+ */
+class BookShard
+{
+public:
+	/*! \brief Callback applying a quote: void apply(int instrument, bool bid, const Quote &quote, bool last)
+	 *
+	 * @a last is @a false for all but the last update of a batch posted by PostBatch().
+	 */
+	using ApplyFunc = std::function<void(int, bool, const Quote &, bool)>;
+
+	/*! \brief Callback ending a batch of updates: void flush() */
+	using FlushFunc = std::function<void()>;
+
+	BookShard(std::string name, ApplyFunc apply, FlushFunc flush = nullptr, size_t queueSize = DFLT_SHARD_QUEUE_SIZE);
+
+	~BookShard();
+
+	BookShard(const BookShard &) = delete;
+
+	BookShard &operator=(const BookShard &) = delete;
+
+	/*! \brief Queues a quote for the given instrument (any thread; waits while the queue is full). */
+	void Post(int instrument, bool bid, const Quote &quote);
+
+	/*! \brief Queues the updates of one instrument in a row (any thread; waits while the queue is full).
+	 *
+	 * Batches larger than the queue are split into batches of its capacity.
+	 *
+	 * @param count Number of updates
+	 * @param update Creates the updates: void update(size_t i, bool &bid, Quote &quote), called for i = 0 .. @a count - 1
+	 */
+	template <typename U>
+	void PostBatch(int instrument, size_t count, U update)
+	{
+		for (size_t first { 0 }; first < count; first += m_queue.Capacity())
+		{
+			const size_t n { std::min(count - first, m_queue.Capacity()) };
+			const auto fill = [instrument, first, n, &update](Item &item, size_t i)
+			{
+				item.instrument = instrument;
+				update(first + i, item.bid, item.quote);
+				item.more = i + 1 < n;
+			};
+			while (!m_queue.TryEnqueue(n, fill))
+			{
+				std::this_thread::yield(); // queue full -> wait for the shard thread
+			}
+			Wake();
+		}
+	}
+
+	/*! \brief Queues a task to be run on the shard thread and returns immediately (any thread).
+	 *
+	 * Updates posted before are applied before the task runs. The task must
+	 * not throw.
+	 */
+	void Post(std::function<void()> task);
+
+	/*! \brief Runs a task on the shard thread and waits for it to complete.
+	 *
+	 * Called on the shard thread itself, the task is executed immediately.
+	 * Updates posted before are applied before the task runs.
+	 */
+	void Run(const std::function<void()> &task);
+
+	/*! \brief Waits until everything queued so far has been applied and flushed.
+	 *
+	 * The caller only watches the progress of the shard thread; nothing is
+	 * queued, so the shard does not end its batch early. Called on the shard
+	 * thread itself, the current batch is flushed.
+	 */
+	void Sync();
+
+	/*! \brief Is the calling thread the shard thread? */
+	bool OnShardThread() const { return std::this_thread::get_id() == m_thread.get_id(); }
+
+private:
+	struct Item
+	{
+		int instrument { -1 };
+		bool bid { false };
+		Quote quote;
+		const std::function<void()> *task { nullptr }; //!< owned by the item if @a done is @a nullptr (see Post(std::function))
+		std::promise<void> *done { nullptr };
+		bool more { false }; //!< further updates of the same batch follow
+	};
+
+	const std::string m_name;
+	const ApplyFunc m_apply;
+	const FlushFunc m_flush;
+	size_t m_unflushed { 0 }; //!< updates applied since the last flush (shard thread only)
+	bool m_inBatch { false }; //!< the rest of a batch is still to be dequeued (shard thread only)
+	size_t m_dequeued { 0 }; //!< items processed so far (shard thread only)
+	std::atomic<size_t> m_completed { 0 }; //!< items processed and flushed so far (see Sync())
+	UTILS::MpscQueue<Item> m_queue;
+	std::atomic_bool m_shutdown { false };
+	std::atomic_bool m_sleeping { false };
+	std::mutex m_wakeMtx;
+	std::condition_variable m_wakeCond;
+	std::thread m_thread;
+
+	void Enqueue(Item &item);
+
+	void Wake();
+
+	void Process(Item &item);
+
+	void Flush();
+
+	void Loop();
+};
+
+} // namespace BOOK
+} // namespace CORE
+
+#endif //COROUT_BOOKSHARD_H
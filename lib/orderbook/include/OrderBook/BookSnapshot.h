@@ -0,0 +1,257 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#ifndef COROUT_BOOKSNAPSHOT_H
+#define COROUT_BOOKSNAPSHOT_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "OrderBook/PriceLadder.h"
+
+namespace CORE {
+namespace BOOK {
+
+/*! \brief Read-only view of the quotes and aggregates of one price level (no allocation) */
+struct LevelView
+{
+	int64_t price { 0 };
+	int64_t totalVolume { 0 }; //!< sum of the volumes of the quotes
+	int64_t minQty { 0 }; //!< greatest minimum quantity of the quotes (as in QuoteGroup)
+	VenueMask venues { 0 }; //!< venues quoting at this level
+	const Quote *first { nullptr };
+	const Quote *last { nullptr };
+
+	const Quote *begin() const { return first; }
+
+	const Quote *end() const { return last; }
+
+	size_t QuoteCount() const { return size_t(last - first); }
+
+	/*! \brief Volume of the quotes of some venues (the total volume if the level has no other venues). */
+	int64_t Volume(VenueMask mask) const
+	{
+		if ((venues & ~mask) == 0)
+		{
+			return totalVolume;
+		}
+		int64_t volume { 0 };
+		for (const Quote &quote: *this)
+		{
+			volume += (VenueBit(quote.Venue()) & mask) ? quote.Volume() : 0;
+		}
+		return volume;
+	}
+};
+
+/*! \brief Read-only range of consecutive levels of a snapshot, best level first */
+struct LevelRange
+{
+	const LevelView *first { nullptr };
+	const LevelView *last { nullptr };
+
+	const LevelView *begin() const { return first; }
+
+	const LevelView *end() const { return last; }
+
+	size_t size() const { return size_t(last - first); }
+
+	bool empty() const { return first == last; }
+
+	const LevelView &operator[](size_t idx) const { return first[idx]; }
+};
+
+/*! \brief Immutable copy of one side of an instrument book
+ *
+ * Snapshots are taken by the writer thread of the instrument and tagged with
+ * the version of the side at that time, so readers can tell whether a cached
+ * snapshot is still current.
+ *
+ * The depth queries of a snapshot ("what price do I get for X", "how much is
+ * quoted within N bps") walk the level totals from the best level on and stop
+ * where the answer is reached; they do not walk the quotes and do not
+ * allocate. The order book answers these queries from the DepthIndex of the
+ * ladder instead and only falls back to a snapshot for queries reaching
+ * levels far from the touch. The queries use the level totals; quotes already
+ * used or with a minimum quantity above the requested volume are not excluded
+ * (see QuoteGroup::PartialAvgPrice() for that). A snapshot of the best levels
+ * only (see Complete()) answers them from these levels.
+ */
+class BookSnapshot
+{
+public:
+	using Ptr = std::shared_ptr<const BookSnapshot>;
+
+	/*! \brief Copies a price ladder (must be called by the writer of the ladder).
+	 *
+	 * @param version   Version of the side
+	 * @param ladder    Ladder to be copied
+	 * @param maxLevels Number of levels to be copied, best first (0 -> all)
+	 */
+	BookSnapshot(uint64_t version, const PriceLadder &ladder, size_t maxLevels = 0);
+
+	uint64_t Version() const { return m_version; }
+
+	bool Bid() const { return m_bid; }
+
+	/*! \brief Does the snapshot hold all levels of the side? */
+	bool Complete() const { return m_complete; }
+
+	/*! \brief Does the snapshot hold the best @a n levels of the side (all levels if @a n is 0)? */
+	bool Covers(size_t n) const { return m_complete || (n > 0 && n <= m_levels.size()); }
+
+	size_t QuoteCount() const { return m_quotes.size(); }
+
+	size_t LevelCount() const { return m_levels.size(); }
+
+	/*! \brief Returns the best @a n levels (all levels if @a n is 0 or exceeds the number of levels). */
+	LevelRange Levels(size_t n = 0) const
+	{
+		const size_t count { n == 0 ? m_levels.size() : std::min(n, m_levels.size()) };
+		return LevelRange { m_levels.data(), m_levels.data() + count };
+	}
+
+	/*! \brief Total volume of the best @a n levels (all levels if @a n is 0 or exceeds the number of levels). */
+	int64_t CumulativeVolume(size_t n = 0) const
+	{
+		int64_t volume { 0 };
+		for (const LevelView &level: Levels(n))
+		{
+			volume += level.totalVolume;
+		}
+		return volume;
+	}
+
+	/*! \brief Price of the level at which the cumulative volume reaches @a volume (0 if the side is too thin). */
+	int64_t PriceForVolume(int64_t volume) const;
+
+	/*! \brief Volume-weighted average price for taking @a volume from the best level on.
+	 *
+	 * @param volume Volume to be taken
+	 * @param filled (optional) receives the volume available, i.e. @a volume unless the side is too thin
+	 * @return Average price (rounded), 0 if the side is empty
+	 */
+	int64_t AvgPriceForVolume(int64_t volume, int64_t *filled = nullptr) const;
+
+	/*! \brief Volume quoted at @a limitPrice or better. */
+	int64_t VolumeWithin(int64_t limitPrice) const;
+
+	/*! \brief Volume quoted within @a bps basis points of the best price. */
+	int64_t VolumeWithinBps(int64_t bps) const;
+
+	/*! \brief Executes an action for each level, best level first.
+	 *
+	 * @param action Signature: void action(const LevelView &level, bool &cont).
+	 *               If @a cont is set to @a false, the iteration is stopped
+	 */
+	template <typename A>
+	void ForEachLevel(A action) const
+	{
+		bool cont { true };
+		for (auto it { m_levels.begin() }; cont && it != m_levels.end(); ++it)
+		{
+			action(*it, cont);
+		}
+	}
+
+	/*! \brief Executes an action for each level quoted by some venues, best level first.
+	 *
+	 * @param mask   Venues to be included
+	 * @param action Signature: void action(const LevelView &level, int64_t volume, bool &cont), with
+	 *               @a volume being the volume of the venues at the level.
+	 *               If @a cont is set to @a false, the iteration is stopped
+	 */
+	template <typename A>
+	void ForEachLevel(VenueMask mask, A action) const
+	{
+		bool cont { true };
+		for (auto it { m_levels.begin() }; cont && it != m_levels.end(); ++it)
+		{
+			if (it->venues & mask)
+			{
+				action(*it, it->Volume(mask), cont);
+			}
+		}
+	}
+
+	/*! \brief Executes an action for each quote, best level first.
+	 *
+	 * @param action Signature: void action(const Quote &quote, bool &cont).
+	 *               If @a cont is set to @a false, the iteration is stopped
+	 */
+	template <typename A>
+	void ForEachQuote(A action) const
+	{
+		bool cont { true };
+		for (auto it { m_quotes.begin() }; cont && it != m_quotes.end(); ++it)
+		{
+			action(*it, cont);
+		}
+	}
+
+private:
+	const uint64_t m_version;
+	const bool m_bid;
+	bool m_complete { true };
+	std::vector<Quote> m_quotes; //!< all quotes, best level first
+	std::vector<LevelView> m_levels; //!< views into m_quotes, best level first
+
+	/*! \brief Index of the first level whose cumulative volume reaches @a volume (LevelCount() if none).
+	 *
+	 * @param beforeVolume   (optional) receives the volume of the levels before it
+	 * @param beforeNotional (optional) receives the sum of price * volume of the levels before it
+	 */
+	size_t levelForVolume(int64_t volume, int64_t *beforeVolume = nullptr, double *beforeNotional = nullptr) const;
+};
+
+/*! \brief Levels of a snapshot together with the snapshot that keeps them alive */
+struct BookDepth
+{
+	BookSnapshot::Ptr snapshot;
+	LevelRange levels;
+};
+
+/*! \brief Latest snapshot of one side, published by the writer thread without a lock
+ *
+ * The writer swaps in a new snapshot with one atomic exchange; readers copy
+ * the shared pointer inside a read section counted per epoch. The pointers
+ * swapped out are freed by the writer on a later Store() once no reader of
+ * their epoch is left: the writer never waits for readers, and readers never
+ * wait for the writer (a minimal RCU with two epochs). Freeing may thus be
+ * delayed until the next Store() or the destruction of the slot.
+ */
+class SnapshotSlot
+{
+public:
+	SnapshotSlot() = default;
+
+	~SnapshotSlot();
+
+	SnapshotSlot(const SnapshotSlot & /* other */) = delete;
+
+	SnapshotSlot &operator=(const SnapshotSlot & /* other */) = delete;
+
+	/*! \brief Returns the snapshot stored last (lock-free, any thread). */
+	BookSnapshot::Ptr Load() const;
+
+	/*! \brief Replaces the snapshot (writer thread only). */
+	void Store(BookSnapshot::Ptr snapshot);
+
+private:
+	std::atomic<const BookSnapshot::Ptr *> m_current { nullptr };
+	std::atomic<uint64_t> m_epoch { 0 };
+	mutable std::array<std::atomic<uint32_t>, 2> m_readers { }; //!< readers in a read section, by parity of their epoch
+	std::vector<const BookSnapshot::Ptr *> m_retired; //!< swapped out in the current epoch (writer only)
+	std::vector<const BookSnapshot::Ptr *> m_waiting; //!< swapped out before the last epoch change (writer only)
+
+	void reclaim();
+};
+
+} // namespace BOOK
+} // namespace CORE
+
+#endif //COROUT_BOOKSNAPSHOT_H
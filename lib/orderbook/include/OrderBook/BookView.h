@@ -66,6 +66,12 @@ public:
 	/*! \brief Type alias for predicates on quotes */
 	using QuotePred = std::function<bool(const Quote &)>;
 	
+	/*! \brief Predicate accepting the quotes of some venues (see OrderBook::RegisterVenue()) */
+	static QuotePred VenuePred(VenueMask venues)
+	{
+		return [venues](const Quote &quote) { return (VenueBit(quote.Venue()) & venues) != 0; };
+	}
+	
 	QuoteGroupVec GetLevels(unsigned int n = 0, const QuotePred &quotePred = nullptr) const;
 	
 	void GetLevels(QuoteGroupVec &vec, unsigned int n = 0, const QuotePred &quotePred = nullptr) const;
@@ -0,0 +1,171 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#ifndef COROUT_DEPTHINDEX_H
+#define COROUT_DEPTHINDEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace CORE {
+namespace BOOK {
+
+/*! \brief Cumulative level totals of one side of a book, readable without locks
+ *
+ * The index mirrors the window of a PriceLadder: one position per window
+ * slot, best slot first, holding the number of levels (0 or 1), the total
+ * volume and the notional (price * volume) of the level in that slot. The
+ * positions are kept in Fenwick trees, so the writer updates a level in
+ * O(log n) and "what price do I get for X" / "how much is quoted up to a
+ * price" are answered by descending the trees in O(log n), without walking
+ * the levels and without a copy of the side.
+ *
+ * Levels outside the window (far from the touch) are only counted in total
+ * (see SetOverflow()); queries that end among them are not answered by the
+ * index (std::nullopt), the caller then walks a snapshot of the side.
+ *
+ * There is a single writer (the writer thread of the book). It brackets its
+ * changes with BeginUpdate() / EndUpdate(), which make a sequence number odd
+ * and even again; readers retry while the sequence is odd or has changed
+ * meanwhile (as TopOfBookRecord does), so they see the totals of complete
+ * updates only.
+ */
+class DepthIndex
+{
+public:
+	/*! \brief Constructor.
+	 *
+	 * @param bid  @a true -> bid side (higher price is better), @a false -> ask side
+	 * @param size Number of positions (window slots of the ladder)
+	 */
+	DepthIndex(bool bid, int size);
+
+	DepthIndex(DepthIndex &&other) noexcept;
+
+	DepthIndex(const DepthIndex &) = delete;
+
+	DepthIndex &operator=(const DepthIndex &) = delete;
+
+	/*! \brief Starts a change (writer only). */
+	void BeginUpdate()
+	{
+		m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	/*! \brief Ends a change (writer only). */
+	void EndUpdate() { m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+	/*! \brief Empties the index and places the window (writer only).
+	 *
+	 * @param base Price of window slot 0
+	 * @param step Price increment between two slots
+	 */
+	void Reset(int64_t base, int64_t step);
+
+	/*! \brief Adds to the totals of a window slot (writer only).
+	 *
+	 * @param slot   Window slot of the level
+	 * @param price  Price of the level
+	 * @param levels +1 -> level created, -1 -> level removed, 0 -> level changed
+	 * @param volume Volume added (negative -> removed)
+	 */
+	void Add(int slot, int64_t price, int levels, int64_t volume);
+
+	/*! \brief Sets the totals of the levels outside the window (writer only).
+	 *
+	 * @param levels    Number of levels
+	 * @param volume    Total volume
+	 * @param notional  Sum of price * volume
+	 * @param bestPrice Price of the best of these levels (0 if none)
+	 */
+	void SetOverflow(int64_t levels, int64_t volume, double notional, int64_t bestPrice);
+
+	/*! \brief Number of levels. */
+	int64_t LevelCount() const;
+
+	/*! \brief Best price (0 if the side is empty). */
+	int64_t BestPrice() const;
+
+	/*! \brief Total volume of the best @a n levels (all levels if @a n is 0). */
+	std::optional<int64_t> CumulativeVolume(size_t n) const;
+
+	/*! \brief Price of the level at which the cumulative volume reaches @a volume (0 if the side is too thin). */
+	std::optional<int64_t> PriceForVolume(int64_t volume) const;
+
+	/*! \brief Volume-weighted average price for taking @a volume from the best level on.
+	 *
+	 * @param volume Volume to be taken
+	 * @param filled (optional) receives the volume available, i.e. @a volume unless the side is too thin
+	 * @return Average price (rounded), 0 if the side is empty
+	 */
+	std::optional<int64_t> AvgPriceForVolume(int64_t volume, int64_t *filled = nullptr) const;
+
+	/*! \brief Volume quoted at @a limitPrice or better. */
+	std::optional<int64_t> VolumeWithin(int64_t limitPrice) const;
+
+	/*! \brief Volume quoted within @a bps basis points of the best price. */
+	std::optional<int64_t> VolumeWithinBps(int64_t bps) const;
+
+private:
+	/*! \brief Totals of the positions before a given one (see descend()). */
+	struct Prefix
+	{
+		int position { 0 }; //!< first position at which the searched total is reached (size -> not reached)
+		int64_t levels { 0 }; //!< totals of the positions before it
+		int64_t volume { 0 };
+		double notional { 0.0 };
+	};
+
+	const bool m_bid;
+	const int m_size;
+	int m_topBit { 1 }; //!< highest power of two <= m_size
+	std::unique_ptr<std::atomic<int64_t>[]> m_levels; //!< Fenwick trees, 1-based
+	std::unique_ptr<std::atomic<int64_t>[]> m_volume;
+	std::unique_ptr<std::atomic<double>[]> m_notional;
+	std::atomic<int64_t> m_base { 0 };
+	std::atomic<int64_t> m_step { 1 };
+	std::atomic<int64_t> m_overflowLevels { 0 };
+	std::atomic<int64_t> m_overflowVolume { 0 };
+	std::atomic<double> m_overflowNotional { 0.0 };
+	std::atomic<int64_t> m_overflowBest { 0 };
+	std::atomic<uint64_t> m_sequence { 0 };
+
+	template <typename F>
+	auto read(F f) const
+	{
+		uint64_t before;
+		uint64_t after;
+		decltype(f()) result;
+		do
+		{
+			before = m_sequence.load(std::memory_order_acquire);
+			result = f();
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = m_sequence.load(std::memory_order_relaxed);
+		} while ((before & 1) || before != after);
+		return result;
+	}
+
+	int position(int slot) const { return m_bid ? m_size - 1 - slot : slot; }
+
+	int64_t priceAt(int position) const;
+
+	int64_t total(const std::unique_ptr<std::atomic<int64_t>[]> &tree, int count) const;
+
+	int positionsWithin(int64_t limitPrice) const;
+
+	Prefix descend(const std::unique_ptr<std::atomic<int64_t>[]> &tree, int64_t target) const;
+
+	std::optional<int64_t> volumeWithin(int64_t limitPrice) const;
+
+	int64_t bestPrice() const;
+};
+
+} // namespace BOOK
+} // namespace CORE
+
+#endif //COROUT_DEPTHINDEX_H
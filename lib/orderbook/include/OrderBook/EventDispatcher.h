@@ -0,0 +1,92 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#ifndef COROUT_EVENTDISPATCHER_H
+#define COROUT_EVENTDISPATCHER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Utils/MpscQueue.h"
+#include "OrderBook/IPublisher.h"
+
+#define DFLT_EVENT_QUEUE_SIZE 16384 // max. number of book events waiting for the publishers
+#define DFLT_EVENT_BATCH_SIZE 256 // max. number of events handed to the dispatch callback at once
+
+namespace CORE {
+namespace BOOK {
+
+/*! \brief Thread delivering the book events of the writer threads to the publishers
+ *
+ * The writer threads post their events to a lock-free queue and go on; the
+ * dispatcher thread hands them to the dispatch callback in the order of the
+ * queue, so the publishers never run on a writer thread and may read the
+ * book while they are called.
+ *
+ * Posting never waits: when the queue is full, TryPost() refuses the event
+ * and the writer keeps the change pending (see OrderBook::PublishChanges()).
+ * Once the dispatcher has emptied the queue after refusing events, it calls
+ * the drained callback, so the writers publish what they have kept back.
+ */
+class EventDispatcher
+{
+public:
+	/*! \brief Callback delivering events: void dispatch(const std::vector<ORDERBOOK::BookEvent> &events) (must not throw) */
+	using DispatchFunc = std::function<void(const std::vector<ORDERBOOK::BookEvent> &)>;
+
+	/*! \brief Callback telling that the queue has run empty after events were refused: void drained() */
+	using DrainedFunc = std::function<void()>;
+
+	EventDispatcher(std::string name, DispatchFunc dispatch, DrainedFunc drained, size_t queueSize = DFLT_EVENT_QUEUE_SIZE);
+
+	~EventDispatcher();
+
+	EventDispatcher(const EventDispatcher &) = delete;
+
+	EventDispatcher &operator=(const EventDispatcher &) = delete;
+
+	/*! \brief Queues an event (any thread, never waits).
+	 *
+	 * @return @a true -> queued, @a false -> queue is full (the drained callback follows once it has run empty)
+	 */
+	bool TryPost(const ORDERBOOK::BookEvent &event);
+
+	/*! \brief Waits until the events queued so far have been delivered (returns at once on the dispatcher thread). */
+	void Sync();
+
+	/*! \brief Stops the dispatcher thread after delivering the events queued so far. */
+	void Stop();
+
+	/*! \brief Is the calling thread the dispatcher thread? */
+	bool OnDispatcherThread() const { return std::this_thread::get_id() == m_thread.get_id(); }
+
+private:
+	const std::string m_name;
+	const DispatchFunc m_dispatch;
+	const DrainedFunc m_drained;
+	UTILS::MpscQueue<ORDERBOOK::BookEvent> m_queue;
+	std::atomic<size_t> m_delivered { 0 }; //!< events handed to the dispatch callback so far (see Sync())
+	std::atomic_bool m_refused { false }; //!< an event was refused since the drained callback was called last
+	std::atomic_bool m_shutdown { false };
+	std::atomic_bool m_stopped { false }; //!< the dispatcher thread has delivered its last events
+	std::atomic_bool m_sleeping { false };
+	std::mutex m_wakeMtx;
+	std::condition_variable m_wakeCond;
+	std::thread m_thread;
+
+	void Wake();
+
+	size_t Deliver(std::vector<ORDERBOOK::BookEvent> &events);
+
+	void Loop();
+};
+
+} // namespace BOOK
+} // namespace CORE
+
+#endif //COROUT_EVENTDISPATCHER_H
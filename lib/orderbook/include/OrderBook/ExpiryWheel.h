@@ -0,0 +1,136 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#ifndef COROUT_EXPIRYWHEEL_H
+#define COROUT_EXPIRYWHEEL_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#define DFLT_EXPIRY_RESOLUTION 10'000'000 // 10ms per tick of the expiry wheel
+
+namespace CORE {
+namespace BOOK {
+
+/*! \brief Hierarchical timing wheel of expiry times
+ *
+ * Entries are put into the bucket of their expiry tick: the innermost wheel
+ * has one bucket per tick, each further wheel buckets 256 times as many ticks.
+ * Advance() moves the wheel forward to the current time and hands out the
+ * entries of the buckets passed; buckets of the outer wheels are redistributed
+ * to the inner wheels when their turn comes. The cost of an advance depends
+ * on the number of entries expiring (and the ticks passed), not on the
+ * number of entries held.
+ *
+ * Entries cannot be removed; the owner checks whether an expired entry is
+ * still current (see @a tag).
+ *
+ * The wheel is not thread-safe; it is used by the writer thread of a book.
+ */
+class ExpiryWheel
+{
+public:
+	struct Entry
+	{
+		int64_t key { 0 };
+		int64_t expiry { 0 }; //!< ns
+		uint64_t tag { 0 }; //!< set by the owner to recognise outdated entries
+	};
+
+	/*! \brief Constructor.
+	 *
+	 * @param start      Current time (ns); entries expiring earlier are handed out by the first Advance()
+	 * @param resolution Duration of a tick (ns)
+	 */
+	explicit ExpiryWheel(int64_t start, int64_t resolution = DFLT_EXPIRY_RESOLUTION);
+
+	/*! \brief Number of entries held (including outdated ones). */
+	size_t Size() const { return m_size; }
+
+	/*! \brief Adds an entry (entries already expired are handed out by the next Advance() to a later tick). */
+	void Add(int64_t key, int64_t expiry, uint64_t tag);
+
+	/*! \brief Hands out all entries expiring up to @a now.
+	 *
+	 * @param now       Current time (ns)
+	 * @param onExpired Signature: void onExpired(const Entry &entry)
+	 * @return Number of entries handed out
+	 */
+	template <typename F>
+	size_t Advance(int64_t now, F onExpired)
+	{
+		const int64_t target { now / m_resolution };
+		if (m_size == 0)
+		{
+			m_current = std::max(m_current, target + 1);
+			return 0;
+		}
+		size_t expired { 0 };
+		if (target - m_current >= RANGE)
+		{
+			// more than a full turn of the outermost wheel: visit the entries instead of the ticks
+			std::vector<Entry> entries { takeAll() };
+			m_current = target + 1;
+			for (const auto &entry: entries)
+			{
+				if (entry.expiry / m_resolution <= target)
+				{
+					onExpired(entry);
+					++expired;
+				}
+				else
+				{
+					place(entry);
+					++m_size;
+				}
+			}
+			return expired;
+		}
+		for (; m_current <= target; ++m_current)
+		{
+			cascade();
+			std::vector<Entry> &bucket { m_wheels[0][size_t(m_current) & SLOT_MASK] };
+			for (const auto &entry: bucket)
+			{
+				onExpired(entry);
+			}
+			expired += bucket.size();
+			m_size -= bucket.size();
+			bucket.clear();
+			if (m_size == 0)
+			{
+				m_current = target;
+			}
+		}
+		return expired;
+	}
+
+	/*! \brief Removes all entries. */
+	void Clear();
+
+private:
+	static constexpr int LEVELS { 4 };
+	static constexpr int SLOT_BITS { 8 };
+	static constexpr size_t SLOTS { size_t(1) << SLOT_BITS };
+	static constexpr size_t SLOT_MASK { SLOTS - 1 };
+	static constexpr int64_t RANGE { int64_t(1) << (SLOT_BITS * LEVELS) }; //!< ticks covered by all wheels
+
+	const int64_t m_resolution;
+	int64_t m_current; //!< next tick to be handed out
+	size_t m_size { 0 };
+	std::array<std::array<std::vector<Entry>, SLOTS>, LEVELS> m_wheels;
+
+	void place(const Entry &entry);
+
+	void cascade();
+
+	std::vector<Entry> takeAll();
+};
+
+} // namespace BOOK
+} // namespace CORE
+
+#endif //COROUT_EXPIRYWHEEL_H
@@ -3,10 +3,45 @@
 #include "Quote.h"
 
 namespace ORDERBOOK {
+    /*! \brief Kind of change reported by a BookEvent */
+    enum class BookEventType
+    {
+        TopOfBook, //!< best price or best volume of the side changed
+        Level,     //!< the side changed from level @a level on, the best level is unchanged
+        Cleared    //!< all quotes of the side were removed
+    };
+
+    /*! \brief Coalesced change of one side of an instrument book
+     *
+     * The book reports at most one event per side for all updates applied in
+     * one batch, so a publisher sees the state after the batch, not every
+     * single quote.
+     */
+    struct BookEvent
+    {
+        UTILS::CurrencyPair cp;
+        BookEventType type { BookEventType::TopOfBook };
+        bool bid { false };
+        int level { 0 };          //!< index of the best level changed (0 for TopOfBook and Cleared)
+        int64_t price { 0 };      //!< best price after the change (0 -> side is empty)
+        int64_t volume { 0 };     //!< total volume of the best level after the change
+        uint64_t version { 0 };   //!< version of the side after the change (see OrderBook::GetSnapshot())
+    };
+
+    /*! \brief Receiver of order book changes
+     *
+     * Publish() is called by the dispatcher thread of the book, one event at
+     * a time, never by a writer thread: it may read the book (snapshots, top
+     * of book), and while it runs the writers go on applying updates. Events
+     * it does not take in time are coalesced, so a slow publisher sees fewer
+     * events, not older ones.
+     */
     class IPublisher
     {
     public:
+        using Ptr = std::shared_ptr<IPublisher>;
+
         virtual ~IPublisher() = default;
-        virtual void Publish(UTILS::CurrencyPair cp, int entry, int level, CORE::BOOK::Quote::Ptr quote, bool bid) = 0;
+        virtual void Publish(const BookEvent &event) = 0;
     };
 }
@@ -0,0 +1,62 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#ifndef COROUT_INSTRUMENTREGISTRY_H
+#define COROUT_INSTRUMENTREGISTRY_H
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <functional>
+
+#include "Utils/CurrencyPair.h"
+
+#define MAX_INSTRUMENTS 1024 // max. number of instruments an order book can hold
+
+namespace CORE {
+namespace BOOK {
+
+/*! \brief Maps currency pairs to dense integer ids (0, 1, 2, ...)
+ *
+ * Ids are assigned once (normally when an instrument is subscribed) and never
+ * change or get reused, so per-instrument data can be kept in plain arrays.
+ * Looking up an id is lock-free; registering a new instrument takes a mutex.
+ */
+class InstrumentRegistry
+{
+public:
+	InstrumentRegistry();
+
+	/*! \brief Returns the id of a currency pair, or -1 if it has not been registered (lock-free). */
+	int Find(UTILS::CurrencyPair cp) const;
+
+	/*! \brief Returns the id of a currency pair, registering it if necessary.
+	 *
+	 * @param cp    Currency pair
+	 * @param onNew (optional) called with the new id before the id becomes visible to Find()
+	 * @return Id, or -1 if the currency pair is empty or the registry is full
+	 */
+	int Register(UTILS::CurrencyPair cp, const std::function<void(int)> &onNew = nullptr);
+
+	/*! \brief Returns the currency pair of an id (id must be < Count()). */
+	UTILS::CurrencyPair Instrument(int id) const { return m_instruments[size_t(id)]; }
+
+	/*! \brief Number of registered currency pairs. */
+	int Count() const { return m_count.load(std::memory_order_acquire); }
+
+private:
+	static constexpr size_t TABLE_SIZE { 2 * MAX_INSTRUMENTS }; // at most half full
+
+	std::array<std::atomic<uint64_t>, TABLE_SIZE> m_table; //!< (key << 32) | (id + 1), 0 -> free
+	std::array<UTILS::CurrencyPair, MAX_INSTRUMENTS> m_instruments;
+	std::atomic<int> m_count { 0 };
+	std::mutex m_mtx; //!< serialises registrations
+
+	static uint32_t key(UTILS::CurrencyPair cp) { return uint32_t(std::hash<UTILS::CurrencyPair>()(cp)); }
+};
+
+} // namespace BOOK
+} // namespace CORE
+
+#endif //COROUT_INSTRUMENTREGISTRY_H
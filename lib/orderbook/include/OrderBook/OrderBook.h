@@ -7,11 +7,23 @@
 
 #include <thread>
 #include <shared_mutex>
+#include <array>
 
 #include "OrderBook/Quote.h"
+#include "OrderBook/PriceLadder.h"
+#include "OrderBook/TopOfBook.h"
+#include "OrderBook/BookSnapshot.h"
+#include "OrderBook/BookShard.h"
+#include "OrderBook/EventDispatcher.h"
+#include "OrderBook/InstrumentRegistry.h"
+#include "OrderBook/ExpiryWheel.h"
+#include "OrderBook/BookFile.h"
+#include "OrderBook/IPublisher.h"
 #include "OrderBook/BookBase.h"
 #include "OrderBook/BookView.h"
 
+#include "Utils/Timer.h"
+
 #define ATTR_BATCHSIZE            "batchsize"
 #define DFLT_BATCHSIZE            1
 #define ATTR_CLEANUP_INTERVAL    "cleanup_interval"
@@ -20,6 +32,16 @@
 #define DFLT_MAX_QUOTE_COUNT    10 // quotes
 #define ATTR_MAX_QUOTE_AGE        "max_quote_age"
 #define DFLT_MAX_QUOTE_AGE        "1m" // 1 minute
+#define ATTR_SHARD_COUNT        "shard_count"
+#define DFLT_SHARD_COUNT        1 // writer threads
+#define ATTR_MAX_LEVEL_COUNT    "max_level_count"
+#define DFLT_MAX_LEVEL_COUNT    0 // levels per side (0 -> unlimited)
+#define ATTR_SNAPSHOT_FILE      "snapshot_file"
+#define DFLT_SNAPSHOT_FILE      "" // no snapshot file
+#define ATTR_SNAPSHOT_INTERVAL  "snapshot_interval"
+#define DFLT_SNAPSHOT_INTERVAL  "0" // save on shutdown only
+#define TAG_ORDERBOOK_CONFIG    "OrderBook"
+#define SNAPSHOT_UNREAD_BATCHES 4 // batches a snapshot is retaken without being read before the writer stops following the side
 
 namespace CORE {
 namespace BOOK {
@@ -27,38 +49,257 @@ namespace BOOK {
 /** @brief This class represents an order book, sorting raw quotes and grouping
  * them by market depth. It provides functions that iterate over the levels and
  * copy them to a vector.
+ *
+ * Each side of an instrument is held in a PriceLadder, so quotes are located
+ * by price instead of by scanning a sorted vector.
+ *
+ * Instruments get a dense id when they are registered (normally at
+ * subscription time, see RegisterInstrument()). The instruments are spread
+ * over a number of shards; each shard has exactly one writer thread, which is
+ * the only thread modifying the books of its instruments, so the write path
+ * takes no locks. AddEntry() only creates the quote and hands it to the shard.
+ * ApplyBatch() hands over all updates of an exchange message at once; they
+ * are applied back to back and published as one change of the book.
+ *
+ * After every change the best level of the affected side is published to a
+ * per-instrument TopOfBookRecord. GetTopOfBook(), GetBestPrices(cp),
+ * GetBestPrice(cp, bid) and GetMidPrice(cp) read these records without
+ * taking any lock. The best levels of all instruments are also kept in a
+ * BboTable, so GetTopOfBooks() reads them for many instruments in one pass
+ * over contiguous arrays. Functions returning quotes or levels read a versioned
+ * BookSnapshot of the side. The first read lets the writer thread take one;
+ * from then on the writer follows the side and publishes a new snapshot of
+ * the best levels asked for at the end of every batch that changed it, as
+ * long as it is being read, so readers do not wait for the writer queue.
+ * The snapshot pointer is swapped without a lock (see SnapshotSlot), so the
+ * writer does not wait for readers either. GetDepth() hands out views of the snapshot
+ * levels, including the per-level aggregates kept by the PriceLadder, without
+ * building QuoteGroups. The cumulative depth queries (GetPriceForVolume(),
+ * GetAvgPriceForVolume(), GetVolumeWithinBps()) read the DepthIndex of the
+ * ladder instead, without a snapshot.
+ *
+ * By default the book keeps everything it receives. In bounded-depth mode
+ * (see SetLimits(), or the optional <OrderBook> node of the configuration)
+ * the writer thread trims each side after every update to the best
+ * max_level_count levels and max_quote_count quotes per level. With a
+ * max_quote_age, each quote is entered into an ExpiryWheel of its side when
+ * it is added; a timer task runs every cleanup_interval and lets the writer
+ * threads remove the quotes whose buckets have expired, so expiring quotes
+ * does not scan the book.
+ *
+ * Registered publishers (see AddPublisher()) are told about changes instead
+ * of having to poll: when a shard has applied a batch of updates, its writer
+ * thread posts one coalesced ORDERBOOK::BookEvent per changed side (best
+ * level changed, or the first level changed below it) to an EventDispatcher,
+ * whose thread calls the publishers, so a slow publisher does not hold up the
+ * writers; Clear() reports a Cleared event for every side. Without
+ * publishers nothing is tracked.
+ *
+ * Several market data sessions may feed the book. Each session registers as
+ * a venue (see RegisterVenue()) and its quotes carry the venue id, so the
+ * ladders are the consolidated book of all venues, maintained quote by quote
+ * and without merging per-venue books on read. Each level is tagged with
+ * the venues quoting at it; IterateVenueLevels() and BookView::VenuePred()
+ * restrict reads to some venues.
+ *
+ * For warm restarts the whole book (levels, quote keys, venues and the last
+ * update id of the feed per instrument, see SetUpdateId()) can be saved to a
+ * binary file (see SaveSnapshot() and BookFile.h) and loaded again on start
+ * (see LoadSnapshot()). With a snapshot_file in the configuration the book
+ * is loaded by LoadConfig(), saved every snapshot_interval and on shutdown;
+ * a session then continues from the saved update id instead of requesting a
+ * full snapshot from the venue. Each session claims the restored quotes of its
+ * venue (see ClaimRestoredQuotes()); the quotes nobody claims are removed once
+ * the sessions have connected (see RemoveUnclaimedQuotes()).
  */
 class OrderBook : public BookBase
 {
 public:
 	/** @brief Type alias for vector of shared pointers to single quotes. */
-	using QuoteVec = std::vector<Quote::Ptr>;
-	
-	/** @brief Type alias for unique pointer to vector of shared pointers to single quotes. */
-	using QuoteVecPtr = std::shared_ptr<QuoteVec>;
-	using QuoteVecPtrToConst = std::shared_ptr<const QuoteVec>;
+	using QuoteVec = PriceLadder::QuoteVec;
 
-	/** @brief Constructor. */
-	explicit OrderBook()
-			: BookBase("SortBook") { }
+	/** @brief Constructor.
+	 *
+	 * @param shardCount Number of writer threads
+	 */
+	explicit OrderBook(size_t shardCount = DFLT_SHARD_COUNT)
+			: OrderBook("SortBook", shardCount) { }
 	
 	/** @brief Constructor accepting an explicit logger name (used by derived classes like FakeBook). */
-	OrderBook(const std::string &loggerName)
-			: BookBase(loggerName) { }
+	OrderBook(const std::string &loggerName, size_t shardCount = DFLT_SHARD_COUNT);
+	
+	~OrderBook();
+	
+	/** @brief Copying is not supported (the book owns its writer threads). */
+	OrderBook(const OrderBook & /* other */) = delete;
+	
+	OrderBook &operator=(const OrderBook & /* other */) = delete;
+	
+	/** @brief Registers an instrument and returns its dense id (-1 if the book is full).
+	 *
+	 * Instruments not registered beforehand are registered by their first AddEntry().
+	 */
+	int RegisterInstrument(UTILS::CurrencyPair cp);
+	
+	/** @brief Registers a venue (market data session) and returns its id (-1 if MAX_VENUES are registered).
+	 *
+	 * Registering a session again returns the same id. Venue 0 stands for
+	 * quotes without a venue.
+	 */
+	int RegisterVenue(const std::string &session);
+	
+	/** @brief Returns the id of a venue, or -1 if it has not been registered. */
+	int FindVenue(const std::string &session) const;
+	
+	/** @brief Returns the session name of a venue (empty if unknown). */
+	std::string VenueName(int venue) const;
+	
+	/** @brief Depth limits of the bounded-depth mode (0 -> no limit). */
+	struct BookLimits
+	{
+		size_t maxLevels { 0 }; //!< levels kept per side (max_level_count)
+		size_t maxQuotesPerLevel { 0 }; //!< quotes kept per level (max_quote_count)
+		int64_t maxQuoteAge { 0 }; //!< ns; older quotes are removed (max_quote_age)
+		int64_t cleanupInterval { 0 }; //!< ns between two removals of old quotes per side (cleanup_interval)
+	};
+	
+	/** @brief Sets the depth limits (takes effect with the next update of each side). */
+	void SetLimits(const BookLimits &limits);
+	
+	BookLimits GetLimits() const;
+	
+	/** @brief Reads the depth limits from the optional <OrderBook> node of a configuration.
+	 *
+	 * Without the node the book stays unbounded; attributes missing from the
+	 * node take their default values.
+	 *
+	 * @return @a false if the configuration could not be read
+	 */
+	bool LoadConfig(const UTILS::XmlDocPtr &pDoc);
+	
+	/** @brief Saves all instruments to a binary snapshot file (see BookFile.h).
+	 *
+	 * The quotes are copied by the writer threads after the updates queued so
+	 * far have been applied, so each instrument is saved with at least the
+	 * state of the update id it is saved with. The file is written under a
+	 * temporary name and renamed when complete.
+	 */
+	UTILS::BoolResult SaveSnapshot(const std::string &path) const;
+	
+	/** @brief Loads a snapshot file saved by SaveSnapshot().
+	 *
+	 * Venues and instruments are registered as necessary; the quotes keep
+	 * their keys and venues. Instruments that already hold quotes are not
+	 * loaded.
+	 *
+	 * @return Number of instruments loaded, or an error message
+	 */
+	UTILS::Result<size_t> LoadSnapshot(const std::string &path);
+	
+	/** @brief Takes over the quotes of a venue restored for an instrument by LoadSnapshot().
+	 *
+	 * The session of the venue maintains (or removes) the quotes from then on,
+	 * so RemoveUnclaimedQuotes() leaves them in the book.
+	 *
+	 * @return @a true if quotes of the venue had been restored and were not claimed yet
+	 */
+	bool ClaimRestoredQuotes(UTILS::CurrencyPair cp, int venue);
+	
+	/** @brief Removes the restored quotes no session has claimed (see ClaimRestoredQuotes()).
+	 *
+	 * Called once the sessions have connected, so the quotes of venues that are
+	 * not configured any more (or did not connect) do not stay in the book.
+	 *
+	 * @return Number of quotes removed
+	 */
+	size_t RemoveUnclaimedQuotes();
+	
+	/** @brief Records the last update id of the feed whose quotes have been passed to AddEntry().
+	 *
+	 * The id is saved with the instrument by SaveSnapshot(), so a session
+	 * can tell which updates a restored book is missing.
+	 */
+	void SetUpdateId(UTILS::CurrencyPair cp, int64_t updateId);
+	
+	/** @brief Returns the last update id recorded or restored for an instrument (0 if none). */
+	int64_t GetUpdateId(UTILS::CurrencyPair cp) const;
+	
+	/** @brief Lets the writer threads remove the expired quotes of all instruments (normally called by the expiry timer).
+	 *
+	 * Returns without waiting: each writer thread removes the quotes once it
+	 * has applied the updates queued before and adds them to
+	 * GetEvictedCount() (call Sync() to wait for it).
+	 */
+	void ExpireQuotes(int64_t now);
+	
+	/** @brief Number of quotes evicted by the depth limits or expired so far. */
+	uint64_t GetEvictedCount() const { return m_evictedCount.load(std::memory_order_relaxed); }
+	
+	/** @brief Returns the dense id of an instrument, or -1 if it has not been registered. */
+	int GetInstrumentId(UTILS::CurrencyPair cp) const { return m_registry.Find(cp); }
+	
+	/** @brief Registers a publisher to be told about the changes of all instruments.
+	 *
+	 * Events are published by the dispatcher thread of the book (see
+	 * ORDERBOOK::IPublisher), in the order the writer threads reported them.
+	 */
+	void AddPublisher(const ORDERBOOK::IPublisher::Ptr &publisher);
+	
+	/** @brief Unregisters a publisher (events being published concurrently may still reach it). */
+	void RemovePublisher(const ORDERBOOK::IPublisher::Ptr &publisher);
+	
+	/** @brief Waits until all updates and tasks queued so far have been applied and their snapshots and events published.
+	 *
+	 * Nothing is queued for this; the caller watches the progress of the
+	 * writer threads (see BookShard::Sync()) and of the dispatcher thread.
+	 * Called by a publisher, it does not wait for the events still to be
+	 * delivered.
+	 */
+	void Sync() const;
 	
-	~OrderBook() = default;
+	/** @brief Returns a snapshot of one side of an instrument (@a nullptr if the instrument is unknown).
+	 *
+	 * Returns the snapshot taken last by the writer thread of the instrument
+	 * if the side has not changed since, without waiting for it. The writer
+	 * follows the best levels read through GetDepth() only, never the whole
+	 * side: once the side has changed, the writer thread takes a new snapshot
+	 * after applying the updates queued so far.
+	 */
+	BookSnapshot::Ptr GetSnapshot(UTILS::CurrencyPair cp, bool bid) const;
 	
-	/** @brief Default copy constructor. */
-	OrderBook(const OrderBook & /* other */) = default;
+	/** @brief Returns read-only views of the best levels of one side (no allocation while the side is unchanged).
+	 *
+	 * The levels carry the aggregates maintained by the book (total volume,
+	 * quote count, minimum quantity) and stay valid as long as the returned
+	 * BookDepth is held. Only the best @a n levels are copied from the book
+	 * (unless a snapshot of the whole side is current anyway).
+	 *
+	 * @param cp  Currency pair
+	 * @param bid @a true -> bid side, @a false -> ask side
+	 * @param n   Maximum number of levels (0 -> all levels)
+	 */
+	BookDepth GetDepth(UTILS::CurrencyPair cp, bool bid, unsigned int n = 0) const;
 	
-	/** @brief Default copy assignment operator. */
-	OrderBook &operator=(const OrderBook & /* other */) = default;
+	/** @brief Volume-weighted average price for taking @a volume from one side (see BookSnapshot::AvgPriceForVolume()).
+	 *
+	 * Answered from the DepthIndex of the side in O(log n), without a snapshot
+	 * and without waiting for the writer thread. Only a volume reaching the
+	 * levels far from the touch (outside the ladder window) is answered from a
+	 * snapshot of the side.
+	 */
+	int64_t GetAvgPriceForVolume(UTILS::CurrencyPair cp, bool bid, int64_t volume, int64_t *filled = nullptr) const;
 	
-	/** @brief Default move constructor. */
-	OrderBook(OrderBook && /* other */) = default;
+	/** @brief Price of the level at which the cumulative volume of one side reaches @a volume (0 if too thin).
+	 *
+	 * Answered from the DepthIndex of the side, as GetAvgPriceForVolume().
+	 */
+	int64_t GetPriceForVolume(UTILS::CurrencyPair cp, bool bid, int64_t volume) const;
 	
-	/** @brief Default move assignment operator. */
-	OrderBook &operator=(OrderBook && /* other */) = default;
+	/** @brief Volume quoted on one side within @a bps basis points of the best price.
+	 *
+	 * Answered from the DepthIndex of the side, as GetAvgPriceForVolume().
+	 */
+	int64_t GetVolumeWithinBps(UTILS::CurrencyPair cp, bool bid, int64_t bps) const;
 	
 	void printBook(std::ostream &ostr, UTILS::CurrencyPair cp, bool bid, unsigned int levels) const;
 	
@@ -67,7 +308,11 @@ public:
 	/** @brief Returns a vector of quote groups for an instrument and side (bid/ask)
 	 *
 	 * This function creates a new vector of quote groups, and fills it with one
-	 * quote group per level.
+	 * quote group per level. Without @a quotePred, only the best @a n levels
+	 * are copied from the book.
+	 *
+	 * @deprecated Allocates a quote group per level; GetDepth() returns the same
+	 * aggregates (LevelView) without allocating while the side is unchanged.
 	 *
 	 * @param instr     Instrument as string
 	 * @param bid       @a true -> bid quote, @a false -> ask quote
@@ -76,6 +321,7 @@ public:
 	 *
 	 * @return Vector of quote groups
 	 */
+	[[deprecated("use GetDepth()")]]
 	BookView::QuoteGroupVec GetLevels(UTILS::CurrencyPair cp, bool bid, unsigned int n, const BookView::QuotePred &quotePred = nullptr) const;
 
 	/** @brief Dynamically creates quote groups and passes them to the provided
@@ -84,11 +330,15 @@ public:
 	 * This function creates quote groups representing one market level, and
 	 * sequentially passes each group to the provided callback action.
 	 *
+	 * @deprecated Allocates a quote group per level; iterate the levels of
+	 * GetDepth() instead.
+	 *
 	 * @param instr     Instrument as string
 	 * @param bid       @a true -> bid quote, @a false -> ask quote
 	 * @param action    void-function to be called for every generated quote group.
 	 * @param quotePred (optional) predicate to be fulfilled by a quote to be added to a quote group
 	 */
+	[[deprecated("use GetDepth()")]]
 	void IterateQuoteGroups(UTILS::CurrencyPair cp, bool bid, const BookView::QuoteGroupFunc &action,
 							const BookView::QuotePred &quotePred = nullptr) const;
 
@@ -98,38 +348,42 @@ public:
 	 * @param cp Currency pair
 	 * @param bid @a true -> bid, @a false -> ask
 	 * @param action Action to be executed for each task.
-	 * 					Signature: void action(const BOOK:Quote:Ptr &quote, bool &cont) or void action(BOOK:Quote:Ptr quote, bool &cont).
+	 * 					Signature: void action(const BOOK::Quote &quote, bool &cont).
 	 * 					           If @a cont is set to @a false, the iteration loop will will exited
 	 */
 	template <typename A>
 	void IterateQuotes(UTILS::CurrencyPair cp, bool bid, A action) const
 	{
-		UTILS::BidAskPair<Quote::Ptr> result { nullptr, nullptr };
-		std::shared_lock lockMap { m_quoteVectorMap.Mutex() };
-		const auto &it { m_quoteVectorMap->find(cp) };
-		if (it != m_quoteVectorMap->end())
+		if (const BookSnapshot::Ptr snapshot { GetSnapshot(cp, bid) })
 		{
-			std::shared_lock lock { GetLock(cp, bid) };
-			QuoteVecPtrToConst quotes { it->second.Get(bid) };
-			if (!quotes->empty())
-			{
-				bool cont { true };
-				for (const auto &q: *quotes)
-				{
-					action(q, cont);
-					if (!cont)
-					{
-						break;
-					}
-				}
-			}
+			snapshot->ForEachQuote(action);
+		}
+	}
+	
+	/**
+	 * Executes an action for each level of a ccy pair and side that is quoted by some venues.
+	 * @tparam A Template type for action to be executed
+	 * @param cp Currency pair
+	 * @param bid @a true -> bid, @a false -> ask
+	 * @param venues Venues to be included (e.g. VenueBit(FindVenue(session)))
+	 * @param action Action to be executed for each level.
+	 * 					Signature: void action(const LevelView &level, int64_t volume, bool &cont),
+	 * 					           @a volume being the volume quoted by @a venues at the level.
+	 * 					           If @a cont is set to @a false, the iteration loop will be exited
+	 */
+	template <typename A>
+	void IterateVenueLevels(UTILS::CurrencyPair cp, bool bid, VenueMask venues, A action) const
+	{
+		if (const BookSnapshot::Ptr snapshot { GetSnapshot(cp, bid) })
+		{
+			snapshot->ForEachLevel(venues, action);
 		}
 	}
 	
 	/**
 	 * This function returns the current best prices (bid/ask) of a given ccy pair. The choice may be constrained by several parameters
 	 *
-	 * @tparam P Function template: (bool, Quote&) -> bool
+	 * @tparam P Function template: (bool, const Quote&) -> bool
 	 * @param cp Currency pair
 	 * @param acceptPredicate Predicate that returns @a true if the quote is accepted, @a false otherwise
 	 * @param allowSkewSafePrices @a true -> Quotes from skew-safe sessions may be included
@@ -142,41 +396,47 @@ public:
 		return { bestQuotes.Bid() ? bestQuotes.Bid()->Price() : 0, bestQuotes.Ask() ? bestQuotes.Ask()->Price() : 0 };
 	}
 	
+	/** @brief Returns the best prices (bid/ask) of a given ccy pair (lock-free). */
 	UTILS::BidAskPair<int64_t> GetBestPrices(UTILS::CurrencyPair cp) const;
 	
+	/** @brief Returns a consistent copy of the best bid and ask levels of a given ccy pair (lock-free). */
+	TopOfBook GetTopOfBook(UTILS::CurrencyPair cp) const;
+	
+	/** @brief Reads the best bids and asks of several instruments in one pass (lock-free).
+	 *
+	 * @param ids Instrument ids (see GetInstrumentId()), resolved once instead of per query
+	 * @param out Receives one element per id (zeros for unknown ids); reused between calls, it does not allocate
+	 */
+	void GetTopOfBooks(const std::vector<int> &ids, BboBatch &out) const { m_bbo.Read(ids.data(), ids.size(), out); }
+	
+	/** @brief Reads the best bids and asks of all registered instruments, indexed by instrument id (lock-free). */
+	void GetTopOfBooks(BboBatch &out) const { m_bbo.ReadAll(size_t(m_registry.Count()), out); }
+	
 	int64_t GetBestPrice(UTILS::CurrencyPair cp, bool bid) const;
 	
 	template <typename P>
 	int64_t GetBestPrice(UTILS::CurrencyPair cp, bool bid, P acceptPredicate) const
 	{
-		Quote::Ptr quote { GetBestQuote(cp, bid, std::move(acceptPredicate)) };
+		const std::optional<Quote> quote { GetBestQuote(cp, bid, std::move(acceptPredicate)) };
 		return quote ? quote->Price() : 0;
 	}
 
-	Quote::Ptr GetBestQuote(UTILS::CurrencyPair cp, bool bid) const;
+	std::optional<Quote> GetBestQuote(UTILS::CurrencyPair cp, bool bid) const;
 	
 	template <typename P>
-	Quote::Ptr GetBestQuote(UTILS::CurrencyPair cp, bool bid, P acceptPredicate) const
+	std::optional<Quote> GetBestQuote(UTILS::CurrencyPair cp, bool bid, P acceptPredicate) const
 	{
-		Quote::Ptr result { nullptr };
-		std::shared_lock lockMap { m_quoteVectorMap.Mutex() };
-		const auto &it { m_quoteVectorMap->find(cp) };
-		if (it != m_quoteVectorMap->end())
+		std::optional<Quote> result;
+		if (const BookSnapshot::Ptr snapshot { GetSnapshot(cp, bid) })
 		{
-			std::shared_lock lock { GetLock(cp, bid) };
-			QuoteVecPtrToConst quotes { it->second.Get(bid) };
-			lockMap.unlock();
-			if (!quotes->empty())
+			snapshot->ForEachQuote([&result](const Quote &q, bool &cont)
 			{
-				for (const auto &q: *quotes)
+				if (q.Price() > 0)
 				{
-					if (q->Price() > 0 )
-					{
-						result = q;
-						break;
-					}
+					result = q;
+					cont = false;
 				}
-			}
+			});
 		}
 		return result;
 	}
@@ -191,52 +451,114 @@ public:
 	}
 	
 	template <typename P>
-	UTILS::BidAskPair<Quote::Ptr> GetBestQuotes(UTILS::CurrencyPair cp, P acceptPredicate) const
+	UTILS::BidAskPair<std::optional<Quote>> GetBestQuotes(UTILS::CurrencyPair cp, P acceptPredicate) const
 	{
-		UTILS::BidAskPair<Quote::Ptr> result { nullptr, nullptr };
-		std::shared_lock lockMap { m_quoteVectorMap.Mutex() };
-		const auto &it { m_quoteVectorMap->find(cp) };
-		if (it != m_quoteVectorMap->end())
+		UTILS::BidAskPair<std::optional<Quote>> result { std::nullopt, std::nullopt };
+		for (bool bid: { true, false })
 		{
-			for (bool bid: { true, false })
+			if (const BookSnapshot::Ptr snapshot { GetSnapshot(cp, bid) })
 			{
-				std::shared_lock lock { GetLock(cp, bid) };
-				QuoteVecPtrToConst quotes { it->second.Get(bid) };
-				if (quotes && !quotes->empty())
+				snapshot->ForEachQuote([&result, &acceptPredicate, bid](const Quote &q, bool &cont)
 				{
-					for (const auto &q: *quotes)
+					if (q.Price() > 0 && acceptPredicate(bid, q))
 					{
-						if (q->Price() > 0 && acceptPredicate(bid, *q))
-						{
-							result.Get(bid) = q;
-							break;
-						}
+						result.Get(bid) = q;
+						cont = false;
 					}
-				}
+				});
 			}
 		}
 		return result;
 	}
 	
-	UTILS::BidAskPair<Quote::Ptr> GetBestQuotes(UTILS::CurrencyPair cp) const;
+	UTILS::BidAskPair<std::optional<Quote>> GetBestQuotes(UTILS::CurrencyPair cp) const;
 	
 	void AddEntry(int64_t key, int64_t refKey,
-				  int64_t receiveTime, UTILS::CurrencyPair cp, const UTILS::NormalizedMDData::Entry &entry);
+				  int64_t receiveTime, UTILS::CurrencyPair cp, const UTILS::NormalizedMDData::Entry &entry, int venue = 0);
 	
 	void AddEntry(int64_t key, int64_t refKey, int64_t sendTime, int64_t receiveTime, UTILS::CurrencyPair cp,
-				  const UTILS::NormalizedMDData::Entry &entry);
+				  const UTILS::NormalizedMDData::Entry &entry, int venue = 0);
+	
+	/** @brief Update of a batch (see ApplyBatch()) */
+	struct BatchEntry
+	{
+		int64_t key { 0 };
+		int64_t refKey { 0 };
+		const UTILS::NormalizedMDData::Entry *entry { nullptr }; //!< instrument, side, price, volume, ... of the update
+	};
+	
+	/** @brief Applies the updates of one exchange message as one change of the book.
+	 *
+	 * The updates of each instrument are handed to its writer thread in one
+	 * go (see BookShard::PostBatch()) and applied back to back: no snapshot
+	 * is taken and no event is published in between, and the quote counts,
+	 * versions and top of book of the changed sides are published once,
+	 * after the last update. Readers see the instrument either before or
+	 * after the message. All quotes get the same sorting time.
+	 *
+	 * @param entries Updates in the order of the message
+	 * @param count   Number of updates
+	 */
+	void ApplyBatch(const BatchEntry *entries, size_t count, int64_t sendTime, int64_t receiveTime, int venue = 0);
 	
 	size_t GetQuoteCount(UTILS::CurrencyPair cp, bool bid) const;
 	
 	void Clear();
 	
-	Quote::Ptr GetLastQuote() const;
+	/*! \brief Returns the quote applied last (lock-free).
+	 *
+	 * Each writer thread publishes the last quote of its batches to a
+	 * LastQuoteRecord of its own; the most recent of these is returned.
+	 */
+	std::optional<Quote> GetLastQuote() const;
 
 protected:
 	
-	using QuoteVectorMap = std::map<UTILS::CurrencyPair, UTILS::BidAskPair<QuoteVecPtr>>;
-	
-	UTILS::SharedLockable<QuoteVectorMap> m_quoteVectorMap;
+	/** @brief Changes of one side not yet published (writer thread only). */
+	struct PendingChange
+	{
+		bool changed { false };
+		bool cleared { false }; //!< cleared by Clear() since the last publication
+		int64_t bestPrice { 0 }; //!< best price touched since the last publication
+		int64_t publishedPrice { 0 }; //!< best price / volume reported last
+		int64_t publishedVolume { 0 };
+	};
+	
+	/** @brief Book of a single instrument. */
+	struct InstrumentBook
+	{
+		InstrumentBook(int instrumentId, UTILS::CurrencyPair instrument)
+				: id(instrumentId), cp(instrument), ladders(PriceLadder(true), PriceLadder(false)),
+				  expiry { ExpiryWheel(UTILS::CurrentTimestamp()), ExpiryWheel(UTILS::CurrentTimestamp()) } { }
+		
+		const int id;
+		const UTILS::CurrencyPair cp;
+		UTILS::BidAskPair<PriceLadder> ladders; //!< modified by the writer thread only
+		std::array<std::atomic<uint64_t>, 2> versions { }; //!< bid, ask: incremented with every change
+		std::array<std::atomic<size_t>, 2> quoteCounts { }; //!< bid, ask
+		std::array<SnapshotSlot, 2> snapshots; //!< bid, ask: latest snapshot taken
+		std::array<std::atomic_bool, 2> snapshotFollowed { }; //!< bid, ask: the writer retakes the snapshot after changes
+		std::array<size_t, 2> snapshotLevels { }; //!< bid, ask: levels retaken while followed, the most asked for (writer only)
+		std::array<std::atomic_bool, 2> snapshotRead { }; //!< bid, ask: the snapshot has been read since it was taken
+		std::array<int, 2> snapshotUnread { }; //!< bid, ask: snapshots retaken in a row without being read (writer only)
+		std::array<bool, 2> snapshotPending { }; //!< bid, ask: listed in the pending snapshots of its shard (writer only)
+		TopOfBookRecord topOfBook;
+		std::array<ExpiryWheel, 2> expiry; //!< bid, ask: expiry times of the quotes (writer only)
+		std::array<PendingChange, 2> changes; //!< bid, ask (writer only)
+		std::array<bool, 2> unpublished { }; //!< bid, ask: changed by a batch not applied completely yet (writer only)
+		bool pending { false }; //!< listed in the pending books of its shard (writer only)
+		bool keptBack { false }; //!< events refused by the full dispatcher (writer only)
+		std::atomic<int64_t> updateId { 0 }; //!< last update id of the feed (see SetUpdateId())
+		std::atomic<VenueMask> restoredVenues { 0 }; //!< venues with restored quotes not claimed yet (see ClaimRestoredQuotes())
+	};
+	
+	InstrumentRegistry m_registry;
+	
+	std::array<std::unique_ptr<InstrumentBook>, MAX_INSTRUMENTS> m_books; //!< indexed by instrument id
+	
+	std::vector<std::unique_ptr<BookShard>> m_shards; //!< instrument id % shard count -> writer
+	
+	BboTable<MAX_INSTRUMENTS> m_bbo; //!< best levels of all instruments, indexed by instrument id
 	
 	/** @brief Connection type name.
 	 *
@@ -250,27 +572,79 @@ protected:
 
 private:
 	
-	Quote::Ptr m_lastQuote;
+	std::unique_ptr<LastQuoteRecord[]> m_lastQuotes; //!< per shard: last quote applied by its writer thread
 	
-	void AddQuote(UTILS::CurrencyPair cp, bool bid, Quote::Ptr quote);
-
-	OrderBook::QuoteVec::const_iterator getNextLevel(QuoteGroup::Ptr &quoteGroup, const QuoteVec &srcVec, const BookView::QuotePred &quotePred,
-													QuoteVec::const_iterator iterator) const;
+	UTILS::Lockable<std::vector<std::string>> m_venues { std::vector<std::string>(1) }; //!< venue id -> session name
+	
+	std::atomic<size_t> m_maxLevels { 0 };
+	std::atomic<size_t> m_maxQuotesPerLevel { 0 };
+	std::atomic<int64_t> m_maxQuoteAge { 0 };
+	std::atomic<int64_t> m_cleanupInterval { 0 };
+	std::atomic<uint64_t> m_evictedCount { 0 };
+	
+	void AddQuote(UTILS::CurrencyPair cp, bool bid, const Quote &quote);
+	
+	static Quote CreateQuote(int64_t key, int64_t refKey, int64_t sendTime, int64_t receiveTime, int64_t sortTime,
+							 UTILS::CurrencyPair cp, const UTILS::NormalizedMDData::Entry &entry, int venue);
+	
+	int FindOrRegisterInstrument(UTILS::CurrencyPair cp);
+	
+	void ApplyQuote(InstrumentBook &book, bool bid, const Quote &quote, bool last);
+	
+	void PublishSide(InstrumentBook &book, bool bid);
+	
+	void PublishTopOfBook(InstrumentBook &book, bool bid);
 	
-	/** @brief Type alias for map of shared exclusive locks. */
-	using AccessMap = std::map<UTILS::CurrencyPair, std::unique_ptr<std::shared_mutex>>;
+	void PublishTopOfBook(InstrumentBook &book);
 	
-	/** @brief Maps for shared exclusive locks (@a ask and @a bid side. */
-	mutable UTILS::SharedLockable<UTILS::BidAskPair<AccessMap>> m_accessMap;
+	InstrumentBook *FindBook(UTILS::CurrencyPair cp, int *id = nullptr) const;
 	
-	UTILS::SharedLockable<std::map<UTILS::CurrencyPair, UTILS::BidAskPair<std::optional<int64_t>>>>
-			m_lastCleanupMap; //!< timestamps of last call to CleanupQuoteVec()
+	BookSnapshot::Ptr GetSnapshot(UTILS::CurrencyPair cp, bool bid, size_t levels) const;
 	
-	std::shared_mutex &GetLock(UTILS::CurrencyPair cp, bool bid) const;
+	static void IterateQuoteGroups(const BookSnapshot &snapshot, const BookView::QuoteGroupFunc &action, const BookView::QuotePred &quotePred);
 	
-	void CleanupQuoteVec(UTILS::CurrencyPair cp, QuoteVec &vec, int64_t maxAge);
+	BookShard &Shard(int id) const { return *m_shards[size_t(id) % m_shards.size()]; }
 	
-	std::optional<int64_t> GetLastCleanupTime(UTILS::CurrencyPair cp, bool bid) const;
+	std::mutex m_limitsMtx; //!< serialises SetLimits()
+	UTILS::Timer m_expiryTimer;
+	
+	UTILS::Lockable<std::string> m_snapshotFile; //!< saved periodically and on shutdown (empty -> none)
+	UTILS::Timer m_snapshotTimer;
+	
+	void StartSnapshots(const std::string &path, int64_t interval);
+	
+	void EnforceLimits(InstrumentBook &book, bool bid, const Quote &quote);
+	
+	size_t ExpireQuotes(InstrumentBook &book, bool bid, int64_t now);
+	
+	static uint64_t HandleTag(QuoteHandle handle) { return uint64_t(handle.slot) << 32 | handle.generation; }
+	
+	using PublisherList = std::vector<ORDERBOOK::IPublisher::Ptr>;
+	
+	UTILS::Lockable<std::shared_ptr<const PublisherList>> m_publishers; //!< replaced, never modified
+	std::atomic_bool m_publishing { false }; //!< any publishers registered?
+	std::vector<std::vector<int>> m_pendingBooks; //!< per shard: ids of books with unpublished changes (writer only)
+	std::vector<std::vector<std::pair<int, bool>>> m_pendingSnapshots; //!< per shard: followed sides changed in the batch (writer only)
+	mutable EventDispatcher m_dispatcher; //!< calls the publishers
+	std::atomic<int64_t> m_keptBackCount { 0 }; //!< books whose events the dispatcher refused (see PublishChanges())
+	
+	void NoteChange(InstrumentBook &book, bool bid, int64_t price);
+	
+	void EndBatch(size_t shardIdx);
+	
+	void PublishSnapshots(size_t shardIdx);
+	
+	void PublishChanges(size_t shardIdx);
+	
+	void Dispatch(const std::vector<ORDERBOOK::BookEvent> &events);
+	
+	std::shared_ptr<const PublisherList> Publishers();
+	
+	bool Bounded() const
+	{
+		return m_maxLevels.load(std::memory_order_relaxed) > 0 || m_maxQuotesPerLevel.load(std::memory_order_relaxed) > 0 ||
+			   m_maxQuoteAge.load(std::memory_order_relaxed) > 0;
+	}
 };
 
 } // namespace BOOK
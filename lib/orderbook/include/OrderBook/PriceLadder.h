@@ -0,0 +1,361 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#ifndef COROUT_PRICELADDER_H
+#define COROUT_PRICELADDER_H
+
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <optional>
+
+#include "Utils/FlatHashMap.h"
+#include "OrderBook/DepthIndex.h"
+#include "OrderBook/Quote.h"
+
+#define DFLT_LADDER_WINDOW 4096 // price levels held in the directly indexed window (multiple of 64)
+
+namespace CORE {
+namespace BOOK {
+
+/*! \brief Price-indexed ladder holding the quotes of one side of an order book
+ *
+ * Levels close to the top of the book live in a fixed window of slots that is
+ * indexed by (price - base) / tick, so locating a level is a subtraction and a
+ * division instead of a search. An occupancy bitmap over the window lets the
+ * next best level be found with a bit scan when the best level disappears.
+ * Levels that fall outside the window (far from the touch) are kept in a sparse
+ * overflow map, sorted best first.
+ *
+ * The tick is learned from the prices seen (greatest common divisor of the
+ * price distances), so no instrument configuration is needed. The window is
+ * re-centred when the best price leaves it; the best level is always inside
+ * the window unless the ladder is empty.
+ *
+ * Within a level, quotes are sorted by volume (greater volume first). Each
+ * level keeps its aggregates (total volume, minimum quantity, venues quoting
+ * at the level) up to date as quotes are added and removed, so depth queries
+ * need not sum up the quotes. Quotes of all venues share the ladder, so the
+ * levels are the consolidated book.
+ *
+ * The level totals are also entered into a DepthIndex (Fenwick trees over the
+ * window slots), so cumulative depth queries are answered in O(log n) without
+ * walking the levels, and by other threads than the writer (see Depth()).
+ *
+ * The ladder keeps an index from quote key to price, so a quote referenced by
+ * an UPDATE/DELETE is located without scanning the side.
+ *
+ * Trim() bounds the depth of the ladder: the worst levels beyond a maximum
+ * level count and the smallest quotes beyond a maximum per level are evicted.
+ * The worst level is found from the far end of the occupancy bitmap (or the
+ * end of the overflow map), so trimming does not scan the ladder.
+ *
+ * The ladder itself is not thread-safe; the owning order book serialises
+ * access. Only Depth() may be read while the ladder is being modified.
+ */
+class PriceLadder
+{
+public:
+	/*! \brief Quotes of a single price level. */
+	using QuoteVec = std::vector<Quote>;
+
+	/*! \brief A single price level. */
+	struct Level
+	{
+		int64_t price { 0 };
+		int64_t totalVolume { 0 }; //!< sum of the volumes of the quotes
+		int64_t minQty { 0 }; //!< greatest minimum quantity of the quotes (as in QuoteGroup)
+		VenueMask venues { 0 }; //!< venues of the quotes
+		QuoteVec quotes; //!< quotes at this price, greater volume first
+
+		size_t QuoteCount() const { return quotes.size(); }
+	};
+
+	/*! \brief Constructor.
+	 *
+	 * @param bid        @a true -> bid side (higher price is better), @a false -> ask side
+	 * @param windowSize Number of directly indexed levels (rounded up to a multiple of 64)
+	 */
+	explicit PriceLadder(bool bid, size_t windowSize = DFLT_LADDER_WINDOW);
+
+	bool Bid() const { return m_bid; }
+
+	bool Empty() const { return m_quoteCount == 0; }
+
+	size_t QuoteCount() const { return m_quoteCount; }
+
+	size_t LevelCount() const { return m_levelCount; }
+
+	/*! \brief Price increment learned so far (0 while less than two distinct prices have been seen). */
+	int64_t Tick() const { return m_tick; }
+
+	/*! \brief Returns the best level, or @a nullptr if the ladder is empty. */
+	const Level *BestLevel() const { return m_bestIdx >= 0 ? &m_slots[m_bestIdx] : nullptr; }
+
+	/*! \brief Cumulative level totals, readable by any thread while the ladder is modified. */
+	const DepthIndex &Depth() const { return m_depth; }
+
+	/*! \brief Returns the level at a given price, or @a nullptr if there is none. */
+	const Level *FindLevel(int64_t price) const;
+
+	/*! \brief Returns the number of levels better than @a price (the index a level at this price has or would have). */
+	size_t LevelIndex(int64_t price) const;
+
+	/*! \brief Adds a quote to the level at its price (the level is created if necessary). */
+	void Insert(const Quote &quote);
+
+	/*! \brief Returns @a true if a quote with the given key is in the ladder. */
+	bool Contains(int64_t key) const { return m_keyIndex.Contains(key); }
+
+	/*! \brief Returns the quote with the given key, or @a nullptr if there is none (valid until the ladder changes). */
+	const Quote *Find(int64_t key) const;
+
+	/*! \brief Removes the quote with the given key.
+	 *
+	 * @return The removed quote, or @a std::nullopt if no quote with this key exists
+	 */
+	std::optional<Quote> Remove(int64_t key);
+
+	/*! \brief Removes all quotes fulfilling a predicate.
+	 *
+	 * @param pred Predicate, signature: bool pred(const Quote &quote)
+	 * @return Number of quotes removed
+	 */
+	template <typename P>
+	size_t RemoveIf(P pred)
+	{
+		const DepthUpdate update { *this };
+		size_t removed { 0 };
+		m_emptied.clear();
+		forEachLevel(*this, [this, &pred, &removed](Level &level, bool &)
+		{
+			const auto itEnd { std::remove_if(level.quotes.begin(), level.quotes.end(), pred) };
+			removed += size_t(level.quotes.end() - itEnd);
+			for (auto it { itEnd }; it != level.quotes.end(); ++it)
+			{
+				m_keyIndex.Erase(it->Key());
+			}
+			if (itEnd == level.quotes.end())
+			{
+				return;
+			}
+			level.quotes.erase(itEnd, level.quotes.end());
+			if (level.quotes.empty())
+			{
+				m_emptied.push_back(level.price);
+			}
+			else
+			{
+				recalcAggregates(level);
+			}
+		});
+		for (int64_t price: m_emptied)
+		{
+			eraseLevel(price);
+		}
+		m_quoteCount -= removed;
+		if (removed > 0)
+		{
+			rebuildDepth(); // bulk removal: the index is rebuilt once instead of per level
+		}
+		return removed;
+	}
+
+	/*! \brief Evicts quotes exceeding the depth limits.
+	 *
+	 * Levels are evicted worst first until at most @a maxLevels are left; quotes
+	 * of the level touched by the last Insert() are evicted smallest first until
+	 * at most @a maxQuotesPerLevel are left.
+	 *
+	 * @param maxLevels         Maximum number of levels (0 -> unlimited)
+	 * @param maxQuotesPerLevel Maximum number of quotes per level (0 -> unlimited)
+	 * @param onEvict           Called for each evicted quote, signature: void onEvict(const Quote &quote)
+	 * @return Number of quotes evicted
+	 */
+	template <typename F>
+	size_t Trim(size_t maxLevels, size_t maxQuotesPerLevel, F onEvict)
+	{
+		const DepthUpdate update { *this };
+		size_t evicted { 0 };
+		if (maxQuotesPerLevel > 0 && m_lastInsertPrice)
+		{
+			if (Level *level { findLevel(*m_lastInsertPrice) })
+			{
+				while (level->quotes.size() > maxQuotesPerLevel)
+				{
+					const Quote quote { level->quotes.back() };
+					level->quotes.pop_back();
+					level->totalVolume -= quote.Volume();
+					adjustDepth(level->price, 0, -quote.Volume());
+					if (quote.MinQty() == level->minQty || level->venues != VenueBit(quote.Venue()))
+					{
+						recalcAggregates(*level);
+					}
+					m_keyIndex.Erase(quote.Key());
+					--m_quoteCount;
+					onEvict(quote);
+					++evicted;
+				}
+			}
+		}
+		m_lastInsertPrice.reset();
+		while (maxLevels > 0 && m_levelCount > maxLevels)
+		{
+			Level &level { worstLevel() };
+			for (const auto &quote: level.quotes)
+			{
+				m_keyIndex.Erase(quote.Key());
+				onEvict(quote);
+			}
+			evicted += level.quotes.size();
+			m_quoteCount -= level.quotes.size();
+			level.quotes.clear();
+			adjustDepth(level.price, -1, -level.totalVolume);
+			eraseLevel(level.price);
+		}
+		return evicted;
+	}
+
+	/*! \brief Removes all quotes (the learned tick is kept). */
+	void Clear();
+
+	/*! \brief Executes an action for each level, best level first.
+	 *
+	 * @param action Signature: void action(const Level &level, bool &cont).
+	 *               If @a cont is set to @a false, the iteration is stopped
+	 */
+	template <typename A>
+	void ForEachLevel(A action) const
+	{
+		forEachLevel(*this, action);
+	}
+
+	/*! \brief Executes an action for each quote, best level first.
+	 *
+	 * @param action Signature: void action(const Quote &quote, bool &cont).
+	 *               If @a cont is set to @a false, the iteration is stopped
+	 */
+	template <typename A>
+	void ForEachQuote(A action) const
+	{
+		forEachLevel(*this, [&action](const Level &level, bool &cont)
+		{
+			for (auto it { level.quotes.begin() }; cont && it != level.quotes.end(); ++it)
+			{
+				action(*it, cont);
+			}
+		});
+	}
+
+private:
+
+	/*! \brief Overflow levels, keyed by rank (best level first). */
+	using OverflowMap = std::map<int64_t, Level>;
+
+	const bool m_bid;
+	const int m_windowSize;
+	int64_t m_tick { 0 }; //!< learned price increment (0 -> unknown)
+	int64_t m_base { 0 }; //!< price of slot 0
+	int m_bestIdx { -1 }; //!< slot of the best level (-1 -> ladder empty)
+	std::vector<Level> m_slots;
+	std::vector<uint64_t> m_occupied; //!< one bit per slot
+	OverflowMap m_overflow;
+	UTILS::FlatHashMap<int64_t, int64_t> m_keyIndex; //!< quote key -> price of its level
+	size_t m_quoteCount { 0 };
+	size_t m_levelCount { 0 };
+	std::vector<int64_t> m_emptied; //!< scratch buffer for RemoveIf()
+	std::optional<int64_t> m_lastInsertPrice; //!< level touched by the last Insert() (for Trim())
+	DepthIndex m_depth;
+	int64_t m_overflowVolume { 0 }; //!< totals of the overflow levels (for m_depth)
+	double m_overflowNotional { 0.0 };
+
+	/*! \brief Brackets a change of the ladder, so readers of the depth index see complete changes only */
+	struct DepthUpdate
+	{
+		explicit DepthUpdate(PriceLadder &ladder) : m_ladder(ladder) { m_ladder.m_depth.BeginUpdate(); }
+
+		~DepthUpdate()
+		{
+			m_ladder.publishOverflow();
+			m_ladder.m_depth.EndUpdate();
+		}
+
+		DepthUpdate(const DepthUpdate &) = delete;
+
+		DepthUpdate &operator=(const DepthUpdate &) = delete;
+
+	private:
+		PriceLadder &m_ladder;
+	};
+
+	template <typename Self, typename A>
+	static void forEachLevel(Self &self, A action)
+	{
+		bool cont { true };
+		for (int idx { self.m_bestIdx }; cont && idx >= 0; idx = self.nextWorse(idx))
+		{
+			action(self.m_slots[idx], cont);
+		}
+		for (auto it { self.m_overflow.begin() }; cont && it != self.m_overflow.end(); ++it)
+		{
+			action(it->second, cont);
+		}
+	}
+
+	int64_t step() const { return m_tick > 0 ? m_tick : 1; }
+
+	int64_t rank(int64_t price) const { return m_bid ? -price : price; }
+
+	bool better(int64_t price, int64_t than) const { return m_bid ? price > than : price < than; }
+
+	int homeIndex() const { return m_bid ? m_windowSize - 1 - m_windowSize / 8 : m_windowSize / 8; }
+
+	int slotIndex(int64_t price) const;
+
+	int nextWorse(int idx) const { return m_bid ? findBelow(idx) : findAbove(idx); }
+
+	int findBelow(int idx) const;
+
+	int findAbove(int idx) const;
+
+	size_t countOccupied(int from, int to) const;
+
+	void setBit(int idx) { m_occupied[size_t(idx) >> 6] |= uint64_t(1) << (idx & 63); }
+
+	void clearBit(int idx) { m_occupied[size_t(idx) >> 6] &= ~(uint64_t(1) << (idx & 63)); }
+
+	Level *findLevel(int64_t price);
+
+	Level &findOrCreateLevel(int64_t price);
+
+	Level &worstLevel();
+
+	void eraseLevel(int64_t price);
+
+	void alignTick(int64_t price);
+
+	void recenter(int64_t price);
+
+	void moveSlot(int idx, int64_t target);
+
+	void spill(int idx);
+
+	void pullOverflow();
+
+	void adjustDepth(int64_t price, int levels, int64_t volume);
+
+	void rebuildDepth();
+
+	void publishOverflow();
+
+	static void recalcAggregates(Level &level);
+
+	static void moveLevel(Level &from, Level &to);
+};
+
+} // namespace BOOK
+} // namespace CORE
+
+#endif //COROUT_PRICELADDER_H
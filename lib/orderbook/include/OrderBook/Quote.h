@@ -10,29 +10,71 @@
 #include <vector>
 #include <memory>
 #include <atomic>
+#include <array>
+#include <mutex>
+#include <type_traits>
+#include <optional>
 
 #include "Utils/Utils.h"
 #include "Utils/Lockable.h"
 #include "Utils/CurrencyPair.h"
-#include "Utils/ObjectPool.h"
 
 #define UNLIMITED_QUOTE_AGE  (std::numeric_limits<int64_t>::max()) // no (realistic) age limit
 //#define LIMITED_QUOTE_AGE  	 10'000'000'000 // limited quote age (10s), to avoid using stale quotes
 #define LIMITED_QUOTE_AGE     300'000'000'000 // limited quote age (5min), to avoid using stale quotes
+#define MAX_VENUES            32 // trading sessions told apart by the book (one bit of a VenueMask each)
 
 namespace CORE {
 namespace BOOK {
 
+/*! \brief Set of venues (bit i -> venue i, see OrderBook::RegisterVenue()) */
+using VenueMask = uint32_t;
+
+constexpr VenueMask ALL_VENUES { ~VenueMask(0) };
+
+inline VenueMask VenueBit(int venue) { return venue >= 0 && venue < MAX_VENUES ? VenueMask(1) << venue : 0; }
+
+/*! \brief Reference to the pool slot holding the details of a quote
+ *
+ * A slot is reused after the quote has left the book; the generation tells
+ * whether the slot still belongs to the quote the handle was created for.
+ */
+struct QuoteHandle
+{
+	uint32_t slot { 0 }; //!< slot index + 1 (0 -> no slot)
+	uint32_t generation { 0 };
+
+	bool operator==(const QuoteHandle &other) const { return slot == other.slot && generation == other.generation; }
+
+	bool operator!=(const QuoteHandle &other) const { return !(*this == other); }
+};
+
+/*! \brief Fields of a quote that are not needed on the hot paths of the book */
+struct QuoteDetails
+{
+	int64_t adptReceiveTime { 0 }; // time when quote was received by the adapter
+	int64_t receiptTime { 0 }; // time when quote was received by the engine
+	int64_t sortTime { 0 }; // time when quote was added to the sortbook
+	int64_t seqnum { 0 };
+	uint32_t quoteID { 0 }; //!< interned string (see QuotePool::Intern())
+	uint32_t settlDate { 0 }; //!< interned string
+	uint32_t originator { 0 }; //!< interned string
+};
+
 /*! \brief This class contains all data of a single quote
+ *
+ * A quote is a trivially copyable record of one cache line, so the book
+ * stores quotes by value. The fields used for sorting, aggregating and
+ * matching are held in the record itself; the rarely used fields, the
+ * @a used flag and the successor information live in a slot of the
+ * QuotePool, referenced by a generation-checked handle. Once a quote has
+ * been removed from the book (see QuotePool::Release()) its slot may be
+ * reused: copies of the quote keep their prices and volumes, but are no
+ * longer valid and cannot be used any more.
 */
 class Quote
 {
 public:
-	/*! \brief Shared pointer to a quote. */
-	using Ptr = std::shared_ptr<Quote>;
-	/*! \brief Weak pointer to a quote. */
-	using WkPtr = std::weak_ptr<Quote>;
-	
 	/*! \brief Enumeration of fields that are part of a quote. */
 	enum Field
 	{
@@ -62,19 +104,25 @@ public:
 		fbtNone, fbtInt64, fbtString
 	};
 	
-	Quote(int64_t adptReceiveTime, int64_t receiptTime, int64_t sortTime, std::string quoteID, int64_t seqnum,
-		  int64_t price, int64_t volume, int64_t minQty, int64_t key, int64_t refKey, int64_t sendingTime, int quoteType, int positionNo,
-		  std::string settlDate, std::string originator)
-			: m_adptReceiveTime(adptReceiveTime), m_receiptTime(receiptTime), m_sortTime(sortTime), m_quoteID(std::move(quoteID)),
-			  m_seqnum(seqnum), m_price(price), m_volume(volume), m_minQty(minQty), m_key(key), m_refKey(refKey), m_sendingTime(sendingTime),
-			  m_quoteType(quoteType), m_positionNo(positionNo), m_settlDate(std::move(settlDate)), m_originator(std::move(originator)), m_used(false),
-			  m_successor { 0, 0 } { }
+	/*! \brief Empty quote (no pool slot, never valid). */
+	Quote() = default;
+	
+	Quote(QuoteHandle handle, int64_t price, int64_t volume, int64_t minQty, int64_t key, int64_t refKey,
+		  int64_t sendingTime, int quoteType, int positionNo, int venue = 0)
+			: m_price(price), m_volume(volume), m_minQty(minQty), m_key(key), m_refKey(refKey), m_sendingTime(sendingTime),
+			  m_handle(handle), m_quoteType(int16_t(quoteType)), m_venue(uint16_t(venue)), m_positionNo(int32_t(positionNo)) { }
+	
+	QuoteHandle Handle() const { return m_handle; }
 	
-	int64_t ReceiptTime() const { return m_receiptTime; }
+	bool operator==(const Quote &other) const { return m_handle == other.m_handle; }
 	
-	const std::string &QuoteID() const { return m_quoteID; }
+	bool operator!=(const Quote &other) const { return !(*this == other); }
 	
-	int64_t SeqNum() const { return m_seqnum; }
+	int64_t ReceiptTime() const { return Details().receiptTime; }
+	
+	const std::string &QuoteID() const;
+	
+	int64_t SeqNum() const { return Details().seqnum; }
 	
 	int64_t Price() const { return m_price; }
 	
@@ -88,23 +136,26 @@ public:
 	
 	int64_t SendingTime() const { return m_sendingTime; }
 	
-	const std::string &SettlDate() const { return m_settlDate; }
+	const std::string &SettlDate() const;
 	
 	int QuoteType() const { return m_quoteType; } //!< Quote update type (QT_NEW, QT_UPDATE, QT_DELETE)
 	
 	int PositionNo() const { return m_positionNo; }
 	
-	const std::string &Originator() const { return m_originator; }
+	int Venue() const { return m_venue; } //!< Venue (trading session) the quote came from
+	
+	const std::string &Originator() const;
 	
-	bool Used() const { return m_used.load(); } //!< Has this quote already been used in an order?
+	bool Used() const; //!< Has this quote already been used in an order?
 	
-	bool SetUsed();
+	bool SetUsed() const;
 	
-	bool Valid() const { return m_successor.sent == 0; }
+	bool Valid() const;
 	
 	bool Valid(int64_t &successorSent, int64_t &successorReceived) const;
 	
-	bool SetInvalid(Quote::Ptr successor);
+	/*! \brief Copy of the rarely used fields (all zero if the quote is no longer valid). */
+	QuoteDetails Details() const;
 	
 	int64_t GetInt(Field fld) const;
 	
@@ -128,62 +179,117 @@ public:
 	
 	double AgeSinceReceiptMs() const { return double(AgeSinceReceipt()) / 1000000.0; }
 	
-	int64_t AdptReceiveTime() const { return m_adptReceiveTime; }
+	int64_t AdptReceiveTime() const { return Details().adptReceiveTime; }
 	
-	int64_t ReceiptDelay() const { return ReceiptTime() - AdptReceiveTime(); }
+	int64_t ReceiptDelay() const
+	{
+		const QuoteDetails details { Details() };
+		return details.receiptTime - details.adptReceiveTime;
+	}
 	
 	double ReceiptDelayMs() const { return double(ReceiptDelay()) / 1000000.0; }
 	
-	int64_t SortTime() const { return m_sortTime; }
+	int64_t SortTime() const { return Details().sortTime; }
 	
-	int64_t SortDelay() const { return SortTime() - ReceiptTime(); }
+	int64_t SortDelay() const
+	{
+		const QuoteDetails details { Details() };
+		return details.sortTime - details.receiptTime;
+	}
 	
 	double SortDelayMs() const { return double(SortDelay()) / 1000000.0; }
 	
 private:
-
-	const int64_t m_adptReceiveTime; // time when quote was received by the adapter
-	const int64_t m_receiptTime; // time when quote was received by the engine
-	const int64_t m_sortTime; // time when quote was added to the sortbook
-	const std::string m_quoteID;
-	const int64_t m_seqnum;
-	const int64_t m_price;
-	const int64_t m_volume;
-	const int64_t m_minQty;
-	const int64_t m_key;
-	const int64_t m_refKey;
-	const int64_t m_sendingTime;
-	const int m_quoteType; //!< Quote update type (QT_NEW, QT_UPDATE, QT_DELETE)
-	const int m_positionNo;
-	const std::string m_settlDate;
-	const std::string m_originator;
-	std::atomic_bool m_used;
-	struct
-	{
-		std::atomic_int64_t sent;
-		std::atomic_int64_t received;
-	} m_successor;
+	int64_t m_price { 0 };
+	int64_t m_volume { 0 };
+	int64_t m_minQty { 0 };
+	int64_t m_key { 0 };
+	int64_t m_refKey { 0 };
+	int64_t m_sendingTime { 0 };
+	QuoteHandle m_handle;
+	int16_t m_quoteType { 0 }; //!< Quote update type (QT_NEW, QT_UPDATE, QT_DELETE)
+	uint16_t m_venue { 0 };
+	int32_t m_positionNo { 0 };
 };
 
+static_assert(std::is_trivially_copyable<Quote>::value, "Quote must be trivially copyable");
+static_assert(sizeof(Quote) <= 64, "Quote must fit into one cache line");
+
 
+/*! \brief Pool of quote slots
+ *
+ * Slots are allocated in chunks that are never freed, and recycled through a
+ * lock-free free list, so creating a quote does not allocate once the pool
+ * has grown to the number of quotes alive. Strings are interned: each
+ * distinct string is stored once and quotes refer to it by id (0 -> empty).
+ */
 class QuotePool
 {
 public:
-	static constexpr uint64_t POOL_SIZE = 1L << 20;
+	static constexpr uint32_t CHUNK_SIZE = 1U << 16; //!< slots per chunk
+	static constexpr uint32_t MAX_CHUNKS = 1U << 12; //!< max. 2^28 slots
 
-	template <typename... Args>
-	static Quote::Ptr getQuote(const char* caller, bool objectPoolDisabled, std::thread::id tid, Args... args)
-	{
-		if(objectPoolDisabled || op.isExhausted())
-		{
-			return std::make_unique<Quote>(std::forward<Args>(args)...);
-		}
+	/*! \brief Creates a quote (any thread). */
+	static Quote Create(int64_t adptReceiveTime, int64_t receiptTime, int64_t sortTime, const std::string &quoteID,
+						int64_t seqnum, int64_t price, int64_t volume, int64_t minQty, int64_t key, int64_t refKey,
+						int64_t sendingTime, int quoteType, int positionNo, const std::string &settlDate,
+						const std::string &originator, int venue = 0);
 
-		return Quote::Ptr((op.getObject(caller, tid, std::forward<Args>(args)...)));
-	}
+	/*! \brief Releases the slot of a quote that has been removed from the book.
+	 *
+	 * The quote becomes invalid. If a successor is given, its sending/receipt
+	 * times are recorded (see Quote::Valid(int64_t&, int64_t&)) until the slot
+	 * is reused.
+	 *
+	 * @return @a false if the quote had already been released
+	 */
+	static bool Release(const Quote &quote, const Quote *successor = nullptr);
+
+	/*! \brief Returns the id of an interned string (the string is added if necessary). */
+	static uint32_t Intern(const std::string &str);
+
+	/*! \brief Returns an interned string by id (empty string for unknown ids). */
+	static const std::string &String(uint32_t id);
+
+	/*! \brief Number of slots currently in use. */
+	static size_t SlotsInUse() { return s_inUse.load(std::memory_order_relaxed); }
+
+	/*! \brief Number of slots allocated so far. */
+	static size_t SlotCount() { return s_slotCount.load(std::memory_order_relaxed); }
 
 private:
-	static UTILS::ObjectPool<Quote, POOL_SIZE> op;
+	friend class Quote;
+
+	/*! \brief Slot state: (generation << 2) | (live << 1) | used */
+	static constexpr uint64_t STATE_USED = 1;
+	static constexpr uint64_t STATE_LIVE = 2;
+
+	struct Slot
+	{
+		std::atomic<uint64_t> state { 0 };
+		std::atomic<uint32_t> next { 0 }; //!< next free slot + 1 (free list)
+		std::atomic<int64_t> adptReceiveTime { 0 };
+		std::atomic<int64_t> receiptTime { 0 };
+		std::atomic<int64_t> sortTime { 0 };
+		std::atomic<int64_t> seqnum { 0 };
+		std::atomic<uint32_t> quoteID { 0 };
+		std::atomic<uint32_t> settlDate { 0 };
+		std::atomic<uint32_t> originator { 0 };
+		std::atomic<int64_t> successorSent { 0 };
+		std::atomic<int64_t> successorReceived { 0 };
+	};
+
+	static std::array<std::atomic<Slot *>, MAX_CHUNKS> s_chunks;
+	static std::atomic<uint32_t> s_slotCount; //!< slots handed out from the chunks so far
+	static std::atomic<uint64_t> s_freeHead; //!< (tag << 32) | (slot + 1)
+	static std::atomic<size_t> s_inUse;
+	static std::mutex s_growMtx;
+
+	static Slot *GetSlot(uint32_t handleSlot);
+
+	static uint32_t AllocateSlot();
+
+	static bool ReadDetails(QuoteHandle handle, QuoteDetails &details);
 };
 
 
@@ -194,13 +300,15 @@ class QuoteGroup
 public:
 	/*! \brief  Shared pointer to a quote group */
 	using Ptr = std::shared_ptr<QuoteGroup>;
-	/*! \brief  Vector of shared pointers to a quote group */
-	using QuoteVector = std::vector<Quote::Ptr>;
+	/*! \brief  Vector of quotes */
+	using QuoteVector = std::vector<Quote>;
 	
 	QuoteGroup();
 	
 	explicit QuoteGroup(const QuoteVector &srcVec);
 	
+	QuoteGroup(const Quote *first, const Quote *last);
+	
 	/*! \brief Creates a new quote group
 	 *
 	 * Static function.
@@ -209,11 +317,11 @@ public:
 	 * */
 	static Ptr Create() { return std::make_shared<QuoteGroup>(); }
 	
-	void AddQuote(const Quote::Ptr &q);
+	void AddQuote(const Quote &q);
 	
 	void AddQuotes(const QuoteGroup::Ptr &quoteGroup);
 	
-	bool RemoveQuote(const CORE::BOOK::Quote::Ptr &q);
+	bool RemoveQuote(const CORE::BOOK::Quote &q);
 	
 	void GetQuotes(QuoteVector &vec) const;
 	
@@ -250,7 +358,7 @@ public:
 	}
 	
 	template <typename F>
-	Quote::Ptr FindFirstQuote(F cond) const
+	std::optional<Quote> FindFirstQuote(F cond) const
 	{
 		std::shared_lock lock { m_quotes.Mutex() };
 		for (const auto &q: *m_quotes)
@@ -260,7 +368,7 @@ public:
 				return q;
 			}
 		}
-		return nullptr;
+		return std::nullopt;
 	}
 	
 	/**
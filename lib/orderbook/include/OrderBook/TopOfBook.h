@@ -0,0 +1,328 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#ifndef COROUT_TOPOFBOOK_H
+#define COROUT_TOPOFBOOK_H
+
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Utils/FixTypes.h"
+#include "OrderBook/Quote.h"
+
+namespace CORE {
+namespace BOOK {
+
+/*! \brief Consistent copy of the best bid and ask of one instrument */
+struct TopOfBook
+{
+	UTILS::BidAskPair<int64_t> price { 0, 0 }; //!< best prices (0 -> side empty)
+	UTILS::BidAskPair<int64_t> volume { 0, 0 }; //!< total volume at the best prices
+	UTILS::BidAskPair<int64_t> quoteCount { 0, 0 }; //!< number of quotes at the best prices
+	uint64_t version { 0 }; //!< increases with every published change
+
+	int64_t MidPrice() const { return price.Bid() > 0 && price.Ask() > 0 ? (price.Bid() + price.Ask()) / 2 : 0; }
+
+	int64_t Spread() const { return price.Bid() > 0 && price.Ask() > 0 ? price.Ask() - price.Bid() : 0; }
+};
+
+/*! \brief Top of book of one instrument, published with a sequence lock
+ *
+ * The record fills exactly one cache line. A writer makes the version odd,
+ * updates the fields and makes it even again; a reader copies the fields and
+ * retries if the version was odd or changed meanwhile. Readers never write to
+ * the record, so polling strategy threads do not contend with the feed writer.
+ * Writers of the bid and the ask side are serialised by the version itself
+ * (compare-and-swap from even to odd).
+ */
+class alignas(64) TopOfBookRecord
+{
+public:
+	/*! \brief Publishes the best level of one side. */
+	void Publish(bool bid, int64_t price, int64_t volume, int64_t quoteCount)
+	{
+		uint64_t version { m_version.load(std::memory_order_relaxed) };
+		while ((version & 1) || !m_version.compare_exchange_weak(version, version + 1, std::memory_order_acquire,
+																	std::memory_order_relaxed))
+		{
+			version = m_version.load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+		const size_t side { bid ? 0u : 1u };
+		m_price[side].store(price, std::memory_order_relaxed);
+		m_volume[side].store(volume, std::memory_order_relaxed);
+		m_quoteCount[side].store(int32_t(quoteCount), std::memory_order_relaxed);
+		m_version.store(version + 2, std::memory_order_release);
+	}
+
+	/*! \brief Publishes the best levels of both sides as one change. */
+	void Publish(const TopOfBook &top)
+	{
+		uint64_t version { m_version.load(std::memory_order_relaxed) };
+		while ((version & 1) || !m_version.compare_exchange_weak(version, version + 1, std::memory_order_acquire,
+																	std::memory_order_relaxed))
+		{
+			version = m_version.load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+		for (size_t side { 0 }; side < 2; ++side)
+		{
+			m_price[side].store(top.price.Get(side == 0), std::memory_order_relaxed);
+			m_volume[side].store(top.volume.Get(side == 0), std::memory_order_relaxed);
+			m_quoteCount[side].store(int32_t(top.quoteCount.Get(side == 0)), std::memory_order_relaxed);
+		}
+		m_version.store(version + 2, std::memory_order_release);
+	}
+
+	/*! \brief Copies the record (lock-free, retries while a writer is active). */
+	TopOfBook Read() const
+	{
+		TopOfBook result;
+		uint64_t before;
+		uint64_t after;
+		do
+		{
+			before = m_version.load(std::memory_order_acquire);
+			result.price = { m_price[0].load(std::memory_order_relaxed), m_price[1].load(std::memory_order_relaxed) };
+			result.volume = { m_volume[0].load(std::memory_order_relaxed), m_volume[1].load(std::memory_order_relaxed) };
+			result.quoteCount = { int64_t(m_quoteCount[0].load(std::memory_order_relaxed)),
+								  int64_t(m_quoteCount[1].load(std::memory_order_relaxed)) };
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = m_version.load(std::memory_order_relaxed);
+		} while ((before & 1) || before != after);
+		result.version = before / 2;
+		return result;
+	}
+
+private:
+	std::array<std::atomic<int32_t>, 2> m_quoteCount { }; //!< bid, ask
+	std::atomic<uint64_t> m_version { 0 };
+	std::array<std::atomic<int64_t>, 2> m_price { }; //!< bid, ask
+	std::array<std::atomic<int64_t>, 2> m_volume { }; //!< bid, ask
+};
+
+static_assert(sizeof(TopOfBookRecord) == 64, "TopOfBookRecord must fill exactly one cache line");
+
+/*! \brief Last quote applied by one writer thread, published with a sequence lock
+ *
+ * The record has a single writer (the writer thread of a shard), so, as in
+ * the BboTable, the writer needs no compare-and-swap. The quote is copied
+ * word by word through relaxed atomics; readers retry while the version is
+ * odd or has changed, as for the TopOfBookRecord. The stamp tells which of
+ * the records of several writers was published last.
+ */
+class alignas(64) LastQuoteRecord
+{
+public:
+	/*! \brief Publishes a quote (writer thread only).
+	 *
+	 * @param stamp Time of publication (> 0, see Read())
+	 */
+	void Publish(const Quote &quote, int64_t stamp)
+	{
+		std::array<uint64_t, WORDS> words;
+		std::memcpy(words.data(), &quote, sizeof(Quote));
+		const uint64_t version { m_version.load(std::memory_order_relaxed) };
+		m_version.store(version + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (size_t i { 0 }; i < WORDS; ++i)
+		{
+			m_words[i].store(words[i], std::memory_order_relaxed);
+		}
+		m_stamp.store(stamp, std::memory_order_relaxed);
+		m_version.store(version + 2, std::memory_order_release);
+	}
+
+	/*! \brief Forgets the quote published last (writer thread only). */
+	void Clear()
+	{
+		const uint64_t version { m_version.load(std::memory_order_relaxed) };
+		m_version.store(version + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_stamp.store(0, std::memory_order_relaxed);
+		m_version.store(version + 2, std::memory_order_release);
+	}
+
+	/*! \brief Copies the quote published last (lock-free, retries while the writer is active).
+	 *
+	 * @return Stamp of the quote, 0 if none has been published (@a quote is left untouched)
+	 */
+	int64_t Read(Quote &quote) const
+	{
+		std::array<uint64_t, WORDS> words;
+		int64_t stamp;
+		uint64_t before;
+		uint64_t after;
+		do
+		{
+			before = m_version.load(std::memory_order_acquire);
+			stamp = m_stamp.load(std::memory_order_relaxed);
+			for (size_t i { 0 }; i < WORDS; ++i)
+			{
+				words[i] = m_words[i].load(std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = m_version.load(std::memory_order_relaxed);
+		} while ((before & 1) || before != after);
+		if (stamp > 0)
+		{
+			std::memcpy(&quote, words.data(), sizeof(Quote));
+		}
+		return stamp;
+	}
+
+private:
+	static constexpr size_t WORDS { sizeof(Quote) / sizeof(uint64_t) };
+
+	std::atomic<uint64_t> m_version { 0 }; //!< odd -> write in progress
+	std::atomic<int64_t> m_stamp { 0 }; //!< 0 -> no quote
+	std::array<std::atomic<uint64_t>, WORDS> m_words { };
+};
+
+static_assert(sizeof(Quote) % sizeof(uint64_t) == 0, "Quote must be copied in whole words");
+
+/*! \brief Best bids and asks of a set of instruments, as arrays (see BboTable::Read()) */
+struct BboBatch
+{
+	std::vector<int64_t> bidPrice; //!< 0 -> side empty or instrument unknown
+	std::vector<int64_t> askPrice;
+	std::vector<int64_t> bidVolume;
+	std::vector<int64_t> askVolume;
+
+	size_t Size() const { return bidPrice.size(); }
+
+	/*! \brief Sets the number of instruments (allocates only if the batch grows). */
+	void Resize(size_t n)
+	{
+		bidPrice.resize(n);
+		askPrice.resize(n);
+		bidVolume.resize(n);
+		askVolume.resize(n);
+	}
+
+	/*! \brief Writes the mid prices to @a out (Size() elements, 0 if a side is empty). */
+	void MidPrices(int64_t *out) const
+	{
+		const size_t n { Size() };
+		const int64_t *bid { bidPrice.data() };
+		const int64_t *ask { askPrice.data() };
+		for (size_t i { 0 }; i < n; ++i) // branch-free, so the loop vectorizes
+		{
+			out[i] = (bid[i] > 0 && ask[i] > 0) ? (bid[i] + ask[i]) / 2 : 0;
+		}
+	}
+
+	/*! \brief Writes the spreads to @a out (Size() elements, 0 if a side is empty). */
+	void Spreads(int64_t *out) const
+	{
+		const size_t n { Size() };
+		const int64_t *bid { bidPrice.data() };
+		const int64_t *ask { askPrice.data() };
+		for (size_t i { 0 }; i < n; ++i)
+		{
+			out[i] = (bid[i] > 0 && ask[i] > 0) ? ask[i] - bid[i] : 0;
+		}
+	}
+};
+
+/*! \brief Best bid and ask of all instruments of an order book, as a structure of arrays
+ *
+ * The fields of all instruments are held in one array per field, indexed by
+ * instrument id, so a query over many instruments reads a few contiguous
+ * arrays instead of one record per instrument. Each instrument has its own
+ * sequence lock; its fields are only written by the writer thread of the
+ * instrument, so writers need no compare-and-swap.
+ *
+ * @tparam N Maximum number of instruments
+ */
+template <size_t N>
+class BboTable
+{
+public:
+	/*! \brief Publishes the best level of one side (writer thread of the instrument only). */
+	void Publish(int id, bool bid, int64_t price, int64_t volume)
+	{
+		const size_t idx { size_t(id) };
+		const uint32_t version { m_version[idx].load(std::memory_order_relaxed) };
+		m_version[idx].store(version + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		(bid ? m_bidPrice : m_askPrice)[idx].store(price, std::memory_order_relaxed);
+		(bid ? m_bidVolume : m_askVolume)[idx].store(volume, std::memory_order_relaxed);
+		m_version[idx].store(version + 2, std::memory_order_release);
+	}
+
+	/*! \brief Publishes the best levels of both sides as one change (writer thread of the instrument only). */
+	void Publish(int id, const TopOfBook &top)
+	{
+		const size_t idx { size_t(id) };
+		const uint32_t version { m_version[idx].load(std::memory_order_relaxed) };
+		m_version[idx].store(version + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bidPrice[idx].store(top.price.Bid(), std::memory_order_relaxed);
+		m_askPrice[idx].store(top.price.Ask(), std::memory_order_relaxed);
+		m_bidVolume[idx].store(top.volume.Bid(), std::memory_order_relaxed);
+		m_askVolume[idx].store(top.volume.Ask(), std::memory_order_relaxed);
+		m_version[idx].store(version + 2, std::memory_order_release);
+	}
+
+	/*! \brief Reads the best levels of the given instruments into @a out (ids out of range -> zeros). */
+	void Read(const int *ids, size_t n, BboBatch &out) const
+	{
+		out.Resize(n);
+		for (size_t i { 0 }; i < n; ++i)
+		{
+			if (ids[i] >= 0 && size_t(ids[i]) < N)
+			{
+				readOne(size_t(ids[i]), out, i);
+			}
+			else
+			{
+				out.bidPrice[i] = out.askPrice[i] = out.bidVolume[i] = out.askVolume[i] = 0;
+			}
+		}
+	}
+
+	/*! \brief Reads the best levels of the instruments with ids 0 .. @a n - 1 into @a out. */
+	void ReadAll(size_t n, BboBatch &out) const
+	{
+		n = std::min(n, N);
+		out.Resize(n);
+		for (size_t id { 0 }; id < n; ++id)
+		{
+			readOne(id, out, id);
+		}
+	}
+
+private:
+	std::array<std::atomic<uint32_t>, N> m_version { }; //!< odd -> write in progress
+	std::array<std::atomic<int64_t>, N> m_bidPrice { };
+	std::array<std::atomic<int64_t>, N> m_askPrice { };
+	std::array<std::atomic<int64_t>, N> m_bidVolume { };
+	std::array<std::atomic<int64_t>, N> m_askVolume { };
+
+	void readOne(size_t id, BboBatch &out, size_t i) const
+	{
+		uint32_t before;
+		uint32_t after;
+		do
+		{
+			before = m_version[id].load(std::memory_order_acquire);
+			out.bidPrice[i] = m_bidPrice[id].load(std::memory_order_relaxed);
+			out.askPrice[i] = m_askPrice[id].load(std::memory_order_relaxed);
+			out.bidVolume[i] = m_bidVolume[id].load(std::memory_order_relaxed);
+			out.askVolume[i] = m_askVolume[id].load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = m_version[id].load(std::memory_order_relaxed);
+		} while ((before & 1) || before != after);
+	}
+};
+
+} // namespace BOOK
+} // namespace CORE
+
+#endif //COROUT_TOPOFBOOK_H
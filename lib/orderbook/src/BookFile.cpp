@@ -0,0 +1,159 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "OrderBook/BookFile.h"
+
+using namespace UTILS;
+
+namespace CORE {
+namespace BOOK {
+
+namespace BOOKFILE {
+
+void SetName(char (&field)[NAME_SIZE], const std::string &name)
+{
+	const size_t len { std::min(name.size(), NAME_SIZE - 1) };
+	std::memset(field, 0, NAME_SIZE);
+	std::memcpy(field, name.data(), len);
+}
+
+std::string GetName(const char (&field)[NAME_SIZE])
+{
+	return std::string(field, strnlen(field, NAME_SIZE));
+}
+
+} // namespace BOOKFILE
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+		: m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)),
+		  m_path(std::move(other.m_path)), m_tmpPath(std::move(other.m_tmpPath)) { }
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		m_data = std::exchange(other.m_data, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+		m_path = std::move(other.m_path);
+		m_tmpPath = std::move(other.m_tmpPath);
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+BoolResult MappedFile::Create(const std::string &path, size_t size)
+{
+	Close();
+	const std::string tmpPath { path + ".tmp" };
+	const int fd { ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) };
+	if (fd < 0)
+	{
+		return BoolResult(false, "Cannot create %s: %s", tmpPath, std::string(std::strerror(errno)));
+	}
+	if (::ftruncate(fd, off_t(size)) != 0)
+	{
+		const std::string error { std::strerror(errno) };
+		::close(fd);
+		::unlink(tmpPath.c_str());
+		return BoolResult(false, "Cannot resize %s: %s", tmpPath, error);
+	}
+	void *data { ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) };
+	const std::string error { std::strerror(errno) };
+	::close(fd); // the mapping keeps the file open
+	if (data == MAP_FAILED)
+	{
+		::unlink(tmpPath.c_str());
+		return BoolResult(false, "Cannot map %s: %s", tmpPath, error);
+	}
+	m_data = static_cast<char *>(data);
+	m_size = size;
+	m_path = path;
+	m_tmpPath = tmpPath;
+	return true;
+}
+
+BoolResult MappedFile::Open(const std::string &path)
+{
+	Close();
+	const int fd { ::open(path.c_str(), O_RDONLY) };
+	if (fd < 0)
+	{
+		return BoolResult(false, "Cannot open %s: %s", path, std::string(std::strerror(errno)));
+	}
+	struct stat st { };
+	if (::fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		::close(fd);
+		return BoolResult(false, "%s is empty or cannot be read", path);
+	}
+	void *data { ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0) };
+	const std::string error { std::strerror(errno) };
+	::close(fd);
+	if (data == MAP_FAILED)
+	{
+		return BoolResult(false, "Cannot map %s: %s", path, error);
+	}
+	m_data = static_cast<char *>(data);
+	m_size = size_t(st.st_size);
+	m_path = path;
+	return true;
+}
+
+BoolResult MappedFile::Commit()
+{
+	if (!m_data || m_tmpPath.empty())
+	{
+		return BoolResult(false, "No file to commit");
+	}
+	if (::msync(m_data, m_size, MS_SYNC) != 0)
+	{
+		return BoolResult(false, "Cannot write %s: %s", m_tmpPath, std::string(std::strerror(errno)));
+	}
+	::munmap(m_data, m_size);
+	m_data = nullptr;
+	m_size = 0;
+	if (std::rename(m_tmpPath.c_str(), m_path.c_str()) != 0)
+	{
+		const BoolResult result { false, "Cannot rename %s to %s: %s", m_tmpPath, m_path, std::string(std::strerror(errno)) };
+		::unlink(m_tmpPath.c_str());
+		m_tmpPath.clear();
+		return result;
+	}
+	m_tmpPath.clear();
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_data)
+	{
+		::munmap(m_data, m_size);
+		m_data = nullptr;
+		m_size = 0;
+	}
+	if (!m_tmpPath.empty())
+	{
+		::unlink(m_tmpPath.c_str());
+		m_tmpPath.clear();
+	}
+}
+
+} // namespace BOOK
+} // namespace CORE
@@ -0,0 +1,191 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#include "Utils/Utils.h"
+#include "OrderBook/BookShard.h"
+
+namespace CORE {
+namespace BOOK {
+
+namespace {
+constexpr int IDLE_SPINS { 2000 }; //!< polls of an empty queue before the shard thread goes to sleep
+constexpr auto MAX_SLEEP { std::chrono::milliseconds(1) }; //!< bounds the latency of a missed wake-up
+}
+
+BookShard::BookShard(std::string name, ApplyFunc apply, FlushFunc flush, size_t queueSize)
+		: m_name(std::move(name)), m_apply(std::move(apply)), m_flush(std::move(flush)), m_queue(queueSize)
+{
+	m_thread = std::thread([this]() { Loop(); });
+}
+
+BookShard::~BookShard()
+{
+	m_shutdown = true;
+	{
+		std::lock_guard lock { m_wakeMtx };
+		m_wakeCond.notify_one();
+	}
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+void BookShard::Post(int instrument, bool bid, const Quote &quote)
+{
+	Item item { instrument, bid, quote, nullptr, nullptr, false };
+	Enqueue(item);
+}
+
+void BookShard::Post(std::function<void()> task)
+{
+	Item item { -1, false, Quote(), new std::function<void()>(std::move(task)), nullptr, false };
+	Enqueue(item);
+}
+
+void BookShard::Run(const std::function<void()> &task)
+{
+	if (OnShardThread())
+	{
+		Flush();
+		task();
+		return;
+	}
+	std::promise<void> done;
+	std::future<void> result { done.get_future() };
+	Item item { -1, false, Quote(), &task, &done, false };
+	Enqueue(item);
+	result.get();
+}
+
+void BookShard::Sync()
+{
+	if (OnShardThread())
+	{
+		Flush();
+		return;
+	}
+	const size_t queued { m_queue.Claimed() };
+	while (m_completed.load(std::memory_order_acquire) < queued)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void BookShard::Enqueue(Item &item)
+{
+	while (!m_queue.TryEnqueue(item))
+	{
+		std::this_thread::yield(); // queue full -> wait for the shard thread
+	}
+	Wake();
+}
+
+/*! \brief Wakes the shard thread up if it is sleeping (called after enqueuing) */
+void BookShard::Wake()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_sleeping.load(std::memory_order_relaxed))
+	{
+		std::lock_guard lock { m_wakeMtx };
+		m_wakeCond.notify_one();
+	}
+}
+
+void BookShard::Process(Item &item)
+{
+	if (item.task && !item.done)
+	{
+		Flush(); // the task sees the updates before it as reported
+		const std::unique_ptr<const std::function<void()>> task { item.task };
+		(*task)();
+	}
+	else if (item.task)
+	{
+		Flush();
+		try
+		{
+			(*item.task)();
+			item.done->set_value();
+		}
+		catch (...)
+		{
+			item.done->set_exception(std::current_exception());
+		}
+	}
+	else
+	{
+		m_apply(item.instrument, item.bid, item.quote, !item.more);
+		m_inBatch = item.more;
+		if (++m_unflushed >= DFLT_SHARD_BATCH_SIZE && !m_inBatch)
+		{
+			Flush();
+		}
+	}
+}
+
+/*! \brief Ends the current batch of updates */
+void BookShard::Flush()
+{
+	if (m_unflushed > 0)
+	{
+		m_unflushed = 0;
+		if (m_flush)
+		{
+			m_flush();
+		}
+	}
+	m_completed.store(m_dequeued, std::memory_order_release);
+}
+
+void BookShard::Loop()
+{
+	UTILS::SetThreadName(m_name);
+	Item item;
+	int idle { 0 };
+	while (!m_shutdown.load(std::memory_order_relaxed))
+	{
+		if (m_queue.TryDequeue(item))
+		{
+			Process(item);
+			++m_dequeued;
+			item = Item();
+			idle = 0;
+		}
+		else if (m_inBatch)
+		{
+			std::this_thread::yield(); // the producer is still writing the rest of the batch
+		}
+		else if (m_unflushed > 0 || m_completed.load(std::memory_order_relaxed) != m_dequeued)
+		{
+			Flush(); // queue ran empty -> end of the batch
+		}
+		else if (++idle < IDLE_SPINS)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			std::unique_lock lock { m_wakeMtx };
+			m_sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_queue.Empty() && !m_shutdown.load(std::memory_order_relaxed))
+			{
+				m_wakeCond.wait_for(lock, MAX_SLEEP);
+			}
+			m_sleeping.store(false, std::memory_order_relaxed);
+			idle = 0;
+		}
+	}
+	while (m_queue.TryDequeue(item)) // apply what is left
+	{
+		Process(item);
+		++m_dequeued;
+		item = Item();
+	}
+	Flush();
+}
+
+} // namespace BOOK
+} // namespace CORE
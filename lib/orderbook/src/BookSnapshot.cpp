@@ -0,0 +1,183 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#include <cmath>
+
+#include "OrderBook/BookSnapshot.h"
+
+namespace CORE {
+namespace BOOK {
+
+BookSnapshot::BookSnapshot(uint64_t version, const PriceLadder &ladder, size_t maxLevels)
+		: m_version(version), m_bid(ladder.Bid())
+{
+	size_t levelCount { ladder.LevelCount() };
+	size_t quoteCount { ladder.QuoteCount() };
+	if (maxLevels > 0 && maxLevels < levelCount)
+	{
+		// only the best levels are copied
+		m_complete = false;
+		levelCount = maxLevels;
+		quoteCount = 0;
+		size_t n { maxLevels };
+		ladder.ForEachLevel([&quoteCount, &n](const PriceLadder::Level &level, bool &cont)
+		{
+			quoteCount += level.QuoteCount();
+			cont = --n > 0;
+		});
+	}
+	m_quotes.reserve(quoteCount);
+	m_levels.reserve(levelCount);
+	// m_quotes is not reallocated below, so the views can point into it right away
+	ladder.ForEachLevel([this, levelCount](const PriceLadder::Level &level, bool &cont)
+	{
+		const Quote *first { m_quotes.data() + m_quotes.size() };
+		m_quotes.insert(m_quotes.end(), level.quotes.begin(), level.quotes.end());
+		m_levels.push_back(LevelView { level.price, level.totalVolume, level.minQty, level.venues, first, first + level.quotes.size() });
+		cont = m_levels.size() < levelCount;
+	});
+}
+
+size_t BookSnapshot::levelForVolume(int64_t volume, int64_t *beforeVolume, double *beforeNotional) const
+{
+	int64_t cumVolume { 0 };
+	double cumNotional { 0.0 };
+	size_t idx { 0 };
+	for (; idx < m_levels.size() && cumVolume + m_levels[idx].totalVolume < volume; ++idx)
+	{
+		cumVolume += m_levels[idx].totalVolume;
+		cumNotional += double(m_levels[idx].price) * double(m_levels[idx].totalVolume);
+	}
+	if (beforeVolume)
+	{
+		*beforeVolume = cumVolume;
+	}
+	if (beforeNotional)
+	{
+		*beforeNotional = cumNotional;
+	}
+	return idx;
+}
+
+int64_t BookSnapshot::PriceForVolume(int64_t volume) const
+{
+	const size_t idx { levelForVolume(std::max<int64_t>(volume, 1)) };
+	return idx < m_levels.size() ? m_levels[idx].price : 0;
+}
+
+int64_t BookSnapshot::AvgPriceForVolume(int64_t volume, int64_t *filled) const
+{
+	int64_t available { 0 };
+	double notional { 0.0 };
+	if (volume > 0 && !m_levels.empty())
+	{
+		const size_t idx { levelForVolume(volume, &available, &notional) };
+		if (idx < m_levels.size())
+		{
+			// full levels before idx, the rest from level idx
+			notional += double(m_levels[idx].price) * double(volume - available);
+			available = volume;
+		}
+	}
+	if (filled)
+	{
+		*filled = available;
+	}
+	return available > 0 ? int64_t(std::llround(notional / double(available))) : 0;
+}
+
+int64_t BookSnapshot::VolumeWithin(int64_t limitPrice) const
+{
+	// levels are sorted best first: descending prices for bids, ascending for asks
+	int64_t volume { 0 };
+	for (auto it { m_levels.begin() }; it != m_levels.end() && (m_bid ? it->price >= limitPrice : it->price <= limitPrice); ++it)
+	{
+		volume += it->totalVolume;
+	}
+	return volume;
+}
+
+int64_t BookSnapshot::VolumeWithinBps(int64_t bps) const
+{
+	if (m_levels.empty())
+	{
+		return 0;
+	}
+	const int64_t best { m_levels.front().price };
+	const int64_t offset { best * bps / 10'000 };
+	return VolumeWithin(m_bid ? best - offset : best + offset);
+}
+
+SnapshotSlot::~SnapshotSlot()
+{
+	delete m_current.load(std::memory_order_relaxed);
+	for (const BookSnapshot::Ptr *snapshot: m_retired)
+	{
+		delete snapshot;
+	}
+	for (const BookSnapshot::Ptr *snapshot: m_waiting)
+	{
+		delete snapshot;
+	}
+}
+
+BookSnapshot::Ptr SnapshotSlot::Load() const
+{
+	// enter a read section of the current epoch (again if the writer changed the epoch meanwhile)
+	uint64_t epoch { m_epoch.load() };
+	for (;;)
+	{
+		m_readers[epoch & 1].fetch_add(1);
+		const uint64_t current { m_epoch.load() };
+		if (current == epoch)
+		{
+			break;
+		}
+		m_readers[epoch & 1].fetch_sub(1);
+		epoch = current;
+	}
+	const BookSnapshot::Ptr *current { m_current.load() };
+	BookSnapshot::Ptr result { current ? *current : nullptr };
+	m_readers[epoch & 1].fetch_sub(1);
+	return result;
+}
+
+void SnapshotSlot::Store(BookSnapshot::Ptr snapshot)
+{
+	const BookSnapshot::Ptr *previous { m_current.exchange(snapshot ? new BookSnapshot::Ptr(std::move(snapshot)) : nullptr) };
+	if (previous)
+	{
+		m_retired.push_back(previous);
+	}
+	reclaim();
+}
+
+/*! \brief Frees the pointers no reader can hold any more and starts a new epoch for the ones swapped out since (writer only)
+ *
+ * Readers of the previous epoch are checked only: they were gone when the
+ * epoch last changed, so the pointers swapped out before that change are
+ * held by readers of the previous epoch at most. The epoch changes only
+ * while no reader of the previous epoch is left.
+ */
+void SnapshotSlot::reclaim()
+{
+	const uint64_t epoch { m_epoch.load(std::memory_order_relaxed) };
+	if (m_readers[(epoch + 1) & 1].load() != 0)
+	{
+		return;
+	}
+	for (const BookSnapshot::Ptr *snapshot: m_waiting)
+	{
+		delete snapshot;
+	}
+	m_waiting.clear();
+	if (!m_retired.empty())
+	{
+		m_waiting.swap(m_retired);
+		m_epoch.store(epoch + 1);
+	}
+}
+
+} // namespace BOOK
+} // namespace CORE
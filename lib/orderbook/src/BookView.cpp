@@ -54,12 +54,12 @@ QuoteGroup::Ptr BookView::AggregateLevel(int64_t volume, const QuotePred &quoteP
 	QuoteGroup::QuoteVector quoteVec;
 	IterateQuoteGroups([&quoteVec, &volume](int level, QuoteGroup::Ptr &qg, bool &cont)
 					   {
-						   qg->ForEachQuote([&volume, &quoteVec](const Quote::Ptr &q)
+						   qg->ForEachQuote([&volume, &quoteVec](const Quote &q)
 											{
-												if (volume > 0 && !q->Used())
+												if (volume > 0 && !q.Used())
 												{
 													quoteVec.push_back(q);
-													volume -= q->Volume();
+													volume -= q.Volume();
 												}
 											});
 						   cont = (volume > 0);
@@ -74,12 +74,12 @@ void BookView::AggregateLevels(int64_t minVolumePerLevel, const QuoteGroupFunc &
 	int aggLevel { 0 };
 	IterateQuoteGroups([&quoteVec, &aggVolume, &aggLevel, minVolumePerLevel, &action](int level, QuoteGroup::Ptr &qg, bool &cont)
 					   {
-						   qg->ForEachQuote([&aggVolume, &aggLevel, &quoteVec, minVolumePerLevel, &action, &cont](const Quote::Ptr &q)
+						   qg->ForEachQuote([&aggVolume, &aggLevel, &quoteVec, minVolumePerLevel, &action, &cont](const Quote &q)
 											{
-												if (cont && !q->Used())
+												if (cont && !q.Used())
 												{
 													quoteVec.push_back(q);
-													aggVolume += q->Volume();
+													aggVolume += q.Volume();
 													if (aggVolume >= minVolumePerLevel)
 													{
 														QuoteGroup::Ptr aggQuoteGroup { std::make_shared<QuoteGroup>(quoteVec) };
@@ -0,0 +1,269 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "OrderBook/DepthIndex.h"
+
+namespace CORE {
+namespace BOOK {
+
+namespace {
+
+/*! \brief Adds to a relaxed atomic that has a single writer */
+template <typename T>
+void Increase(std::atomic<T> &value, T delta)
+{
+	value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+/*! \brief Rounds a division towards negative infinity */
+int64_t FloorDiv(int64_t a, int64_t b)
+{
+	return a / b - (a % b != 0 && (a < 0) != (b < 0) ? 1 : 0);
+}
+
+}
+
+DepthIndex::DepthIndex(bool bid, int size)
+		: m_bid(bid), m_size(size), m_levels(std::make_unique<std::atomic<int64_t>[]>(size_t(size) + 1)),
+		  m_volume(std::make_unique<std::atomic<int64_t>[]>(size_t(size) + 1)),
+		  m_notional(std::make_unique<std::atomic<double>[]>(size_t(size) + 1))
+{
+	while (m_topBit * 2 <= m_size)
+	{
+		m_topBit *= 2;
+	}
+	Reset(0, 1);
+}
+
+DepthIndex::DepthIndex(DepthIndex &&other) noexcept
+		: m_bid(other.m_bid), m_size(other.m_size), m_topBit(other.m_topBit), m_levels(std::move(other.m_levels)),
+		  m_volume(std::move(other.m_volume)), m_notional(std::move(other.m_notional)),
+		  m_base(other.m_base.load()), m_step(other.m_step.load()), m_overflowLevels(other.m_overflowLevels.load()),
+		  m_overflowVolume(other.m_overflowVolume.load()), m_overflowNotional(other.m_overflowNotional.load()),
+		  m_overflowBest(other.m_overflowBest.load()), m_sequence(other.m_sequence.load()) { }
+
+void DepthIndex::Reset(int64_t base, int64_t step)
+{
+	for (int i { 0 }; i <= m_size; ++i)
+	{
+		m_levels[i].store(0, std::memory_order_relaxed);
+		m_volume[i].store(0, std::memory_order_relaxed);
+		m_notional[i].store(0.0, std::memory_order_relaxed);
+	}
+	m_base.store(base, std::memory_order_relaxed);
+	m_step.store(step > 0 ? step : 1, std::memory_order_relaxed);
+	SetOverflow(0, 0, 0.0, 0);
+}
+
+void DepthIndex::Add(int slot, int64_t price, int levels, int64_t volume)
+{
+	const double notional { double(price) * double(volume) };
+	for (int i { position(slot) + 1 }; i <= m_size; i += i & -i)
+	{
+		Increase(m_levels[i], int64_t(levels));
+		Increase(m_volume[i], volume);
+		Increase(m_notional[i], notional);
+	}
+}
+
+void DepthIndex::SetOverflow(int64_t levels, int64_t volume, double notional, int64_t bestPrice)
+{
+	m_overflowLevels.store(levels, std::memory_order_relaxed);
+	m_overflowVolume.store(volume, std::memory_order_relaxed);
+	m_overflowNotional.store(notional, std::memory_order_relaxed);
+	m_overflowBest.store(bestPrice, std::memory_order_relaxed);
+}
+
+int64_t DepthIndex::LevelCount() const
+{
+	return read([this]() { return total(m_levels, m_size) + m_overflowLevels.load(std::memory_order_relaxed); });
+}
+
+int64_t DepthIndex::BestPrice() const
+{
+	return read([this]() { return bestPrice(); });
+}
+
+std::optional<int64_t> DepthIndex::CumulativeVolume(size_t n) const
+{
+	return read([this, n]() -> std::optional<int64_t>
+	{
+		const int64_t windowLevels { total(m_levels, m_size) };
+		const int64_t overflowLevels { m_overflowLevels.load(std::memory_order_relaxed) };
+		if (n == 0 || int64_t(n) >= windowLevels + overflowLevels)
+		{
+			return total(m_volume, m_size) + m_overflowVolume.load(std::memory_order_relaxed);
+		}
+		if (int64_t(n) > windowLevels)
+		{
+			return std::nullopt; // ends among the levels outside the window
+		}
+		const Prefix prefix { descend(m_levels, int64_t(n)) };
+		return prefix.volume + total(m_volume, prefix.position + 1) - total(m_volume, prefix.position);
+	});
+}
+
+std::optional<int64_t> DepthIndex::PriceForVolume(int64_t volume) const
+{
+	return read([this, volume]() -> std::optional<int64_t>
+	{
+		const Prefix prefix { descend(m_volume, std::max<int64_t>(volume, 1)) };
+		if (prefix.position < m_size)
+		{
+			return priceAt(prefix.position);
+		}
+		const int64_t overflowVolume { m_overflowVolume.load(std::memory_order_relaxed) };
+		if (overflowVolume > 0 && prefix.volume + overflowVolume >= volume)
+		{
+			return std::nullopt;
+		}
+		return 0;
+	});
+}
+
+std::optional<int64_t> DepthIndex::AvgPriceForVolume(int64_t volume, int64_t *filled) const
+{
+	struct Result
+	{
+		bool answered { true };
+		int64_t available { 0 };
+		double notional { 0.0 };
+	};
+	const Result result { read([this, volume]()
+	{
+		Result r;
+		if (volume <= 0)
+		{
+			return r;
+		}
+		const Prefix prefix { descend(m_volume, volume) };
+		if (prefix.position < m_size)
+		{
+			// full levels before the position, the rest from the level at the position
+			r.available = volume;
+			r.notional = prefix.notional + double(priceAt(prefix.position)) * double(volume - prefix.volume);
+			return r;
+		}
+		const int64_t overflowVolume { m_overflowVolume.load(std::memory_order_relaxed) };
+		if (overflowVolume > 0 && prefix.volume + overflowVolume > volume)
+		{
+			r.answered = false;
+			return r;
+		}
+		// the whole side is taken
+		r.available = prefix.volume + overflowVolume;
+		r.notional = prefix.notional + m_overflowNotional.load(std::memory_order_relaxed);
+		return r;
+	}) };
+	if (!result.answered)
+	{
+		return std::nullopt;
+	}
+	if (filled)
+	{
+		*filled = result.available;
+	}
+	return result.available > 0 ? int64_t(std::llround(result.notional / double(result.available))) : 0;
+}
+
+std::optional<int64_t> DepthIndex::VolumeWithin(int64_t limitPrice) const
+{
+	return read([this, limitPrice]() { return volumeWithin(limitPrice); });
+}
+
+std::optional<int64_t> DepthIndex::VolumeWithinBps(int64_t bps) const
+{
+	return read([this, bps]() -> std::optional<int64_t>
+	{
+		const int64_t best { bestPrice() };
+		if (best == 0)
+		{
+			return 0;
+		}
+		const int64_t offset { best * bps / 10'000 };
+		return volumeWithin(m_bid ? best - offset : best + offset);
+	});
+}
+
+/*! \brief Price of a window position */
+int64_t DepthIndex::priceAt(int position) const
+{
+	const int slot { m_bid ? m_size - 1 - position : position };
+	return m_base.load(std::memory_order_relaxed) + int64_t(slot) * m_step.load(std::memory_order_relaxed);
+}
+
+/*! \brief Total of the first @a count positions of a tree */
+int64_t DepthIndex::total(const std::unique_ptr<std::atomic<int64_t>[]> &tree, int count) const
+{
+	int64_t sum { 0 };
+	for (int i { count }; i > 0; i -= i & -i)
+	{
+		sum += tree[i].load(std::memory_order_relaxed);
+	}
+	return sum;
+}
+
+/*! \brief Number of positions with a price at @a limitPrice or better */
+int DepthIndex::positionsWithin(int64_t limitPrice) const
+{
+	const int64_t base { m_base.load(std::memory_order_relaxed) };
+	const int64_t step { m_step.load(std::memory_order_relaxed) };
+	// bids: slots at or above the limit, asks: slots at or below it
+	const int64_t slot { m_bid ? -FloorDiv(base - limitPrice, step) : FloorDiv(limitPrice - base, step) };
+	const int64_t count { m_bid ? m_size - slot : slot + 1 };
+	return int(std::clamp<int64_t>(count, 0, m_size));
+}
+
+/*! \brief Finds the first position at which the total of a tree reaches @a target (O(log n)) */
+DepthIndex::Prefix DepthIndex::descend(const std::unique_ptr<std::atomic<int64_t>[]> &tree, int64_t target) const
+{
+	Prefix prefix;
+	int idx { 0 };
+	int64_t sum { 0 };
+	for (int bit { m_topBit }; bit > 0; bit >>= 1)
+	{
+		const int next { idx + bit };
+		if (next > m_size)
+		{
+			continue;
+		}
+		const int64_t value { tree[next].load(std::memory_order_relaxed) };
+		if (sum + value < target)
+		{
+			idx = next;
+			sum += value;
+			prefix.levels += m_levels[next].load(std::memory_order_relaxed);
+			prefix.volume += m_volume[next].load(std::memory_order_relaxed);
+			prefix.notional += m_notional[next].load(std::memory_order_relaxed);
+		}
+	}
+	prefix.position = idx;
+	return prefix;
+}
+
+std::optional<int64_t> DepthIndex::volumeWithin(int64_t limitPrice) const
+{
+	const int count { positionsWithin(limitPrice) };
+	const int64_t volume { total(m_volume, count) };
+	// the levels outside the window are worse than those in it
+	const int64_t overflowBest { m_overflowBest.load(std::memory_order_relaxed) };
+	if (count < m_size || m_overflowLevels.load(std::memory_order_relaxed) == 0 ||
+		(m_bid ? overflowBest < limitPrice : overflowBest > limitPrice))
+	{
+		return volume;
+	}
+	return std::nullopt; // the limit reaches the levels outside the window
+}
+
+int64_t DepthIndex::bestPrice() const
+{
+	const Prefix prefix { descend(m_levels, 1) };
+	return prefix.position < m_size ? priceAt(prefix.position) : 0;
+}
+
+} // namespace BOOK
+} // namespace CORE
@@ -0,0 +1,139 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#include "Utils/Utils.h"
+#include "OrderBook/EventDispatcher.h"
+
+namespace CORE {
+namespace BOOK {
+
+namespace {
+constexpr int IDLE_SPINS { 2000 }; //!< polls of an empty queue before the dispatcher thread goes to sleep
+constexpr auto MAX_SLEEP { std::chrono::milliseconds(1) }; //!< bounds the latency of a missed wake-up
+}
+
+EventDispatcher::EventDispatcher(std::string name, DispatchFunc dispatch, DrainedFunc drained, size_t queueSize)
+		: m_name(std::move(name)), m_dispatch(std::move(dispatch)), m_drained(std::move(drained)), m_queue(queueSize)
+{
+	m_thread = std::thread([this]() { Loop(); });
+}
+
+EventDispatcher::~EventDispatcher()
+{
+	Stop();
+}
+
+bool EventDispatcher::TryPost(const ORDERBOOK::BookEvent &event)
+{
+	ORDERBOOK::BookEvent item { event };
+	if (!m_queue.TryEnqueue(item))
+	{
+		m_refused.store(true, std::memory_order_release);
+		return false;
+	}
+	Wake();
+	return true;
+}
+
+void EventDispatcher::Sync()
+{
+	if (OnDispatcherThread())
+	{
+		return;
+	}
+	const size_t queued { m_queue.Claimed() };
+	while (m_delivered.load(std::memory_order_acquire) < queued && !m_stopped.load(std::memory_order_acquire))
+	{
+		std::this_thread::yield();
+	}
+}
+
+void EventDispatcher::Stop()
+{
+	m_shutdown = true;
+	{
+		std::lock_guard lock { m_wakeMtx };
+		m_wakeCond.notify_one();
+	}
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+/*! \brief Wakes the dispatcher thread up if it is sleeping (called after enqueuing) */
+void EventDispatcher::Wake()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_sleeping.load(std::memory_order_relaxed))
+	{
+		std::lock_guard lock { m_wakeMtx };
+		m_wakeCond.notify_one();
+	}
+}
+
+/*! \brief Dequeues up to DFLT_EVENT_BATCH_SIZE events and hands them to the dispatch callback
+ *
+ * @return Number of events delivered
+ */
+size_t EventDispatcher::Deliver(std::vector<ORDERBOOK::BookEvent> &events)
+{
+	events.clear();
+	ORDERBOOK::BookEvent event;
+	while (events.size() < DFLT_EVENT_BATCH_SIZE && m_queue.TryDequeue(event))
+	{
+		events.push_back(event);
+	}
+	if (!events.empty())
+	{
+		m_dispatch(events);
+		m_delivered.fetch_add(events.size(), std::memory_order_release);
+	}
+	return events.size();
+}
+
+void EventDispatcher::Loop()
+{
+	UTILS::SetThreadName(m_name);
+	std::vector<ORDERBOOK::BookEvent> events;
+	events.reserve(DFLT_EVENT_BATCH_SIZE);
+	int idle { 0 };
+	while (!m_shutdown.load(std::memory_order_relaxed))
+	{
+		if (Deliver(events) > 0)
+		{
+			idle = 0;
+		}
+		else if (m_refused.exchange(false, std::memory_order_acq_rel))
+		{
+			if (m_drained)
+			{
+				m_drained(); // queue ran empty -> the writers publish the changes they kept back
+			}
+		}
+		else if (++idle < IDLE_SPINS)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			std::unique_lock lock { m_wakeMtx };
+			m_sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_queue.Empty() && !m_shutdown.load(std::memory_order_relaxed))
+			{
+				m_wakeCond.wait_for(lock, MAX_SLEEP);
+			}
+			m_sleeping.store(false, std::memory_order_relaxed);
+			idle = 0;
+		}
+	}
+	while (Deliver(events) > 0) // deliver what is left
+	{
+	}
+	m_stopped.store(true, std::memory_order_release);
+}
+
+} // namespace BOOK
+} // namespace CORE
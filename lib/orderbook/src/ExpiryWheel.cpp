@@ -0,0 +1,86 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#include <algorithm>
+
+#include "OrderBook/ExpiryWheel.h"
+
+namespace CORE {
+namespace BOOK {
+
+ExpiryWheel::ExpiryWheel(int64_t start, int64_t resolution)
+		: m_resolution(std::max<int64_t>(resolution, 1)), m_current(start / m_resolution) { }
+
+void ExpiryWheel::Add(int64_t key, int64_t expiry, uint64_t tag)
+{
+	place(Entry { key, expiry, tag });
+	++m_size;
+}
+
+void ExpiryWheel::Clear()
+{
+	for (auto &wheel: m_wheels)
+	{
+		for (auto &bucket: wheel)
+		{
+			bucket.clear();
+		}
+	}
+	m_size = 0;
+}
+
+/*! \brief Removes and returns all entries */
+std::vector<ExpiryWheel::Entry> ExpiryWheel::takeAll()
+{
+	std::vector<Entry> entries;
+	entries.reserve(m_size);
+	for (auto &wheel: m_wheels)
+	{
+		for (auto &bucket: wheel)
+		{
+			entries.insert(entries.end(), bucket.begin(), bucket.end());
+			bucket.clear();
+		}
+	}
+	m_size = 0;
+	return entries;
+}
+
+/*! \brief Puts an entry into the innermost wheel that covers its expiry tick */
+void ExpiryWheel::place(const Entry &entry)
+{
+	int64_t tick { std::max(entry.expiry / m_resolution, m_current) };
+	const int64_t delta { tick - m_current };
+	int level { 0 };
+	while (level < LEVELS - 1 && delta >= int64_t(1) << (SLOT_BITS * (level + 1)))
+	{
+		++level;
+	}
+	if (delta >= RANGE)
+	{
+		tick = m_current + RANGE - 1; // beyond the outermost wheel -> re-placed when its bucket comes up
+	}
+	m_wheels[size_t(level)][size_t(tick >> (SLOT_BITS * level)) & SLOT_MASK].push_back(entry);
+}
+
+/*! \brief Redistributes the outer buckets starting at the current tick to the inner wheels */
+void ExpiryWheel::cascade()
+{
+	for (int level { 1 }; level < LEVELS; ++level)
+	{
+		if ((m_current & ((int64_t(1) << (SLOT_BITS * level)) - 1)) != 0)
+		{
+			break; // the inner wheel has not completed a turn
+		}
+		std::vector<Entry> bucket;
+		bucket.swap(m_wheels[size_t(level)][size_t(m_current >> (SLOT_BITS * level)) & SLOT_MASK]);
+		for (const auto &entry: bucket)
+		{
+			place(entry);
+		}
+	}
+}
+
+} // namespace BOOK
+} // namespace CORE
@@ -0,0 +1,74 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#include "OrderBook/InstrumentRegistry.h"
+
+namespace CORE {
+namespace BOOK {
+
+InstrumentRegistry::InstrumentRegistry()
+{
+	for (auto &slot: m_table)
+	{
+		slot.store(0, std::memory_order_relaxed);
+	}
+}
+
+int InstrumentRegistry::Find(UTILS::CurrencyPair cp) const
+{
+	const uint32_t k { key(cp) };
+	if (k == 0)
+	{
+		return -1;
+	}
+	for (size_t idx { k % TABLE_SIZE };; idx = (idx + 1) % TABLE_SIZE)
+	{
+		const uint64_t entry { m_table[idx].load(std::memory_order_acquire) };
+		if (entry == 0)
+		{
+			return -1;
+		}
+		if (uint32_t(entry >> 32) == k)
+		{
+			return int(uint32_t(entry)) - 1;
+		}
+	}
+}
+
+int InstrumentRegistry::Register(UTILS::CurrencyPair cp, const std::function<void(int)> &onNew)
+{
+	int id { Find(cp) };
+	if (id >= 0 || key(cp) == 0)
+	{
+		return id;
+	}
+	std::lock_guard lock { m_mtx };
+	id = Find(cp);
+	if (id >= 0)
+	{
+		return id;
+	}
+	id = m_count.load(std::memory_order_relaxed);
+	if (id >= MAX_INSTRUMENTS)
+	{
+		return -1;
+	}
+	m_instruments[size_t(id)] = cp;
+	if (onNew)
+	{
+		onNew(id);
+	}
+	m_count.store(id + 1, std::memory_order_release);
+	const uint32_t k { key(cp) };
+	size_t idx { k % TABLE_SIZE };
+	while (m_table[idx].load(std::memory_order_relaxed) != 0)
+	{
+		idx = (idx + 1) % TABLE_SIZE;
+	}
+	m_table[idx].store((uint64_t(k) << 32) | uint64_t(id + 1), std::memory_order_release);
+	return id;
+}
+
+} // namespace BOOK
+} // namespace CORE
@@ -1,4 +1,7 @@
 #include <memory>
+#include <algorithm>
+#include <cstring>
+#include <future>
 
 #include <Poco/DOM/Node.h>
 #include <Poco/DOM/DOMParser.h>
@@ -17,6 +20,62 @@ using namespace UTILS;
 namespace CORE {
 namespace BOOK {
 
+OrderBook::OrderBook(const std::string &loggerName, size_t shardCount)
+		: BookBase(loggerName),
+		  m_dispatcher("book_events", [this](const std::vector<ORDERBOOK::BookEvent> &events) { Dispatch(events); },
+					   [this]()
+					   {
+						   // the queue was full: let the writers publish the changes they kept back
+						   for (size_t i { 0 }; i < m_shards.size(); ++i)
+						   {
+							   m_shards[i]->Post([this, i]() { PublishChanges(i); });
+						   }
+					   })
+{
+	shardCount = std::max<size_t>(shardCount, 1);
+	m_shards.reserve(shardCount);
+	m_pendingBooks.resize(shardCount);
+	m_pendingSnapshots.resize(shardCount);
+	m_lastQuotes = std::make_unique<LastQuoteRecord[]>(shardCount);
+	for (size_t i { 0 }; i < shardCount; ++i)
+	{
+		m_shards.emplace_back(std::make_unique<BookShard>("book_shard_" + std::to_string(i),
+														  [this](int id, bool bid, const Quote &quote, bool last)
+														  {
+															  ApplyQuote(*m_books[size_t(id)], bid, quote, last);
+														  },
+														  [this, i]() { EndBatch(i); }));
+	}
+}
+
+OrderBook::~OrderBook()
+{
+	if (m_expiryTimer.Running())
+	{
+		m_expiryTimer.Stop();
+	}
+	if (m_snapshotTimer.Running())
+	{
+		m_snapshotTimer.Stop();
+	}
+	std::string snapshotFile;
+	{
+		std::lock_guard lock { m_snapshotFile.Mutex() };
+		snapshotFile = *m_snapshotFile;
+	}
+	if (!snapshotFile.empty())
+	{
+		const BoolResult result { SaveSnapshot(snapshotFile) };
+		if (!result)
+		{
+			poco_error_f1(logger(), "Failed to save the order book on shutdown: %s", result.ErrorMessage());
+		}
+	}
+	Sync();
+	m_dispatcher.Stop(); // it posts to the writer threads
+	m_shards.clear(); // stop the writer threads before the books are destroyed
+}
+
 std::string OrderBook::propDefaultValue(const std::string &name) const
 {
 	if (name == ATTR_BATCHSIZE)
@@ -35,343 +94,1204 @@ std::string OrderBook::propDefaultValue(const std::string &name) const
 	{
 		return DFLT_MAX_QUOTE_AGE;
 	}
+	else if (name == ATTR_SHARD_COUNT)
+	{
+		return std::to_string(DFLT_SHARD_COUNT);
+	}
+	else if (name == ATTR_MAX_LEVEL_COUNT)
+	{
+		return std::to_string(DFLT_MAX_LEVEL_COUNT);
+	}
+	else if (name == ATTR_SNAPSHOT_FILE)
+	{
+		return DFLT_SNAPSHOT_FILE;
+	}
+	else if (name == ATTR_SNAPSHOT_INTERVAL)
+	{
+		return DFLT_SNAPSHOT_INTERVAL;
+	}
 	else
 	{
 		return BookBase::propDefaultValue(name);
 	}
 }
 
-void OrderBook::AddEntry(int64_t key, int64_t refKey, int64_t receiveTime, CurrencyPair cp, const NormalizedMDData::Entry &entry)
+void OrderBook::SetLimits(const BookLimits &limits)
 {
-    AddQuote(cp, entry.entryType.Bid(),
-		QuotePool::getQuote(__PRETTY_FUNCTION__,
-							true,
-							std::this_thread::get_id(),
-							entry.adptReceiveTime,
-							receiveTime,
-							CurrentTimestamp(),
-							entry.quoteId,
-							1,
-							cp.DblToCpip(entry.price),
-							cp.DoubleToQty(entry.volume),
-							cp.DoubleToQty(entry.minQty),
-							key,
-							refKey,
-							0,
-							int(entry.updateType),
-							int(entry.positionNo),
-							entry.settlDate,
-							entry.originators));
+	std::lock_guard lock { m_limitsMtx };
+	m_maxLevels.store(limits.maxLevels, std::memory_order_relaxed);
+	m_maxQuotesPerLevel.store(limits.maxQuotesPerLevel, std::memory_order_relaxed);
+	m_maxQuoteAge.store(limits.maxQuoteAge, std::memory_order_relaxed);
+	m_cleanupInterval.store(limits.cleanupInterval, std::memory_order_relaxed);
+	if (m_expiryTimer.Running())
+	{
+		m_expiryTimer.Stop();
+	}
+	if (limits.maxQuoteAge > 0)
+	{
+		const int64_t interval { limits.cleanupInterval > 0 ? limits.cleanupInterval : StringToNanoseconds(DFLT_CLEANUP_INTERVAL) };
+		BoolResult result { m_expiryTimer.Start("BookExpiry") };
+		if (result)
+		{
+			result = m_expiryTimer.Schedule("quote_expiry", [this](Timer::Task &)
+			{
+				ExpireQuotes(CurrentTimestamp());
+			}, std::chrono::nanoseconds(interval), std::chrono::nanoseconds(interval));
+		}
+		if (!result)
+		{
+			poco_error_f1(logger(), "Failed to schedule quote expiry: %s", result.ErrorMessage());
+		}
+	}
 }
 
-void OrderBook::AddEntry(int64_t key, int64_t refKey, int64_t sendTime, int64_t receiveTime, CurrencyPair cp,
-						const NormalizedMDData::Entry &entry)
+OrderBook::BookLimits OrderBook::GetLimits() const
 {
-    AddQuote(cp, entry.entryType.Bid(),
-		QuotePool::getQuote(__PRETTY_FUNCTION__, true, std::this_thread::get_id(),
-			entry.adptReceiveTime, receiveTime, CurrentTimestamp(), entry.quoteId,
-							1, cp.DblToCpip(entry.price),
-							cp.DoubleToQty(entry.volume), cp.DoubleToQty(entry.minQty), key, refKey, sendTime, int(entry.updateType),
-							int(entry.positionNo), entry.settlDate, entry.originators));
+	return BookLimits { m_maxLevels.load(std::memory_order_relaxed), m_maxQuotesPerLevel.load(std::memory_order_relaxed),
+						m_maxQuoteAge.load(std::memory_order_relaxed), m_cleanupInterval.load(std::memory_order_relaxed) };
 }
 
-void OrderBook::AddQuote(CurrencyPair cp, bool bid, Quote::Ptr quote)
+bool OrderBook::LoadConfig(const XmlDocPtr &pDoc)
 {
+	try
 	{
-		std::shared_lock lockMap { m_quoteVectorMap.Mutex() };
-		
-		auto it { m_quoteVectorMap->find(cp) };
-		
-		if (it == m_quoteVectorMap->end())
+		auto *baseNode { pDoc ? GetConfigNode(pDoc, TAG_ORDERBOOK_CONFIG) : nullptr };
+		if (!baseNode)
+		{
+			return true; // unbounded book
+		}
+		BookLimits limits;
+		limits.maxLevels = GetXmlAttribute(baseNode, ATTR_MAX_LEVEL_COUNT, size_t(DFLT_MAX_LEVEL_COUNT));
+		limits.maxQuotesPerLevel = GetXmlAttribute(baseNode, ATTR_MAX_QUOTE_COUNT, size_t(DFLT_MAX_QUOTE_COUNT));
+		limits.maxQuoteAge = StringToNanoseconds(GetXmlAttribute(baseNode, ATTR_MAX_QUOTE_AGE, std::string(DFLT_MAX_QUOTE_AGE)));
+		limits.cleanupInterval = StringToNanoseconds(GetXmlAttribute(baseNode, ATTR_CLEANUP_INTERVAL, std::string(DFLT_CLEANUP_INTERVAL)));
+		SetLimits(limits);
+		poco_information_f4(logger(), "Order book limits: %s levels, %s quotes per level, max. age %s, cleanup interval %s",
+							std::to_string(limits.maxLevels), std::to_string(limits.maxQuotesPerLevel),
+							NanosecondsToString(limits.maxQuoteAge), NanosecondsToString(limits.cleanupInterval));
+		const std::string snapshotFile { GetXmlAttribute(baseNode, ATTR_SNAPSHOT_FILE, std::string(DFLT_SNAPSHOT_FILE)) };
+		if (!snapshotFile.empty())
 		{
-			lockMap.unlock();
+			const Result<size_t> loaded { LoadSnapshot(snapshotFile) };
+			if (loaded)
 			{
-				std::unique_lock uniqueLock { m_quoteVectorMap.Mutex() };
-				m_quoteVectorMap->emplace(cp, BidAskPair<QuoteVecPtr>(std::make_shared<QuoteVec>(), std::make_shared<QuoteVec>()));
+				poco_information_f2(logger(), "Loaded %s instruments from %s", std::to_string(loaded.Value()), snapshotFile);
 			}
-			lockMap.lock();
-			it = m_quoteVectorMap->find(cp);
-			if (it == m_quoteVectorMap->end())
+			else
 			{
-				poco_error_f1(logger(), "FAILED TO CREATE QUOTE VECTOR ENTRY FOR %s", cp.ToString());
-				return;
+				poco_warning_f1(logger(), "Starting with an empty order book: %s", loaded.ErrorMessage());
 			}
+			StartSnapshots(snapshotFile, StringToNanoseconds(GetXmlAttribute(baseNode, ATTR_SNAPSHOT_INTERVAL,
+																			  std::string(DFLT_SNAPSHOT_INTERVAL))));
 		}
-		
-		std::unique_lock lock { GetLock(cp, bid) };
-		
-		QuoteVecPtr vec { it->second.Get(bid) };
-		lockMap.unlock();
-		// delete, check if there is something to delete, then erase element and change rest of affected quotes
-		if (quote->QuoteType() == QT_DELETE || quote->QuoteType() == QT_UPDATE)
+	}
+	catch (std::exception &e)
+	{
+		poco_error_f1(logger(), "Error loading order book config: %s", std::string(e.what()));
+		return false;
+	}
+	return true;
+}
+
+void OrderBook::StartSnapshots(const std::string &path, int64_t interval)
+{
+	{
+		std::lock_guard lock { m_snapshotFile.Mutex() };
+		*m_snapshotFile = path;
+	}
+	if (m_snapshotTimer.Running())
+	{
+		m_snapshotTimer.Stop();
+	}
+	if (interval <= 0)
+	{
+		return; // saved on shutdown only
+	}
+	BoolResult result { m_snapshotTimer.Start("BookSnapshot") };
+	if (result)
+	{
+		result = m_snapshotTimer.Schedule("book_snapshot", [this, path](Timer::Task &)
 		{
-			if (!vec->empty() && quote->RefKey() > 0)
+			const BoolResult saved { SaveSnapshot(path) };
+			if (!saved)
 			{
-				const auto
-						&resultIter { std::find_if(vec->begin(), vec->end(), [&quote](const Quote::Ptr &q) { return q->Key() == quote->RefKey(); }) };
-				if (resultIter != vec->end())
-				{
-					(*resultIter)->SetInvalid(quote);
-					vec->erase(resultIter);
-				}
-				else
+				poco_error_f1(logger(), "Failed to save the order book: %s", saved.ErrorMessage());
+			}
+		}, std::chrono::nanoseconds(interval), std::chrono::nanoseconds(interval));
+	}
+	if (!result)
+	{
+		poco_error_f1(logger(), "Failed to schedule order book snapshots: %s", result.ErrorMessage());
+	}
+}
+
+BoolResult OrderBook::SaveSnapshot(const std::string &path) const
+{
+	using namespace BOOKFILE;
+	struct SavedInstrument
+	{
+		InstrumentRecord header;
+		std::vector<QuoteRecord> quotes; //!< bid quotes, then ask quotes
+	};
+	const int count { m_registry.Count() };
+	std::vector<SavedInstrument> instruments(static_cast<size_t>(count));
+	// read the update ids first: the quotes copied afterwards are at least as recent
+	for (int id { 0 }; id < count; ++id)
+	{
+		SavedInstrument &saved { instruments[size_t(id)] };
+		saved.header = InstrumentRecord();
+		SetName(saved.header.cp, m_registry.Instrument(id).ToString());
+		saved.header.updateId = m_books[size_t(id)]->updateId.load(std::memory_order_acquire);
+	}
+	// the shards copy their instruments in parallel, each once it has applied the updates queued before
+	std::vector<std::promise<void>> copied(m_shards.size());
+	std::vector<std::future<void>> done;
+	for (auto &promise: copied)
+	{
+		done.push_back(promise.get_future());
+	}
+	for (size_t shardIdx { 0 }; shardIdx < m_shards.size(); ++shardIdx)
+	{
+		m_shards[shardIdx]->Post([this, count, shardIdx, &instruments, &copied = copied[shardIdx]]()
+		{
+			try
+			{
+				for (int id { int(shardIdx) }; id < count; id += int(m_shards.size()))
 				{
-                    std::string msg = UTILS::Format("*** %s %s/%Ld: FAILED UPDATE/DELETE: Quote with RefKey %Ld %Ld not found !!! ***", cp.ToString(),
-                                                    quote->SeqNum(), quote->RefKey(), quote->Price());
-					poco_error(logger(),msg);
+					const InstrumentBook &book { *m_books[size_t(id)] };
+					SavedInstrument &saved { instruments[size_t(id)] };
+					saved.quotes.reserve(book.ladders.Bid().QuoteCount() + book.ladders.Ask().QuoteCount());
+					for (bool bid: { true, false })
+					{
+						book.ladders.Get(bid).ForEachQuote([&saved](const Quote &q, bool &)
+						{
+							saved.quotes.push_back(QuoteRecord { q.Price(), q.Volume(), q.MinQty(), q.Key(), q.SendingTime(),
+																 uint32_t(q.Venue()), int32_t(q.PositionNo()) });
+						});
+						saved.header.quoteCount[bid ? 0 : 1] = uint32_t(saved.quotes.size() - (bid ? 0 : saved.header.quoteCount[0]));
+					}
 				}
+				copied.set_value();
 			}
-			else
+			catch (...)
 			{
-				poco_error_f3(logger(), "*** %s/%Ld %Ld: Missing RefKey in UPDATE/DELETE ***", cp.ToString(),  quote->SeqNum(), quote->Price());
+				copied.set_exception(std::current_exception());
 			}
+		});
+	}
+	for (auto &future: done)
+	{
+		future.wait(); // all of them before rethrowing: the tasks use the vectors above
+	}
+	for (auto &future: done)
+	{
+		future.get();
+	}
+	std::vector<std::string> venues;
+	{
+		std::lock_guard lock { m_venues.Mutex() };
+		venues = *m_venues;
+	}
+
+	size_t size { sizeof(FileHeader) + venues.size() * sizeof(VenueRecord) + instruments.size() * sizeof(InstrumentRecord) };
+	for (const auto &saved: instruments)
+	{
+		size += saved.quotes.size() * sizeof(QuoteRecord);
+	}
+	MappedFile file;
+	BoolResult result { file.Create(path, size) };
+	if (!result)
+	{
+		return result;
+	}
+	char *pos { file.Data() };
+	const auto write { [&pos](const void *data, size_t len)
+	{
+		std::memcpy(pos, data, len);
+		pos += len;
+	} };
+	FileHeader header { };
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.venueCount = uint32_t(venues.size());
+	header.instrumentCount = uint32_t(instruments.size());
+	header.savedAt = CurrentTimestamp();
+	write(&header, sizeof(header));
+	for (const auto &venue: venues)
+	{
+		VenueRecord record;
+		SetName(record.name, venue);
+		write(&record, sizeof(record));
+	}
+	size_t quoteCount { 0 };
+	for (const auto &saved: instruments)
+	{
+		write(&saved.header, sizeof(saved.header));
+		write(saved.quotes.data(), saved.quotes.size() * sizeof(QuoteRecord));
+		quoteCount += saved.quotes.size();
+	}
+	result = file.Commit();
+	if (result)
+	{
+		poco_information_f3(logger(), "Saved %s instruments (%s quotes) to %s", std::to_string(instruments.size()),
+							std::to_string(quoteCount), path);
+	}
+	return result;
+}
+
+Result<size_t> OrderBook::LoadSnapshot(const std::string &path)
+{
+	using namespace BOOKFILE;
+	MappedFile file;
+	const BoolResult opened { file.Open(path) };
+	if (!opened)
+	{
+		return Result<size_t>(setError, opened.ErrorMessage());
+	}
+	const char *pos { file.Data() };
+	const char *const end { file.Data() + file.Size() };
+	const auto read { [&pos, end](auto &record)
+	{
+		if (size_t(end - pos) < sizeof(record))
+		{
+			return false;
+		}
+		std::memcpy(&record, pos, sizeof(record));
+		pos += sizeof(record);
+		return true;
+	} };
+	FileHeader header { };
+	if (!read(header) || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+	{
+		return Result<size_t>(setError, "%s is not an order book snapshot (version %s)", path, std::to_string(VERSION));
+	}
+	if (size_t(end - pos) / sizeof(VenueRecord) < header.venueCount) // checked before allocating for a corrupt count
+	{
+		return Result<size_t>(setError, "%s is truncated", path);
+	}
+	std::vector<int> venues(header.venueCount, 0); // file venue -> venue id of this book
+	for (uint32_t i { 0 }; i < header.venueCount; ++i)
+	{
+		VenueRecord record { };
+		if (!read(record))
+		{
+			return Result<size_t>(setError, "%s is truncated", path);
 		}
-		if (quote->QuoteType() != QT_DELETE)
+		const std::string name { GetName(record.name) };
+		venues[i] = i == 0 || name.empty() ? 0 : std::max(RegisterVenue(name), 0);
+	}
+	size_t loaded { 0 };
+	for (uint32_t i { 0 }; i < header.instrumentCount; ++i)
+	{
+		InstrumentRecord record { };
+		if (!read(record) || size_t(end - pos) / sizeof(QuoteRecord) < size_t(record.quoteCount[0]) + record.quoteCount[1])
+		{
+			return Result<size_t>(setError, "%s is truncated", path);
+		}
+		const char *const quotes { pos };
+		pos += (size_t(record.quoteCount[0]) + record.quoteCount[1]) * sizeof(QuoteRecord);
+
+		const CurrencyPair cp { GetName(record.cp) };
+		int id { -1 };
+		InstrumentBook *book { FindBook(cp, &id) };
+		if (!book)
+		{
+			id = RegisterInstrument(cp);
+			book = id < 0 ? nullptr : m_books[size_t(id)].get();
+		}
+		if (!book || book->quoteCounts[0].load(std::memory_order_relaxed) > 0 || book->quoteCounts[1].load(std::memory_order_relaxed) > 0)
 		{
-			if (vec->empty()) // vector empty, create and no need to sort
+			poco_warning_f1(logger(), "Instrument %s of the snapshot file skipped", GetName(record.cp));
+			continue;
+		}
+		VenueMask restored { 0 };
+		std::vector<QuoteRecord> records(size_t(record.quoteCount[0]) + record.quoteCount[1]);
+		std::memcpy(records.data(), quotes, records.size() * sizeof(QuoteRecord));
+		auto first { records.begin() };
+		for (bool bid: { true, false })
+		{
+			const auto last { first + record.quoteCount[bid ? 0 : 1] };
+			for (auto level { first }; level != last;)
 			{
-				vec->push_back(quote);
+				// a level lists its quotes in reverse order of insertion (see PriceLadder::Insert())
+				const auto levelEnd { std::find_if(level, last, [price = level->price](const QuoteRecord &q) { return q.price != price; }) };
+				for (auto it { levelEnd }; it != level;)
+				{
+					const QuoteRecord &q { *--it };
+					const int venue { q.venue < venues.size() ? venues[q.venue] : 0 };
+					restored |= VenueBit(venue);
+					Shard(id).Post(id, bid, QuotePool::Create(0, 0, CurrentTimestamp(), "", 1, q.price, q.volume, q.minQty, q.key, 0,
+															  q.sendingTime, QT_NEW, q.positionNo, "", "", venue));
+				}
+				level = levelEnd;
 			}
-			else // vector NOT empty, update and sort or insert at correct position
+			first = last;
+		}
+		book->updateId.store(record.updateId, std::memory_order_release);
+		book->restoredVenues.fetch_or(restored, std::memory_order_relaxed);
+		++loaded;
+	}
+	Sync();
+	return loaded;
+}
+
+bool OrderBook::ClaimRestoredQuotes(CurrencyPair cp, int venue)
+{
+	InstrumentBook *book { FindBook(cp) };
+	const VenueMask bit { VenueBit(venue) };
+	return book && bit && (book->restoredVenues.fetch_and(~bit, std::memory_order_relaxed) & bit) != 0;
+}
+
+size_t OrderBook::RemoveUnclaimedQuotes()
+{
+	std::atomic<size_t> removed { 0 };
+	const int count { m_registry.Count() };
+	for (size_t shardIdx { 0 }; shardIdx < m_shards.size(); ++shardIdx)
+	{
+		m_shards[shardIdx]->Run([this, count, shardIdx, &removed]()
+		{
+			std::vector<int64_t> keys;
+			for (int id { int(shardIdx) }; id < count; id += int(m_shards.size()))
 			{
-				//insert quote at right place
-				vec->insert(std::find_if(vec->begin(), vec->end(), [bid, &quote](const Quote::Ptr &q)
+				InstrumentBook &book { *m_books[size_t(id)] };
+				const VenueMask venues { book.restoredVenues.exchange(0, std::memory_order_relaxed) };
+				if (venues == 0)
 				{
-					if (quote->Price() != q->Price()) // different price -> better price first
+					continue;
+				}
+				for (bool bid: { true, false })
+				{
+					PriceLadder &ladder { book.ladders.Get(bid) };
+					keys.clear();
+					ladder.ForEachQuote([venues, &keys](const Quote &q, bool &)
+					{
+						if ((VenueBit(q.Venue()) & venues) != 0)
+						{
+							keys.push_back(q.Key());
+						}
+					});
+					for (const int64_t key: keys)
 					{
-						return bid ? quote->Price() > q->Price() : quote->Price() < q->Price();
+						NoteChange(book, bid, ladder.Find(key)->Price());
+						QuotePool::Release(*ladder.Remove(key));
 					}
-					else // same price -> greater volume first
+					if (!keys.empty())
 					{
-						return quote->Volume() >= q->Volume();
+						PublishSide(book, bid);
+						PublishTopOfBook(book, bid);
+						removed.fetch_add(keys.size(), std::memory_order_relaxed);
 					}
-				}), quote);
+				}
 			}
-		}
+			EndBatch(shardIdx);
+		});
+	}
+	if (removed > 0)
+	{
+		poco_information_f1(logger(), "Removed %s restored quotes not claimed by any session", std::to_string(removed.load()));
 	}
+	return removed;
+}
 
-	std::atomic_store(&m_lastQuote, quote);
+void OrderBook::SetUpdateId(CurrencyPair cp, int64_t updateId)
+{
+	if (InstrumentBook *book { FindBook(cp) })
+	{
+		book->updateId.store(updateId, std::memory_order_release);
+	}
+}
 
-	// static int cnt=1;
-	//
-	// if (cnt++ == 30)
-	// {
-	// 	printBooks(std::cout, true, 10);
-	// 	printBooks(std::cout, false, 10);
-	// 	cnt = 1;
-	// }
+int64_t OrderBook::GetUpdateId(CurrencyPair cp) const
+{
+	const InstrumentBook *book { FindBook(cp) };
+	return book ? book->updateId.load(std::memory_order_acquire) : 0;
 }
 
-BookView::QuoteGroupVec OrderBook::GetLevels(CurrencyPair cp, bool bid, unsigned int n, const BookView::QuotePred &quotePred) const
+int OrderBook::RegisterInstrument(CurrencyPair cp)
 {
-	BookView::QuoteGroupVec out;
-	IterateQuoteGroups(cp, bid, [&out, &n](int level, QuoteGroup::Ptr &qg, bool &cont)
+	const int id { m_registry.Register(cp, [this, cp](int newId)
 	{
-		out.push_back(qg);
-		cont = n == 0 || --n > 0; // n == 0 => unlimited levels; n > 0 => n levels (break when --n reaches 0)
-	}, quotePred);
-	return out;
+		m_books[size_t(newId)] = std::make_unique<InstrumentBook>(newId, cp);
+	}) };
+	if (id < 0 && cp.Valid())
+	{
+		poco_error_f2(logger(), "Failed to register instrument %s (limit of %s instruments reached)", cp.ToString(),
+					  std::to_string(MAX_INSTRUMENTS));
+	}
+	return id;
 }
 
-size_t OrderBook::GetQuoteCount(CurrencyPair cp, bool bid) const
+int OrderBook::RegisterVenue(const std::string &session)
 {
-	size_t result { 0 };
-	std::shared_lock lockMap { m_quoteVectorMap.Mutex() };
-	const auto &it { m_quoteVectorMap->find(cp) };
-	if (it != m_quoteVectorMap->end())
+	std::lock_guard lock { m_venues.Mutex() };
+	const auto it { std::find(m_venues->begin() + 1, m_venues->end(), session) };
+	if (it != m_venues->end())
 	{
-		std::shared_lock lock { GetLock(cp, bid) };
-		result = it->second.Get(bid)->size();
+		return int(it - m_venues->begin());
 	}
-	return result;
+	if (m_venues->size() >= MAX_VENUES)
+	{
+		poco_error_f2(logger(), "Failed to register venue %s (limit of %s venues reached)", session, std::to_string(MAX_VENUES));
+		return -1;
+	}
+	m_venues->push_back(session);
+	return int(m_venues->size() - 1);
 }
 
-void OrderBook::IterateQuoteGroups(CurrencyPair cp, bool bid, const BookView::QuoteGroupFunc &action, const BookView::QuotePred &quotePred) const
+int OrderBook::FindVenue(const std::string &session) const
 {
-	std::shared_lock lockMap { m_quoteVectorMap.Mutex() };
-	const auto &it { m_quoteVectorMap->find(cp) };
-	if (it != m_quoteVectorMap->end())
+	std::lock_guard lock { m_venues.Mutex() };
+	const auto it { std::find(m_venues->begin() + 1, m_venues->end(), session) };
+	return it != m_venues->end() ? int(it - m_venues->begin()) : -1;
+}
+
+std::string OrderBook::VenueName(int venue) const
+{
+	std::lock_guard lock { m_venues.Mutex() };
+	return venue > 0 && size_t(venue) < m_venues->size() ? (*m_venues)[size_t(venue)] : std::string();
+}
+
+OrderBook::InstrumentBook *OrderBook::FindBook(CurrencyPair cp, int *id) const
+{
+	const int found { m_registry.Find(cp) };
+	if (id)
 	{
-		std::shared_lock lock { GetLock(cp, bid) };
-		QuoteVecPtrToConst quotes { it->second.Get(bid) };
-		lockMap.unlock();
-		QuoteGroup::Ptr quoteGroup;
-		bool cont { true };
-		int level { 1 };
-		for (auto itQuote { quotes->begin() }; cont && itQuote != quotes->end(); ++level)
+		*id = found;
+	}
+	return found < 0 ? nullptr : m_books[size_t(found)].get();
+}
+
+void OrderBook::AddEntry(int64_t key, int64_t refKey, int64_t receiveTime, CurrencyPair cp, const NormalizedMDData::Entry &entry,
+						 int venue)
+{
+	AddEntry(key, refKey, 0, receiveTime, cp, entry, venue);
+}
+
+void OrderBook::AddEntry(int64_t key, int64_t refKey, int64_t sendTime, int64_t receiveTime, CurrencyPair cp,
+						const NormalizedMDData::Entry &entry, int venue)
+{
+	AddQuote(cp, entry.entryType.Bid(), CreateQuote(key, refKey, sendTime, receiveTime, CurrentTimestamp(), cp, entry, venue));
+}
+
+void OrderBook::ApplyBatch(const BatchEntry *entries, size_t count, int64_t sendTime, int64_t receiveTime, int venue)
+{
+	const int64_t sortTime { CurrentTimestamp() };
+	size_t next { 0 };
+	for (size_t first { 0 }; first < count; first = next)
+	{
+		// the updates of one instrument are posted to its writer thread in a row
+		const CurrencyPair cp { entries[first].entry->instrument };
+		for (next = first + 1; next < count && entries[next].entry->instrument == cp; ++next) { }
+		const int id { FindOrRegisterInstrument(cp) };
+		if (id < 0)
 		{
-			itQuote = getNextLevel(quoteGroup, *quotes, quotePred, itQuote);
-			if (quoteGroup)
+			continue;
+		}
+		const BatchEntry *const run { entries + first };
+		Shard(id).PostBatch(id, next - first, [run, sendTime, receiveTime, sortTime, cp, venue](size_t i, bool &bid, Quote &quote)
+		{
+			bid = run[i].entry->entryType.Bid();
+			quote = CreateQuote(run[i].key, run[i].refKey, sendTime, receiveTime, sortTime, cp, *run[i].entry, venue);
+		});
+	}
+}
+
+Quote OrderBook::CreateQuote(int64_t key, int64_t refKey, int64_t sendTime, int64_t receiveTime, int64_t sortTime, CurrencyPair cp,
+							 const NormalizedMDData::Entry &entry, int venue)
+{
+	// fixed-point entries were converted from the message text exactly, the others still go through double
+	const int64_t price { entry.fixedPoint ? entry.cpipPrice : cp.DblToCpip(entry.price) };
+	const int64_t volume { entry.fixedPoint ? entry.qtyVolume : cp.DoubleToQty(entry.volume) };
+	const int64_t minQty { entry.fixedPoint ? entry.qtyMinQty : cp.DoubleToQty(entry.minQty) };
+	return QuotePool::Create(entry.adptReceiveTime, receiveTime, sortTime, entry.quoteId, 1, price, volume, minQty, key, refKey, sendTime,
+							 int(entry.updateType), int(entry.positionNo), entry.settlDate, entry.originators, venue);
+}
+
+/*! \brief Returns the id of an instrument, registering it if necessary (-1 if the book is full) */
+int OrderBook::FindOrRegisterInstrument(CurrencyPair cp)
+{
+	int id { m_registry.Find(cp) };
+	if (id < 0)
+	{
+		id = RegisterInstrument(cp);
+		if (id < 0)
+		{
+			poco_error_f1(logger(), "FAILED TO CREATE PRICE LADDER ENTRY FOR %s", cp.ToString());
+		}
+	}
+	return id;
+}
+
+void OrderBook::AddQuote(CurrencyPair cp, bool bid, const Quote &quote)
+{
+	const int id { FindOrRegisterInstrument(cp) };
+	if (id >= 0)
+	{
+		Shard(id).Post(id, bid, quote);
+	}
+}
+
+/*! \brief Applies a quote to the book of an instrument (writer thread of the instrument only)
+ *
+ * The changed sides are published with the last update of a batch (@a last), both sides as one change.
+ */
+void OrderBook::ApplyQuote(InstrumentBook &book, bool bid, const Quote &quote, bool last)
+{
+	PriceLadder &ladder { book.ladders.Get(bid) };
+	// delete, check if there is something to delete, then remove it from its level
+	if (quote.QuoteType() == QT_DELETE || quote.QuoteType() == QT_UPDATE)
+	{
+		if (!ladder.Empty() && quote.RefKey() > 0)
+		{
+			const std::optional<Quote> removed { ladder.Remove(quote.RefKey()) };
+			if (removed)
 			{
-				action(level, quoteGroup, cont);
+				NoteChange(book, bid, removed->Price());
+				QuotePool::Release(*removed, &quote);
 			}
+			else if (!Bounded()) // in bounded-depth mode the quote may have been evicted
+			{
+				std::string msg = UTILS::Format("*** %s %s/%Ld: FAILED UPDATE/DELETE: Quote with RefKey %Ld %Ld not found !!! ***", book.cp.ToString(),
+												quote.SeqNum(), quote.RefKey(), quote.Price());
+				poco_error(logger(),msg);
+			}
+		}
+		else
+		{
+			poco_error_f3(logger(), "*** %s/%Ld %Ld: Missing RefKey in UPDATE/DELETE ***", book.cp.ToString(),  quote.SeqNum(), quote.Price());
+		}
+	}
+	if (quote.QuoteType() != QT_DELETE)
+	{
+		ladder.Insert(quote);
+		NoteChange(book, bid, quote.Price());
+	}
+	EnforceLimits(book, bid, quote);
+	book.unpublished[bid ? 0 : 1] = true;
+	if (!last)
+	{
+		return;
+	}
+	// the side of the last update is unpublished in any case
+	const bool both { book.unpublished[0] && book.unpublished[1] };
+	for (bool changed: { true, false })
+	{
+		if (book.unpublished[changed ? 0 : 1])
+		{
+			PublishSide(book, changed);
 		}
 	}
+	book.unpublished = { };
+	if (both)
+	{
+		PublishTopOfBook(book);
+	}
+	else
+	{
+		PublishTopOfBook(book, bid);
+	}
+	m_lastQuotes[size_t(book.id) % m_shards.size()].Publish(quote, std::chrono::steady_clock::now().time_since_epoch().count());
 }
 
-BidAskPair<int64_t> OrderBook::GetBestPrices(CurrencyPair cp) const
+/*! \brief Trims one side to the depth limits and registers a new quote for expiry (writer thread of the instrument only) */
+void OrderBook::EnforceLimits(InstrumentBook &book, bool bid, const Quote &quote)
 {
-	return GetBestPrices(cp, [](bool, BOOK::Quote&) { return true; });
+	PriceLadder &ladder { book.ladders.Get(bid) };
+	const int64_t maxAge { m_maxQuoteAge.load(std::memory_order_relaxed) };
+	if (maxAge > 0 && quote.QuoteType() != QT_DELETE)
+	{
+		// quotes without sending time age from now on
+		const int64_t sent { quote.SendingTime() > 0 ? quote.SendingTime() : CurrentTimestamp() };
+		book.expiry[bid ? 0 : 1].Add(quote.Key(), sent + maxAge, HandleTag(quote.Handle()));
+	}
+	const size_t evicted { ladder.Trim(m_maxLevels.load(std::memory_order_relaxed), m_maxQuotesPerLevel.load(std::memory_order_relaxed),
+									   [](const Quote &q) { QuotePool::Release(q); }) };
+	if (evicted > 0)
+	{
+		m_evictedCount.fetch_add(evicted, std::memory_order_relaxed);
+	}
 }
 
-int64_t OrderBook::GetBestPrice(CurrencyPair cp, bool bid) const
+void OrderBook::ExpireQuotes(int64_t now)
 {
-	return GetBestPrice(cp, bid, [](bool, BOOK::Quote&) { return true; });
+	const int count { m_registry.Count() };
+	for (size_t shardIdx { 0 }; shardIdx < m_shards.size(); ++shardIdx)
+	{
+		m_shards[shardIdx]->Post([this, count, shardIdx, now]()
+		{
+			size_t expired { 0 };
+			for (int id { int(shardIdx) }; id < count; id += int(m_shards.size()))
+			{
+				InstrumentBook &book { *m_books[size_t(id)] };
+				expired += ExpireQuotes(book, true, now) + ExpireQuotes(book, false, now);
+			}
+			EndBatch(shardIdx);
+			if (expired > 0)
+			{
+				m_evictedCount.fetch_add(expired, std::memory_order_relaxed);
+				poco_information_f3(logger(), "Expired %s quotes older than %s (shard %s)", std::to_string(expired),
+									NanosecondsToString(m_maxQuoteAge.load(std::memory_order_relaxed)), std::to_string(shardIdx));
+			}
+		});
+	}
 }
 
-Quote::Ptr OrderBook::GetBestQuote(CurrencyPair cp, bool bid) const
+/*! \brief Removes the quotes of one side whose expiry time has passed (writer thread of the instrument only) */
+size_t OrderBook::ExpireQuotes(InstrumentBook &book, bool bid, int64_t now)
 {
-	return GetBestQuote(cp, bid, [](bool, BOOK::Quote&) { return true; });
+	PriceLadder &ladder { book.ladders.Get(bid) };
+	size_t expired { 0 };
+	book.expiry[bid ? 0 : 1].Advance(now, [this, &book, bid, &ladder, &expired](const ExpiryWheel::Entry &entry)
+	{
+		// the quote may have been removed (or the key reused) in the meantime
+		const Quote *quote { ladder.Find(entry.key) };
+		if (quote && HandleTag(quote->Handle()) == entry.tag)
+		{
+			NoteChange(book, bid, quote->Price());
+			QuotePool::Release(*ladder.Remove(entry.key));
+			++expired;
+		}
+	});
+	if (expired > 0)
+	{
+		PublishSide(book, bid);
+		PublishTopOfBook(book, bid);
+	}
+	return expired;
 }
 
-int64_t OrderBook::GetMidPrice(CurrencyPair cp) const
+void OrderBook::AddPublisher(const ORDERBOOK::IPublisher::Ptr &publisher)
 {
-	return GetMidPrice(cp, [](bool, BOOK::Quote&) { return true; });
+	if (!publisher)
+	{
+		return;
+	}
+	std::lock_guard lock { m_publishers.Mutex() };
+	auto publishers { *m_publishers ? std::make_shared<PublisherList>(**m_publishers) : std::make_shared<PublisherList>() };
+	publishers->push_back(publisher);
+	*m_publishers = std::move(publishers);
+	m_publishing.store(true, std::memory_order_relaxed);
 }
 
-BidAskPair<Quote::Ptr> OrderBook::GetBestQuotes(CurrencyPair cp) const
+void OrderBook::RemovePublisher(const ORDERBOOK::IPublisher::Ptr &publisher)
 {
-	return GetBestQuotes(cp, [](bool, BOOK::Quote&) { return true; });
+	std::lock_guard lock { m_publishers.Mutex() };
+	if (!*m_publishers)
+	{
+		return;
+	}
+	auto publishers { std::make_shared<PublisherList>(**m_publishers) };
+	publishers->erase(std::remove(publishers->begin(), publishers->end(), publisher), publishers->end());
+	m_publishing.store(!publishers->empty(), std::memory_order_relaxed);
+	*m_publishers = publishers->empty() ? nullptr : std::move(publishers);
 }
 
-void OrderBook::Clear()
+std::shared_ptr<const OrderBook::PublisherList> OrderBook::Publishers()
+{
+	std::lock_guard lock { m_publishers.Mutex() };
+	return *m_publishers;
+}
+
+/*! \brief Records a change of one side at a given price for the next publication (writer thread of the instrument only) */
+void OrderBook::NoteChange(InstrumentBook &book, bool bid, int64_t price)
+{
+	if (!m_publishing.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+	PendingChange &change { book.changes[bid ? 0 : 1] };
+	if (!change.changed || (bid ? price > change.bestPrice : price < change.bestPrice))
+	{
+		change.bestPrice = price;
+	}
+	change.changed = true;
+	if (!book.pending)
+	{
+		book.pending = true;
+		m_pendingBooks[size_t(book.id) % m_shards.size()].push_back(book.id);
+	}
+}
+
+/*! \brief Posts one event per side changed since the last call to the dispatcher (writer thread of the shard only)
+ *
+ * When the queue of the dispatcher is full, the changes of the book stay
+ * pending and are reported with the next batch (or once the dispatcher has
+ * caught up), coalesced with the changes made meanwhile.
+ */
+void OrderBook::PublishChanges(size_t shardIdx)
 {
+	std::vector<int> &pending { m_pendingBooks[shardIdx] };
+	size_t kept { 0 };
+	for (int id: pending)
 	{
-		std::unique_lock lockQuoteVectorMap { m_quoteVectorMap.Mutex() };
-		std::unique_lock lockAccessMap { m_accessMap.Mutex() };
-		
-		// set invalid all quotes:
-		for (const auto &it: *m_quoteVectorMap)
+		InstrumentBook &book { *m_books[size_t(id)] };
+		const TopOfBook top { book.topOfBook.Read() };
+		bool posted { true };
+		for (bool bid: { true, false })
 		{
-			for (bool bid: { true, false })
+			const size_t side { bid ? 0u : 1u };
+			PendingChange &change { book.changes[side] };
+			if (!change.changed)
 			{
-				const QuoteVecPtr &qvp { it.second.Get(bid) };
-				if (qvp)
-				{
-					for (auto &q: *qvp)
-					{
-						if (q)
-						{
-							q->SetInvalid(nullptr);
-						}
-					}
-				}
+				continue;
+			}
+			ORDERBOOK::BookEvent event { book.cp, ORDERBOOK::BookEventType::TopOfBook, bid, 0, top.price.Get(bid),
+										 top.volume.Get(bid), book.versions[side].load(std::memory_order_relaxed) };
+			if (change.cleared)
+			{
+				event.type = ORDERBOOK::BookEventType::Cleared;
 			}
+			else if (event.price == change.publishedPrice && event.volume == change.publishedVolume)
+			{
+				event.type = ORDERBOOK::BookEventType::Level;
+				event.level = int(book.ladders.Get(bid).LevelIndex(change.bestPrice));
+			}
+			if (!m_dispatcher.TryPost(event))
+			{
+				posted = false;
+				continue;
+			}
+			change.changed = false;
+			change.cleared = false;
+			change.publishedPrice = event.price;
+			change.publishedVolume = event.volume;
+		}
+		if (posted)
+		{
+			book.pending = false;
+		}
+		else
+		{
+			pending[kept++] = id;
+		}
+		if (book.keptBack != !posted)
+		{
+			book.keptBack = !posted;
+			m_keptBackCount.fetch_add(posted ? -1 : 1, std::memory_order_release);
 		}
-		
-		m_quoteVectorMap->clear();
-		m_accessMap->Bid().clear();
-		m_accessMap->Ask().clear();
 	}
-
-	std::atomic_store(&m_lastQuote, BOOK::Quote::Ptr(nullptr));
+	pending.resize(kept);
 }
 
-OrderBook::QuoteVec::const_iterator OrderBook::getNextLevel(QuoteGroup::Ptr &quoteGroup, const QuoteVec &srcVec, const BookView::QuotePred &quotePred,
-														  QuoteVec::const_iterator iterator) const
+/*! \brief Hands a run of events to the publishers (dispatcher thread) */
+void OrderBook::Dispatch(const std::vector<ORDERBOOK::BookEvent> &events)
 {
-	bool success { false };
-	quoteGroup = QuoteGroup::Create();
-	while (iterator != srcVec.end())
+	const std::shared_ptr<const PublisherList> publishers { Publishers() };
+	if (!publishers)
+	{
+		return;
+	}
+	for (const auto &event: events)
 	{
-		int64_t price { iterator->get()->Price() };
-		while (iterator != srcVec.end() && price == iterator->get()->Price())
+		for (const auto &publisher: *publishers)
 		{
-			if (!quotePred || quotePred(**iterator))
+			try
 			{
-				quoteGroup->AddQuote(*iterator);
-				success = true;
+				publisher->Publish(event);
+			}
+			catch (std::exception &e)
+			{
+				poco_error_f2(logger(), "Publisher failed on an event of %s: %s", event.cp.ToString(), std::string(e.what()));
 			}
-			++iterator;
 		}
-		if (success) // if quoteGroup contains at least one quote -> done
+	}
+}
+
+/*! \brief Ends a batch of changes: republishes the snapshots being read, then reports the changes (writer thread of the shard only) */
+void OrderBook::EndBatch(size_t shardIdx)
+{
+	PublishSnapshots(shardIdx);
+	PublishChanges(shardIdx);
+}
+
+/*! \brief Takes new snapshots of the changed sides that readers are following (writer thread of the shard only)
+ *
+ * Only the best levels asked for by the readers of a side are copied (see
+ * GetSnapshot()). A side stays followed while its snapshot is read between
+ * two batches (or up to SNAPSHOT_UNREAD_BATCHES batches without a read);
+ * once it is not followed any more, the next reader lets the writer take the
+ * snapshot again.
+ */
+void OrderBook::PublishSnapshots(size_t shardIdx)
+{
+	std::vector<std::pair<int, bool>> &pending { m_pendingSnapshots[shardIdx] };
+	for (const auto &[id, bid]: pending)
+	{
+		InstrumentBook &book { *m_books[size_t(id)] };
+		const size_t side { bid ? 0u : 1u };
+		book.snapshotPending[side] = false;
+		if (book.snapshotRead[side].exchange(false, std::memory_order_relaxed))
+		{
+			book.snapshotUnread[side] = 0;
+		}
+		else if (++book.snapshotUnread[side] > SNAPSHOT_UNREAD_BATCHES)
+		{
+			book.snapshotUnread[side] = 0;
+			book.snapshotLevels[side] = 0;
+			book.snapshotFollowed[side].store(false, std::memory_order_relaxed);
+			continue;
+		}
+		book.snapshots[side].Store(std::make_shared<const BookSnapshot>(book.versions[side].load(std::memory_order_relaxed),
+																		book.ladders.Get(bid), book.snapshotLevels[side]));
+	}
+	pending.clear();
+}
+
+void OrderBook::Sync() const
+{
+	for (;;)
+	{
+		for (const auto &shard: m_shards)
+		{
+			shard->Sync();
+		}
+		// changes kept back while the dispatcher was full are posted again once it has caught up;
+		// read before waiting for the dispatcher, so the events that ended keeping them back are waited for
+		const bool keptBack { m_keptBackCount.load(std::memory_order_acquire) > 0 };
+		m_dispatcher.Sync();
+		if (!keptBack || m_dispatcher.OnDispatcherThread())
 		{
 			break;
 		}
 	}
-	if (!success)
+}
+
+BookSnapshot::Ptr OrderBook::GetSnapshot(CurrencyPair cp, bool bid) const
+{
+	return GetSnapshot(cp, bid, 0);
+}
+
+/*! \brief Returns a snapshot holding at least the best @a levels levels of one side (all levels if @a levels is 0)
+ *
+ * A reader of the best levels makes the writer follow the side with that
+ * many levels; a reader of all levels is answered from the latest snapshot
+ * while the side is unchanged, but the whole side is not followed.
+ */
+BookSnapshot::Ptr OrderBook::GetSnapshot(CurrencyPair cp, bool bid, size_t levels) const
+{
+	int id { -1 };
+	InstrumentBook *book { FindBook(cp, &id) };
+	if (!book)
+	{
+		return nullptr;
+	}
+	const size_t side { bid ? 0u : 1u };
+	SnapshotSlot &cache { book->snapshots[side] };
+	if (BookSnapshot::Ptr snapshot { cache.Load() })
+	{
+		const bool current { snapshot->Version() == book->versions[side].load(std::memory_order_acquire) };
+		// a followed side is retaken by the writer at the end of the batch changing it
+		if (snapshot->Covers(levels) && (current || book->snapshotFollowed[side].load(std::memory_order_relaxed)))
+		{
+			if (!book->snapshotRead[side].load(std::memory_order_relaxed))
+			{
+				book->snapshotRead[side].store(true, std::memory_order_relaxed);
+			}
+			return snapshot;
+		}
+	}
+	// no snapshot, or the writer stopped following the side: let the writer take one (after applying the updates queued so far)
+	BookSnapshot::Ptr result { nullptr };
+	Shard(id).Run([book, bid, side, levels, &cache, &result]()
+	{
+		if (levels > 0)
+		{
+			book->snapshotFollowed[side].store(true, std::memory_order_relaxed);
+			book->snapshotLevels[side] = std::max(book->snapshotLevels[side], levels);
+		}
+		book->snapshotUnread[side] = 0;
+		const uint64_t version { book->versions[side].load(std::memory_order_relaxed) };
+		result = cache.Load();
+		if (result && result->Version() == version && result->Covers(levels)) // taken meanwhile by another reader
+		{
+			return;
+		}
+		result = std::make_shared<const BookSnapshot>(version, book->ladders.Get(bid), levels);
+		cache.Store(result);
+	});
+	return result;
+}
+
+BookDepth OrderBook::GetDepth(CurrencyPair cp, bool bid, unsigned int n) const
+{
+	BookDepth depth { GetSnapshot(cp, bid, n), LevelRange() };
+	if (depth.snapshot)
 	{
-		quoteGroup = nullptr;
+		depth.levels = depth.snapshot->Levels(n);
 	}
-	return iterator;
+	return depth;
 }
 
-// DEBUG
-//static
-//void OrderBook::printBook(BookView *view, std::ostream& ostr, const std::string& instr, bool bid, unsigned int levels)
-void OrderBook::printBook(std::ostream &ostr, CurrencyPair cp, bool bid, unsigned int levels) const
+int64_t OrderBook::GetAvgPriceForVolume(CurrencyPair cp, bool bid, int64_t volume, int64_t *filled) const
 {
-	ostr << ">>>>> getting book " << cp.ToString() << " (" << (bid ? "BID" : "ASK") << ", " << levels << " levels) start"
-		 << std::endl;
-	BookView::QuoteGroupVec book { GetLevels(cp, bid, levels) };
-	for (auto &qb: book)
+	const InstrumentBook *book { FindBook(cp) };
+	if (!book)
 	{
-		ostr << qb->AvgPrice();
-		if (!qb->SinglePrice())
+		if (filled)
 		{
-			ostr << " (" << qb->MinPrice() << " - " << qb->MaxPrice() << ")";
+			*filled = 0;
 		}
-		ostr << " " << qb->TotalVolume() << " size: " << qb->QuoteCount() << " " << std::endl;
+		return 0;
 	}
-	ostr << std::endl << ">>>>> getting book done" << std::endl;
+	if (const std::optional<int64_t> price { book->ladders.Get(bid).Depth().AvgPriceForVolume(volume, filled) })
+	{
+		return *price;
+	}
+	// reaches the levels far from the touch
+	const BookSnapshot::Ptr snapshot { GetSnapshot(cp, bid) };
+	return snapshot->AvgPriceForVolume(volume, filled);
 }
 
-void OrderBook::printBooks(std::ostream &ostr, bool bid, unsigned int levels) const
+int64_t OrderBook::GetPriceForVolume(CurrencyPair cp, bool bid, int64_t volume) const
 {
-	std::shared_lock lockMap { m_quoteVectorMap.Mutex() };
-	QuoteVectorMap mapCopy { *m_quoteVectorMap };
-	lockMap.unlock();
-	for (auto &it: mapCopy)
+	const InstrumentBook *book { FindBook(cp) };
+	if (!book)
 	{
-		std::shared_lock lock { GetLock(it.first, bid) };
-		printBook(ostr, it.first, bid, levels);
+		return 0;
 	}
+	const std::optional<int64_t> price { book->ladders.Get(bid).Depth().PriceForVolume(volume) };
+	return price ? *price : GetSnapshot(cp, bid)->PriceForVolume(volume);
 }
 
+int64_t OrderBook::GetVolumeWithinBps(CurrencyPair cp, bool bid, int64_t bps) const
+{
+	const InstrumentBook *book { FindBook(cp) };
+	if (!book)
+	{
+		return 0;
+	}
+	const std::optional<int64_t> volume { book->ladders.Get(bid).Depth().VolumeWithinBps(bps) };
+	return volume ? *volume : GetSnapshot(cp, bid)->VolumeWithinBps(bps);
+}
 
-std::shared_mutex &OrderBook::GetLock(CurrencyPair cp, bool bid) const
+BookView::QuoteGroupVec OrderBook::GetLevels(CurrencyPair cp, bool bid, unsigned int n, const BookView::QuotePred &quotePred) const
 {
-	std::shared_lock slock { m_accessMap.Mutex() };
-	AccessMap &map { m_accessMap->Get(bid) };
-	const auto &it { map.find(cp) };
-	if (it != map.end())
+	BookView::QuoteGroupVec out;
+	if (n > 0)
 	{
-		return *(it->second);
+		out.reserve(n);
 	}
-	else
+	if (const BookSnapshot::Ptr snapshot { GetSnapshot(cp, bid, quotePred ? 0 : n) }) // levels may be skipped by quotePred
 	{
-		slock.unlock();
-		std::unique_lock ulock { m_accessMap.Mutex() };
-		AccessMap &map2 { m_accessMap->Get(bid) }; // "map" could have been invalidated while unlocked
-		return *map2.emplace(cp, std::make_unique<std::shared_mutex>()).first->second;
+		IterateQuoteGroups(*snapshot, [&out, &n](int level, QuoteGroup::Ptr &qg, bool &cont)
+		{
+			out.push_back(qg);
+			cont = n == 0 || --n > 0; // n == 0 => unlimited levels; n > 0 => n levels (break when --n reaches 0)
+		}, quotePred);
 	}
+	return out;
 }
 
+size_t OrderBook::GetQuoteCount(CurrencyPair cp, bool bid) const
+{
+	const InstrumentBook *book { FindBook(cp) };
+	return book ? book->quoteCounts[bid ? 0 : 1].load(std::memory_order_relaxed) : 0;
+}
 
-void OrderBook::CleanupQuoteVec(CurrencyPair cp, QuoteVec &vec, int64_t maxAge)
+void OrderBook::IterateQuoteGroups(CurrencyPair cp, bool bid, const BookView::QuoteGroupFunc &action, const BookView::QuotePred &quotePred) const
 {
-	if (maxAge > 0)
+	if (const BookSnapshot::Ptr snapshot { GetSnapshot(cp, bid) })
 	{
-		auto it = vec.begin();
-		while (it != vec.end())
+		IterateQuoteGroups(*snapshot, action, quotePred);
+	}
+}
+
+/*! \brief Passes one quote group per level of a snapshot to @a action (levels without accepted quotes are skipped) */
+void OrderBook::IterateQuoteGroups(const BookSnapshot &snapshot, const BookView::QuoteGroupFunc &action, const BookView::QuotePred &quotePred)
+{
+	int level { 1 };
+	snapshot.ForEachLevel([&action, &quotePred, &level](const LevelView &snapshotLevel, bool &cont)
+	{
+		if (!quotePred)
 		{
-			if ((*it)->AgeSinceSend() > maxAge)
+			QuoteGroup::Ptr quoteGroup { std::make_shared<QuoteGroup>(snapshotLevel.begin(), snapshotLevel.end()) };
+			action(level++, quoteGroup, cont);
+			return;
+		}
+		QuoteGroup::Ptr quoteGroup { QuoteGroup::Create() };
+		bool success { false };
+		for (const auto &q: snapshotLevel)
+		{
+			if (quotePred(q))
 			{
-				poco_information_f2(logger(), "Erase outdated quote: %s (older than MaxAge = %s)", (*it)->ToString(cp), NanosecondsToString(maxAge));
-				(*it)->SetInvalid(nullptr);
-				it = vec.erase(it);
+				quoteGroup->AddQuote(q);
+				success = true;
 			}
-			else
+		}
+		if (success) // skip levels without accepted quotes
+		{
+			action(level++, quoteGroup, cont);
+		}
+	});
+}
+
+/*! \brief Publishes the quote count of one side and increments its version (writer thread of the instrument only) */
+void OrderBook::PublishSide(InstrumentBook &book, bool bid)
+{
+	const size_t side { bid ? 0u : 1u };
+	book.quoteCounts[side].store(book.ladders.Get(bid).QuoteCount(), std::memory_order_relaxed);
+	book.versions[side].fetch_add(1, std::memory_order_release);
+	if (book.snapshotFollowed[side].load(std::memory_order_relaxed) && !book.snapshotPending[side])
+	{
+		book.snapshotPending[side] = true;
+		m_pendingSnapshots[size_t(book.id) % m_shards.size()].emplace_back(book.id, bid);
+	}
+}
+
+namespace {
+
+/*! \brief Copies the best level (with a positive price) of a ladder to one side of @a top */
+void ReadBestLevel(const PriceLadder &ladder, bool bid, TopOfBook &top)
+{
+	ladder.ForEachLevel([bid, &top](const PriceLadder::Level &level, bool &cont)
+	{
+		if (level.price > 0)
+		{
+			top.price.Get(bid) = level.price;
+			top.volume.Get(bid) = level.totalVolume;
+			top.quoteCount.Get(bid) = int64_t(level.QuoteCount());
+			cont = false;
+		}
+	});
+}
+
+}
+
+/*! \brief Publishes the best level (with a positive price) of one side to the top of book record
+ *
+ * Must be called by the writer thread of the instrument.
+ */
+void OrderBook::PublishTopOfBook(InstrumentBook &book, bool bid)
+{
+	TopOfBook top;
+	ReadBestLevel(book.ladders.Get(bid), bid, top);
+	book.topOfBook.Publish(bid, top.price.Get(bid), top.volume.Get(bid), top.quoteCount.Get(bid));
+	m_bbo.Publish(book.id, bid, top.price.Get(bid), top.volume.Get(bid));
+}
+
+/*! \brief Publishes the best levels of both sides to the top of book record as one change (writer thread of the instrument only) */
+void OrderBook::PublishTopOfBook(InstrumentBook &book)
+{
+	TopOfBook top;
+	ReadBestLevel(book.ladders.Bid(), true, top);
+	ReadBestLevel(book.ladders.Ask(), false, top);
+	book.topOfBook.Publish(top);
+	m_bbo.Publish(book.id, top);
+}
+
+TopOfBook OrderBook::GetTopOfBook(CurrencyPair cp) const
+{
+	const InstrumentBook *book { FindBook(cp) };
+	return book ? book->topOfBook.Read() : TopOfBook();
+}
+
+BidAskPair<int64_t> OrderBook::GetBestPrices(CurrencyPair cp) const
+{
+	return GetTopOfBook(cp).price;
+}
+
+int64_t OrderBook::GetBestPrice(CurrencyPair cp, bool bid) const
+{
+	return GetTopOfBook(cp).price.Get(bid);
+}
+
+std::optional<Quote> OrderBook::GetBestQuote(CurrencyPair cp, bool bid) const
+{
+	return GetBestQuote(cp, bid, [](bool, const BOOK::Quote &) { return true; });
+}
+
+int64_t OrderBook::GetMidPrice(CurrencyPair cp) const
+{
+	return GetTopOfBook(cp).MidPrice();
+}
+
+BidAskPair<std::optional<Quote>> OrderBook::GetBestQuotes(CurrencyPair cp) const
+{
+	return GetBestQuotes(cp, [](bool, const BOOK::Quote &) { return true; });
+}
+
+void OrderBook::Clear()
+{
+	const int count { m_registry.Count() };
+	for (size_t shardIdx { 0 }; shardIdx < m_shards.size(); ++shardIdx)
+	{
+		m_shards[shardIdx]->Run([this, count, shardIdx]()
+		{
+			for (int id { int(shardIdx) }; id < count; id += int(m_shards.size()))
 			{
-				++it;
+				InstrumentBook &book { *m_books[size_t(id)] };
+				for (bool bid: { true, false })
+				{
+					// set invalid all quotes:
+					PriceLadder &ladder { book.ladders.Get(bid) };
+					ladder.ForEachQuote([](const Quote &q, bool &)
+					{
+						QuotePool::Release(q);
+					});
+					ladder.Clear();
+					const size_t side { bid ? 0u : 1u };
+					book.expiry[side].Clear();
+					PublishSide(book, bid);
+					book.topOfBook.Publish(bid, 0, 0, 0);
+					m_bbo.Publish(id, bid, 0, 0);
+					book.changes[side] = PendingChange();
+					if (m_publishing.load(std::memory_order_relaxed))
+					{
+						book.changes[side].changed = true;
+						book.changes[side].cleared = true;
+						if (!book.pending)
+						{
+							book.pending = true;
+							m_pendingBooks[shardIdx].push_back(id);
+						}
+					}
+				}
 			}
-		}
+			m_lastQuotes[shardIdx].Clear();
+			EndBatch(shardIdx);
+		});
+	}
+}
+
+// DEBUG
+//static
+//void OrderBook::printBook(BookView *view, std::ostream& ostr, const std::string& instr, bool bid, unsigned int levels)
+void OrderBook::printBook(std::ostream &ostr, CurrencyPair cp, bool bid, unsigned int levels) const
+{
+	ostr << ">>>>> getting book " << cp.ToString() << " (" << (bid ? "BID" : "ASK") << ", " << levels << " levels) start"
+		 << std::endl;
+	const BookDepth depth { GetDepth(cp, bid, levels) };
+	for (const LevelView &level: depth.levels)
+	{
+		ostr << level.price << " " << level.totalVolume << " size: " << level.QuoteCount() << " " << std::endl;
 	}
+	ostr << std::endl << ">>>>> getting book done" << std::endl;
 }
 
-Quote::Ptr OrderBook::GetLastQuote() const
+void OrderBook::printBooks(std::ostream &ostr, bool bid, unsigned int levels) const
 {
-	return std::atomic_load(&m_lastQuote);
+	for (int id { 0 }, count { m_registry.Count() }; id < count; ++id)
+	{
+		printBook(ostr, m_registry.Instrument(id), bid, levels);
+	}
+}
+
+
+std::optional<Quote> OrderBook::GetLastQuote() const
+{
+	std::optional<Quote> result;
+	int64_t latest { 0 };
+	for (size_t shardIdx { 0 }; shardIdx < m_shards.size(); ++shardIdx)
+	{
+		Quote quote;
+		const int64_t stamp { m_lastQuotes[shardIdx].Read(quote) };
+		if (stamp > latest)
+		{
+			latest = stamp;
+			result = quote;
+		}
+	}
+	return result;
 }
 
 } // namespace BOOK
@@ -0,0 +1,448 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#include <algorithm>
+#include <numeric>
+
+#include "OrderBook/PriceLadder.h"
+
+namespace CORE {
+namespace BOOK {
+
+PriceLadder::PriceLadder(bool bid, size_t windowSize)
+		: m_bid(bid), m_windowSize(int(std::max<size_t>((windowSize + 63) & ~size_t(63), 64))),
+		  m_slots(size_t(m_windowSize)), m_occupied(size_t(m_windowSize) / 64, 0), m_keyIndex(size_t(m_windowSize)),
+		  m_depth(bid, m_windowSize) { }
+
+/*! \brief Returns the window slot of a price, or -1 if the price is outside the window */
+int PriceLadder::slotIndex(int64_t price) const
+{
+	const int64_t offset { price - m_base };
+	if (offset < 0 || offset % step() != 0)
+	{
+		return -1;
+	}
+	const int64_t idx { offset / step() };
+	return idx < m_windowSize ? int(idx) : -1;
+}
+
+/*! \brief Returns the highest occupied slot below @a idx, or -1 */
+int PriceLadder::findBelow(int idx) const
+{
+	if (idx <= 0)
+	{
+		return -1;
+	}
+	--idx;
+	size_t word { size_t(idx) >> 6 };
+	uint64_t bits { m_occupied[word] & (~uint64_t(0) >> (63 - (idx & 63))) };
+	while (bits == 0)
+	{
+		if (word == 0)
+		{
+			return -1;
+		}
+		bits = m_occupied[--word];
+	}
+	return int(word * 64 + 63 - size_t(__builtin_clzll(bits)));
+}
+
+/*! \brief Returns the lowest occupied slot above @a idx, or -1 */
+int PriceLadder::findAbove(int idx) const
+{
+	if (++idx >= m_windowSize)
+	{
+		return -1;
+	}
+	size_t word { size_t(idx) >> 6 };
+	uint64_t bits { m_occupied[word] & (~uint64_t(0) << (idx & 63)) };
+	while (bits == 0)
+	{
+		if (++word == m_occupied.size())
+		{
+			return -1;
+		}
+		bits = m_occupied[word];
+	}
+	return int(word * 64 + size_t(__builtin_ctzll(bits)));
+}
+
+/*! \brief Returns the number of occupied slots in [from, to) */
+size_t PriceLadder::countOccupied(int from, int to) const
+{
+	size_t count { 0 };
+	for (int idx { from }; idx < to; idx = (idx | 63) + 1)
+	{
+		uint64_t bits { m_occupied[size_t(idx) >> 6] >> (idx & 63) };
+		const int n { std::min(to, (idx | 63) + 1) - idx };
+		if (n < 64)
+		{
+			bits &= (uint64_t(1) << n) - 1;
+		}
+		count += size_t(__builtin_popcountll(bits));
+	}
+	return count;
+}
+
+size_t PriceLadder::LevelIndex(int64_t price) const
+{
+	if (m_bestIdx < 0 || !better(m_slots[m_bestIdx].price, price))
+	{
+		return 0;
+	}
+	// window slots holding better prices: above the price for bids, below it for asks
+	const int64_t offset { price - m_base };
+	size_t count { 0 };
+	if (m_bid)
+	{
+		const int64_t first { offset < 0 ? 0 : offset / step() + 1 };
+		count = first < m_windowSize ? countOccupied(int(first), m_windowSize) : 0;
+	}
+	else
+	{
+		const int64_t end { offset <= 0 ? 0 : (offset + step() - 1) / step() };
+		count = countOccupied(0, int(std::min<int64_t>(end, m_windowSize)));
+	}
+	for (auto it { m_overflow.begin() }; it != m_overflow.end() && it->first < rank(price); ++it)
+	{
+		++count;
+	}
+	return count;
+}
+
+const PriceLadder::Level *PriceLadder::FindLevel(int64_t price) const
+{
+	return const_cast<PriceLadder *>(this)->findLevel(price);
+}
+
+PriceLadder::Level *PriceLadder::findLevel(int64_t price)
+{
+	if (m_bestIdx < 0)
+	{
+		return nullptr;
+	}
+	const int idx { slotIndex(price) };
+	if (idx >= 0)
+	{
+		return (m_occupied[size_t(idx) >> 6] >> (idx & 63)) & 1 ? &m_slots[idx] : nullptr;
+	}
+	const auto it { m_overflow.find(rank(price)) };
+	return it != m_overflow.end() ? &it->second : nullptr;
+}
+
+void PriceLadder::Insert(const Quote &quote)
+{
+	const DepthUpdate update { *this };
+	const size_t levelCount { m_levelCount };
+	Level &level { findOrCreateLevel(quote.Price()) };
+	QuoteVec &quotes { level.quotes };
+	// same price -> greater volume first
+	quotes.insert(std::find_if(quotes.begin(), quotes.end(), [&quote](const Quote &q)
+	{
+		return quote.Volume() >= q.Volume();
+	}), quote);
+	level.totalVolume += quote.Volume();
+	level.minQty = std::max(level.minQty, quote.MinQty());
+	level.venues |= VenueBit(quote.Venue());
+	adjustDepth(quote.Price(), m_levelCount > levelCount ? 1 : 0, quote.Volume());
+	m_keyIndex.Insert(quote.Key(), quote.Price());
+	++m_quoteCount;
+	m_lastInsertPrice = quote.Price();
+}
+
+const Quote *PriceLadder::Find(int64_t key) const
+{
+	const int64_t *indexedPrice { m_keyIndex.Find(key) };
+	if (!indexedPrice)
+	{
+		return nullptr;
+	}
+	const Level *level { FindLevel(*indexedPrice) };
+	const auto it { std::find_if(level->quotes.begin(), level->quotes.end(), [key](const Quote &q) { return q.Key() == key; }) };
+	return it != level->quotes.end() ? &*it : nullptr;
+}
+
+std::optional<Quote> PriceLadder::Remove(int64_t key)
+{
+	const int64_t *indexedPrice { m_keyIndex.Find(key) };
+	if (!indexedPrice)
+	{
+		return std::nullopt;
+	}
+	const DepthUpdate update { *this };
+	const int64_t price { *indexedPrice };
+	m_keyIndex.Erase(key);
+	Level *level { findLevel(price) };
+	// only the quotes of one level are searched
+	const auto it { std::find_if(level->quotes.begin(), level->quotes.end(), [key](const Quote &q) { return q.Key() == key; }) };
+	const Quote result { *it };
+	level->quotes.erase(it);
+	--m_quoteCount;
+	if (level->quotes.empty())
+	{
+		adjustDepth(price, -1, -result.Volume());
+		eraseLevel(price);
+	}
+	else
+	{
+		level->totalVolume -= result.Volume();
+		adjustDepth(price, 0, -result.Volume());
+		// with quotes of other venues left, the venue of the removed quote may be gone
+		if (result.MinQty() == level->minQty || level->venues != VenueBit(result.Venue()))
+		{
+			recalcAggregates(*level);
+		}
+	}
+	return result;
+}
+
+void PriceLadder::Clear()
+{
+	const DepthUpdate update { *this };
+	for (int idx { m_bestIdx }; idx >= 0; idx = nextWorse(idx))
+	{
+		m_slots[idx].quotes.clear();
+		m_slots[idx].totalVolume = 0;
+		m_slots[idx].minQty = 0;
+		m_slots[idx].venues = 0;
+	}
+	std::fill(m_occupied.begin(), m_occupied.end(), 0);
+	m_overflow.clear();
+	m_keyIndex.Clear();
+	m_bestIdx = -1;
+	m_quoteCount = 0;
+	m_levelCount = 0;
+	m_lastInsertPrice.reset();
+	rebuildDepth();
+}
+
+PriceLadder::Level &PriceLadder::findOrCreateLevel(int64_t price)
+{
+	if (m_bestIdx < 0)
+	{
+		// empty ladder: place the window around the new price
+		recenter(price);
+	}
+	else
+	{
+		alignTick(price);
+		if (slotIndex(price) < 0 && better(price, m_slots[m_bestIdx].price))
+		{
+			// new best price outside the window
+			recenter(price);
+		}
+	}
+	const int idx { slotIndex(price) };
+	if (idx < 0)
+	{
+		// far from the touch -> overflow
+		const auto res { m_overflow.try_emplace(rank(price)) };
+		if (res.second)
+		{
+			res.first->second.price = price;
+			++m_levelCount;
+		}
+		return res.first->second;
+	}
+	Level &level { m_slots[idx] };
+	if (!((m_occupied[size_t(idx) >> 6] >> (idx & 63)) & 1))
+	{
+		setBit(idx);
+		level.price = price;
+		level.totalVolume = 0;
+		level.minQty = 0;
+		level.venues = 0;
+		++m_levelCount;
+		m_bestIdx = m_bestIdx < 0 ? idx : m_bid ? std::max(m_bestIdx, idx) : std::min(m_bestIdx, idx);
+	}
+	return level;
+}
+
+/*! \brief Returns the worst level (the ladder must not be empty) */
+PriceLadder::Level &PriceLadder::worstLevel()
+{
+	if (!m_overflow.empty())
+	{
+		return std::prev(m_overflow.end())->second;
+	}
+	return m_slots[m_bid ? findAbove(-1) : findBelow(m_windowSize)];
+}
+
+void PriceLadder::eraseLevel(int64_t price)
+{
+	const int idx { slotIndex(price) };
+	if (idx < 0)
+	{
+		m_levelCount -= m_overflow.erase(rank(price));
+		return;
+	}
+	clearBit(idx);
+	--m_levelCount;
+	if (idx == m_bestIdx)
+	{
+		m_bestIdx = nextWorse(idx);
+		if (m_bestIdx < 0 && !m_overflow.empty())
+		{
+			// window drained -> move it to the best overflow level
+			recenter(m_overflow.begin()->second.price);
+		}
+	}
+}
+
+/*! \brief Reduces the tick if @a price is not a multiple of it away from the prices in the ladder */
+void PriceLadder::alignTick(int64_t price)
+{
+	const int64_t distance { std::abs(price - m_slots[m_bestIdx].price) };
+	if (distance == 0 || (m_tick > 0 && distance % m_tick == 0))
+	{
+		return;
+	}
+	const int64_t best { m_slots[m_bestIdx].price };
+	for (int idx { m_bestIdx }; idx >= 0; idx = nextWorse(idx))
+	{
+		spill(idx);
+	}
+	m_bestIdx = -1;
+	m_tick = std::gcd(m_tick, distance);
+	recenter(best);
+}
+
+/*! \brief Moves the window so that @a price lands on the home slot
+ *
+ * Levels that leave the window are moved to the overflow map; overflow levels
+ * that fall inside the new window are moved into their slots.
+ */
+void PriceLadder::recenter(int64_t price)
+{
+	const int64_t newBase { price - homeIndex() * step() };
+	if (m_bestIdx >= 0)
+	{
+		// slots line up (same tick) -> shift occupied slots in place
+		const int64_t shift { (newBase - m_base) / step() }; // new slot = old slot - shift
+		if (shift > 0) // window moves up -> walk upwards so that targets are free
+		{
+			for (int idx { findAbove(-1) }; idx >= 0; idx = findAbove(idx))
+			{
+				moveSlot(idx, idx - shift);
+			}
+		}
+		else if (shift < 0) // window moves down -> walk downwards
+		{
+			for (int idx { findBelow(m_windowSize) }; idx >= 0; idx = findBelow(idx))
+			{
+				moveSlot(idx, idx - shift);
+			}
+		}
+	}
+	m_base = newBase;
+	pullOverflow();
+	m_bestIdx = m_bid ? findBelow(m_windowSize) : findAbove(-1);
+	rebuildDepth(); // the levels have moved to other slots
+}
+
+/*! \brief Moves the level in slot @a idx to slot @a target, or to the overflow map if @a target is outside the window */
+void PriceLadder::moveSlot(int idx, int64_t target)
+{
+	if (target < 0 || target >= m_windowSize)
+	{
+		spill(idx);
+	}
+	else
+	{
+		clearBit(idx);
+		std::swap(m_slots[target], m_slots[idx]);
+		setBit(int(target));
+	}
+}
+
+/*! \brief Moves the level in slot @a idx to the overflow map */
+void PriceLadder::spill(int idx)
+{
+	clearBit(idx);
+	Level &level { m_slots[idx] };
+	moveLevel(level, m_overflow[rank(level.price)]);
+}
+
+/*! \brief Moves overflow levels that fall inside the window into their slots */
+void PriceLadder::pullOverflow()
+{
+	auto it { m_overflow.begin() };
+	while (it != m_overflow.end())
+	{
+		const int idx { slotIndex(it->second.price) };
+		if (idx < 0)
+		{
+			break; // overflow is sorted best first -> the remaining levels are further away
+		}
+		moveLevel(it->second, m_slots[idx]);
+		setBit(idx);
+		it = m_overflow.erase(it);
+	}
+}
+
+/*! \brief Enters a change of the level at @a price into the depth index (before the level is erased) */
+void PriceLadder::adjustDepth(int64_t price, int levels, int64_t volume)
+{
+	const int idx { slotIndex(price) };
+	if (idx >= 0)
+	{
+		m_depth.Add(idx, price, levels, volume);
+	}
+	else
+	{
+		m_overflowVolume += volume;
+		m_overflowNotional += double(price) * double(volume);
+	}
+}
+
+/*! \brief Enters all levels into the depth index again (after the window has moved) */
+void PriceLadder::rebuildDepth()
+{
+	m_depth.Reset(m_base, step());
+	for (int idx { m_bestIdx }; idx >= 0; idx = nextWorse(idx))
+	{
+		m_depth.Add(idx, m_slots[idx].price, 1, m_slots[idx].totalVolume);
+	}
+	m_overflowVolume = 0;
+	m_overflowNotional = 0.0;
+	for (const auto &[rank, level]: m_overflow)
+	{
+		m_overflowVolume += level.totalVolume;
+		m_overflowNotional += double(level.price) * double(level.totalVolume);
+	}
+}
+
+/*! \brief Passes the totals of the overflow levels to the depth index */
+void PriceLadder::publishOverflow()
+{
+	m_depth.SetOverflow(int64_t(m_overflow.size()), m_overflowVolume, m_overflowNotional,
+						m_overflow.empty() ? 0 : m_overflow.begin()->second.price);
+}
+
+/*! \brief Recalculates the aggregates of a level from its quotes */
+void PriceLadder::recalcAggregates(Level &level)
+{
+	level.totalVolume = 0;
+	level.minQty = 0;
+	level.venues = 0;
+	for (const auto &q: level.quotes)
+	{
+		level.totalVolume += q.Volume();
+		level.minQty = std::max(level.minQty, q.MinQty());
+		level.venues |= VenueBit(q.Venue());
+	}
+}
+
+/*! \brief Moves the quotes and aggregates of a level to another (empty) level */
+void PriceLadder::moveLevel(Level &from, Level &to)
+{
+	to.price = from.price;
+	to.totalVolume = from.totalVolume;
+	to.minQty = from.minQty;
+	to.venues = from.venues;
+	to.quotes.swap(from.quotes);
+}
+
+} // namespace BOOK
+} // namespace CORE
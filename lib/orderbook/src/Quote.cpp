@@ -4,6 +4,10 @@
 
 #include <Poco/Format.h>
 
+#include <deque>
+#include <shared_mutex>
+#include <unordered_map>
+
 #include "OrderBook/Quote.h"
 #include "Utils/FixDefs.h"
 
@@ -12,48 +16,278 @@ using namespace UTILS;
 namespace CORE {
 namespace BOOK {
 
-ObjectPool<Quote, QuotePool::POOL_SIZE> QuotePool::op;
+std::array<std::atomic<QuotePool::Slot *>, QuotePool::MAX_CHUNKS> QuotePool::s_chunks { };
+std::atomic<uint32_t> QuotePool::s_slotCount { 0 };
+std::atomic<uint64_t> QuotePool::s_freeHead { 0 };
+std::atomic<size_t> QuotePool::s_inUse { 0 };
+std::mutex QuotePool::s_growMtx;
+
+namespace {
+
+/*! \brief Interned strings (id 0 -> empty string) */
+struct StringTable
+{
+	std::shared_mutex mtx;
+	std::deque<std::string> strings { "" }; //!< deque: references stay valid when strings are added
+	std::unordered_map<std::string, uint32_t> ids;
+};
+
+StringTable &stringTable()
+{
+	static StringTable table;
+	return table;
+}
+
+const std::string EMPTY_STRING;
+
+}
+
+uint32_t QuotePool::Intern(const std::string &str)
+{
+	if (str.empty())
+	{
+		return 0;
+	}
+	StringTable &table { stringTable() };
+	{
+		std::shared_lock lock { table.mtx };
+		const auto it { table.ids.find(str) };
+		if (it != table.ids.end())
+		{
+			return it->second;
+		}
+	}
+	std::unique_lock lock { table.mtx };
+	const auto it { table.ids.find(str) };
+	if (it != table.ids.end())
+	{
+		return it->second;
+	}
+	const auto id { uint32_t(table.strings.size()) };
+	table.strings.push_back(str);
+	table.ids.emplace(str, id);
+	return id;
+}
+
+const std::string &QuotePool::String(uint32_t id)
+{
+	if (id == 0)
+	{
+		return EMPTY_STRING;
+	}
+	StringTable &table { stringTable() };
+	std::shared_lock lock { table.mtx };
+	return id < table.strings.size() ? table.strings[id] : EMPTY_STRING;
+}
+
+QuotePool::Slot *QuotePool::GetSlot(uint32_t handleSlot)
+{
+	if (handleSlot == 0)
+	{
+		return nullptr;
+	}
+	const uint32_t idx { handleSlot - 1 };
+	Slot *chunk { s_chunks[idx / CHUNK_SIZE].load(std::memory_order_acquire) };
+	return chunk ? &chunk[idx % CHUNK_SIZE] : nullptr;
+}
+
+/*! \brief Takes a slot from the free list, or a new one from the chunks (returns slot index + 1) */
+uint32_t QuotePool::AllocateSlot()
+{
+	uint64_t head { s_freeHead.load(std::memory_order_acquire) };
+	while (uint32_t(head) != 0)
+	{
+		const uint32_t next { GetSlot(uint32_t(head))->next.load(std::memory_order_relaxed) };
+		const uint64_t newHead { ((head >> 32) + 1) << 32 | next }; // the tag prevents ABA
+		if (s_freeHead.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire))
+		{
+			return uint32_t(head);
+		}
+	}
+	const uint32_t idx { s_slotCount.fetch_add(1, std::memory_order_relaxed) };
+	if (idx >= CHUNK_SIZE * MAX_CHUNKS)
+	{
+		throw Poco::Exception("Quote pool exhausted");
+	}
+	std::atomic<Slot *> &chunk { s_chunks[idx / CHUNK_SIZE] };
+	if (!chunk.load(std::memory_order_acquire))
+	{
+		std::lock_guard lock { s_growMtx };
+		if (!chunk.load(std::memory_order_relaxed))
+		{
+			chunk.store(new Slot[CHUNK_SIZE], std::memory_order_release); // never freed
+		}
+	}
+	return idx + 1;
+}
+
+Quote QuotePool::Create(int64_t adptReceiveTime, int64_t receiptTime, int64_t sortTime, const std::string &quoteID,
+						int64_t seqnum, int64_t price, int64_t volume, int64_t minQty, int64_t key, int64_t refKey,
+						int64_t sendingTime, int quoteType, int positionNo, const std::string &settlDate,
+						const std::string &originator, int venue)
+{
+	const uint32_t handleSlot { AllocateSlot() };
+	Slot &slot { *GetSlot(handleSlot) };
+	const auto generation { uint32_t(slot.state.load(std::memory_order_relaxed) >> 2) };
+	// readers of a previous generation validate the state after reading the fields
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.adptReceiveTime.store(adptReceiveTime, std::memory_order_relaxed);
+	slot.receiptTime.store(receiptTime, std::memory_order_relaxed);
+	slot.sortTime.store(sortTime, std::memory_order_relaxed);
+	slot.seqnum.store(seqnum, std::memory_order_relaxed);
+	slot.quoteID.store(Intern(quoteID), std::memory_order_relaxed);
+	slot.settlDate.store(Intern(settlDate), std::memory_order_relaxed);
+	slot.originator.store(Intern(originator), std::memory_order_relaxed);
+	slot.successorSent.store(0, std::memory_order_relaxed);
+	slot.successorReceived.store(0, std::memory_order_relaxed);
+	slot.state.store(uint64_t(generation) << 2 | STATE_LIVE, std::memory_order_release);
+	s_inUse.fetch_add(1, std::memory_order_relaxed);
+	return Quote(QuoteHandle { handleSlot, generation }, price, volume, minQty, key, refKey, sendingTime, quoteType, positionNo,
+				 venue);
+}
+
+bool QuotePool::Release(const Quote &quote, const Quote *successor)
+{
+	const QuoteHandle handle { quote.Handle() };
+	Slot *slot { GetSlot(handle.slot) };
+	if (!slot)
+	{
+		return false;
+	}
+	const uint64_t live { uint64_t(handle.generation) << 2 | STATE_LIVE };
+	uint64_t state { slot->state.load(std::memory_order_acquire) };
+	if ((state & ~STATE_USED) != live)
+	{
+		return false;
+	}
+	const int64_t tsSent { successor ? successor->SendingTime() : CurrentTimestamp() };
+	const int64_t tsReceived { successor ? successor->ReceiptTime() : CurrentTimestamp() };
+	slot->successorSent.store(tsSent, std::memory_order_relaxed);
+	slot->successorReceived.store(tsReceived, std::memory_order_relaxed);
+	// next generation, not live (a concurrent SetUsed() may still flip the used bit)
+	while (!slot->state.compare_exchange_weak(state, uint64_t(handle.generation + 1) << 2, std::memory_order_release,
+											  std::memory_order_acquire))
+	{
+		if ((state & ~STATE_USED) != live)
+		{
+			return false;
+		}
+	}
+	s_inUse.fetch_sub(1, std::memory_order_relaxed);
+	uint64_t head { s_freeHead.load(std::memory_order_relaxed) };
+	do
+	{
+		slot->next.store(uint32_t(head), std::memory_order_relaxed);
+	} while (!s_freeHead.compare_exchange_weak(head, ((head >> 32) + 1) << 32 | handle.slot, std::memory_order_release,
+											   std::memory_order_relaxed));
+	return true;
+}
+
+/*! \brief Copies the details of a live quote (seqlock-style: the state is checked before and after copying) */
+bool QuotePool::ReadDetails(QuoteHandle handle, QuoteDetails &details)
+{
+	const Slot *slot { GetSlot(handle.slot) };
+	if (!slot)
+	{
+		return false;
+	}
+	const uint64_t live { uint64_t(handle.generation) << 2 | STATE_LIVE };
+	if ((slot->state.load(std::memory_order_acquire) & ~STATE_USED) != live)
+	{
+		return false;
+	}
+	details.adptReceiveTime = slot->adptReceiveTime.load(std::memory_order_relaxed);
+	details.receiptTime = slot->receiptTime.load(std::memory_order_relaxed);
+	details.sortTime = slot->sortTime.load(std::memory_order_relaxed);
+	details.seqnum = slot->seqnum.load(std::memory_order_relaxed);
+	details.quoteID = slot->quoteID.load(std::memory_order_relaxed);
+	details.settlDate = slot->settlDate.load(std::memory_order_relaxed);
+	details.originator = slot->originator.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if ((slot->state.load(std::memory_order_relaxed) & ~STATE_USED) != live)
+	{
+		details = QuoteDetails();
+		return false;
+	}
+	return true;
+}
+
+QuoteDetails Quote::Details() const
+{
+	QuoteDetails details;
+	QuotePool::ReadDetails(m_handle, details);
+	return details;
+}
+
+const std::string &Quote::QuoteID() const
+{
+	return QuotePool::String(Details().quoteID);
+}
+
+const std::string &Quote::SettlDate() const
+{
+	return QuotePool::String(Details().settlDate);
+}
+
+const std::string &Quote::Originator() const
+{
+	return QuotePool::String(Details().originator);
+}
+
+bool Quote::Used() const
+{
+	const QuotePool::Slot *slot { QuotePool::GetSlot(m_handle.slot) };
+	return slot && slot->state.load(std::memory_order_acquire) ==
+				   (uint64_t(m_handle.generation) << 2 | QuotePool::STATE_LIVE | QuotePool::STATE_USED);
+}
 
 /*! \brief Set the \a used flag of this quote to \a true
  *
  * @return \a true if successful, \a false if \a used flag was already set
+ * or the quote is no longer valid
  * */
-bool Quote::SetUsed()
+bool Quote::SetUsed() const
 {
-	bool result { false };
-	if (!Used())
-	{
-		bool oldValue { false };
-		result = m_used.compare_exchange_strong(oldValue, true);
-	}
-	return result;
+	QuotePool::Slot *slot { QuotePool::GetSlot(m_handle.slot) };
+	uint64_t expected { uint64_t(m_handle.generation) << 2 | QuotePool::STATE_LIVE };
+	return slot && slot->state.compare_exchange_strong(expected, expected | QuotePool::STATE_USED, std::memory_order_acq_rel);
 }
 
-bool Quote::Valid(int64_t &successorSent, int64_t &successorReceived) const
+bool Quote::Valid() const
 {
-	successorSent = m_successor.sent;
-	successorReceived = m_successor.received;
-	return Valid();
+	const QuotePool::Slot *slot { QuotePool::GetSlot(m_handle.slot) };
+	return slot && (slot->state.load(std::memory_order_acquire) & ~QuotePool::STATE_USED) ==
+				   (uint64_t(m_handle.generation) << 2 | QuotePool::STATE_LIVE);
 }
 
-bool Quote::SetInvalid(Quote::Ptr successor)
+/*! \brief Validity of this quote, with the times of its successor if it has been released
+ *
+ * The successor times are only available until the slot of the quote is reused.
+ * */
+bool Quote::Valid(int64_t &successorSent, int64_t &successorReceived) const
 {
-	bool result { false };
-	if (Valid() && successor.get() != this)
+	successorSent = 0;
+	successorReceived = 0;
+	const QuotePool::Slot *slot { QuotePool::GetSlot(m_handle.slot) };
+	if (!slot)
+	{
+		return false;
+	}
+	const uint64_t released { uint64_t(m_handle.generation + 1) << 2 };
+	const uint64_t state { slot->state.load(std::memory_order_acquire) & ~QuotePool::STATE_USED };
+	if (state == released)
 	{
-		const int64_t tsSent { successor ? successor->SendingTime() : CurrentTimestamp() };
-		const int64_t tsReceived { successor ? successor->ReceiptTime() : CurrentTimestamp() };
-		if (tsSent != 0 && tsReceived != 0)
+		const int64_t sent { slot->successorSent.load(std::memory_order_relaxed) };
+		const int64_t received { slot->successorReceived.load(std::memory_order_relaxed) };
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if ((slot->state.load(std::memory_order_relaxed) & ~QuotePool::STATE_USED) == released)
 		{
-			int64_t oldValue { 0 };
-			result = m_successor.sent.compare_exchange_strong(oldValue, tsSent);
-			if (result)
-			{
-				m_successor.received = tsReceived;
-			}
+			successorSent = sent;
+			successorReceived = received;
 		}
+		return false;
 	}
-	return result;
+	return state == (uint64_t(m_handle.generation) << 2 | QuotePool::STATE_LIVE);
 }
 
 /*! \brief Field value as 64bit-integer.
@@ -259,12 +493,16 @@ QuoteGroup::QuoteGroup() : m_aggregateValues { nullptr, nullptr }
 }
 
 QuoteGroup::QuoteGroup(const QuoteVector &srcVec)
+		: QuoteGroup(srcVec.data(), srcVec.data() + srcVec.size())
+{
+}
+
+/*! \brief Creates a quote group holding a range of quotes (e.g. a snapshot level)
+ * */
+QuoteGroup::QuoteGroup(const Quote *first, const Quote *last)
 		: QuoteGroup()
 {
-	for (const auto &q : srcVec)
-	{
-		m_quotes->emplace_back(q);
-	}
+	m_quotes->assign(first, last);
 }
 
 /*! \brief Adds a quote to the quote group
@@ -274,7 +512,7 @@ QuoteGroup::QuoteGroup(const QuoteVector &srcVec)
  *
  * @param q     Quote to be added to the quote group
  * */
-void QuoteGroup::AddQuote(const Quote::Ptr &q)
+void QuoteGroup::AddQuote(const Quote &q)
 {
 	{
 		std::unique_lock lock { m_quotes.Mutex() };
@@ -290,7 +528,7 @@ void QuoteGroup::AddQuote(const Quote::Ptr &q)
  *
  * @param q     Quote to be removed from the quote group
  * */
-bool QuoteGroup::RemoveQuote(const CORE::BOOK::Quote::Ptr &q)
+bool QuoteGroup::RemoveQuote(const CORE::BOOK::Quote &q)
 {
 	{
 		std::unique_lock lock { m_quotes };
@@ -315,16 +553,16 @@ QuoteGroup::AggregateValues::Ptr QuoteGroup::CalculateAggregateValues(const Quot
 	std::shared_ptr<AggregateValues> av { std::make_shared<AggregateValues>() };
 	for (const auto &q : quoteVector)
 	{
-		if (!(unusedOnly && q->Used()))
+		if (!(unusedOnly && q.Used()))
 		{
-			if (av->totalVolume == 0 || av->minPrice > q->Price())
+			if (av->totalVolume == 0 || av->minPrice > q.Price())
 			{
-				av->minPrice = q->Price();
+				av->minPrice = q.Price();
 			}
-			av->maxPrice = std::max(av->maxPrice, q->Price());
-			av->maxVolume = std::max(av->maxVolume, q->Volume());
-			av->totalVolume += q->Volume();
-			av->minQty = std::max(av->minQty, q->MinQty());
+			av->maxPrice = std::max(av->maxPrice, q.Price());
+			av->maxVolume = std::max(av->maxVolume, q.Volume());
+			av->totalVolume += q.Volume();
+			av->minQty = std::max(av->minQty, q.MinQty());
 		}
 	}
 	if (av->totalVolume == 0 || av->minPrice == av->maxPrice) // trivial standard case: avgPrice = minPrice = maxPrice
@@ -336,9 +574,9 @@ QuoteGroup::AggregateValues::Ptr QuoteGroup::CalculateAggregateValues(const Quot
 		int64_t sum { 0 };
 		for (const auto &q : quoteVector)
 		{
-			if (!(unusedOnly && q->Used()))
+			if (!(unusedOnly && q.Used()))
 			{
-				sum += q->Price() * q->Volume();
+				sum += q.Price() * q.Volume();
 			}
 		}
 		av->avgPrice = sum / av->totalVolume;
@@ -357,7 +595,7 @@ void QuoteGroup::AddQuotes(const QuoteGroup::Ptr &quoteGroup)
 {
 	{
 		std::unique_lock lock { m_quotes.Mutex() };
-		quoteGroup->ForEachQuote([this](const Quote::Ptr &q)
+		quoteGroup->ForEachQuote([this](const Quote &q)
 								 {
 									 m_quotes->emplace_back(q);
 								 });
@@ -411,13 +649,13 @@ int64_t QuoteGroup::PartialAvgPrice(int64_t volume, int64_t *numOfQuotes) const
 			for (const auto &q : *m_quotes)
 			{
 				// consider only unused quotes that have a minQty lower that the required volume
-				if (!q->Used() && volume >= q->MinQty())
+				if (!q.Used() && volume >= q.MinQty())
 				{
-					int64_t currentVolume { std::min(q->Volume(), volume) };
+					int64_t currentVolume { std::min(q.Volume(), volume) };
 					if (currentVolume > 0)
 					{
 						aggregateVolume += currentVolume;
-						result += (q->Price() - result) * currentVolume / aggregateVolume;
+						result += (q.Price() - result) * currentVolume / aggregateVolume;
 						++quoteCount;
 						volume -= currentVolume; // decrement required volume by current quote volume
 						if (volume <= 0)
@@ -0,0 +1,255 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <tuple>
+
+#include "OrderBook/BookFile.h"
+#include "OrderBook/OrderBook.h"
+#include "Utils/FixDefs.h"
+
+namespace TEST {
+using namespace CORE::BOOK;
+using namespace UTILS;
+
+namespace {
+/*! \brief Saved fields of a quote, the venue by name */
+using SavedQuote = std::tuple<int64_t, int64_t, int64_t, int64_t, int64_t, std::string>;
+
+const std::vector<CurrencyPair> &Instruments()
+{
+	static const std::vector<CurrencyPair> instruments { CurrencyPair("BTC/USDT"), CurrencyPair("ETH/USDT") };
+	return instruments;
+}
+
+std::string TempPath(const std::string &name)
+{
+	return ::testing::TempDir() + "BookFileTests_" + name;
+}
+
+void AddQuote(OrderBook &book, CurrencyPair cp, bool bid, int64_t key, double price, double volume, int venue, int64_t positionNo = 0)
+{
+	NormalizedMDData::Entry entry;
+	entry.updateType = QT_NEW;
+	entry.entryType = bid ? QuoteType::BID : QuoteType::OFFER;
+	entry.price = price;
+	entry.volume = volume;
+	entry.minQty = volume / 2;
+	entry.positionNo = positionNo;
+	book.AddEntry(key, 0, 1000 + key, 0, cp, entry, venue);
+}
+
+/*! \brief Lists the quotes of one side in book order */
+std::vector<SavedQuote> Dump(const OrderBook &book, CurrencyPair cp, bool bid)
+{
+	std::vector<SavedQuote> quotes;
+	book.IterateQuotes(cp, bid, [&book, &quotes](const Quote &q, bool &)
+	{
+		quotes.emplace_back(q.Price(), q.Volume(), q.MinQty(), q.Key(), q.PositionNo(), book.VenueName(q.Venue()));
+	});
+	return quotes;
+}
+
+/*! \brief Fills a book with quotes of two venues, several of them per level */
+void FillBook(OrderBook &book)
+{
+	const int first { book.RegisterVenue("BINANCE") };
+	const int second { book.RegisterVenue("COINBASE") };
+	int64_t key { 1 };
+	for (const CurrencyPair &cp: Instruments())
+	{
+		for (int i { 0 }; i < 30; ++i)
+		{
+			const int venue { i % 3 == 0 ? second : first };
+			AddQuote(book, cp, true, key++, 100.0 - (i % 10) * 0.5, 1.0 + i, venue, i); // 3 quotes per level
+			AddQuote(book, cp, false, key++, 101.0 + (i % 10) * 0.5, 2.0 + i, venue, i);
+		}
+	}
+	book.SetUpdateId(Instruments()[0], 4711);
+	book.SetUpdateId(Instruments()[1], 815);
+	book.Sync();
+}
+
+std::string ReadFile(const std::string &path)
+{
+	std::ifstream in(path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const std::string &path, const std::string &data)
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(data.data(), std::streamsize(data.size()));
+}
+
+template <typename T>
+void Patch(std::string &data, size_t offset, T value)
+{
+	ASSERT_LE(offset + sizeof(value), data.size());
+	std::memcpy(&data[offset], &value, sizeof(value));
+}
+} // anon ns
+
+//--------------------------------------------------------------------------
+TEST(BookFile, Test_SaveLoad_RoundTrip)
+{
+	// Arrange
+	const std::string path { TempPath("roundtrip.bin") };
+	OrderBook saved { 2 };
+	FillBook(saved);
+	OrderBook loaded { 3 };
+	loaded.RegisterVenue("OKX"); // the venues get other ids than in the saved book
+	loaded.RegisterVenue("COINBASE");
+
+	// Act
+	const BoolResult save { saved.SaveSnapshot(path) };
+	const Result<size_t> load { loaded.LoadSnapshot(path) };
+
+	// Check
+	ASSERT_TRUE(save) << save.ErrorMessage();
+	ASSERT_TRUE(load) << load.ErrorMessage();
+	ASSERT_EQ(Instruments().size(), load.Value());
+	for (const CurrencyPair &cp: Instruments())
+	{
+		for (bool bid: { true, false })
+		{
+			// same quotes in the same order, also within a level (a level lists the quote added last first)
+			const std::vector<SavedQuote> before { Dump(saved, cp, bid) };
+			ASSERT_FALSE(before.empty());
+			ASSERT_EQ(before, Dump(loaded, cp, bid));
+			ASSERT_EQ(saved.GetQuoteCount(cp, bid), loaded.GetQuoteCount(cp, bid));
+		}
+		ASSERT_EQ(saved.GetBestPrices(cp).Bid(), loaded.GetBestPrices(cp).Bid());
+		ASSERT_EQ(saved.GetBestPrices(cp).Ask(), loaded.GetBestPrices(cp).Ask());
+		ASSERT_EQ(saved.GetUpdateId(cp), loaded.GetUpdateId(cp));
+	}
+	ASSERT_EQ("BINANCE", loaded.VenueName(3)); // registered by the load, after the venues of the book
+	std::remove(path.c_str());
+}
+
+//--------------------------------------------------------------------------
+TEST(BookFile, Test_Load_LevelOrder)
+{
+	// Arrange
+	const std::string path { TempPath("order.bin") };
+	OrderBook saved { 1 };
+	const CurrencyPair cp { Instruments()[0] };
+	const int venue { saved.RegisterVenue("BINANCE") };
+	AddQuote(saved, cp, true, 10, 100.0, 1, venue);
+	AddQuote(saved, cp, true, 11, 100.0, 2, venue);
+	AddQuote(saved, cp, true, 12, 100.0, 3, venue);
+	saved.Sync();
+	OrderBook loaded { 1 };
+
+	// Act
+	ASSERT_TRUE(saved.SaveSnapshot(path));
+	ASSERT_TRUE(loaded.LoadSnapshot(path));
+
+	// Check
+	std::vector<int64_t> keys;
+	loaded.IterateQuotes(cp, true, [&keys](const Quote &q, bool &) { keys.push_back(q.Key()); });
+	ASSERT_EQ(std::vector<int64_t>({ 12, 11, 10 }), keys);
+	std::remove(path.c_str());
+}
+
+//--------------------------------------------------------------------------
+TEST(BookFile, Test_Load_NotASnapshot)
+{
+	// Arrange
+	const std::string path { TempPath("magic.bin") };
+	OrderBook saved { 1 };
+	FillBook(saved);
+	ASSERT_TRUE(saved.SaveSnapshot(path));
+	std::string data { ReadFile(path) };
+	OrderBook loaded { 1 };
+
+	// Act
+	data[0] = 'X';
+	WriteFile(path, data);
+	const Result<size_t> badMagic { loaded.LoadSnapshot(path) };
+	data[0] = BOOKFILE::MAGIC[0];
+	Patch(data, offsetof(BOOKFILE::FileHeader, version), BOOKFILE::VERSION + 1);
+	WriteFile(path, data);
+	const Result<size_t> badVersion { loaded.LoadSnapshot(path) };
+	WriteFile(path, "SGB");
+	const Result<size_t> tooShort { loaded.LoadSnapshot(path) };
+	const Result<size_t> missing { loaded.LoadSnapshot(TempPath("missing.bin")) };
+
+	// Check
+	ASSERT_FALSE(badMagic);
+	ASSERT_NE(std::string::npos, badMagic.ErrorMessage().find("is not an order book snapshot"));
+	ASSERT_FALSE(badVersion);
+	ASSERT_FALSE(tooShort);
+	ASSERT_FALSE(missing);
+	ASSERT_EQ(0, loaded.GetQuoteCount(Instruments()[0], true));
+	std::remove(path.c_str());
+}
+
+//--------------------------------------------------------------------------
+TEST(BookFile, Test_Load_Truncated)
+{
+	// Arrange
+	const std::string path { TempPath("truncated.bin") };
+	OrderBook saved { 1 };
+	FillBook(saved);
+	ASSERT_TRUE(saved.SaveSnapshot(path));
+	const std::string data { ReadFile(path) };
+	const size_t venuesEnd { sizeof(BOOKFILE::FileHeader) + 3 * sizeof(BOOKFILE::VenueRecord) };
+	// within the header, the venues, the first instrument record, its quotes and the last quote
+	const std::vector<size_t> sizes { sizeof(BOOKFILE::FileHeader) - 1, venuesEnd - 1, venuesEnd + sizeof(BOOKFILE::InstrumentRecord) / 2,
+									  venuesEnd + sizeof(BOOKFILE::InstrumentRecord) + 5 * sizeof(BOOKFILE::QuoteRecord), data.size() - 1 };
+
+	for (size_t size: sizes)
+	{
+		// Act
+		WriteFile(path, data.substr(0, size));
+		OrderBook loaded { 1 };
+		const Result<size_t> load { loaded.LoadSnapshot(path) };
+
+		// Check
+		ASSERT_FALSE(load) << size;
+		ASSERT_NE(std::string::npos, load.ErrorMessage().find("truncated")) << size << ": " << load.ErrorMessage();
+	}
+	std::remove(path.c_str());
+}
+
+//--------------------------------------------------------------------------
+TEST(BookFile, Test_Load_CorruptCounts)
+{
+	// Arrange
+	const std::string path { TempPath("corrupt.bin") };
+	OrderBook saved { 1 };
+	FillBook(saved);
+	ASSERT_TRUE(saved.SaveSnapshot(path));
+	const std::string data { ReadFile(path) };
+	const size_t firstInstrument { sizeof(BOOKFILE::FileHeader) + 3 * sizeof(BOOKFILE::VenueRecord) };
+	const size_t quoteCounts { firstInstrument + offsetof(BOOKFILE::InstrumentRecord, quoteCount) };
+	// counts pointing beyond the end of the file must fail on the check, not read past the mapping
+	const std::vector<std::pair<size_t, uint32_t>> patches {
+			{ offsetof(BOOKFILE::FileHeader, venueCount), 0xFFFF'FFFFu },
+			{ offsetof(BOOKFILE::FileHeader, venueCount), 1'000 },
+			{ offsetof(BOOKFILE::FileHeader, instrumentCount), 0xFFFF'FFFFu },
+			{ quoteCounts, 0xFFFF'FFFFu },
+			{ quoteCounts + sizeof(uint32_t), 0x8000'0000u },
+			{ quoteCounts, 1'000 } };
+
+	for (const auto &[offset, value]: patches)
+	{
+		// Act
+		std::string corrupt { data };
+		Patch(corrupt, offset, value);
+		WriteFile(path, corrupt);
+		OrderBook loaded { 1 };
+		const Result<size_t> load { loaded.LoadSnapshot(path) };
+
+		// Check
+		ASSERT_FALSE(load) << offset << " " << value;
+		ASSERT_NE(std::string::npos, load.ErrorMessage().find("truncated")) << load.ErrorMessage();
+	}
+	std::remove(path.c_str());
+}
+
+} // namespace TEST
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "OrderBook/BookSnapshot.h"
+
+namespace TEST {
+using namespace CORE::BOOK;
+
+//--------------------------------------------------------------------------
+TEST(SnapshotSlot, Test_Store_WhileReading)
+{
+	// Arrange
+	constexpr uint64_t STORES { 20'000 };
+	const PriceLadder ladder { true };
+	SnapshotSlot slot;
+	slot.Store(std::make_shared<const BookSnapshot>(0, ladder));
+	std::atomic_bool done { false };
+	std::atomic<size_t> errors { 0 };
+	std::vector<std::thread> readers;
+	for (int i { 0 }; i < 4; ++i)
+	{
+		readers.emplace_back([&slot, &done, &errors]()
+		{
+			uint64_t last { 0 };
+			BookSnapshot::Ptr held;
+			while (!done.load())
+			{
+				const BookSnapshot::Ptr snapshot { slot.Load() };
+				errors += !snapshot || snapshot->Version() < last ? 1 : 0;
+				last = snapshot ? snapshot->Version() : last;
+				if (last % 1024 == 0)
+				{
+					held = snapshot; // kept beyond later stores
+				}
+			}
+		});
+	}
+
+	// Act - the writer does not wait for the readers
+	std::weak_ptr<const BookSnapshot> early;
+	for (uint64_t version { 1 }; version <= STORES; ++version)
+	{
+		BookSnapshot::Ptr snapshot { std::make_shared<const BookSnapshot>(version, ladder) };
+		if (version == 1)
+		{
+			early = snapshot;
+		}
+		slot.Store(std::move(snapshot));
+	}
+	done.store(true);
+	for (std::thread &reader: readers)
+	{
+		reader.join();
+	}
+	// without readers, two more stores free all pointers swapped out before
+	slot.Store(std::make_shared<const BookSnapshot>(STORES + 1, ladder));
+	slot.Store(std::make_shared<const BookSnapshot>(STORES + 2, ladder));
+
+	// Check
+	ASSERT_EQ(0, errors.load());
+	ASSERT_TRUE(early.expired());
+	ASSERT_EQ(STORES + 2, slot.Load()->Version());
+}
+
+//--------------------------------------------------------------------------
+TEST(SnapshotSlot, Test_Empty)
+{
+	// Arrange
+	SnapshotSlot slot;
+
+	// Act
+	const BookSnapshot::Ptr before { slot.Load() };
+	slot.Store(std::make_shared<const BookSnapshot>(7, PriceLadder(false)));
+	const BookSnapshot::Ptr stored { slot.Load() };
+	slot.Store(nullptr);
+
+	// Check
+	ASSERT_FALSE(before);
+	ASSERT_EQ(7, stored->Version());
+	ASSERT_FALSE(stored->Bid());
+	ASSERT_FALSE(slot.Load());
+}
+
+} // namespace TEST
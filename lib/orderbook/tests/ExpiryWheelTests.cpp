@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+
+#include "OrderBook/ExpiryWheel.h"
+
+namespace TEST {
+using namespace CORE::BOOK;
+
+namespace {
+constexpr int64_t TURN_1 { 256 }; //!< ticks of one turn of the innermost wheel
+constexpr int64_t TURN_2 { 65'536 }; //!< ticks of one turn of the second wheel
+constexpr int64_t RANGE { int64_t(1) << 32 }; //!< ticks covered by all wheels
+
+/*! \brief Advances the wheel and returns the keys handed out */
+std::vector<int64_t> Advance(ExpiryWheel &wheel, int64_t now)
+{
+	std::vector<int64_t> keys;
+	const size_t count { wheel.Advance(now, [&keys](const ExpiryWheel::Entry &entry) { keys.push_back(entry.key); }) };
+	EXPECT_EQ(keys.size(), count);
+	std::sort(keys.begin(), keys.end());
+	return keys;
+}
+
+/*! \brief Checks that an entry is handed out at its expiry tick, not one tick earlier */
+void ExpectExpiresAt(ExpiryWheel &wheel, int64_t key, int64_t expiry)
+{
+	ASSERT_TRUE(Advance(wheel, expiry - 1).empty()) << expiry;
+	ASSERT_EQ(std::vector<int64_t>({ key }), Advance(wheel, expiry)) << expiry;
+}
+} // anon ns
+
+//--------------------------------------------------------------------------
+TEST(ExpiryWheel, Test_Advance_TurnBoundaries)
+{
+	// expiries just before, at and after a turn of the first and the second wheel, seen from a tick not on a boundary
+	for (int64_t start: { int64_t(0), int64_t(1), TURN_1 - 1, TURN_1, TURN_2 - 1, int64_t(1'000'003) })
+	{
+		for (int64_t delta: { TURN_1 - 1, TURN_1, TURN_1 + 1, TURN_2 - 1, TURN_2, TURN_2 + 1, 2 * TURN_2 })
+		{
+			// Arrange
+			ExpiryWheel wheel { start, 1 };
+			wheel.Add(1, start + delta, 0);
+
+			// Act / Check
+			ExpectExpiresAt(wheel, 1, start + delta);
+			ASSERT_EQ(0, wheel.Size());
+		}
+	}
+}
+
+//--------------------------------------------------------------------------
+TEST(ExpiryWheel, Test_Advance_AbsoluteBoundaries)
+{
+	// Arrange - expiries on the ticks at which the outer wheels are cascaded
+	ExpiryWheel wheel { 0, 1 };
+	const std::vector<int64_t> expiries { TURN_1 - 1, TURN_1, TURN_1 + 1, 2 * TURN_1, TURN_2 - 1, TURN_2, TURN_2 + 1, TURN_2 + TURN_1,
+										  3 * TURN_2, int64_t(1) << 24 };
+	for (size_t i { 0 }; i < expiries.size(); ++i)
+	{
+		wheel.Add(int64_t(i), expiries[i], 0);
+	}
+
+	// Act / Check - in steps, so every entry goes through the cascades
+	for (size_t i { 0 }; i < expiries.size(); ++i)
+	{
+		ExpectExpiresAt(wheel, int64_t(i), expiries[i]);
+		ASSERT_EQ(expiries.size() - i - 1, wheel.Size());
+	}
+}
+
+//--------------------------------------------------------------------------
+TEST(ExpiryWheel, Test_Add_BeyondRange)
+{
+	// Arrange
+	ExpiryWheel wheel { 0, 1 };
+	wheel.Add(1, RANGE - 1, 0); // last tick of the outermost wheel
+	wheel.Add(2, RANGE + 1'000, 0);
+	wheel.Add(3, 3 * RANGE + 7, 0);
+	wheel.Add(4, 100, 0);
+
+	// Act / Check - the entries beyond the range are kept until their tick
+	ASSERT_EQ(std::vector<int64_t>({ 4 }), Advance(wheel, 100));
+	ASSERT_EQ(std::vector<int64_t>({ 1 }), Advance(wheel, RANGE + 999));
+	ASSERT_EQ(std::vector<int64_t>({ 2 }), Advance(wheel, RANGE + 1'000));
+	ASSERT_TRUE(Advance(wheel, 3 * RANGE + 6).empty());
+	ASSERT_EQ(1, wheel.Size());
+	ASSERT_EQ(std::vector<int64_t>({ 3 }), Advance(wheel, 3 * RANGE + 7));
+	ASSERT_EQ(0, wheel.Size());
+}
+
+//--------------------------------------------------------------------------
+TEST(ExpiryWheel, Test_Advance_MoreThanOneTurn)
+{
+	// Arrange
+	ExpiryWheel wheel { 5, 1 };
+	wheel.Add(1, 10, 0);
+	wheel.Add(2, TURN_2 + 3, 0);
+	wheel.Add(3, RANGE + 10, 0);
+	wheel.Add(4, RANGE + 11, 0);
+	wheel.Add(5, 2 * RANGE + TURN_1, 0);
+
+	// Act - a jump beyond the range of the wheels
+	const std::vector<int64_t> jumped { Advance(wheel, RANGE + 10) };
+
+	// Check - the remaining entries are re-placed relative to the new tick
+	ASSERT_EQ(std::vector<int64_t>({ 1, 2, 3 }), jumped);
+	ASSERT_EQ(2, wheel.Size());
+	ExpectExpiresAt(wheel, 4, RANGE + 11);
+	ExpectExpiresAt(wheel, 5, 2 * RANGE + TURN_1);
+	ASSERT_EQ(0, wheel.Size());
+}
+
+//--------------------------------------------------------------------------
+TEST(ExpiryWheel, Test_Advance_Empty)
+{
+	// Arrange
+	ExpiryWheel wheel { 0, 10 };
+
+	// Act - an empty wheel skips to the current time, and never goes back
+	const size_t first { wheel.Advance(1'000, [](const ExpiryWheel::Entry &) { }) };
+	const size_t back { wheel.Advance(500, [](const ExpiryWheel::Entry &) { }) };
+	wheel.Add(1, 200, 0); // expired already
+	wheel.Add(2, 1'050, 0);
+	wheel.Add(3, 1'010 + 10 * TURN_1, 0); // one turn from the tick skipped to
+
+	// Check
+	ASSERT_EQ(0, first);
+	ASSERT_EQ(0, back);
+	ASSERT_EQ(std::vector<int64_t>({ 1 }), Advance(wheel, 1'010)); // handed out by the next tick
+	ASSERT_TRUE(Advance(wheel, 1'049).empty());
+	ASSERT_EQ(std::vector<int64_t>({ 2 }), Advance(wheel, 1'059)); // same tick
+	ExpectExpiresAt(wheel, 3, 1'010 + 10 * TURN_1);
+}
+
+//--------------------------------------------------------------------------
+TEST(ExpiryWheel, Test_Advance_Random)
+{
+	// Arrange - random entries and steps, checked against a map of the pending expiry ticks
+	std::mt19937_64 rng { 42 };
+	ExpiryWheel wheel { 0, 1 };
+	std::multimap<int64_t, int64_t> pending; // expiry tick -> key
+	int64_t now { 0 };
+	int64_t key { 0 };
+
+	for (int round { 0 }; round < 2'000; ++round)
+	{
+		const int adds { int(rng() % 20) };
+		for (int i { 0 }; i < adds; ++i)
+		{
+			// mostly near the current tick, some beyond the second wheel, some expired already
+			const uint64_t kind { rng() % 10 };
+			const int64_t delta { kind < 6 ? int64_t(rng() % (2 * TURN_1)) : kind < 9 ? int64_t(rng() % (2 * TURN_2)) : -int64_t(rng() % 100) };
+			wheel.Add(++key, now + delta, 0);
+			pending.emplace(std::max(now + delta, now + 1), key);
+		}
+		const uint64_t kind { rng() % 10 };
+		now += kind < 7 ? int64_t(rng() % TURN_1) : int64_t(rng() % (TURN_2 + TURN_1));
+
+		// Act
+		const std::vector<int64_t> expired { Advance(wheel, now) };
+
+		// Check
+		std::vector<int64_t> expected;
+		for (auto it { pending.begin() }; it != pending.end() && it->first <= now; it = pending.erase(it))
+		{
+			expected.push_back(it->second);
+		}
+		std::sort(expected.begin(), expected.end());
+		ASSERT_EQ(expected, expired) << "round " << round << " now " << now;
+		ASSERT_EQ(pending.size(), wheel.Size());
+	}
+}
+
+} // namespace TEST
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "OrderBook/OrderBook.h"
+#include "Utils/FixDefs.h"
+
+namespace TEST {
+using namespace CORE::BOOK;
+using namespace UTILS;
+
+namespace {
+/*! \brief Adds a new quote to the book */
+void AddQuote(OrderBook &book, CurrencyPair cp, bool bid, int64_t key, double price, double volume, int venue = 0)
+{
+	NormalizedMDData::Entry entry;
+	entry.updateType = QT_NEW;
+	entry.entryType = bid ? QuoteType::BID : QuoteType::OFFER;
+	entry.price = price;
+	entry.volume = volume;
+	book.AddEntry(key, 0, 0, cp, entry, venue);
+}
+} // anon ns
+
+//--------------------------------------------------------------------------
+TEST(OrderBook, Test_GetLastQuote)
+{
+	// Arrange
+	OrderBook book { 2 };
+	const CurrencyPair first { "EUR/USD" };
+	const CurrencyPair second { "GBP/USD" };
+	ASSERT_FALSE(book.GetLastQuote());
+
+	// Act
+	AddQuote(book, first, true, 1, 1.05, 1);
+	AddQuote(book, first, false, 2, 1.06, 1);
+	book.Sync();
+	const std::optional<Quote> afterFirst { book.GetLastQuote() };
+	AddQuote(book, second, true, 3, 1.25, 2);
+	book.Sync();
+	const std::optional<Quote> afterSecond { book.GetLastQuote() };
+	book.Clear();
+	book.Sync();
+	const std::optional<Quote> afterClear { book.GetLastQuote() };
+
+	// Check
+	ASSERT_TRUE(afterFirst);
+	ASSERT_EQ(2, afterFirst->Key());
+	ASSERT_TRUE(afterSecond);
+	ASSERT_EQ(3, afterSecond->Key()); // latest of the writer threads
+	ASSERT_FALSE(afterClear);
+}
+
+//--------------------------------------------------------------------------
+TEST(OrderBook, Test_Writer_NotBlockedByReaders)
+{
+	// Arrange
+	constexpr int LEVELS { 1000 };
+	constexpr size_t DEPTH { 20 };
+	OrderBook book { 1 };
+	const CurrencyPair cp { "EUR/USD" };
+	AddQuote(book, cp, true, 1, 1.0, 1);
+	book.Sync();
+	std::atomic_bool done { false };
+	std::atomic<size_t> reads { 0 };
+	std::atomic<size_t> maxLevels { 0 };
+	std::vector<std::thread> readers;
+	for (int i { 0 }; i < 3; ++i)
+	{
+		readers.emplace_back([&book, &cp, &done, &reads, &maxLevels]()
+		{
+			BookDepth held;
+			while (!done.load())
+			{
+				const BookDepth depth { book.GetDepth(cp, true, DEPTH) };
+				if (depth.snapshot && depth.snapshot->LevelCount() > maxLevels.load())
+				{
+					maxLevels.store(depth.snapshot->LevelCount());
+				}
+				held = depth; // readers keep the snapshots they read
+				++reads;
+			}
+		});
+	}
+
+	// Act - the writer publishes a followed snapshot after every update while the readers are reading
+	for (int i { 1 }; i < LEVELS; ++i)
+	{
+		AddQuote(book, cp, true, i + 1, 1.0 + 0.0001 * i, 1);
+	}
+	book.Sync();
+	while (reads.load() < 1000)
+	{
+		std::this_thread::yield();
+	}
+	done.store(true);
+	for (std::thread &reader: readers)
+	{
+		reader.join();
+	}
+	const BookDepth depth { book.GetDepth(cp, true, DEPTH) };
+
+	// Check - followed snapshots never copy more levels than asked for
+	ASSERT_LE(maxLevels.load(), DEPTH);
+	ASSERT_EQ(DEPTH, depth.levels.size());
+	ASSERT_FALSE(depth.snapshot->Complete());
+	ASSERT_EQ(book.GetBestPrice(cp, true), depth.levels[0].price);
+	ASSERT_GT(depth.levels[0].price, depth.levels[DEPTH - 1].price);
+}
+
+} // namespace TEST
@@ -0,0 +1,483 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "Utils/FixDefs.h"
+#include "OrderBook/PriceLadder.h"
+
+namespace TEST {
+using namespace CORE::BOOK;
+
+namespace {
+
+Quote MakeQuote(int64_t key, int64_t price, int64_t volume, int64_t minQty = 0, int venue = 0)
+{
+	return Quote(QuoteHandle(), price, volume, minQty, key, 0, 0, QT_NEW, 0, venue);
+}
+
+/*! \brief Reference model of one side: levels in a std::map, quotes of a level in ladder order */
+class LadderModel
+{
+public:
+	explicit LadderModel(bool bid) : m_bid(bid) { }
+
+	void Insert(const Quote &quote)
+	{
+		auto &quotes { m_levels[quote.Price()] };
+		// same price -> greater volume first, a new quote before the quotes of equal volume
+		auto it { quotes.begin() };
+		while (it != quotes.end() && it->Volume() > quote.Volume())
+		{
+			++it;
+		}
+		quotes.insert(it, quote);
+		m_prices[quote.Key()] = quote.Price();
+	}
+
+	bool Remove(int64_t key)
+	{
+		const auto found { m_prices.find(key) };
+		if (found == m_prices.end())
+		{
+			return false;
+		}
+		auto &quotes { m_levels[found->second] };
+		quotes.erase(std::find_if(quotes.begin(), quotes.end(), [key](const Quote &q) { return q.Key() == key; }));
+		if (quotes.empty())
+		{
+			m_levels.erase(found->second);
+		}
+		m_prices.erase(found);
+		return true;
+	}
+
+	/*! \brief Levels, best first */
+	std::vector<std::pair<int64_t, std::vector<Quote>>> Levels() const
+	{
+		std::vector<std::pair<int64_t, std::vector<Quote>>> levels(m_levels.begin(), m_levels.end());
+		if (m_bid)
+		{
+			std::reverse(levels.begin(), levels.end());
+		}
+		return levels;
+	}
+
+	size_t LevelIndex(int64_t price) const
+	{
+		return size_t(m_bid ? std::distance(m_levels.upper_bound(price), m_levels.end())
+							: std::distance(m_levels.begin(), m_levels.lower_bound(price)));
+	}
+
+	std::optional<int64_t> PriceForVolume(int64_t volume) const
+	{
+		int64_t sum { 0 };
+		for (const auto &[price, quotes]: Levels())
+		{
+			for (const auto &q: quotes)
+			{
+				sum += q.Volume();
+			}
+			if (sum >= volume)
+			{
+				return price;
+			}
+		}
+		return 0;
+	}
+
+	const std::unordered_map<int64_t, int64_t> &Keys() const { return m_prices; }
+
+	size_t LevelCount() const { return m_levels.size(); }
+
+	size_t QuoteCount() const { return m_prices.size(); }
+
+private:
+	const bool m_bid;
+	std::map<int64_t, std::vector<Quote>> m_levels;
+	std::unordered_map<int64_t, int64_t> m_prices; //!< key -> price
+};
+
+/*! \brief Checks levels, order of the quotes, aggregates, key index and depth index of a ladder against the model */
+void ExpectSame(const PriceLadder &ladder, const LadderModel &model)
+{
+	const auto expected { model.Levels() };
+	ASSERT_EQ(expected.size(), ladder.LevelCount());
+	ASSERT_EQ(model.QuoteCount(), ladder.QuoteCount());
+	ASSERT_EQ(model.QuoteCount() == 0, ladder.Empty());
+	size_t idx { 0 };
+	int64_t totalVolume { 0 };
+	ladder.ForEachLevel([&](const PriceLadder::Level &level, bool &)
+	{
+		ASSERT_LT(idx, expected.size());
+		const auto &[price, quotes] { expected[idx] };
+		ASSERT_EQ(price, level.price) << "level " << idx;
+		ASSERT_EQ(quotes.size(), level.QuoteCount()) << "price " << price;
+		int64_t volume { 0 };
+		int64_t minQty { 0 };
+		VenueMask venues { 0 };
+		for (size_t i { 0 }; i < quotes.size(); ++i)
+		{
+			ASSERT_EQ(quotes[i].Key(), level.quotes[i].Key()) << "price " << price << ", quote " << i;
+			volume += quotes[i].Volume();
+			minQty = std::max(minQty, quotes[i].MinQty());
+			venues |= VenueBit(quotes[i].Venue());
+		}
+		ASSERT_EQ(volume, level.totalVolume) << "price " << price;
+		ASSERT_EQ(minQty, level.minQty) << "price " << price;
+		ASSERT_EQ(venues, level.venues) << "price " << price;
+		if (idx < 64 || idx % 16 == 0)
+		{
+			ASSERT_EQ(idx, ladder.LevelIndex(price));
+		}
+		totalVolume += volume;
+		++idx;
+	});
+	ASSERT_EQ(expected.size(), idx);
+	if (expected.empty())
+	{
+		ASSERT_EQ(nullptr, ladder.BestLevel());
+	}
+	else
+	{
+		ASSERT_EQ(expected.front().first, ladder.BestLevel()->price);
+	}
+	for (const auto &[key, price]: model.Keys())
+	{
+		const Quote *quote { ladder.Find(key) };
+		ASSERT_NE(nullptr, quote) << "key " << key;
+		ASSERT_EQ(price, quote->Price()) << "key " << key;
+	}
+	ASSERT_EQ(int64_t(expected.size()), ladder.Depth().LevelCount());
+	ASSERT_EQ(totalVolume, ladder.Depth().CumulativeVolume(0));
+	ASSERT_EQ(expected.empty() ? 0 : expected.front().first, ladder.Depth().BestPrice());
+	for (const int64_t volume: { int64_t(1), totalVolume / 3, totalVolume / 2, totalVolume, totalVolume + 1 })
+	{
+		// not answered by the index if the volume is reached outside the window
+		if (const std::optional<int64_t> price { ladder.Depth().PriceForVolume(volume) })
+		{
+			ASSERT_EQ(model.PriceForVolume(volume), *price) << "volume " << volume;
+		}
+	}
+}
+
+/*! \brief Replays random inserts, updates and deletes around a moving mid price against the model
+ *
+ * The mid price swings @a swing ticks up and down (twice) and takes out the
+ * levels it moves across, so the best price leaves the window in both
+ * directions and levels move to and from the overflow map. New quotes are
+ * mostly placed within @a spread ticks of the mid price, some up to three
+ * windows away from it.
+ */
+void Replay(bool bid, size_t windowSize, int64_t tick, int64_t spread, int64_t swing, uint32_t seed)
+{
+	PriceLadder ladder(bid, windowSize);
+	LadderModel model(bid);
+	std::mt19937 rng(seed);
+	std::vector<int64_t> keys;
+	int64_t nextKey { 1 };
+	const int64_t start { 1'000'000 * tick };
+	int64_t mid { start };
+	int64_t lowestBest { mid };
+	int64_t highestBest { mid };
+	size_t maxLevels { 0 };
+	bool overflowSeen { false };
+	const auto random { [&rng](int64_t from, int64_t to) { return std::uniform_int_distribution<int64_t>(from, to)(rng); } };
+	constexpr int OPERATIONS { 20'000 };
+	for (int op { 0 }; op < OPERATIONS; ++op)
+	{
+		if (op % 10 == 9)
+		{
+			mid = start + int64_t(std::lround(double(swing) * std::sin(4.0 * M_PI * op / OPERATIONS))) * tick;
+			// the levels the mid price has moved across are taken out, best first
+			for (const PriceLadder::Level *best { ladder.BestLevel() };
+				 best && (bid ? best->price > mid + 5 * tick : best->price < mid - 5 * tick); best = ladder.BestLevel())
+			{
+				const PriceLadder::QuoteVec quotes { best->quotes };
+				for (const Quote &quote: quotes)
+				{
+					ASSERT_TRUE(ladder.Remove(quote.Key()));
+					ASSERT_TRUE(model.Remove(quote.Key()));
+					keys.erase(std::find(keys.begin(), keys.end(), quote.Key()));
+				}
+			}
+		}
+		const int64_t choice { random(0, 9) };
+		if (keys.empty() || choice < 4)
+		{
+			// new quote, mostly close to the mid price, sometimes far from it (or on the other side of it)
+			const int64_t offset { random(0, 9) == 0 ? random(0, 3 * int64_t(windowSize)) : random(-5, spread) };
+			const int64_t price { bid ? mid - offset * tick : mid + offset * tick };
+			const Quote quote { MakeQuote(nextKey++, price, random(1, 20) * 100, random(0, 3) * 10, int(random(0, 3))) };
+			ladder.Insert(quote);
+			model.Insert(quote);
+			keys.push_back(quote.Key());
+		}
+		else
+		{
+			const size_t pos { size_t(random(0, int64_t(keys.size()) - 1)) };
+			const int64_t key { keys[pos] };
+			keys[pos] = keys.back();
+			keys.pop_back();
+			const std::optional<Quote> removed { ladder.Remove(key) };
+			ASSERT_TRUE(removed.has_value()) << "key " << key;
+			ASSERT_EQ(key, removed->Key());
+			ASSERT_TRUE(model.Remove(key));
+			ASSERT_FALSE(ladder.Contains(key));
+			if (choice < 8) // update: the new quote replaces the removed one, at a price close to it
+			{
+				const Quote quote { MakeQuote(nextKey++, removed->Price() + random(-3, 3) * tick, random(1, 20) * 100) };
+				ladder.Insert(quote);
+				model.Insert(quote);
+				keys.push_back(quote.Key());
+			}
+		}
+		if (op % 50 == 0)
+		{
+			ASSERT_NO_FATAL_FAILURE(ExpectSame(ladder, model)) << "operation " << op;
+		}
+		if (const PriceLadder::Level *best { ladder.BestLevel() })
+		{
+			maxLevels = std::max(maxLevels, ladder.LevelCount());
+			lowestBest = std::min(lowestBest, best->price);
+			highestBest = std::max(highestBest, best->price);
+		}
+		// the whole side is not answered by the index while levels are outside the window
+		overflowSeen = overflowSeen || !ladder.Depth().PriceForVolume(*ladder.Depth().CumulativeVolume(0)).has_value();
+	}
+	ASSERT_NO_FATAL_FAILURE(ExpectSame(ladder, model));
+	ASSERT_TRUE(overflowSeen);
+	ASSERT_GT(maxLevels, windowSize / 4);
+	ASSERT_GT(highestBest - start, int64_t(windowSize) * tick); // the best price has left the window upwards ...
+	ASSERT_GT(start - lowestBest, int64_t(windowSize) * tick); // ... and downwards
+	// drain the side best first: the window is moved to the overflow levels again and again
+	while (!keys.empty())
+	{
+		const int64_t key { ladder.BestLevel()->quotes.front().Key() };
+		ASSERT_TRUE(ladder.Remove(key));
+		ASSERT_TRUE(model.Remove(key));
+		keys.erase(std::find(keys.begin(), keys.end(), key));
+		if (keys.size() % 97 == 0)
+		{
+			ASSERT_NO_FATAL_FAILURE(ExpectSame(ladder, model)) << keys.size() << " quotes left";
+		}
+	}
+	ASSERT_TRUE(ladder.Empty());
+}
+
+} // anon ns
+
+//--------------------------------------------------------------------------
+TEST(PriceLadder, Test_Replay_Bid_CrossesWindow)
+{
+	ASSERT_NO_FATAL_FAILURE(Replay(true, DFLT_LADDER_WINDOW, 10, DFLT_LADDER_WINDOW / 4, 2 * DFLT_LADDER_WINDOW, 1));
+}
+
+//--------------------------------------------------------------------------
+TEST(PriceLadder, Test_Replay_Ask_CrossesWindow)
+{
+	ASSERT_NO_FATAL_FAILURE(Replay(false, DFLT_LADDER_WINDOW, 10, DFLT_LADDER_WINDOW / 4, 2 * DFLT_LADDER_WINDOW, 2));
+}
+
+//--------------------------------------------------------------------------
+TEST(PriceLadder, Test_Replay_SmallWindow)
+{
+	// most levels live in the overflow map, the window moves all the time
+	for (bool bid: { true, false })
+	{
+		ASSERT_NO_FATAL_FAILURE(Replay(bid, 64, 1, 48, 300, bid ? 3 : 4)) << (bid ? "bid" : "ask");
+	}
+}
+
+//--------------------------------------------------------------------------
+TEST(PriceLadder, Test_Recenter_BothDirections)
+{
+	for (bool bid: { true, false })
+	{
+		// Arrange - levels 0 .. 99 ticks from the best price, window of 64 slots
+		PriceLadder ladder(bid, 64);
+		LadderModel model(bid);
+		const int64_t sign { bid ? -1 : 1 }; // direction of the worse prices
+		int64_t key { 1 };
+		for (int64_t i { 0 }; i < 100; ++i)
+		{
+			const Quote quote { MakeQuote(key++, 10'000 + sign * i, 100 + i) };
+			ladder.Insert(quote);
+			model.Insert(quote);
+		}
+		ASSERT_NO_FATAL_FAILURE(ExpectSame(ladder, model));
+
+		// Act - a new best price far outside the window pushes all levels into the overflow map
+		const Quote better { MakeQuote(key++, 10'000 - sign * 5'000, 5) };
+		ladder.Insert(better);
+		model.Insert(better);
+		ASSERT_NO_FATAL_FAILURE(ExpectSame(ladder, model));
+
+		// Act - removing it moves the window back and pulls the overflow levels into their slots
+		ASSERT_TRUE(ladder.Remove(better.Key()));
+		ASSERT_TRUE(model.Remove(better.Key()));
+
+		// Check
+		ASSERT_NO_FATAL_FAILURE(ExpectSame(ladder, model));
+		ASSERT_EQ(10'000, ladder.BestLevel()->price);
+	}
+}
+
+//--------------------------------------------------------------------------
+TEST(PriceLadder, Test_Overflow_WorseThanWindow)
+{
+	// Arrange - the levels outside the window are all worse than those in it
+	PriceLadder ladder(true, 64);
+	LadderModel model(true);
+	for (int64_t i { 0 }; i < 200; ++i)
+	{
+		const Quote quote { MakeQuote(i + 1, 5'000 - i * 3, 10) };
+		ladder.Insert(quote);
+		model.Insert(quote);
+	}
+
+	// Act - worse levels go to the overflow map, a better level within the window keeps them there
+	const Quote better { MakeQuote(1'000, 5'003, 10) };
+	ladder.Insert(better);
+	model.Insert(better);
+
+	// Check
+	ASSERT_NO_FATAL_FAILURE(ExpectSame(ladder, model));
+	ASSERT_EQ(int64_t(201 * 10), ladder.Depth().CumulativeVolume(0));
+	ASSERT_FALSE(ladder.Depth().PriceForVolume(2'000).has_value()); // reached outside the window
+	ASSERT_EQ(5'003, ladder.Depth().PriceForVolume(10));
+}
+
+//--------------------------------------------------------------------------
+TEST(PriceLadder, Test_Tick_LearnedFromGcd)
+{
+	// Arrange
+	PriceLadder ladder(false, 64);
+	LadderModel model(false);
+	ASSERT_EQ(0, ladder.Tick());
+
+	// Act / Check - the tick is the gcd of the distances seen so far
+	int64_t key { 1 };
+	const auto insert { [&](int64_t price)
+	{
+		const Quote quote { MakeQuote(key++, price, 100) };
+		ladder.Insert(quote);
+		model.Insert(quote);
+	} };
+	insert(1'000);
+	ASSERT_EQ(0, ladder.Tick());
+	insert(1'100);
+	ASSERT_EQ(100, ladder.Tick());
+	insert(1'300);
+	insert(6'000); // 50 ticks away: in the window
+	ASSERT_EQ(100, ladder.Tick());
+	ASSERT_NO_FATAL_FAILURE(ExpectSame(ladder, model));
+	insert(1'050);
+	ASSERT_EQ(50, ladder.Tick());
+	ASSERT_NO_FATAL_FAILURE(ExpectSame(ladder, model));
+	insert(1'003); // finer tick: the window shrinks, far levels move to the overflow map
+	ASSERT_EQ(1, ladder.Tick());
+	ASSERT_NO_FATAL_FAILURE(ExpectSame(ladder, model));
+	ASSERT_EQ(1'000, ladder.BestLevel()->price);
+
+	// Check - the tick is kept when the ladder is cleared
+	ladder.Clear();
+	ASSERT_TRUE(ladder.Empty());
+	ASSERT_EQ(1, ladder.Tick());
+}
+
+//--------------------------------------------------------------------------
+TEST(PriceLadder, Test_KeyIndex)
+{
+	// Arrange
+	PriceLadder ladder(true, 64);
+	ladder.Insert(MakeQuote(1, 1'000, 100));
+	ladder.Insert(MakeQuote(2, 1'000, 300));
+	ladder.Insert(MakeQuote(3, 900, 200));
+	ladder.Insert(MakeQuote(4, 10, 50)); // overflow
+
+	// Act
+	const std::optional<Quote> removed { ladder.Remove(2) };
+	const std::optional<Quote> unknown { ladder.Remove(42) };
+	const std::optional<Quote> again { ladder.Remove(2) };
+	ladder.Insert(MakeQuote(2, 950, 10)); // the key is reused at another price
+
+	// Check
+	ASSERT_TRUE(removed);
+	ASSERT_EQ(300, removed->Volume());
+	ASSERT_FALSE(unknown);
+	ASSERT_FALSE(again);
+	ASSERT_EQ(950, ladder.Find(2)->Price());
+	ASSERT_EQ(10, ladder.Find(4)->Price());
+	ASSERT_EQ(nullptr, ladder.Find(42));
+	ASSERT_TRUE(ladder.Contains(3));
+	ASSERT_EQ(4, ladder.QuoteCount());
+	ASSERT_EQ(4, ladder.LevelCount());
+	ASSERT_EQ(1, ladder.LevelIndex(950));
+	ASSERT_EQ(2, ladder.LevelIndex(920)); // no level: index it would have
+	ASSERT_EQ(3, ladder.LevelIndex(10));
+}
+
+//--------------------------------------------------------------------------
+TEST(PriceLadder, Test_Aggregates_Venues)
+{
+	// Arrange
+	PriceLadder ladder(false, 64);
+	ladder.Insert(MakeQuote(1, 500, 100, 30, 1));
+	ladder.Insert(MakeQuote(2, 500, 200, 10, 2));
+	ladder.Insert(MakeQuote(3, 500, 50, 20, 1));
+
+	// Act
+	ladder.Remove(1);
+	const PriceLadder::Level after1 { *ladder.BestLevel() };
+	ladder.Remove(2);
+	const PriceLadder::Level after2 { *ladder.BestLevel() };
+
+	// Check - the aggregates are recalculated when the quote defining them is removed
+	ASSERT_EQ(250, after1.totalVolume);
+	ASSERT_EQ(20, after1.minQty);
+	ASSERT_EQ(VenueBit(1) | VenueBit(2), after1.venues);
+	ASSERT_EQ(50, after2.totalVolume);
+	ASSERT_EQ(20, after2.minQty);
+	ASSERT_EQ(VenueBit(1), after2.venues);
+}
+
+//--------------------------------------------------------------------------
+TEST(PriceLadder, Test_Trim)
+{
+	// Arrange - 80 levels of a window of 64 slots, 16 of them in the overflow map
+	PriceLadder ladder(false, 64);
+	LadderModel model(false);
+	for (int64_t i { 0 }; i < 80; ++i)
+	{
+		const Quote quote { MakeQuote(i + 1, 1'000 + i, 100) };
+		ladder.Insert(quote);
+		model.Insert(quote);
+	}
+	for (int64_t i { 0 }; i < 5; ++i)
+	{
+		const Quote quote { MakeQuote(100 + i, 1'000, 10 * (i + 1)) };
+		ladder.Insert(quote);
+		model.Insert(quote);
+	}
+	std::vector<int64_t> evictedKeys;
+
+	// Act - the last insert was at 1'000: its smallest quotes go, then the worst levels
+	const size_t evicted { ladder.Trim(10, 3, [&evictedKeys](const Quote &q) { evictedKeys.push_back(q.Key()); }) };
+
+	// Check
+	ASSERT_EQ(3 + 70, evicted);
+	ASSERT_EQ(evicted, evictedKeys.size());
+	for (const int64_t key: evictedKeys)
+	{
+		ASSERT_TRUE(model.Remove(key));
+	}
+	ASSERT_NO_FATAL_FAILURE(ExpectSame(ladder, model));
+	ASSERT_EQ(10, ladder.LevelCount());
+	ASSERT_EQ(1'009, model.Levels().back().first);
+}
+
+} // namespace TEST
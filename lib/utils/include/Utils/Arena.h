@@ -0,0 +1,101 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace UTILS
+{
+
+/*! \brief Monotonic arena: a memory resource handing out memory from large blocks, released all at once
+ *
+ * Allocating bumps a pointer in the current block and deallocating does
+ * nothing. Reset() makes the whole arena available again in O(1): the blocks
+ * are kept, so an arena reused for one message after the other stops
+ * allocating once its blocks hold the largest message. Containers use it
+ * through std::pmr::polymorphic_allocator, e.g. std::pmr::vector.
+ *
+ * Everything allocated from the arena must be destroyed before Reset().
+ *
+ * Not thread-safe.
+ */
+class Arena final : public std::pmr::memory_resource
+{
+public:
+	/*! \brief Default size of the first block (the following ones double in size) */
+	static constexpr size_t DFLT_BLOCK_SIZE { 16 * 1024 };
+
+	explicit Arena(size_t blockSize = DFLT_BLOCK_SIZE)
+			: m_blockSize(blockSize) { }
+
+	Arena(const Arena &) = delete;
+
+	Arena &operator=(const Arena &) = delete;
+
+	/*! \brief Makes all memory available again (the blocks are kept). */
+	void Reset()
+	{
+		m_current = 0;
+		m_offset = 0;
+	}
+
+	/*! \brief Total size of the blocks */
+	size_t Capacity() const
+	{
+		size_t capacity { 0 };
+		for (const auto &block: m_blocks)
+		{
+			capacity += block.size;
+		}
+		return capacity;
+	}
+
+private:
+	struct Block
+	{
+		std::unique_ptr<std::byte[]> data;
+		size_t size;
+	};
+
+	const size_t m_blockSize;
+	std::vector<Block> m_blocks;
+	size_t m_current { 0 }; //!< block in use
+	size_t m_offset { 0 }; //!< first free byte of the block in use
+
+	void *do_allocate(size_t bytes, size_t alignment) override
+	{
+		for (; m_current < m_blocks.size(); ++m_current, m_offset = 0)
+		{
+			Block &block { m_blocks[m_current] };
+			const uintptr_t base { reinterpret_cast<uintptr_t>(block.data.get()) };
+			const size_t offset { size_t(((base + m_offset + alignment - 1) & ~uintptr_t(alignment - 1)) - base) };
+			if (offset + bytes <= block.size)
+			{
+				m_offset = offset + bytes;
+				return block.data.get() + offset;
+			}
+		}
+		// no block left with room -> add one, at least twice as large as the last one
+		size_t size { m_blocks.empty() ? m_blockSize : m_blocks.back().size * 2 };
+		while (size < bytes + alignment)
+		{
+			size *= 2;
+		}
+		m_blocks.push_back({ std::unique_ptr<std::byte[]>(new std::byte[size]), size });
+		m_current = m_blocks.size() - 1;
+		m_offset = 0;
+		return do_allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void *, size_t, size_t) override { } // released by Reset()
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+};
+
+} // namespace UTILS
@@ -13,6 +13,7 @@
 
 #include "Utils/Result.h"
 #include "Utils/Lockable.h"
+#include "Utils/Decimal.h"
 
 namespace UTILS
 {
@@ -334,16 +335,28 @@ public:
 	/*! \brief Converts "CentiPips" to a a double currency value */
 	double CpipToDbl(int64_t cpip) const { return (double) (cpip) / CpipFactor(); }
 
+	/*! \brief Converts a decimal string to "CentiPips" without a floating point conversion (std::nullopt if it is not a number) */
+	std::optional<int64_t> StrToCpip(std::string_view str) const { return ParseDecimal(str, CpipFactor()); }
+
+    /*! \brief Quantity factor (quantity units per currency unit) */
+    int64_t QtyFactor() const
+    {
+        return int64_t(IsFX() ? QUANTITY_DECIMAL_FACTOR : QUANTITY_DECIMAL_FACTOR_CRYPTO);
+    }
+
     const double QtyToDouble(int64_t qty) const
     {
-        return IsFX() ? (double(qty) / QUANTITY_DECIMAL_FACTOR) : (double(qty) / QUANTITY_DECIMAL_FACTOR_CRYPTO);
+        return double(qty) / double(QtyFactor());
     }
 
     const int64_t DoubleToQty(double qty) const
     {
-        return llround(qty * (IsFX() ? QUANTITY_DECIMAL_FACTOR : QUANTITY_DECIMAL_FACTOR_CRYPTO));
+        return llround(qty * QtyFactor());
     }
 
+    /*! \brief Converts a decimal string to quantity units without a floating point conversion (std::nullopt if it is not a number) */
+    std::optional<int64_t> StrToQty(std::string_view str) const { return ParseDecimal(str, QtyFactor()); }
+
     int64_t Round(int64_t cpip, bool down, int64_t roundBy) const;
 
 	int64_t RoundForStreaming(int64_t cpip, bool down) const;
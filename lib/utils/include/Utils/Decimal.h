@@ -0,0 +1,140 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+namespace UTILS
+{
+
+namespace DECIMAL
+{
+
+/*! \brief Maximum number of digits parsed exactly (10^18 still fits into an int64_t) */
+constexpr int MAX_DIGITS { 18 };
+
+constexpr int64_t POW10[MAX_DIGITS + 1] { 1, 10, 100, 1'000, 10'000, 100'000, 1'000'000, 10'000'000, 100'000'000, 1'000'000'000,
+										  10'000'000'000, 100'000'000'000, 1'000'000'000'000, 10'000'000'000'000,
+										  100'000'000'000'000, 1'000'000'000'000'000, 10'000'000'000'000'000,
+										  100'000'000'000'000'000, 1'000'000'000'000'000'000 };
+
+/*! \brief Are all 8 bytes of @a chunk ASCII digits? */
+inline bool AllDigits(uint64_t chunk)
+{
+	// the high nibble of each byte is 3 and adding 6 to the low nibble does not carry into it
+	return ((chunk & 0xF0F0F0F0F0F0F0F0) | (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+}
+
+/*! \brief Value of 8 ASCII digits loaded little-endian (first digit in the lowest byte), with 3 multiplications */
+inline uint32_t EightDigits(uint64_t chunk)
+{
+	chunk -= 0x3030303030303030;
+	chunk = (chunk * 10) + (chunk >> 8); // pairs of digits
+	chunk = (((chunk & 0x000000FF000000FF) * 0x000F424000000064) + (((chunk >> 16) & 0x000000FF000000FF) * 0x0000271000000001)) >> 32;
+	return uint32_t(chunk);
+}
+
+/*! \brief Reads a run of digits into @a mantissa and returns the position after it (8 digits per step where possible). */
+inline const char *ReadDigits(const char *p, const char *end, uint64_t &mantissa, int &digits)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	uint64_t chunk;
+	while (end - p >= 8 && (std::memcpy(&chunk, p, 8), AllDigits(chunk)))
+	{
+		if (digits + 8 <= MAX_DIGITS)
+		{
+			mantissa = mantissa * 100'000'000 + EightDigits(chunk);
+		}
+		digits += 8;
+		p += 8;
+	}
+#endif
+	for (; p != end && *p >= '0' && *p <= '9'; ++p)
+	{
+		if (digits < MAX_DIGITS)
+		{
+			mantissa = mantissa * 10 + uint64_t(*p - '0');
+		}
+		++digits;
+	}
+	return p;
+}
+
+} // namespace DECIMAL
+
+/*! \brief Converts a decimal string to a fixed-point integer: round(value * factor)
+ *
+ * Made for the prices and sizes of market data ("16850.12000000"): the
+ * digits are read 8 at a time (SWAR) into one integer, which is scaled by
+ * @a factor without a floating point conversion, so the result is exact
+ * (rounded half away from zero like llround() if the string has more
+ * decimals than the factor). Strings with an exponent or with more than
+ * DECIMAL::MAX_DIGITS digits are converted through double.
+ *
+ * @param text   Decimal number, optionally with a leading '-'
+ * @param factor Fixed-point factor, e.g. CurrencyPair::CpipFactor()
+ * @return Fixed-point value, std::nullopt if @a text is not a number or the result does not fit
+ */
+inline std::optional<int64_t> ParseDecimal(std::string_view text, int64_t factor)
+{
+	const char *p { text.data() };
+	const char *const end { p + text.size() };
+	const bool negative { p != end && *p == '-' };
+	p += negative ? 1 : 0;
+
+	uint64_t mantissa { 0 };
+	int digits { 0 };
+	p = DECIMAL::ReadDigits(p, end, mantissa, digits);
+	int fracDigits { 0 };
+	if (p != end && *p == '.')
+	{
+		const char *const fracStart { ++p };
+		p = DECIMAL::ReadDigits(p, end, mantissa, digits);
+		fracDigits = int(p - fracStart);
+	}
+	if (digits == 0)
+	{
+		return std::nullopt;
+	}
+	if (p != end || digits > DECIMAL::MAX_DIGITS)
+	{
+		// exponent or too many digits
+		double dbl { 0.0 };
+		const auto [ptr, ec] { std::from_chars(text.data(), end, dbl) };
+		const double scaled { dbl * double(factor) };
+		if (ec != std::errc() || ptr != end || !(std::fabs(scaled) < 9.2e18))
+		{
+			return std::nullopt;
+		}
+		return std::llround(scaled);
+	}
+
+	int64_t result;
+	const int64_t divisor { DECIMAL::POW10[fracDigits] };
+	if (factor % divisor == 0) // the usual case: no more decimals than the factor has
+	{
+		if (__builtin_mul_overflow(int64_t(mantissa), factor / divisor, &result))
+		{
+			return std::nullopt;
+		}
+	}
+	else
+	{
+		const __int128 scaled { (__int128(mantissa) * factor + divisor / 2) / divisor };
+		if (scaled > INT64_MAX)
+		{
+			return std::nullopt;
+		}
+		result = int64_t(scaled);
+	}
+	return negative ? -result : result;
+}
+
+}
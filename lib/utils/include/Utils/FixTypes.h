@@ -4,6 +4,7 @@
 #include <map>
 #include <vector>
 #include <memory>
+#include <memory_resource>
 
 #include "CurrencyPair.h"
 #include "FixDefs.h"
@@ -479,6 +480,9 @@ struct NormalizedMDData
 		CurrencyPair instrument { }; //!< tag 55
 		Currency currency { }; //!< tag 15
 		double price { 0.0 }, volume { 0.0 }, minQty { 0.0 }; //!< tags 270, 271, 110, respectively
+		int64_t cpipPrice { 0 }; //!< price in cpips (see CurrencyPair::CpipFactor())
+		int64_t qtyVolume { 0 }, qtyMinQty { 0 }; //!< volume and minimum quantity in quantity units (see CurrencyPair::QtyFactor())
+		bool fixedPoint { false }; //!< cpipPrice, qtyVolume and qtyMinQty are set (price, volume and minQty need not be)
 #ifdef PARSE_ORIGINATORS
 		OriginatorVectorPtr originators;
 #else
@@ -489,15 +493,22 @@ struct NormalizedMDData
 		bool endOfMessage { false }; //!< Is this the last entry of the message?
 	};
 	
+	NormalizedMDData() = default;
+	
+	/*! \brief Entries allocated from @a resource (e.g. the arena of the message they are parsed from) */
+	explicit NormalizedMDData(std::pmr::memory_resource *resource)
+			: entries(resource) { }
+	
 	std::string mdReqID { "" }; //!< tag 262
-	std::vector<Entry> entries; //!< vector of entries
+	std::pmr::vector<Entry> entries; //!< vector of entries
 };
 
 
 class NormalizedMDDataPool
 {
 public:
-	static constexpr uint64_t POOL_SIZE = 1L << 20;
+	static constexpr uint64_t POOL_SIZE = 1L << 20; // max. number of pooled objects
+	static constexpr uint64_t SLAB_SIZE = 1L << 12; // objects allocated at a time
 
 	template <typename... Args>
 	static NormalizedMDData::Ptr getNormalizedMDDataObject(const char* caller, std::thread::id tid, Args... args)
@@ -510,7 +521,7 @@ public:
 	}
 
 private:
-	static UTILS::ObjectPool<NormalizedMDData, POOL_SIZE> op;
+	static UTILS::DynamicObjectPool<NormalizedMDData> op;
 };
 
 
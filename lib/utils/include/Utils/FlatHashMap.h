@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <type_traits>
+#include <utility>
+
+namespace UTILS
+{
+
+/*! \brief Default key hash of FlatHashMap: the integer key itself (the map scrambles it) */
+template <typename K>
+struct IdentityHash
+{
+	uint64_t operator()(K key) const { return uint64_t(key); }
+};
+
+/*! \brief Open-addressing hash map for integer keys.
+ *
+ * Keys and values are stored inline in one array (linear probing, backward
+ * shift deletion), so lookups touch one or two cache lines and inserting or
+ * erasing an element never allocates once the table has grown to its working
+ * size. The table is kept at most half full.
+ *
+ * Pointers returned by Find()/Insert() are invalidated by the next Insert().
+ *
+ * Not thread-safe.
+ *
+ * @tparam K Integer key type, or a small trivially copyable key with a Hash
+ * @tparam V Value type (default constructible, move assignable)
+ * @tparam Hash Function object returning a 64 bit hash of a key (need not be well mixed)
+ */
+template <typename K, typename V, typename Hash = IdentityHash<K>>
+class FlatHashMap
+{
+	static_assert(std::is_integral<K>::value || !std::is_same<Hash, IdentityHash<K>>::value,
+				  "FlatHashMap requires an integer key type or a hash function");
+
+public:
+	/*! \brief Constructor.
+	 *
+	 * @param capacity Number of elements to reserve space for
+	 */
+	explicit FlatHashMap(size_t capacity = 16) { Reserve(capacity); }
+
+	size_t Size() const { return m_size; }
+
+	bool Empty() const { return m_size == 0; }
+
+	/*! \brief Returns a pointer to the value of a key, or @a nullptr. */
+	V *Find(K key)
+	{
+		for (size_t idx { bucket(key) };; idx = (idx + 1) & m_mask)
+		{
+			if (!m_used[idx])
+			{
+				return nullptr;
+			}
+			if (m_slots[idx].key == key)
+			{
+				return &m_slots[idx].value;
+			}
+		}
+	}
+
+	/*! \brief Returns a pointer to the value of a key, or @a nullptr (const). */
+	const V *Find(K key) const { return const_cast<FlatHashMap *>(this)->Find(key); }
+
+	bool Contains(K key) const { return Find(key) != nullptr; }
+
+	/*! \brief Inserts a key or overwrites its value.
+	 *
+	 * @return Reference to the stored value
+	 */
+	V &Insert(K key, V value)
+	{
+		if ((m_size + 1) * 2 > m_slots.size())
+		{
+			rehash(m_slots.size() * 2);
+		}
+		size_t idx { bucket(key) };
+		for (; m_used[idx]; idx = (idx + 1) & m_mask)
+		{
+			if (m_slots[idx].key == key)
+			{
+				m_slots[idx].value = std::move(value);
+				return m_slots[idx].value;
+			}
+		}
+		m_used[idx] = 1;
+		m_slots[idx].key = key;
+		m_slots[idx].value = std::move(value);
+		++m_size;
+		return m_slots[idx].value;
+	}
+
+	/*! \brief Removes a key.
+	 *
+	 * @return @a true if the key was found
+	 */
+	bool Erase(K key)
+	{
+		size_t idx { bucket(key) };
+		for (;; idx = (idx + 1) & m_mask)
+		{
+			if (!m_used[idx])
+			{
+				return false;
+			}
+			if (m_slots[idx].key == key)
+			{
+				break;
+			}
+		}
+		// backward shift: move following elements of the probe chain into the gap
+		for (size_t next { (idx + 1) & m_mask }; m_used[next]; next = (next + 1) & m_mask)
+		{
+			const size_t home { bucket(m_slots[next].key) };
+			if (((next - home) & m_mask) >= ((next - idx) & m_mask))
+			{
+				m_slots[idx] = std::move(m_slots[next]);
+				idx = next;
+			}
+		}
+		m_used[idx] = 0;
+		m_slots[idx].value = V();
+		--m_size;
+		return true;
+	}
+
+	/*! \brief Removes all elements (the capacity is kept). */
+	void Clear()
+	{
+		for (size_t idx { 0 }; idx < m_slots.size(); ++idx)
+		{
+			if (m_used[idx])
+			{
+				m_used[idx] = 0;
+				m_slots[idx].value = V();
+			}
+		}
+		m_size = 0;
+	}
+
+	/*! \brief Makes sure that @a capacity elements can be stored without rehashing. */
+	void Reserve(size_t capacity)
+	{
+		size_t buckets { 16 };
+		while (buckets < capacity * 2)
+		{
+			buckets *= 2;
+		}
+		if (buckets > m_slots.size())
+		{
+			rehash(buckets);
+		}
+	}
+
+	/*! \brief Executes an action for each element.
+	 *
+	 * @param action Signature: void action(K key, V &value)
+	 */
+	template <typename A>
+	void ForEach(A action)
+	{
+		for (size_t idx { 0 }; idx < m_slots.size(); ++idx)
+		{
+			if (m_used[idx])
+			{
+				action(m_slots[idx].key, m_slots[idx].value);
+			}
+		}
+	}
+
+	/*! \brief Executes an action for each element (const).
+	 *
+	 * @param action Signature: void action(K key, const V &value)
+	 */
+	template <typename A>
+	void ForEach(A action) const
+	{
+		for (size_t idx { 0 }; idx < m_slots.size(); ++idx)
+		{
+			if (m_used[idx])
+			{
+				action(m_slots[idx].key, m_slots[idx].value);
+			}
+		}
+	}
+
+private:
+	struct Slot
+	{
+		K key {};
+		V value {};
+	};
+
+	std::vector<Slot> m_slots;
+	std::vector<uint8_t> m_used;
+	size_t m_mask { 0 };
+	size_t m_size { 0 };
+	int m_shift { 64 };
+
+	/*! \brief Fibonacci hashing (keys are often sequential or timestamp based) */
+	size_t bucket(K key) const
+	{
+		return size_t((Hash()(key) * 0x9E3779B97F4A7C15ull) >> m_shift);
+	}
+
+	void rehash(size_t buckets)
+	{
+		std::vector<Slot> slots(buckets);
+		std::vector<uint8_t> used(buckets, 0);
+		slots.swap(m_slots);
+		used.swap(m_used);
+		m_mask = buckets - 1;
+		m_shift = 64;
+		for (size_t b { buckets }; b > 1; b >>= 1)
+		{
+			--m_shift;
+		}
+		for (size_t idx { 0 }; idx < slots.size(); ++idx)
+		{
+			if (used[idx])
+			{
+				size_t target { bucket(slots[idx].key) };
+				while (m_used[target])
+				{
+					target = (target + 1) & m_mask;
+				}
+				m_used[target] = 1;
+				m_slots[target] = std::move(slots[idx]);
+			}
+		}
+	}
+};
+
+} // namespace UTILS
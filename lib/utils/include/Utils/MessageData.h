@@ -240,7 +240,8 @@ namespace MESSAGE {
 class MDSnapshotDataPool
 {
 public:
-    static constexpr uint64_t POOL_SIZE = 1L << 20;
+    static constexpr uint64_t POOL_SIZE = 1L << 20; // max. number of pooled objects
+    static constexpr uint64_t SLAB_SIZE = 1L << 12; // objects allocated at a time
 
     template <typename... Args>
     static MDSnapshotData::Ptr getMDSnapshotData(const char* caller, bool objectPoolDisabled, std::thread::id tid, Args... args)
@@ -254,7 +255,7 @@ public:
     }
 
 private:
-    static UTILS::ObjectPool<MDSnapshotData, POOL_SIZE> op;
+    static UTILS::DynamicObjectPool<MDSnapshotData> op;
 };
 
     /*!
@@ -334,7 +335,8 @@ private:
 class QuoteDataPool
 {
 public:
-    static constexpr uint64_t POOL_SIZE = 1L << 20;
+    static constexpr uint64_t POOL_SIZE = 1L << 20; // max. number of pooled objects
+    static constexpr uint64_t SLAB_SIZE = 1L << 12; // objects allocated at a time
 
     template <typename... Args>
     static QuoteData::Ptr getQuoteData(const char* caller, bool objectPoolDisabled, std::thread::id tid, Args... args)
@@ -348,7 +350,7 @@ public:
     }
 
 private:
-    static UTILS::ObjectPool<QuoteData, POOL_SIZE> op;
+    static UTILS::DynamicObjectPool<QuoteData> op;
 };
 
 
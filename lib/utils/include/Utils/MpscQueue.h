@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace UTILS
+{
+
+/**
+ * Bounded lock-free queue for many producer threads and one consumer thread.
+ *
+ * Every cell carries a sequence number telling producers and the consumer
+ * whether the cell is free or filled (D. Vyukov's bounded queue), so producers
+ * only contend on one atomic increment and never block each other.
+ *
+ * @tparam T Type of the queue element (default constructible, move assignable)
+ */
+template <typename T>
+class MpscQueue
+{
+public:
+	/**
+	 * Constructor.
+	 * @param capacity Maximum number of queued elements (rounded up to a power of two)
+	 */
+	explicit MpscQueue(size_t capacity)
+	{
+		size_t size { 2 };
+		while (size < capacity)
+		{
+			size *= 2;
+		}
+		m_mask = size - 1;
+		m_cells = std::make_unique<Cell[]>(size);
+		for (size_t i { 0 }; i < size; ++i)
+		{
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	MpscQueue(const MpscQueue &) = delete;
+
+	MpscQueue &operator=(const MpscQueue &) = delete;
+
+	/**
+	 * Enqueue a value (any thread).
+	 * @param value Value to be moved into the queue (left untouched if the queue is full)
+	 * @return @a true -> @a value was enqueued, @a false -> queue is full
+	 */
+	bool TryEnqueue(T &value)
+	{
+		size_t pos { m_tail.load(std::memory_order_relaxed) };
+		for (;;)
+		{
+			Cell &cell { m_cells[pos & m_mask] };
+			const size_t sequence { cell.sequence.load(std::memory_order_acquire) };
+			const auto diff { static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos) };
+			if (diff == 0)
+			{
+				if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					cell.value = std::move(value);
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false; // full
+			}
+			else
+			{
+				pos = m_tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * Enqueue several values in consecutive cells (any thread), so the consumer
+	 * dequeues them in a row, without values of other producers in between.
+	 *
+	 * The cells are claimed with one increment; the values are set afterwards
+	 * and become visible one by one, so the consumer may find the rest of the
+	 * batch missing for a moment.
+	 *
+	 * @param count Number of values (at most Capacity())
+	 * @param fill Sets the values: void fill(T &cell, size_t i), called for i = 0 .. @a count - 1 once the cells are claimed
+	 * @return @a true -> the values were enqueued, @a false -> not enough free cells (nothing enqueued)
+	 */
+	template <typename F>
+	bool TryEnqueue(size_t count, F fill)
+	{
+		if (count == 0)
+		{
+			return true;
+		}
+		if (count > Capacity())
+		{
+			return false;
+		}
+		size_t pos { m_tail.load(std::memory_order_relaxed) };
+		for (;;)
+		{
+			// the consumer frees the cells in order, so if the last cell is free all of them are
+			const size_t last { pos + count - 1 };
+			const size_t sequence { m_cells[last & m_mask].sequence.load(std::memory_order_acquire) };
+			const auto diff { static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(last) };
+			if (diff == 0)
+			{
+				if (m_tail.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+				{
+					for (size_t i { 0 }; i < count; ++i)
+					{
+						Cell &cell { m_cells[(pos + i) & m_mask] };
+						fill(cell.value, i);
+						cell.sequence.store(pos + i + 1, std::memory_order_release);
+					}
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false; // full
+			}
+			else
+			{
+				pos = m_tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * Dequeue a value (consumer thread only).
+	 * @param ref (out) reference to the variable to hold the dequeued element
+	 * @return @a true -> @a ref holds the dequeued element, @a false -> queue is empty
+	 */
+	bool TryDequeue(T &ref)
+	{
+		Cell &cell { m_cells[m_head & m_mask] };
+		const size_t sequence { cell.sequence.load(std::memory_order_acquire) };
+		if (sequence != m_head + 1)
+		{
+			return false;
+		}
+		ref = std::move(cell.value);
+		cell.value = T();
+		cell.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+		++m_head;
+		return true;
+	}
+
+	/** Is the queue empty? (consumer thread only) */
+	bool Empty() const
+	{
+		return m_cells[m_head & m_mask].sequence.load(std::memory_order_acquire) != m_head + 1;
+	}
+
+	size_t Capacity() const { return m_mask + 1; }
+
+	/** Number of cells claimed by producers so far, i.e. the position after the last value enqueued (any thread) */
+	size_t Claimed() const { return m_tail.load(std::memory_order_acquire); }
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence { 0 };
+		T value { };
+	};
+
+	std::unique_ptr<Cell[]> m_cells;
+	size_t m_mask { 0 };
+	alignas(64) std::atomic<size_t> m_tail { 0 }; //!< next position to be claimed by a producer
+	alignas(64) size_t m_head { 0 }; //!< next position to be read by the consumer
+};
+
+} // namespace UTILS
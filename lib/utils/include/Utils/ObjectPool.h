@@ -6,11 +6,20 @@
 #define OBJECTPOOL_H
 
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <vector>
 #include <memory>
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <new>
+
+#include <sys/mman.h>
+#include <unistd.h>
 
 //#define DEBUG_OBJECT_DELETER
 
@@ -31,6 +40,353 @@ constexpr bool OBJECT_POOL_VERBOSE = false;
  *  an enhancement that is not necessary for the first iteration.
  */
 
+// Allocation strategies of the BufferPool:
+//  Locked        - a single free list guarded by a mutex (the original implementation).
+//  ThreadCaching - every thread allocates from and releases to its own magazine (a small
+//                  local free list). Magazines exchange whole batches with a global lock-free
+//                  stack, so the shared state is touched once per POOL_BATCH_SIZE operations.
+//                  Nothing is printed when the pool is exhausted; the fallback allocations are
+//                  counted instead (see exhaustedCount()). The DynamicBufferPool always works
+//                  this way.
+enum class PoolMode
+{
+    Locked,
+    ThreadCaching
+};
+
+constexpr uint32_t POOL_BATCH_SIZE = 32;        // buffers moved between a magazine and the global stack at once
+constexpr uint32_t POOL_MAX_THREADS = 64;       // threads with a magazine (others use the global stack directly)
+
+// Magazines of one pool, one per thread index (see poolThreadIndex()).
+class PoolMagazines
+{
+public:
+    // Gives the buffers cached by a thread back to the pool (called when the thread exits).
+    virtual void flushMagazine(uint32_t index) = 0;
+
+protected:
+    ~PoolMagazines() = default;
+};
+
+// Thread indices in use and the pools whose magazines are flushed when a thread exits.
+struct PoolThreadRegistry
+{
+    std::mutex mtx;
+    uint64_t used{0};
+    std::vector<PoolMagazines*> pools;
+};
+
+inline PoolThreadRegistry& poolThreadRegistry()
+{
+    static PoolThreadRegistry registry;
+    return registry;
+}
+
+// Small dense index of the calling thread (0 .. POOL_MAX_THREADS - 1, or POOL_MAX_THREADS if all are taken).
+// Indices are recycled when a thread exits, after the magazines of the thread have been flushed.
+inline uint32_t poolThreadIndex()
+{
+    struct Registration
+    {
+        uint32_t index{POOL_MAX_THREADS};
+
+        Registration()
+        {
+            PoolThreadRegistry& registry = poolThreadRegistry();
+            std::lock_guard<std::mutex> lck(registry.mtx);
+            for (uint32_t i = 0; i < POOL_MAX_THREADS; ++i)
+            {
+                if (!(registry.used & (uint64_t(1) << i)))
+                {
+                    registry.used |= uint64_t(1) << i;
+                    index = i;
+                    break;
+                }
+            }
+        }
+
+        ~Registration()
+        {
+            if (index < POOL_MAX_THREADS)
+            {
+                PoolThreadRegistry& registry = poolThreadRegistry();
+                std::lock_guard<std::mutex> lck(registry.mtx);
+                for (PoolMagazines* pool : registry.pools)
+                {
+                    pool->flushMagazine(index);
+                }
+                registry.used &= ~(uint64_t(1) << index);
+            }
+        }
+    };
+    static_assert(POOL_MAX_THREADS <= 64, "thread registry is a 64 bit mask");
+
+    thread_local Registration registration;
+    return registration.index;
+}
+
+// ThreadCachingPool - magazines and global stack of the ThreadCaching mode, shared by the BufferPool
+// and the DynamicBufferPool. Buffers are identified by their index + 1 (0 -> none); the pool deriving
+// from it (CRTP) provides:
+//   unsigned char* bufferAt(uint32_t item) const         - the buffer
+//   std::atomic<uint32_t>& batchNext(uint32_t item)       - link of a batch on the global stack
+//   uint32_t itemOf(const unsigned char* buffer) const    - 0 if the buffer was allocated from the heap
+//   uint32_t takeFresh(uint32_t n, uint32_t& taken)       - first of up to n never used buffers (0 -> none left)
+// and calls unregisterPool() first thing in its destructor.
+template <typename Pool>
+class ThreadCachingPool : public PoolMagazines
+{
+public:
+    ThreadCachingPool(const ThreadCachingPool&) = delete;
+    ThreadCachingPool& operator=(const ThreadCachingPool&) = delete;
+
+    // Number of heap allocations made because the pool was exhausted.
+    uint64_t exhaustedCount() const { return m_exhaustedCount.load(std::memory_order_relaxed); }
+
+    // Maximum number of buffers handed out of the pool at the same time (ThreadCaching: including the
+    // buffers cached in magazines, i.e. accurate to POOL_BATCH_SIZE per thread).
+    uint64_t highWaterMark() const { return m_highWaterMark.load(std::memory_order_relaxed); }
+
+    void flushMagazine(uint32_t index) override
+    {
+        Magazine& magazine = m_magazines[index];
+        const uint32_t count = magazine.count.load(std::memory_order_relaxed);
+        if (count == 0)
+        {
+            return;
+        }
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            link(pool().bufferAt(magazine.items[i])) = i + 1 < count ? magazine.items[i + 1] : 0;
+        }
+        magazine.count.store(0, std::memory_order_relaxed);
+        pushBatch(magazine.items[0]);
+    }
+
+protected:
+    // enabled = false -> no magazines (PoolMode::Locked); only the counters are used
+    explicit ThreadCachingPool(bool enabled = true)
+    {
+        if (enabled)
+        {
+            m_magazines = std::make_unique<Magazine[]>(POOL_MAX_THREADS);
+            PoolThreadRegistry& registry = poolThreadRegistry();
+            std::lock_guard<std::mutex> lck(registry.mtx);
+            registry.pools.push_back(this);
+        }
+    }
+
+    ~ThreadCachingPool()
+    {
+        unregisterPool();
+    }
+
+    // Stops flushing into the pool when threads exit (the buffers of the pool are about to be freed).
+    void unregisterPool()
+    {
+        if (m_magazines)
+        {
+            PoolThreadRegistry& registry = poolThreadRegistry();
+            std::lock_guard<std::mutex> lck(registry.mtx);
+            registry.pools.erase(std::remove(registry.pools.begin(), registry.pools.end(), this), registry.pools.end());
+        }
+    }
+
+    // Are the magazine of the calling thread and the global stack empty?
+    bool cacheEmpty() const
+    {
+        const uint32_t index = poolThreadIndex();
+        return (index >= POOL_MAX_THREADS || m_magazines[index].count == 0) &&
+               uint32_t(m_globalHead.load(std::memory_order_relaxed)) == 0;
+    }
+
+    // Number of buffers currently handed out (approximate while other threads allocate).
+    uint64_t cachedBuffersInUse() const
+    {
+        uint64_t cached = 0;
+        for (uint32_t i = 0; i < POOL_MAX_THREADS; ++i)
+        {
+            cached += m_magazines[i].count;
+        }
+        const uint64_t outstanding = m_outstanding.load(std::memory_order_relaxed);
+        return outstanding > cached ? outstanding - cached : 0;
+    }
+
+    unsigned char* getCachedBuffer(uint64_t bufferSize)
+    {
+        const uint32_t index = poolThreadIndex();
+        if (index < POOL_MAX_THREADS)
+        {
+            Magazine& magazine = m_magazines[index];
+            uint32_t count = magazine.count.load(std::memory_order_relaxed);
+            if (count == 0)
+            {
+                count = refill(magazine);
+            }
+            if (count > 0)
+            {
+                magazine.count.store(count - 1, std::memory_order_relaxed);
+                return pool().bufferAt(magazine.items[count - 1]);
+            }
+        }
+        else
+        {
+            uint32_t item = popBatch();
+            if (item != 0)
+            {
+                // keep the first buffer, give the rest of the batch back
+                const uint32_t rest = link(pool().bufferAt(item));
+                if (rest != 0)
+                {
+                    pushBatch(rest);
+                }
+                return pool().bufferAt(item);
+            }
+            uint32_t taken = 0;
+            item = takeFresh(1, taken);
+            if (item != 0)
+            {
+                return pool().bufferAt(item);
+            }
+        }
+        m_exhaustedCount.fetch_add(1, std::memory_order_relaxed);
+        return static_cast<unsigned char*>(malloc(bufferSize));
+    }
+
+    void releaseCachedBuffer(unsigned char* buffer)
+    {
+        const uint32_t item = pool().itemOf(buffer);
+        if (item == 0)
+        {
+            free(buffer); // allocated while the pool was exhausted
+            return;
+        }
+        const uint32_t index = poolThreadIndex();
+        if (index >= POOL_MAX_THREADS)
+        {
+            link(buffer) = 0;
+            pushBatch(item);
+            return;
+        }
+        Magazine& magazine = m_magazines[index];
+        uint32_t count = magazine.count.load(std::memory_order_relaxed);
+        if (count == 2 * POOL_BATCH_SIZE)
+        {
+            // magazine full -> move the older half to the global stack as one batch
+            for (uint32_t i = 0; i < POOL_BATCH_SIZE; ++i)
+            {
+                link(pool().bufferAt(magazine.items[i])) = i + 1 < POOL_BATCH_SIZE ? magazine.items[i + 1] : 0;
+            }
+            pushBatch(magazine.items[0]);
+            std::copy(magazine.items + POOL_BATCH_SIZE, magazine.items + count, magazine.items);
+            count -= POOL_BATCH_SIZE;
+        }
+        magazine.items[count] = item;
+        magazine.count.store(count + 1, std::memory_order_relaxed);
+    }
+
+    void updateHighWaterMark(uint64_t value)
+    {
+        uint64_t current = m_highWaterMark.load(std::memory_order_relaxed);
+        while (value > current && !m_highWaterMark.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    std::atomic<uint64_t> m_exhaustedCount{0};
+    std::atomic<uint64_t> m_highWaterMark{0};
+
+private:
+    // Local free list of one thread. Only the owning thread touches the items (and flushMagazine() when
+    // the thread exits); count is atomic so that buffersInUse() can read it from other threads.
+    struct alignas(64) Magazine
+    {
+        std::atomic<uint32_t> count{0};
+        uint32_t items[2 * POOL_BATCH_SIZE];   // buffer index + 1
+    };
+
+    std::unique_ptr<Magazine[]> m_magazines;
+    alignas(64) std::atomic<uint64_t> m_globalHead{0};      // (tag << 32) | (first buffer of the top batch + 1)
+    std::atomic<uint64_t> m_outstanding{0};                 // buffers outside the global stack
+
+    Pool& pool() { return static_cast<Pool&>(*this); }
+
+    // Buffers of a batch are chained through their first bytes (the batch is owned by one thread at a time).
+    static uint32_t& link(unsigned char* buffer) { return *reinterpret_cast<uint32_t*>(buffer); }
+
+    uint32_t takeFresh(uint32_t n, uint32_t& taken)
+    {
+        const uint32_t first = pool().takeFresh(n, taken);
+        if (first != 0)
+        {
+            updateHighWaterMark(m_outstanding.fetch_add(taken, std::memory_order_relaxed) + taken);
+        }
+        return first;
+    }
+
+    // Fills an empty magazine with a batch from the global stack, or with fresh buffers.
+    uint32_t refill(Magazine& magazine)
+    {
+        uint32_t count = 0;
+        for (uint32_t item = popBatch(); item != 0; item = link(pool().bufferAt(item)))
+        {
+            magazine.items[count++] = item;
+        }
+        if (count == 0)
+        {
+            uint32_t taken = 0;
+            const uint32_t first = takeFresh(POOL_BATCH_SIZE, taken);
+            for (uint32_t item = first; item != 0 && count < taken; ++item)
+            {
+                magazine.items[count++] = item;
+            }
+        }
+        magazine.count.store(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    // Pushes a chain of buffers (linked through link()) as one batch.
+    void pushBatch(uint32_t first)
+    {
+        uint32_t count = 0;
+        for (uint32_t item = first; item != 0; item = link(pool().bufferAt(item)))
+        {
+            ++count;
+        }
+        m_outstanding.fetch_sub(count, std::memory_order_relaxed);
+        std::atomic<uint32_t>& next = pool().batchNext(first);
+        uint64_t head = m_globalHead.load(std::memory_order_relaxed);
+        do
+        {
+            next.store(uint32_t(head), std::memory_order_relaxed);
+        } while (!m_globalHead.compare_exchange_weak(head, (((head >> 32) + 1) << 32) | first,
+                                                     std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // Pops a batch and returns its first buffer (0 if the global stack is empty).
+    uint32_t popBatch()
+    {
+        uint64_t head = m_globalHead.load(std::memory_order_acquire);
+        while (uint32_t(head) != 0)
+        {
+            const uint32_t next = pool().batchNext(uint32_t(head)).load(std::memory_order_relaxed);
+            // the tag in the upper half prevents ABA
+            if (m_globalHead.compare_exchange_weak(head, (((head >> 32) + 1) << 32) | next,
+                                                   std::memory_order_acquire, std::memory_order_acquire))
+            {
+                uint32_t count = 0;
+                for (uint32_t item = uint32_t(head); item != 0; item = link(pool().bufferAt(item)))
+                {
+                    ++count;
+                }
+                updateHighWaterMark(m_outstanding.fetch_add(count, std::memory_order_relaxed) + count);
+                return uint32_t(head);
+            }
+        }
+        return 0;
+    }
+};
+
 // BufferPool - allocates a slab of memory and dispenses chunks using a unique_ptr with custom deleter to
 // return chunks to the pool.  Template arguments are a buffer/chunk size and number of chunks to create.
 // This class is supposed to stay simple.  Dynamic resizing, using the memory to construct objects in place, etc.
@@ -40,11 +396,16 @@ constexpr bool OBJECT_POOL_VERBOSE = false;
 // This data structure works like a stack.  Objects are added to the free list
 // by pushing them on the top via pointer manipulation.  New objects are created
 // in the most recently freed memory, which is what will be at the top of the stack.
-template <uint64_t BufferSize, uint64_t BufferCount>
-class BufferPool
+template <uint64_t BufferSize, uint64_t BufferCount, PoolMode Mode = PoolMode::ThreadCaching>
+class BufferPool : public ThreadCachingPool<BufferPool<BufferSize, BufferCount, Mode>>
 {
     static_assert(BufferCount > 0, "BufferCount must be greater than 0.");
     static_assert(BufferSize > 0, "BufferSize must be greater than 0.");
+    static_assert(BufferCount < UINT32_MAX, "BufferCount must fit into 32 bits.");
+    static_assert(BufferSize >= sizeof(uint32_t), "BufferSize must be >= sizeof(uint32_t).");
+
+    using Cache = ThreadCachingPool<BufferPool<BufferSize, BufferCount, Mode>>;
+    friend Cache;
 public:
     class CustomDeleter
     {
@@ -61,7 +422,7 @@ public:
 
             if(m_pool)
             {
-                m_pool->releaseBuffer(buffer);
+                m_pool->releaseBuffer(__PRETTY_FUNCTION__, buffer);
             }
         }
 
@@ -72,6 +433,7 @@ public:
     using BufferPtr = std::unique_ptr<unsigned char, CustomDeleter>;
 
     BufferPool()
+        : Cache(Mode == PoolMode::ThreadCaching)
     {
         constexpr auto bytes_to_allocate = BufferSize * BufferCount;
 
@@ -81,9 +443,17 @@ public:
 #endif
 
         m_pool = static_cast<unsigned char*>(malloc(bytes_to_allocate));
-        std::lock_guard<std::mutex> lck(m_poolMutex);
-        m_freeList = m_pool;
-        initBuffers(m_pool);
+        if constexpr (Mode == PoolMode::Locked)
+        {
+            std::lock_guard<std::mutex> lck(m_poolMutex);
+            m_freeList = m_pool;
+            initBuffers(m_pool);
+        }
+        else
+        {
+            // buffers are handed out from m_fresh first, so the slab is not touched up front
+            m_batchNext = std::make_unique<std::atomic<uint32_t>[]>(BufferCount);
+        }
     }
 
     ~BufferPool()
@@ -93,18 +463,43 @@ public:
                 "]\tPool memory being freed." << std::endl;
 #endif
 
+        this->unregisterPool();
         free(m_pool);
     }
 
     // This is equivalent to popping a value off of a stack where what's popped is the pointer to the new buffer.
     auto getBuffer(std::thread::id tid)
     {
-        return  BufferPtr(getRawBuffer(), this);
+        return  BufferPtr(getRawBuffer(__PRETTY_FUNCTION__, tid), CustomDeleter(this));
     }
 
     auto bufferSize() const { return BufferSize; }
 
-    bool isExhausted() const { return m_buffersInUse >= m_capacity; }
+    // Would the next allocation of the calling thread fall back to the heap?
+    bool isExhausted() const
+    {
+        if constexpr (Mode == PoolMode::Locked)
+        {
+            return m_buffersInUse >= m_capacity;
+        }
+        else
+        {
+            return this->cacheEmpty() && m_fresh.load(std::memory_order_relaxed) >= BufferCount;
+        }
+    }
+
+    // Number of buffers currently handed out of the slab (ThreadCaching: approximate while other threads allocate).
+    uint64_t buffersInUse() const
+    {
+        if constexpr (Mode == PoolMode::Locked)
+        {
+            return m_buffersInUse;
+        }
+        else
+        {
+            return this->cachedBuffersInUse();
+        }
+    }
 
 protected:
 
@@ -113,22 +508,31 @@ protected:
     // which is not possible here since there is no class type being contained.
     auto getRawBuffer(const char* caller, std::thread::id tid)
     {
-        std::lock_guard<std::mutex> lck(m_poolMutex);
-        if (m_buffersInUse >= m_capacity)
+        if constexpr (Mode == PoolMode::ThreadCaching)
         {
-            std::cerr << "Memory pool capacity of " << m_capacity << " objects is exhausted. Reverting to regular heap allocation.";
-            return static_cast<unsigned char*>(malloc(BufferSize));
+            return this->getCachedBuffer(BufferSize);
         }
-        auto newBuffer = m_freeList;
-        m_freeList = *reinterpret_cast<unsigned char**>(newBuffer);
+        else
+        {
+            std::lock_guard<std::mutex> lck(m_poolMutex);
+            if (m_buffersInUse >= m_capacity)
+            {
+                std::cerr << "Memory pool capacity of " << m_capacity << " objects is exhausted. Reverting to regular heap allocation.";
+                ++this->m_exhaustedCount;
+                return static_cast<unsigned char*>(malloc(BufferSize));
+            }
+            auto newBuffer = m_freeList;
+            m_freeList = *reinterpret_cast<unsigned char**>(newBuffer);
 
 #if defined(DEBUG_BUFFER_POOL)
-        std::cout << "[tid: " << tid << "]\tNew buffer: [" << static_cast<void*>(newBuffer) << "]\tNew m_freeList head: [" << static_cast<void*>(m_freeList.load()) << "]";
-        std::cout << "\tbuffersInUse: " << m_buffersInUse.load() << std::endl;
+            std::cout << "[tid: " << tid << "]\tNew buffer: [" << static_cast<void*>(newBuffer) << "]\tNew m_freeList head: [" << static_cast<void*>(m_freeList) << "]";
+            std::cout << "\tbuffersInUse: " << m_buffersInUse << std::endl;
 #endif
 
-        ++m_buffersInUse;
-        return  newBuffer;
+            ++m_buffersInUse;
+            this->updateHighWaterMark(m_buffersInUse);
+            return  newBuffer;
+        }
     }
 
 
@@ -137,17 +541,30 @@ protected:
     // use raw pointers to control the lifecycle to release buffer in a callback.
     void releaseBuffer(const char* caller, unsigned char* buffer)
     {
-        std::lock_guard<std::mutex> lck(m_poolMutex);
-        *reinterpret_cast<unsigned char**>(buffer) = m_freeList;
-        m_freeList = buffer;
-        --m_buffersInUse;
+        if constexpr (Mode == PoolMode::ThreadCaching)
+        {
+            this->releaseCachedBuffer(buffer);
+            return;
+        }
+        else
+        {
+            if (itemOf(buffer) == 0)
+            {
+                free(buffer); // allocated while the pool was exhausted
+                return;
+            }
+            std::lock_guard<std::mutex> lck(m_poolMutex);
+            *reinterpret_cast<unsigned char**>(buffer) = m_freeList;
+            m_freeList = buffer;
+            --m_buffersInUse;
 
 #if defined(DEBUG_BUFFER_POOL)
-        std::cout << "Next buffer: " << static_cast<void*>(reinterpret_cast<char**>(buffer)) << "\t"
-            << "new m_freeList head: "
-            << static_cast<void*>(m_freeList) << "\tbuffersInUse: " << m_buffersInUse.load()
-            << std::endl;
+            std::cout << "Next buffer: " << static_cast<void*>(reinterpret_cast<char**>(buffer)) << "\t"
+                << "new m_freeList head: "
+                << static_cast<void*>(m_freeList) << "\tbuffersInUse: " << m_buffersInUse
+                << std::endl;
 #endif
+        }
     }
 
 
@@ -185,14 +602,241 @@ private:
     uint64_t m_buffersInUse{0};
     const uint64_t m_capacity {BufferCount};
     std::mutex m_poolMutex;
+
+    std::unique_ptr<std::atomic<uint32_t>[]> m_batchNext;   // first buffer of a batch -> first buffer of the next batch
+    alignas(64) std::atomic<uint64_t> m_fresh{0};           // buffers never handed out start here
+
+    unsigned char* bufferAt(uint32_t item) const { return m_pool + uint64_t(item - 1) * BufferSize; }
+
+    std::atomic<uint32_t>& batchNext(uint32_t item) { return m_batchNext[item - 1]; }
+
+    uint32_t itemOf(const unsigned char* buffer) const
+    {
+        return buffer < m_pool || buffer >= m_pool + BufferSize * BufferCount ? 0 : uint32_t((buffer - m_pool) / BufferSize) + 1;
+    }
+
+    // Returns the first of up to n never used buffers (0 if the slab is used up); the range ends at BufferCount.
+    uint32_t takeFresh(uint32_t n, uint32_t& taken)
+    {
+        if (m_fresh.load(std::memory_order_relaxed) >= BufferCount)
+        {
+            return 0;
+        }
+        const uint64_t first = m_fresh.fetch_add(n, std::memory_order_relaxed);
+        if (first >= BufferCount)
+        {
+            return 0;
+        }
+        taken = uint32_t(std::min<uint64_t>(n, BufferCount - first));
+        return uint32_t(first + 1);
+    }
 };
 
-// DynamicBufferPool - BufferPool that expands dynamically once the originally allocated memory is exhausted.
-// Adds a function to allocate additional slabs and connect them to the pool. Takes an initial size,
-// and a max size to expand to.
-class DynamicBufferPool //: public BufferPool
+// DynamicBufferPool - BufferPool that grows once its buffers are exhausted.
+// The address range of maxBuffers buffers is reserved up front without committing memory. The pool
+// starts with initialSlabs slabs and makes one more slab of buffersPerSlab buffers usable at a time,
+// under a mutex and only when no free buffer is left, until maxBuffers is reached; beyond that it
+// reverts to regular heap allocation (see exhaustedCount()). Buffers are allocated and released
+// through the magazines and the global stack of the ThreadCaching mode, so neither takes a lock, and
+// as the slabs are contiguous a pool buffer is told from a heap buffer by its address. Slabs are kept
+// until the pool is destroyed.
+template <uint64_t BufferSize>
+class DynamicBufferPool : public ThreadCachingPool<DynamicBufferPool<BufferSize>>
 {
+    static_assert(BufferSize >= sizeof(uint32_t), "BufferSize must be >= sizeof(uint32_t).");
+
+    using Cache = ThreadCachingPool<DynamicBufferPool<BufferSize>>;
+    friend Cache;
+public:
+    // buffersPerSlab is rounded up to a power of two, maxBuffers up to a multiple of it
+    DynamicBufferPool(uint64_t buffersPerSlab, uint64_t maxBuffers, uint64_t initialSlabs = 1)
+        : m_slabShift(slabShift(buffersPerSlab))
+        , m_buffersPerSlab(uint64_t(1) << m_slabShift)
+        , m_maxSlabs(std::max<uint64_t>((std::min<uint64_t>(maxBuffers, UINT32_MAX - 1) + m_buffersPerSlab - 1) / m_buffersPerSlab, 1))
+        , m_nextOffset((m_buffersPerSlab * BufferSize + 63) / 64 * 64)
+        , m_slabBytes(pageAligned(m_nextOffset + m_buffersPerSlab * sizeof(std::atomic<uint32_t>)))
+    {
+        void* memory = mmap(nullptr, m_maxSlabs * m_slabBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        m_memory = memory == MAP_FAILED ? nullptr : static_cast<unsigned char*>(memory);
+        std::lock_guard<std::mutex> lck(m_growMutex);
+        for (uint64_t i = 0; i < std::min(initialSlabs, m_maxSlabs); ++i)
+        {
+            addSlab();
+        }
+    }
+
+    ~DynamicBufferPool()
+    {
+        this->unregisterPool();
+        if (m_memory)
+        {
+            munmap(m_memory, m_maxSlabs * m_slabBytes);
+        }
+    }
+
+    DynamicBufferPool(const DynamicBufferPool&) = delete;
+    DynamicBufferPool& operator=(const DynamicBufferPool&) = delete;
+
+    auto bufferSize() const { return BufferSize; }
+
+    // Is the ceiling reached, i.e. would the next allocation of the calling thread fall back to the heap?
+    bool isExhausted() const
+    {
+        return this->cacheEmpty() && m_fresh.load(std::memory_order_relaxed) >= m_capacity.load(std::memory_order_relaxed) &&
+               slabCount() >= m_maxSlabs;
+    }
+
+    uint64_t slabCount() const { return m_slabCount.load(std::memory_order_relaxed); }
+
+    // Number of buffers currently handed out (approximate while other threads allocate).
+    uint64_t buffersInUse() const { return this->cachedBuffersInUse(); }
+
+    // Number of slabs added after construction.
+    uint64_t growCount() const { return m_growCount.load(std::memory_order_relaxed); }
+
+    // Total time spent adding slabs after construction.
+    std::chrono::nanoseconds growTime() const { return std::chrono::nanoseconds(m_growNanos.load(std::memory_order_relaxed)); }
+
+protected:
+    unsigned char* getRawBuffer(const char* caller, std::thread::id tid)
+    {
+        return this->getCachedBuffer(BufferSize);
+    }
+
+    void releaseBuffer(const char* caller, unsigned char* buffer)
+    {
+        this->releaseCachedBuffer(buffer);
+    }
+
+private:
+    const uint32_t m_slabShift;
+    const uint64_t m_buffersPerSlab;
+    const uint64_t m_maxSlabs;
+    const uint64_t m_nextOffset;                            // batch links of a slab, behind its buffers
+    const uint64_t m_slabBytes;
+    unsigned char* m_memory{nullptr};                       // reserved for m_maxSlabs slabs
+
+    std::mutex m_growMutex;
+    std::atomic<uint64_t> m_slabCount{0};                   // usable slabs
+    std::atomic<uint64_t> m_capacity{0};                    // buffers of the usable slabs
+    alignas(64) std::atomic<uint64_t> m_fresh{0};           // buffers never handed out start here
+    std::atomic<uint64_t> m_growCount{0};
+    std::atomic<int64_t> m_growNanos{0};
+
+    static uint32_t slabShift(uint64_t buffersPerSlab)
+    {
+        uint32_t shift = 0;
+        while ((uint64_t(1) << shift) < buffersPerSlab && shift < 31)
+        {
+            ++shift;
+        }
+        return shift;
+    }
+
+    static uint64_t pageAligned(uint64_t bytes)
+    {
+        const uint64_t page = uint64_t(sysconf(_SC_PAGESIZE));
+        return (bytes + page - 1) / page * page;
+    }
+
+    unsigned char* slabAt(uint32_t item) const { return m_memory + (uint64_t(item - 1) >> m_slabShift) * m_slabBytes; }
+
+    unsigned char* bufferAt(uint32_t item) const
+    {
+        return slabAt(item) + (uint64_t(item - 1) & (m_buffersPerSlab - 1)) * BufferSize;
+    }
 
+    std::atomic<uint32_t>& batchNext(uint32_t item)
+    {
+        return reinterpret_cast<std::atomic<uint32_t>*>(slabAt(item) + m_nextOffset)[uint64_t(item - 1) & (m_buffersPerSlab - 1)];
+    }
+
+    uint32_t itemOf(const unsigned char* buffer) const
+    {
+        if (buffer < m_memory || buffer >= m_memory + slabCount() * m_slabBytes)
+        {
+            return 0;
+        }
+        const uint64_t slab = uint64_t(buffer - m_memory) / m_slabBytes;
+        const uint64_t offset = uint64_t(buffer - m_memory) - slab * m_slabBytes;
+        return uint32_t((slab << m_slabShift) + offset / BufferSize + 1);
+    }
+
+    // Returns the first of up to n never used buffers, adding a slab if all have been used (0 if the ceiling is reached).
+    uint32_t takeFresh(uint32_t n, uint32_t& taken)
+    {
+        uint64_t first = m_fresh.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            const uint64_t capacity = m_capacity.load(std::memory_order_acquire);
+            if (first < capacity)
+            {
+                // a batch does not extend beyond the slabs added so far
+                const uint64_t count = std::min<uint64_t>(n, capacity - first);
+                if (m_fresh.compare_exchange_weak(first, first + count, std::memory_order_relaxed))
+                {
+                    taken = uint32_t(count);
+                    return uint32_t(first + 1);
+                }
+            }
+            else if (grow(capacity))
+            {
+                first = m_fresh.load(std::memory_order_relaxed);
+            }
+            else
+            {
+                return 0;
+            }
+        }
+    }
+
+    // Adds a slab unless another thread has done so since the capacity was seen (false if the ceiling is reached).
+    bool grow(uint64_t seenCapacity)
+    {
+        std::lock_guard<std::mutex> lck(m_growMutex);
+        if (m_capacity.load(std::memory_order_relaxed) != seenCapacity)
+        {
+            return true;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const bool added = addSlab();
+        if (added)
+        {
+            m_growCount.fetch_add(1, std::memory_order_relaxed);
+            m_growNanos.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+        }
+        return added;
+    }
+
+    // m_growMutex must be held
+    bool addSlab()
+    {
+        const uint64_t slab = m_slabCount.load(std::memory_order_relaxed);
+        if (!m_memory || slab >= m_maxSlabs)
+        {
+            return false;
+        }
+        unsigned char* memory = m_memory + slab * m_slabBytes;
+        if (mprotect(memory, m_slabBytes, PROT_READ | PROT_WRITE) != 0)
+        {
+            return false;
+        }
+
+#if defined(DEBUG_BUFFER_POOL)
+        std::cout << "[" << __PRETTY_FUNCTION__ << ":" << __LINE__ <<
+        "]\tAdding slab " << slab << " of " << m_slabBytes << " bytes." << std::endl;
+#endif
+
+        auto next = reinterpret_cast<std::atomic<uint32_t>*>(memory + m_nextOffset);
+        for (uint64_t i = 0; i < m_buffersPerSlab; ++i)
+        {
+            new (next + i) std::atomic<uint32_t>(0);
+        }
+        m_slabCount.store(slab + 1, std::memory_order_release);
+        m_capacity.store((slab + 1) * m_buffersPerSlab, std::memory_order_release);
+        return true;
+    }
 };
 
 
@@ -201,8 +845,8 @@ class DynamicBufferPool //: public BufferPool
 // passing them to placement new for calling ctors gand getting a T*. The dtors must be handled
 // explicity because of the use of placement new, so a custom deleter for
 // cleaning up objects before returning them to the pool is needed.
-template <typename T, uint64_t PoolItemCount>
-class ObjectPool : public BufferPool<sizeof(T), PoolItemCount>
+template <typename T, uint64_t PoolItemCount, PoolMode Mode = PoolMode::ThreadCaching>
+class ObjectPool : public BufferPool<sizeof(T), PoolItemCount, Mode>
 {
     // Because pointers to other free buffers are kept in the memory for T instances, T must be
     // at least as large as the pointer type that will be used to manage the free list.
@@ -240,17 +884,46 @@ public:
     template <typename ...Args>
     ItemPtr getObject(std::thread::id tid, Args &&...args)
     {
-        if (!this->isExhausted())
+        return getObject(__PRETTY_FUNCTION__, tid, std::forward<Args>(args)...);
+    }
+
+    // This is equivalent to popping a value off of a stack where what's popped is the pointer to the new object.
+    template <typename ...Args>
+    ItemPtr getObject(const char* caller, std::thread::id tid, Args &&...args)
+    {
+        auto newBuffer = this->getRawBuffer(caller, tid);
+        auto newItemPtr = new(newBuffer) T(std::forward<Args>(args)...);
+        return  ItemPtr(newItemPtr, this);
+    }
+
+    auto maxObjectSize() { return this->bufferSize(); }
+};
+
+// DynamicObjectPool - ObjectPool on top of a DynamicBufferPool.
+template <typename T>
+class DynamicObjectPool : public DynamicBufferPool<sizeof(T)>
+{
+    class ObjectDeleter
+    {
+    public:
+        ObjectDeleter() = default;
+        ObjectDeleter(DynamicObjectPool* pool) : m_pool(pool) {}
+
+        void operator()(T* item)
         {
-            auto newBuffer = this->getRawBuffer(tid);
-            auto newItemPtr = new(newBuffer) T(std::forward<Args>(args)...);
-            return  ItemPtr(newItemPtr, this);
+            item->~T();
+            m_pool->releaseBuffer(__PRETTY_FUNCTION__, reinterpret_cast<unsigned char*>(item));
         }
 
-        return std::make_unique<T>(std::forward<Args>(args)...);
-    }
+    private:
+        DynamicObjectPool* m_pool{nullptr};
+    };
+
+public:
+    using ItemPtr = std::unique_ptr<T,  ObjectDeleter>;
+
+    using DynamicBufferPool<sizeof(T)>::DynamicBufferPool;
 
-    // This is equivalent to popping a value off of a stack where what's popped is the pointer to the new object.
     template <typename ...Args>
     ItemPtr getObject(const char* caller, std::thread::id tid, Args &&...args)
     {
@@ -70,12 +70,13 @@ namespace UTILS {
     class QuoteBufferPool
     {
     public:
-        static constexpr uint64_t POOL_SIZE = 1L << 20;
+        static constexpr uint64_t POOL_SIZE = 1L << 20; // max. number of pooled buffers
+        static constexpr uint64_t SLAB_SIZE = 1L << 12; // buffers allocated at a time
         // static QuoteBufferPtr getQuoteBuffer(const char* caller, bool objectPoolDisabled, std::thread::id tid, short size, bool header);
         static QuoteBufferPtr getQuoteBuffer(const char* caller, std::thread::id tid, short size, bool header);
 
     private:
-        static ObjectPool<QuoteBuffer, POOL_SIZE> op;
+        static DynamicObjectPool<QuoteBuffer> op;
     };
 
 }
@@ -225,7 +225,7 @@ public:
 	 * @param condition Condition that determines the result value
 	 * */
 	BoolResult(bool condition)
-			: BoolResult(condition, EMSG_UNSPECIFIED_ERROR) { }
+			: BoolResult(condition, condition ? EMSG_NO_ERROR : EMSG_UNSPECIFIED_ERROR) { } // no allocation on success
 	
 	/**
 	 * Constructing a @a BoolResult from any @a Result<T>
@@ -173,6 +173,8 @@ std::string NewUUID();
 
 int64_t NewInt64Key();
 
+int64_t NewInt64Keys(size_t count);
+
 /*! \brief Returns the index of a vector element.
  *
  * The template function takes references to a vector and an element
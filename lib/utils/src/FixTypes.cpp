@@ -20,7 +20,7 @@ std::map<char, std::string>Side::nameMap = {{ '1',  "BUY" },
 											{ '2',  "SELL" },
 											{ '\0', "INVALID" }, };
 
-ObjectPool<NormalizedMDData, NormalizedMDDataPool::POOL_SIZE> NormalizedMDDataPool::op;
+DynamicObjectPool<NormalizedMDData> NormalizedMDDataPool::op{NormalizedMDDataPool::SLAB_SIZE, NormalizedMDDataPool::POOL_SIZE};
 
 //definitions of static const variables:
 const char QuoteType::BID = '0';
@@ -6,8 +6,8 @@
 
 namespace UTILS {
 namespace MESSAGE {
-    ObjectPool<QuoteData, QuoteDataPool::POOL_SIZE> QuoteDataPool::op;
-    ObjectPool<MDSnapshotData, MDSnapshotDataPool::POOL_SIZE> MDSnapshotDataPool::op;
+    DynamicObjectPool<QuoteData> QuoteDataPool::op{QuoteDataPool::SLAB_SIZE, QuoteDataPool::POOL_SIZE};
+    DynamicObjectPool<MDSnapshotData> MDSnapshotDataPool::op{MDSnapshotDataPool::SLAB_SIZE, MDSnapshotDataPool::POOL_SIZE};
 
     std::atomic<int> IMessageAdapter::m_stSeqNumGenerator;
 } // namespace MESSAGE
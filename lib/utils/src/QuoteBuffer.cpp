@@ -2,7 +2,7 @@
 
 namespace UTILS {
 
-ObjectPool<QuoteBuffer, QuoteBufferPool::POOL_SIZE> QuoteBufferPool::op;
+DynamicObjectPool<QuoteBuffer> QuoteBufferPool::op{QuoteBufferPool::SLAB_SIZE, QuoteBufferPool::POOL_SIZE};
 
 // QuoteBufferPtr QuoteBufferPool::getQuoteBuffer(const char* caller, bool objectPoolDisabled, std::thread::id tid, short size, bool header)
 QuoteBufferPtr QuoteBufferPool::getQuoteBuffer(const char* caller, std::thread::id tid, short size, bool header)
@@ -8,6 +8,7 @@
 #include <dirent.h>
 
 #include <algorithm>
+#include <atomic>
 
 #include "Poco/DOM/DOMParser.h"
 #include "Poco/DOM/NodeList.h"
@@ -463,19 +464,34 @@ void SleepForMicroseconds(long us)
  */
 int64_t NewInt64Key()
 {
-	static int64_t lastKey { 0 };
-	static std::mutex mtx;
-	std::lock_guard lock { mtx };
-	int64_t currentKey { CurrentTimestamp() };
-	if (currentKey <= lastKey)
-	{
-		++lastKey;
-	}
-	else
+	return NewInt64Keys(1);
+}
+
+/*! \brief Returns the first of @a count new consecutive 64bit integer keys.
+ *
+ * The keys first .. first + @a count - 1 are reserved at once, so they are
+ * unique and ascending like the keys returned by NewInt64Key().
+ *
+ * Lock-free: the last key handed out is raised to the reserved block with a
+ * compare-and-swap (a fetch-max seeded by the clock), so threads generating
+ * keys do not serialise on a mutex; a thread that loses the race retries
+ * above the key taken by the winner.
+ *
+ * @param count Number of keys (at least 1)
+ * @return First key
+ */
+int64_t NewInt64Keys(size_t count)
+{
+	static std::atomic<int64_t> lastKey { 0 };
+	const int64_t now { CurrentTimestamp() };
+	const int64_t n { int64_t(std::max<size_t>(count, 1)) };
+	int64_t last { lastKey.load(std::memory_order_relaxed) };
+	int64_t first;
+	do
 	{
-		lastKey = currentKey;
-	}
-	return lastKey;
+		first = std::max(now, last + 1);
+	} while (!lastKey.compare_exchange_weak(last, first + n - 1, std::memory_order_relaxed));
+	return first;
 }
 
 XmlDocPtr GetConfigDoc(const std::string &configPath, std::string *errorMessage)
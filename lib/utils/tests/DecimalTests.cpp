@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include "Utils/Decimal.h"
+
+namespace TEST {
+using namespace UTILS;
+
+namespace {
+constexpr int64_t FACTOR = 100'000'000; // 8 decimals
+} // anon ns
+
+//--------------------------------------------------------------------------
+TEST(ParseDecimal, Test_Exact)
+{
+	ASSERT_EQ(1'685'012'000'000, ParseDecimal("16850.12000000", FACTOR));
+	ASSERT_EQ(1'685'012'000'000, ParseDecimal("16850.12", FACTOR));
+	ASSERT_EQ(-50'000'000, ParseDecimal("-0.5", FACTOR));
+	ASSERT_EQ(0, ParseDecimal("0", FACTOR));
+	ASSERT_EQ(0, ParseDecimal("-0.0", FACTOR));
+	ASSERT_EQ(1, ParseDecimal("0.00000001", FACTOR));
+	ASSERT_EQ(12'345'678'900'000'000, ParseDecimal("123456789", FACTOR)); // 8 digits at a time and the rest
+	ASSERT_EQ(123'456'789'012'345'678, ParseDecimal("1234567890.12345678", FACTOR)); // 18 digits
+	ASSERT_EQ(500, ParseDecimal("5.", 100));
+}
+
+//--------------------------------------------------------------------------
+TEST(ParseDecimal, Test_RoundingBeyondTheFactor)
+{
+	// more decimals than the factor: rounded half away from zero, exactly
+	ASSERT_EQ(13, ParseDecimal("0.125", 100));
+	ASSERT_EQ(-13, ParseDecimal("-0.125", 100));
+	ASSERT_EQ(12, ParseDecimal("0.1249999", 100));
+	ASSERT_EQ(268, ParseDecimal("2.675", 100)); // 2.675 is 2.67499999... as a double
+	ASSERT_EQ(1, ParseDecimal("0.000000005", FACTOR));
+	ASSERT_EQ(0, ParseDecimal("0.000000004999", FACTOR));
+	ASSERT_EQ(2, ParseDecimal("1.5", 1));
+}
+
+//--------------------------------------------------------------------------
+TEST(ParseDecimal, Test_MoreThanMaxDigits)
+{
+	// more than DECIMAL::MAX_DIGITS digits are converted through double
+	ASSERT_EQ(12'345'679, ParseDecimal("0.1234567890123456789", FACTOR));
+	ASSERT_EQ(100'000'000'000, ParseDecimal("1000.0000000000000000001", FACTOR));
+	ASSERT_EQ(-100'000'000'000, ParseDecimal("-1000.0000000000000000001", FACTOR));
+}
+
+//--------------------------------------------------------------------------
+TEST(ParseDecimal, Test_Exponents)
+{
+	ASSERT_EQ(15'000'000'000, ParseDecimal("1.5e2", FACTOR));
+	ASSERT_EQ(15'000'000'000, ParseDecimal("1.5E+2", FACTOR));
+	ASSERT_EQ(25'000, ParseDecimal("2.5e-4", FACTOR));
+	ASSERT_EQ(-3'000'000, ParseDecimal("-3e-2", FACTOR));
+	ASSERT_FALSE(ParseDecimal("1e", FACTOR));
+	ASSERT_FALSE(ParseDecimal("1e+", FACTOR));
+}
+
+//--------------------------------------------------------------------------
+TEST(ParseDecimal, Test_Overflow)
+{
+	ASSERT_EQ(92'233'720'368'000'000, ParseDecimal("922337203.68", FACTOR));
+	ASSERT_FALSE(ParseDecimal("100000000000", FACTOR)); // 1e19 does not fit
+	ASSERT_FALSE(ParseDecimal("-100000000000", FACTOR));
+	ASSERT_FALSE(ParseDecimal("92233720368.547758075", FACTOR)); // rounded beyond the factor
+	ASSERT_FALSE(ParseDecimal("1e300", FACTOR));
+	ASSERT_FALSE(ParseDecimal("123456789012345678901234567890", FACTOR)); // more digits and too large
+}
+
+//--------------------------------------------------------------------------
+TEST(ParseDecimal, Test_NotANumber)
+{
+	ASSERT_FALSE(ParseDecimal("", FACTOR));
+	ASSERT_FALSE(ParseDecimal("-", FACTOR));
+	ASSERT_FALSE(ParseDecimal(".", FACTOR));
+	ASSERT_FALSE(ParseDecimal("+1", FACTOR));
+	ASSERT_FALSE(ParseDecimal("1-2", FACTOR));
+	ASSERT_FALSE(ParseDecimal("1.2.3", FACTOR));
+	ASSERT_FALSE(ParseDecimal(" 1", FACTOR));
+	ASSERT_FALSE(ParseDecimal("1 ", FACTOR));
+	ASSERT_FALSE(ParseDecimal("abc", FACTOR));
+	ASSERT_FALSE(ParseDecimal("nan", FACTOR));
+}
+
+} // namespace TEST
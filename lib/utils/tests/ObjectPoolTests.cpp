@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "Utils/ObjectPool.h"
+
+namespace TEST {
+using namespace UTILS;
+
+namespace {
+constexpr uint64_t BUFFER_SIZE = 64;
+
+using CachingPool = BufferPool<BUFFER_SIZE, 2 * POOL_BATCH_SIZE>;
+using LockedPool = BufferPool<BUFFER_SIZE, 2 * POOL_BATCH_SIZE, PoolMode::Locked>;
+
+struct Item
+{
+	explicit Item(uint64_t value) : first(value), last(value) { }
+
+	uint64_t first;
+	char payload[40];
+	uint64_t last;
+};
+} // anon ns
+
+//--------------------------------------------------------------------------
+TEST(BufferPool, Test_ThreadCaching_IsTheDefault)
+{
+	static_assert(std::is_same_v<BufferPool<BUFFER_SIZE, 1>, BufferPool<BUFFER_SIZE, 1, PoolMode::ThreadCaching>>);
+}
+
+//--------------------------------------------------------------------------
+TEST(BufferPool, Test_ThreadCaching_ExhaustionCounters)
+{
+	// Arrange
+	CachingPool pool;
+	std::vector<CachingPool::BufferPtr> buffers;
+	std::set<unsigned char*> distinct;
+
+	// Act
+	for (uint32_t i = 0; i < 2 * POOL_BATCH_SIZE; ++i)
+	{
+		buffers.push_back(pool.getBuffer(std::this_thread::get_id()));
+		distinct.insert(buffers.back().get());
+	}
+	const bool exhaustedAtCapacity = pool.isExhausted();
+	buffers.push_back(pool.getBuffer(std::this_thread::get_id()));
+	buffers.push_back(pool.getBuffer(std::this_thread::get_id()));
+
+	// Check
+	ASSERT_EQ(2 * POOL_BATCH_SIZE, distinct.size());
+	ASSERT_TRUE(exhaustedAtCapacity);
+	ASSERT_EQ(2, pool.exhaustedCount());
+	ASSERT_EQ(2 * POOL_BATCH_SIZE, pool.buffersInUse());
+	ASSERT_EQ(2 * POOL_BATCH_SIZE, pool.highWaterMark());
+
+	// the heap buffers go back to the heap, the pool buffers to the pool
+	buffers.clear();
+	ASSERT_EQ(0, pool.buffersInUse());
+	ASSERT_FALSE(pool.isExhausted());
+}
+
+//--------------------------------------------------------------------------
+TEST(BufferPool, Test_ThreadCaching_MagazineFlushedOnThreadExit)
+{
+	// Arrange - a thread takes every buffer and releases them into its magazine
+	CachingPool pool;
+	std::thread worker([&pool]()
+	{
+		std::vector<CachingPool::BufferPtr> buffers;
+		for (uint32_t i = 0; i < 2 * POOL_BATCH_SIZE; ++i)
+		{
+			buffers.push_back(pool.getBuffer(std::this_thread::get_id()));
+		}
+	});
+	worker.join();
+
+	// Act - the buffers cached by the thread are back in the pool
+	std::vector<CachingPool::BufferPtr> buffers;
+	for (uint32_t i = 0; i < 2 * POOL_BATCH_SIZE; ++i)
+	{
+		buffers.push_back(pool.getBuffer(std::this_thread::get_id()));
+	}
+
+	// Check
+	ASSERT_EQ(0, pool.exhaustedCount());
+	ASSERT_EQ(2 * POOL_BATCH_SIZE, pool.buffersInUse());
+}
+
+//--------------------------------------------------------------------------
+TEST(BufferPool, Test_ThreadCaching_CrossThreadRelease)
+{
+	// Arrange
+	CachingPool pool;
+	std::vector<CachingPool::BufferPtr> buffers;
+	std::thread producer([&]()
+	{
+		for (uint32_t i = 0; i < 2 * POOL_BATCH_SIZE; ++i)
+		{
+			buffers.push_back(pool.getBuffer(std::this_thread::get_id()));
+		}
+	});
+	producer.join();
+
+	// Act - released by another thread than the one that allocated them
+	std::thread consumer([&buffers]() { buffers.clear(); });
+	consumer.join();
+
+	// Check
+	ASSERT_EQ(0, pool.buffersInUse());
+	for (uint32_t i = 0; i < 2 * POOL_BATCH_SIZE; ++i)
+	{
+		buffers.push_back(pool.getBuffer(std::this_thread::get_id()));
+	}
+	ASSERT_EQ(0, pool.exhaustedCount());
+}
+
+//--------------------------------------------------------------------------
+TEST(BufferPool, Test_Locked_ExhaustionCounters)
+{
+	// Arrange
+	LockedPool pool;
+	std::vector<LockedPool::BufferPtr> buffers;
+
+	// Act
+	for (uint32_t i = 0; i < 2 * POOL_BATCH_SIZE + 1; ++i)
+	{
+		buffers.push_back(pool.getBuffer(std::this_thread::get_id()));
+	}
+
+	// Check
+	ASSERT_TRUE(pool.isExhausted());
+	ASSERT_EQ(1, pool.exhaustedCount());
+	ASSERT_EQ(2 * POOL_BATCH_SIZE, pool.buffersInUse());
+	buffers.clear();
+	ASSERT_EQ(0, pool.buffersInUse());
+	ASSERT_EQ(2 * POOL_BATCH_SIZE, pool.highWaterMark());
+}
+
+//--------------------------------------------------------------------------
+TEST(DynamicBufferPool, Test_GrowsUpToTheCeiling)
+{
+	// Arrange - slabs of 64 buffers, at most 4 slabs
+	DynamicObjectPool<Item> pool(2 * POOL_BATCH_SIZE, 8 * POOL_BATCH_SIZE);
+	std::vector<DynamicObjectPool<Item>::ItemPtr> items;
+	ASSERT_EQ(1, pool.slabCount());
+
+	// Act
+	for (uint64_t i = 0; i < 8 * POOL_BATCH_SIZE + 3; ++i)
+	{
+		items.push_back(pool.getObject(__PRETTY_FUNCTION__, std::this_thread::get_id(), i));
+	}
+
+	// Check
+	ASSERT_EQ(4, pool.slabCount());
+	ASSERT_EQ(3, pool.growCount());
+	ASSERT_TRUE(pool.isExhausted());
+	ASSERT_EQ(3, pool.exhaustedCount());
+	ASSERT_EQ(8 * POOL_BATCH_SIZE, pool.buffersInUse());
+	for (uint64_t i = 0; i < items.size(); ++i)
+	{
+		ASSERT_EQ(i, items[i]->first);
+		ASSERT_EQ(i, items[i]->last);
+	}
+
+	// released buffers are reused, the pool does not grow further
+	items.clear();
+	ASSERT_EQ(0, pool.buffersInUse());
+	for (uint64_t i = 0; i < 8 * POOL_BATCH_SIZE; ++i)
+	{
+		items.push_back(pool.getObject(__PRETTY_FUNCTION__, std::this_thread::get_id(), i));
+	}
+	ASSERT_EQ(3, pool.growCount());
+	ASSERT_EQ(3, pool.exhaustedCount());
+}
+
+//--------------------------------------------------------------------------
+TEST(DynamicBufferPool, Test_ConcurrentThreads)
+{
+	// Arrange
+	constexpr uint64_t threadCount = 8;
+	constexpr uint64_t rounds = 20000;
+	DynamicObjectPool<Item> pool(POOL_BATCH_SIZE, 1 << 16);
+	std::vector<DynamicObjectPool<Item>::ItemPtr> handedOver;
+	std::mutex handedOverMutex;
+	std::atomic<uint64_t> corrupted{0};
+
+	// Act - every thread keeps a window of items, checks that no other thread wrote to them and
+	// passes some of them to other threads to be released there
+	std::vector<std::thread> threads;
+	for (uint64_t t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			std::vector<DynamicObjectPool<Item>::ItemPtr> items;
+			for (uint64_t r = 0; r < rounds; ++r)
+			{
+				const uint64_t value = (t << 32) | r;
+				items.push_back(pool.getObject(__PRETTY_FUNCTION__, std::this_thread::get_id(), value));
+				if (items.size() == 100)
+				{
+					for (const auto &item : items)
+					{
+						if (item->first != item->last || (item->first >> 32) != t)
+						{
+							++corrupted;
+						}
+					}
+					std::lock_guard<std::mutex> lck(handedOverMutex);
+					handedOver.clear();
+					for (uint64_t i = 0; i < 50; ++i)
+					{
+						handedOver.push_back(std::move(items[i]));
+					}
+					items.erase(items.begin(), items.begin() + 50);
+				}
+			}
+		});
+	}
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+	handedOver.clear();
+
+	// Check
+	ASSERT_EQ(0, corrupted);
+	ASSERT_EQ(0, pool.exhaustedCount());
+	ASSERT_EQ(0, pool.buffersInUse());
+}
+
+} // namespace TEST
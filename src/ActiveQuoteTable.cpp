@@ -10,8 +10,17 @@ namespace CORE {
 //static
 size_t ActiveQuoteTable::CalculateHashValue(const UTILS::NormalizedMDData::Entry &entry)
 {
-	std::hash<double> dblHash;
-	size_t result { dblHash(entry.volume) ^ dblHash(entry.price) ^ dblHash(entry.minQty) };
+	size_t result;
+	if (entry.fixedPoint)
+	{
+		std::hash<int64_t> intHash;
+		result = intHash(entry.qtyVolume) ^ intHash(entry.cpipPrice) ^ intHash(entry.qtyMinQty);
+	}
+	else
+	{
+		std::hash<double> dblHash;
+		result = dblHash(entry.volume) ^ dblHash(entry.price) ^ dblHash(entry.minQty);
+	}
 	if (!entry.quoteId.empty()) // if quote ID is set -> include in hash value
 	{
 		std::hash<std::string> strHash;
@@ -24,64 +33,49 @@ size_t ActiveQuoteTable::CalculateHashValue(const UTILS::NormalizedMDData::Entry
 bool ActiveQuoteTable::Empty() const
 {
 	std::shared_lock lock { m_activeQuoteMap.Mutex() };
-	return m_activeQuoteMap->empty();
+	return m_activeQuoteMap->Empty();
 }
 
 
-bool ActiveQuoteTable::FindQuoteInfo(const std::string &refId, QuoteInfo &quoteInfo)
+bool ActiveQuoteTable::FindQuoteInfo(const QuoteId &id, QuoteInfo &quoteInfo) const
 {
-	bool result { false };
 	std::shared_lock lock { m_activeQuoteMap.Mutex() };
-	if (!refId.empty())
+	const QuoteInfo *info { m_activeQuoteMap->Find(id) };
+	if (info)
 	{
-		const auto &it { m_activeQuoteMap->find(refId) };
-		if (it != m_activeQuoteMap->end())
-		{
-			quoteInfo = *it->second;
-			result = true;
-		}
+		quoteInfo = *info;
 	}
-	return result;
+	return info != nullptr;
 }
 
 
-ActiveQuoteTable::QuoteInfoPtr ActiveQuoteTable::ReplaceQuoteInfoAt(QuoteMap::iterator it, const std::string &newId, QuoteInfoPtr &&newQuote)
+std::optional<ActiveQuoteTable::QuoteInfo> ActiveQuoteTable::ReplaceQuoteInfoAt(const QuoteId &id, const QuoteInfo &newQuote)
 {
-	ActiveQuoteTable::QuoteInfoPtr lastQuote { nullptr };
-	if (it != m_activeQuoteMap->end())
+	std::optional<QuoteInfo> lastQuote;
+	if (QuoteInfo *info { m_activeQuoteMap->Find(id) })
 	{
-		lastQuote = std::move(it->second); // save replaced entry
-		it->second = std::move(newQuote); // replace quote info
-		if (newId != it->first) // new ID -> replace map key:
-		{
-			auto nh { m_activeQuoteMap->extract(it) };
-			nh.key() = newId;
-			m_activeQuoteMap->insert(move(nh));
-		}
+		lastQuote = *info; // save replaced entry
+		*info = newQuote; // replace quote info
 	}
-	else // Ref ID not found -> create new entry
+	else // not active -> create new entry
 	{
-		m_activeQuoteMap->emplace(newId, std::move(newQuote));
+		m_activeQuoteMap->Insert(id, newQuote);
 	}
 	return lastQuote;
 }
 
 
-ActiveQuoteTable::QuoteInfoPtr ActiveQuoteTable::RemoveQuoteInfo(const std::string &refId)
+std::optional<ActiveQuoteTable::QuoteInfo> ActiveQuoteTable::RemoveQuoteInfo(const QuoteId &id)
 {
-	QuoteInfoPtr lastQuote { nullptr };
+	std::optional<QuoteInfo> lastQuote;
 
 	std::unique_lock lock { m_activeQuoteMap.Mutex() };
-	if (!refId.empty())
+	if (const QuoteInfo *info { m_activeQuoteMap->Find(id) })
 	{
-		const auto &it { m_activeQuoteMap->find(refId) };
-		if (it != m_activeQuoteMap->end())
-		{
-			lastQuote = std::move(it->second);
-			m_activeQuoteMap->erase(it);
-		}
+		lastQuote = *info;
+		m_activeQuoteMap->Erase(id);
 	}
 	return lastQuote;
 }
 
-}
\ No newline at end of file
+}
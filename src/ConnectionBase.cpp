@@ -10,13 +10,6 @@
 using namespace UTILS;
 using namespace Poco;
 
-namespace {
-std::string GenerateStandardEntryId(const UTILS::CurrencyPair &cp, UTILS::QuoteType entryType, const std::string &price)
-{
-	return UTILS::Format("%s_%c%s", cp.ToString(), entryType.Bid() ? 'B' : 'A', price);
-}
-}
-
 namespace CORE {
 namespace CRYPTO {
 ConnectionBase::ConnectionBase(const CRYPTO::Settings &settings, const std::string &loggingPropsPath, const std::string &loggerName, const ConnectionManager& connectionManager)
@@ -57,21 +50,34 @@ BoolResult ConnectionBase::Connect()
 		m_listenerThread = std::make_unique<std::thread>([this]()
 														 {
 															 int exceptionCounter = 0;
+															 bool ringExhausted = false;
 															 while (m_connected)
 															 {
 																 try
 																 {
-																	 memset(m_buffer, 0, sizeof(m_buffer));
+																	 // frames are received straight into a free slot of the ring and indexed there
+																	 const std::optional<size_t> slot { m_receiveRing.Acquire() };
+																	 if (!slot && !ringExhausted)
+																	 {
+																		 poco_warning_f1(logger(), "All %s receive slots are in use, frames are copied until one is released",
+																						 std::to_string(m_receiveRing.Slots()));
+																	 }
+																	 ringExhausted = !slot;
+																	 if (!slot && !m_spareBuffer)
+																	 {
+																		 m_spareBuffer.reset(new char[MAX_BUFF]);
+																	 }
+																	 char *const buffer { slot ? m_receiveRing.Buffer(*slot) : m_spareBuffer.get() };
 																	 int flags { };
 																	 const auto bytes =
-																			 ReceiveWebSocketData(m_ws.get(), m_buffer, sizeof(m_buffer), flags);
-					
+																			 ReceiveWebSocketData(m_ws.get(), buffer, MAX_BUFF, flags);
+
 																	 // Process ping/pong
 																	 using namespace Poco::Net;
 																	 if ((flags & WebSocket::FRAME_OP_BITMASK) == WebSocket::FRAME_OP_PING)
 																	 {
 																		 poco_information(logger(), "received PING");
-																		 m_ws->sendFrame(m_buffer, 1,
+																		 m_ws->sendFrame(buffer, 1,
 																						 WebSocket::FRAME_FLAG_FIN | WebSocket::FRAME_OP_PONG);
 																		 poco_information(logger(), "sent successfully");
 																		 continue;
@@ -82,30 +88,37 @@ BoolResult ConnectionBase::Connect()
 																		 continue;
 																	 }
 
-																 	 if ((flags & WebSocket::FRAME_OP_BITMASK) == WebSocket::FRAME_OP_CLOSE)
-																 	 {
+																	 if ((flags & WebSocket::FRAME_OP_BITMASK) == WebSocket::FRAME_OP_CLOSE)
+																	 {
 																		 poco_error(logger(), "socket closed at source...");
-																 	  	 m_connected=false;
+																		 m_connected=false;
 																		 return;
 																	 }
 
 																	 // Processing bytes
 																	 if (bytes)
 																	 {
-																		 const auto res = GetMessageProcessor().ProcessMessage(
-																				 std::make_shared<CRYPTO::JSONDocument>(m_buffer));
+																		 const auto message = slot ? m_receiveRing.Commit(*slot, size_t(bytes))
+																								   : std::make_shared<CRYPTO::JSONDocument>(std::string(buffer, size_t(bytes)));
+																		 const uint64_t dropped { GetMessageProcessor().DroppedCount() };
+																		 const auto res = GetMessageProcessor().ProcessMessage(message);
 																		 if (!res)
 																		 {
 																			 poco_error_f2(logger(), "Message processor error: %s [buffer='%s']",
-																						   res.ErrorMessage(), std::string(m_buffer));
+																						   res.ErrorMessage(), std::string(message->Text()));
+																			 if (GetMessageProcessor().DroppedCount() != dropped)
+																			 {
+																				 Resubscribe(); // the books miss the dropped message
+																			 }
 																		 }
-																		 
-																		 m_logger.Protocol().Incoming(m_buffer);
+
+																		 m_logger.Protocol().Incoming(message->Text());
 																	 }
 																	 else
 																	 {
 																		 break;
 																	 }
+
 																	 m_lastMessageTime.store(UTILS::CurrentTimestamp());
 																	 exceptionCounter = 0;
 																 }
@@ -130,9 +143,8 @@ BoolResult ConnectionBase::Connect()
 		m_logger.Session().Start(m_settings.m_name);
 		poco_information_f1(logger(), "Session started: %s", m_settings.m_name);
 
-		const auto instruments = GetInstruments();
-		Subscribe(instruments);
-		Snapshot(instruments);
+		// the venue is registered first, so the quotes of the session are attributed to it from the first one on
+		Start();
 	}
 	else
 	{
@@ -191,7 +203,7 @@ bool ConnectionBase::Send(const std::string &payload)
 UTILS::BoolResult ConnectionBase::PublishQuote(int64_t key, int64_t refKey, int64_t timestamp,
 															 int64_t receiveTime, UTILS::CurrencyPair cp, const UTILS::NormalizedMDData::Entry &entry)
 {
-	m_connectionManager.GetOrderBook()->AddEntry(key, refKey, timestamp, receiveTime, cp, entry);
+	m_connectionManager.GetOrderBook()->AddEntry(key, refKey, timestamp, receiveTime, cp, entry, m_venue.load(std::memory_order_relaxed));
 
 	return true;
 }
@@ -211,6 +223,123 @@ ConnectionBase::TInstruments ConnectionBase::GetInstruments() const
 	return instruments;
 }
 
+//------------------------------------------------------------------------------
+void ConnectionBase::RegisterVenue()
+{
+	const int venue = m_connectionManager.GetOrderBook()->RegisterVenue(m_settings.m_name);
+	m_venue.store(std::max(venue, 0), std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+void ConnectionBase::SetUpdateId(UTILS::CurrencyPair cp, int64_t updateId) const
+{
+	m_connectionManager.GetOrderBook()->SetUpdateId(cp, updateId);
+}
+
+//------------------------------------------------------------------------------
+int64_t ConnectionBase::RestoreQuotes(UTILS::CurrencyPair cp)
+{
+	const auto orderBook = m_connectionManager.GetOrderBook();
+	const int venue = m_venue.load(std::memory_order_relaxed);
+	orderBook->ClaimRestoredQuotes(cp, venue); // the session maintains them from now on
+	size_t count = 0;
+	for (bool bid: { true, false })
+	{
+		const QuoteType entryType(bid ? QuoteType::BID : QuoteType::OFFER);
+		orderBook->IterateQuotes(cp, bid, [this, cp, venue, &entryType, &count](const BOOK::Quote &quote, bool &)
+		{
+			if (quote.Venue() == venue)
+			{
+				// identified by the price in the book's units, so the quotes restored from a book snapshot match the feed's
+				m_activeQuoteTable.ReplaceQuoteInfo(ActiveQuoteTable::MakeQuoteId(cp, entryType, quote.Price()), quote.Key(), cp, entryType);
+				++count;
+			}
+		});
+	}
+	poco_information_f3(logger(), "Session %s: %s quotes of %s restored from the order book", m_settings.m_name, std::to_string(count),
+						cp.ToString());
+	return count > 0 ? orderBook->GetUpdateId(cp) : 0;
+}
+
+//------------------------------------------------------------------------------
+void ConnectionBase::RemoveQuotes(UTILS::CurrencyPair cp)
+{
+	NormalizedMDData::Ptr nmd { std::make_shared<NormalizedMDData>() };
+	const int venue = m_venue.load(std::memory_order_relaxed);
+	for (bool bid: { true, false })
+	{
+		const QuoteType entryType(bid ? QuoteType::BID : QuoteType::OFFER);
+		m_connectionManager.GetOrderBook()->IterateQuotes(cp, bid, [cp, venue, &entryType, &nmd](const BOOK::Quote &quote, bool &)
+		{
+			if (quote.Venue() == venue)
+			{
+				NormalizedMDData::Entry &entry = nmd->entries.emplace_back();
+				entry.entryType = entryType;
+				entry.instrument = cp;
+				entry.cpipPrice = quote.Price();
+				entry.fixedPoint = true;
+				entry.updateType = QT_DELETE;
+			}
+		});
+	}
+	if (!nmd->entries.empty())
+	{
+		PublishQuotes(nmd);
+	}
+}
+
+//------------------------------------------------------------------------------
+void ConnectionBase::PrepareInstruments(const TInstruments &instruments)
+{
+	// the feed sends the full book on subscription, so the quotes the session had before are removed
+	for (const auto &instrument: instruments)
+	{
+		const UTILS::CurrencyPair cp(TranslateSymbol(instrument));
+		if (cp.Valid())
+		{
+			RestoreQuotes(cp);
+			RemoveQuotes(cp);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+void ConnectionBase::RegisterInstruments(const TInstruments &instruments) const
+{
+	for (const auto &instrument: instruments)
+	{
+		const UTILS::CurrencyPair cp(TranslateSymbol(instrument));
+		if (cp.Valid())
+		{
+			m_connectionManager.GetOrderBook()->RegisterInstrument(cp);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+void ConnectionBase::StartInstruments(const TInstruments &instruments)
+{
+	RegisterInstruments(instruments);
+	// prepared before the stream is subscribed, so the first message of an instrument finds its state
+	const auto result = m_messageProcessor.Run([this, instruments]() { PrepareInstruments(instruments); });
+	if (!result)
+	{
+		poco_error_f2(logger(), "Session %s: instruments not prepared: %s", m_settings.m_name, result.ErrorMessage());
+	}
+	Subscribe(instruments);
+	Snapshot(instruments);
+}
+
+//------------------------------------------------------------------------------
+void ConnectionBase::Resubscribe()
+{
+	const auto instruments = GetInstruments();
+	poco_warning_f2(logger(), "Session %s: resubscribing %s instruments to rebuild their books", m_settings.m_name,
+					std::to_string(instruments.size()));
+	Unsubscribe(instruments);
+	StartInstruments(instruments); // waits for the message processor to work off the queue
+}
+
 //------------------------------------------------------------------------------
 UTILS::BoolResult ConnectionBase::SubscribeInstrument(const std::string &symbol)
 {
@@ -229,9 +358,7 @@ UTILS::BoolResult ConnectionBase::SubscribeInstrument(const std::string &symbol)
 	// Update config
 	m_settings.m_instruments += (m_settings.m_instruments.empty() ? "" : ",") + instStr;
 	
-	// Request snapshot and subscribe
-	Snapshot({ instStr });
-	Subscribe({ instStr });
+	StartInstruments({ instStr });
 	return true;
 }
 
@@ -277,29 +404,55 @@ int ConnectionBase::ReceiveWebSocketData(Poco::Net::WebSocket *ws, char *buffer,
 
 
 //------------------------------------------------------------------------------
-UTILS::NormalizedMDData::Ptr ConnectionBase::ParseQuote(CORE::CRYPTO::PriceMessage::Levels &levels, const char side, const std::string &instrument)
+UTILS::NormalizedMDData::Ptr ConnectionBase::ParseQuote(const CORE::CRYPTO::PriceMessage::Levels &levels, const char side, const std::string &instrument)
 {
-	NormalizedMDData::Ptr nmd { std::make_unique<NormalizedMDData>() };
-	NormalizedMDData::Entry *entry;
+	// the entries are allocated from the same arena as the levels, i.e. the arena of their message
+	std::pmr::memory_resource *const arena { levels.get_allocator().resource() };
+	NormalizedMDData::Ptr nmd { std::allocate_shared<NormalizedMDData>(std::pmr::polymorphic_allocator<NormalizedMDData>(arena), arena) };
+	nmd->entries.reserve(levels.size());
+	AppendQuotes(*nmd, levels, side, GetCurrencyPair(instrument));
+	return nmd;
+}
+
+//------------------------------------------------------------------------------
+UTILS::NormalizedMDData::Ptr ConnectionBase::ParseQuotes(const CORE::CRYPTO::PriceMessage &msg, const std::string &instrument)
+{
+	std::pmr::memory_resource *const arena { msg.Bids.get_allocator().resource() };
+	NormalizedMDData::Ptr nmd { std::allocate_shared<NormalizedMDData>(std::pmr::polymorphic_allocator<NormalizedMDData>(arena), arena) };
+	nmd->entries.reserve(msg.Bids.size() + msg.Asks.size());
+	const CurrencyPair cp { GetCurrencyPair(instrument) };
+	AppendQuotes(*nmd, msg.Bids, QuoteType::BID, cp);
+	AppendQuotes(*nmd, msg.Asks, QuoteType::OFFER, cp);
+	return nmd;
+}
+
+//------------------------------------------------------------------------------
+void ConnectionBase::AppendQuotes(NormalizedMDData &nmd, const CORE::CRYPTO::PriceMessage::Levels &levels, const char side, CurrencyPair cp)
+{
+	const int64_t cpipFactor { cp.CpipFactor() }, qtyFactor { cp.QtyFactor() };
+	const QuoteType entryType(side);
 	
-	nmd->entries.resize(levels.size());
+	// prices and sizes are converted from their decimal text to cpips/quantity units directly (no double in between)
 	BidAskPair<int64_t> currentLevel { 0, 0 };
-	for (size_t i { 0 }; i < levels.size(); ++i)
+	for (const auto &level: levels)
 	{
-		entry = &(nmd->entries[i]);
-		entry->entryType = side;
-		
-		bool bid { entry->entryType.Bid() };
-
-		entry->instrument = GetCurrencyPair(instrument);
-		entry->price = std::stod(levels[i]->price);
-		entry->volume = std::stod(levels[i]->size);
-		entry->updateType = (entry->volume == 0) ? QT_DELETE : QT_NEW;
-		entry->refId = entry->id = GenerateStandardEntryId(entry->instrument, entry->entryType, levels[i]->price);
-		entry->quoteId = "";
-		entry->positionNo = currentLevel.Get(bid);
+		const std::optional<int64_t> price { ParseDecimal(level.price, cpipFactor) };
+		const std::optional<int64_t> volume { ParseDecimal(level.size, qtyFactor) };
+		if (!price || !volume)
+		{
+			poco_error_f3(logger(), "Session %ld - ERROR: Invalid level '%s'@'%s' -> LEVEL SKIPPED", GetSettings().m_numId, std::string(level.size),
+						  std::string(level.price));
+			continue;
+		}
+		NormalizedMDData::Entry &entry { nmd.entries.emplace_back() };
+		entry.entryType = entryType;
+		entry.instrument = cp;
+		entry.cpipPrice = *price;
+		entry.qtyVolume = *volume;
+		entry.fixedPoint = true;
+		entry.updateType = (entry.qtyVolume == 0) ? QT_DELETE : QT_NEW;
+		entry.positionNo = currentLevel.Get(entryType.Bid());
 	}
-	return nmd;
 }
 
 //------------------------------------------------------------------------------
@@ -307,57 +460,42 @@ void ConnectionBase::PublishQuotes(UTILS::NormalizedMDData::Ptr nmd)
 {
 	if (nmd)
 	{
-		int64_t key { 0 }, refKey { 0 };
-		ActiveQuoteTable::QuoteInfoPtr replacedQuoteRef;
+		int64_t refKey { 0 };
+		std::optional<ActiveQuoteTable::QuoteInfo> replacedQuoteRef;
 
 		const size_t cnt { nmd->entries.size() };
 		uint64_t sequenceTag { std::hash<std::string>()("") };
+		if (cnt == 0)
+		{
+			return;
+		}
 
-		for (size_t i { 0 }; i < cnt; ++i)
+		// keys and timestamps are assigned to the whole message at once, and the book applies it as one change
+		int64_t key { NewInt64Keys(cnt) };
+		const int64_t timestamp { CurrentTimestamp() };
+		std::pmr::vector<BOOK::OrderBook::BatchEntry> batch(nmd->entries.get_allocator().resource());
+		batch.reserve(cnt);
+
+		for (size_t i { 0 }; i < cnt; ++i, ++key)
 		{
 			NormalizedMDData::Entry &entry { nmd->entries[i] };
 			entry.endOfMessage = (i == cnt - 1);
 			entry.sequenceTag = sequenceTag;
 			CurrencyPair cp = entry.instrument;
-			if ((!entry.entryType.Valid() || !cp.Valid())) //no entry type with UPDATEs and DELETEs -> lookup entry and guess type
+			if (!entry.entryType.Valid() || !cp.Valid()) // quotes are identified by instrument, side and price
 			{
-				if (!entry.refId.empty())
-				{
-					ActiveQuoteTable::QuoteInfo quoteInfo;
-					if (m_activeQuoteTable.FindQuoteInfo(entry.refId, quoteInfo))
-					{
-						if (!cp.Valid())
-						{
-							cp = quoteInfo.cp;
-						}
-						if (!entry.entryType.Valid())
-						{
-							entry.entryType = quoteInfo.entryType;
-						}
-					}
-					else
-					{
-						poco_error_f3(logger(), "Session %ld - ERROR: No quote info found for entry '%s'->'%s' -> QUOTE SKIPPED", GetSettings().m_numId, entry.id,
-									  entry.refId);
-						continue;
-					}
-				}
-				else
-				{
-					poco_error_f3(logger(), "Session %ld - ERROR: No entry type and/or symbol and no ref ID in entry '%s'-> '%s' -> QUOTE SKIPPED",
-								  GetSettings().m_numId, entry.id, entry.refId);
-					continue;
-				}
+				poco_error_f1(logger(), "Session %ld - ERROR: No entry type and/or symbol in entry -> QUOTE SKIPPED", GetSettings().m_numId);
+				continue;
 			}
+			const auto quoteId { ActiveQuoteTable::MakeQuoteId(cp, entry.entryType, entry.fixedPoint ? entry.cpipPrice : cp.DblToCpip(entry.price)) };
 
-			key = NewInt64Key();
 			if (entry.updateType == QT_DELETE)
 			{
-				replacedQuoteRef = entry.refId.empty() ? nullptr : m_activeQuoteTable.RemoveQuoteInfo(entry.refId);
+				replacedQuoteRef = m_activeQuoteTable.RemoveQuoteInfo(quoteId);
 			}
 			else
 			{
-				replacedQuoteRef = m_activeQuoteTable.ReplaceQuoteInfo(entry.refId, entry.id, key, cp, entry.entryType);
+				replacedQuoteRef = m_activeQuoteTable.ReplaceQuoteInfo(quoteId, key, cp, entry.entryType);
 			}
 			if (replacedQuoteRef)
 			{
@@ -371,8 +509,9 @@ void ConnectionBase::PublishQuotes(UTILS::NormalizedMDData::Ptr nmd)
 			{
 				if (entry.updateType == QT_DELETE)
 				{
-					poco_error_f3(logger(), "%ld - ERROR: DELETE referring to non-existent entry '%s' --> '%s'", GetSettings().m_numId, entry.id, entry.refId);
-					return;
+					poco_error_f4(logger(), "%ld - ERROR: DELETE referring to non-existent %s quote of %s at %s", GetSettings().m_numId,
+								  std::string(entry.entryType.Bid() ? "bid" : "ask"), cp.ToString(), std::to_string(quoteId.price));
+					continue; // only this entry is skipped, the rest of the message is published
 				}
 				else if (entry.updateType == QT_UPDATE) // UPDATE -> NEW
 				{
@@ -381,8 +520,9 @@ void ConnectionBase::PublishQuotes(UTILS::NormalizedMDData::Ptr nmd)
 				refKey = 0;
 			}
 
-			PublishQuote(key, refKey, CurrentTimestamp(), CurrentTimestamp(), cp, entry);
+			batch.push_back({ key, refKey, &entry });
 		}
+		m_connectionManager.GetOrderBook()->ApplyBatch(batch.data(), batch.size(), timestamp, timestamp, m_venue.load(std::memory_order_relaxed));
 	}
 	else
 	{
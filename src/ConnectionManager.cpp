@@ -78,6 +78,11 @@ void ConnectionManager::Connect()
 			poco_warning_f1(logger(), "Failed to connect session [%s] ", conn.first );
 		}
 	}
+	// the connected sessions have claimed their restored quotes, the others are outdated
+	if (m_orderBook)
+	{
+		m_orderBook->RemoveUnclaimedQuotes();
+	}
 }
 
 void ConnectionManager::Disconnect()
@@ -101,6 +106,13 @@ bool ConnectionManager::LoadConfig(const UTILS::XmlDocPtr &pDoc)
 	{
 		std::string errMsg;
 
+		// Read order book limits (optional)
+		//----------------------------------
+		if (m_orderBook && !m_orderBook->LoadConfig(pDoc))
+		{
+			return false;
+		}
+
 		// Read sessions
 		//--------------
 		if (auto *baseNode = GetConfigNode(pDoc, CORE::CRYPTO::TAG_SESSION_CONFIG, &errMsg))
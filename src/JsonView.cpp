@@ -0,0 +1,491 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#include <charconv>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "JsonView.h"
+
+namespace CORE {
+namespace CRYPTO {
+
+namespace {
+
+const char *SkipWhitespace(const char *p, const char *end)
+{
+	while (p != end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+	{
+		++p;
+	}
+	return p;
+}
+
+/*! \brief Returns the first quote or backslash at or after @a p (@a end if there is none). */
+const char *FindQuoteOrBackslash(const char *p, const char *end)
+{
+#if defined(__SSE2__)
+	const __m128i quote { _mm_set1_epi8('"') };
+	const __m128i backslash { _mm_set1_epi8('\\') };
+	for (; end - p >= 16; p += 16)
+	{
+		const __m128i chunk { _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)) };
+		const int mask { _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash))) };
+		if (mask != 0)
+		{
+			return p + __builtin_ctz(unsigned(mask));
+		}
+	}
+#endif
+	while (p != end && *p != '"' && *p != '\\')
+	{
+		++p;
+	}
+	return p;
+}
+
+const char *SkipDigits(const char *p, const char *end)
+{
+	while (p != end && *p >= '0' && *p <= '9')
+	{
+		++p;
+	}
+	return p;
+}
+
+/*! \brief Scans a number as defined by RFC 8259: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+ *
+ * @return Position after the number, @a nullptr if @a p does not start a valid number
+ */
+const char *ScanNumber(const char *p, const char *end)
+{
+	if (p != end && *p == '-')
+	{
+		++p;
+	}
+	if (p == end || *p < '0' || *p > '9')
+	{
+		return nullptr;
+	}
+	p = *p == '0' ? p + 1 : SkipDigits(p, end); // no leading zeros
+	if (p != end && *p == '.')
+	{
+		const char *const fraction { ++p };
+		if ((p = SkipDigits(p, end)) == fraction)
+		{
+			return nullptr;
+		}
+	}
+	if (p != end && (*p == 'e' || *p == 'E'))
+	{
+		if (++p != end && (*p == '+' || *p == '-'))
+		{
+			++p;
+		}
+		const char *const exponent { p };
+		if ((p = SkipDigits(p, end)) == exponent)
+		{
+			return nullptr;
+		}
+	}
+	return p;
+}
+
+/*! \brief Appends a code point as UTF-8. */
+void AppendUtf8(std::string &out, uint32_t cp)
+{
+	if (cp < 0x80)
+	{
+		out += char(cp);
+	}
+	else if (cp < 0x800)
+	{
+		out += char(0xC0 | (cp >> 6));
+		out += char(0x80 | (cp & 0x3F));
+	}
+	else if (cp < 0x10000)
+	{
+		out += char(0xE0 | (cp >> 12));
+		out += char(0x80 | ((cp >> 6) & 0x3F));
+		out += char(0x80 | (cp & 0x3F));
+	}
+	else
+	{
+		out += char(0xF0 | (cp >> 18));
+		out += char(0x80 | ((cp >> 12) & 0x3F));
+		out += char(0x80 | ((cp >> 6) & 0x3F));
+		out += char(0x80 | (cp & 0x3F));
+	}
+}
+
+/*! \brief Reads the 4 hex digits of a \\u escape (std::nullopt if they are missing or invalid). */
+std::optional<uint32_t> ReadHex4(std::string_view text, size_t pos)
+{
+	uint32_t value { 0 };
+	if (pos + 4 > text.size() || std::from_chars(text.data() + pos, text.data() + pos + 4, value, 16).ptr != text.data() + pos + 4)
+	{
+		return std::nullopt;
+	}
+	return value;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// JsonIndex
+////////////////////////////////////////////////////////////////////////////////
+
+UTILS::BoolResult JsonIndex::Parse(std::string_view json)
+{
+	m_json = json;
+	m_nodes.clear();
+	if (json.size() >= UINT32_MAX)
+	{
+		return UTILS::BoolResult(false, "JSON document too large (%s bytes)", std::to_string(json.size()));
+	}
+
+	const char *const begin { json.data() };
+	const char *const end { begin + json.size() };
+	const auto fail = [this, begin](const char *p, const char *expected)
+	{
+		m_nodes.clear();
+		return UTILS::BoolResult(false, "Invalid JSON at offset %s: %s", std::to_string(p - begin), std::string(expected));
+	};
+	const auto push = [this, begin](JsonType type, const char *start, size_t length, bool escaped = false)
+	{
+		const uint32_t idx { uint32_t(m_nodes.size()) };
+		m_nodes.push_back({ type, escaped, uint32_t(start - begin), uint32_t(length), idx + 1, 0 });
+	};
+	// scans a string starting at its opening quote and returns the position after the closing quote (nullptr if unterminated)
+	const auto scanString = [&push, end](const char *p) -> const char *
+	{
+		const char *start { ++p };
+		bool escaped { false };
+		for (;;)
+		{
+			p = FindQuoteOrBackslash(p, end);
+			if (p == end)
+			{
+				return nullptr;
+			}
+			if (*p == '"')
+			{
+				push(JsonType::String, start, size_t(p - start), escaped);
+				return p + 1;
+			}
+			escaped = true;
+			if (end - p < 2)
+			{
+				return nullptr;
+			}
+			p += 2; // skips the escaped character, so \" does not end the string
+		}
+	};
+
+	enum class State
+	{
+		Value, //!< a value is expected
+		Name, //!< a member name is expected
+		AfterValue //!< a value is complete
+	};
+
+	uint32_t stack[MAX_DEPTH]; // open arrays and objects
+	size_t depth { 0 };
+	State state { State::Value };
+	const char *p { begin };
+	for (;;)
+	{
+		p = SkipWhitespace(p, end);
+		if (state == State::AfterValue)
+		{
+			if (depth == 0)
+			{
+				return p == end ? UTILS::BoolResult(true) : fail(p, "end of document expected");
+			}
+			Node &parent { m_nodes[stack[depth - 1]] };
+			++parent.count;
+			if (p != end && *p == ',')
+			{
+				state = parent.type == JsonType::Object ? State::Name : State::Value;
+				++p;
+				continue;
+			}
+			if (p != end && *p == (parent.type == JsonType::Object ? '}' : ']'))
+			{
+				parent.length = uint32_t(p + 1 - begin) - parent.start;
+				parent.next = uint32_t(m_nodes.size());
+				--depth;
+				++p;
+				continue;
+			}
+			return fail(p, parent.type == JsonType::Object ? "',' or '}' expected" : "',' or ']' expected");
+		}
+		if (p == end)
+		{
+			return fail(p, "unexpected end of document");
+		}
+		if (state == State::Name)
+		{
+			if (*p != '"' || !(p = scanString(p)))
+			{
+				return fail(p ? p : end, "member name expected");
+			}
+			p = SkipWhitespace(p, end);
+			if (p == end || *p != ':')
+			{
+				return fail(p, "':' expected");
+			}
+			++p;
+			state = State::Value;
+			continue;
+		}
+
+		state = State::AfterValue;
+		switch (*p)
+		{
+			case '{':
+			case '[':
+			{
+				if (depth == MAX_DEPTH)
+				{
+					return fail(p, "document nested too deeply");
+				}
+				const bool object { *p == '{' };
+				stack[depth++] = uint32_t(m_nodes.size());
+				push(object ? JsonType::Object : JsonType::Array, p, 1);
+				p = SkipWhitespace(p + 1, end);
+				if (p != end && *p == (object ? '}' : ']'))
+				{
+					Node &container { m_nodes.back() };
+					container.length = uint32_t(p + 1 - begin) - container.start;
+					--depth;
+					++p;
+				}
+				else
+				{
+					state = object ? State::Name : State::Value;
+				}
+				break;
+			}
+			case '"':
+			{
+				const char *const start { p };
+				if (!(p = scanString(p)))
+				{
+					return fail(start, "unterminated string");
+				}
+				break;
+			}
+			case 't':
+			case 'f':
+			case 'n':
+			{
+				const std::string_view literal { *p == 't' ? "true" : *p == 'f' ? "false" : "null" };
+				if (size_t(end - p) < literal.size() || std::string_view(p, literal.size()) != literal)
+				{
+					return fail(p, "value expected");
+				}
+				push(*p == 't' ? JsonType::True : *p == 'f' ? JsonType::False : JsonType::Null, p, literal.size());
+				p += literal.size();
+				break;
+			}
+			default:
+			{
+				if (*p != '-' && (*p < '0' || *p > '9'))
+				{
+					return fail(p, "value expected");
+				}
+				const char *const start { p };
+				if (!(p = ScanNumber(p, end)))
+				{
+					return fail(start, "invalid number");
+				}
+				push(JsonType::Number, start, size_t(p - start));
+				break;
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// JsonValue
+////////////////////////////////////////////////////////////////////////////////
+
+JsonType JsonValue::Type() const
+{
+	return m_index ? m_index->node(m_node).type : JsonType::Invalid;
+}
+
+std::string_view JsonValue::Text() const
+{
+	if (!m_index)
+	{
+		return { };
+	}
+	const auto &n { m_index->node(m_node) };
+	return m_index->m_json.substr(n.start, n.length);
+}
+
+std::string JsonValue::ToString() const
+{
+	const JsonType type { Type() };
+	if (type == JsonType::Null || type == JsonType::Invalid)
+	{
+		return { };
+	}
+	const std::string_view text { Text() };
+	if (type != JsonType::String || !m_index->node(m_node).escaped)
+	{
+		return std::string(text);
+	}
+	std::string result;
+	result.reserve(text.size());
+	for (size_t i { 0 }; i < text.size(); ++i)
+	{
+		if (text[i] != '\\' || i + 1 == text.size())
+		{
+			result += text[i];
+			continue;
+		}
+		switch (const char c { text[++i] })
+		{
+			case 'b': result += '\b'; break;
+			case 'f': result += '\f'; break;
+			case 'n': result += '\n'; break;
+			case 'r': result += '\r'; break;
+			case 't': result += '\t'; break;
+			case 'u':
+			{
+				std::optional<uint32_t> cp { ReadHex4(text, i + 1) };
+				if (!cp)
+				{
+					result += "\\u";
+					break;
+				}
+				i += 4;
+				// a high surrogate followed by a low surrogate encodes one code point
+				if (*cp >= 0xD800 && *cp < 0xDC00 && i + 2 < text.size() && text[i + 1] == '\\' && text[i + 2] == 'u')
+				{
+					const std::optional<uint32_t> low { ReadHex4(text, i + 3) };
+					if (low && *low >= 0xDC00 && *low < 0xE000)
+					{
+						cp = 0x10000 + ((*cp - 0xD800) << 10) + (*low - 0xDC00);
+						i += 6;
+					}
+				}
+				AppendUtf8(result, *cp);
+				break;
+			}
+			default: result += c; break; // \" \\ \/
+		}
+	}
+	return result;
+}
+
+std::optional<int64_t> JsonValue::Int64() const
+{
+	const JsonType type { Type() };
+	if (type != JsonType::Number && type != JsonType::String)
+	{
+		return std::nullopt;
+	}
+	const std::string_view text { Text() };
+	int64_t value { 0 };
+	const auto [ptr, ec] { std::from_chars(text.data(), text.data() + text.size(), value) };
+	if (ec != std::errc() || ptr != text.data() + text.size() || text.empty())
+	{
+		return std::nullopt;
+	}
+	return value;
+}
+
+std::optional<double> JsonValue::Double() const
+{
+	const JsonType type { Type() };
+	if (type != JsonType::Number && type != JsonType::String)
+	{
+		return std::nullopt;
+	}
+	const std::string_view text { Text() };
+	double value { 0.0 };
+	const auto [ptr, ec] { std::from_chars(text.data(), text.data() + text.size(), value) };
+	if (ec != std::errc() || ptr != text.data() + text.size() || text.empty())
+	{
+		return std::nullopt;
+	}
+	return value;
+}
+
+size_t JsonValue::Size() const
+{
+	const JsonType type { Type() };
+	return type == JsonType::Array || type == JsonType::Object ? m_index->node(m_node).count : 0;
+}
+
+JsonValue JsonValue::operator[](std::string_view name) const
+{
+	if (!IsObject())
+	{
+		return { };
+	}
+	for (auto it { begin() }; it != end(); ++it)
+	{
+		if (it.Name() == name)
+		{
+			return *it;
+		}
+	}
+	return { };
+}
+
+JsonValue JsonValue::operator[](size_t idx) const
+{
+	if (!IsArray() || idx >= Size())
+	{
+		return { };
+	}
+	auto it { begin() };
+	while (idx-- > 0)
+	{
+		++it;
+	}
+	return *it;
+}
+
+JsonValue::Iterator JsonValue::begin() const
+{
+	const JsonType type { Type() };
+	if (type != JsonType::Array && type != JsonType::Object)
+	{
+		return end();
+	}
+	return Iterator(m_index, Size() > 0 ? m_node + 1 : m_index->node(m_node).next, type == JsonType::Object);
+}
+
+JsonValue::Iterator JsonValue::end() const
+{
+	const JsonType type { Type() };
+	if (type != JsonType::Array && type != JsonType::Object)
+	{
+		return Iterator(nullptr, 0, false);
+	}
+	return Iterator(m_index, m_index->node(m_node).next, type == JsonType::Object);
+}
+
+std::string_view JsonValue::Iterator::Name() const
+{
+	return m_object ? JsonValue(m_index, m_node).Text() : std::string_view();
+}
+
+JsonValue::Iterator &JsonValue::Iterator::operator++()
+{
+	m_node = m_index->node(m_object ? m_node + 1 : m_node).next;
+	return *this;
+}
+
+}
+}
@@ -1,9 +1,10 @@
 #include "Utils/Logging.h"
 #include "Utils/ErrorHandler.h"
 #include "Utils/Result.h"
-#include "Utils/BackgroundWorker.hpp"
 #include "MessageProcessor.h"
 
+#include <future>
+
 #include "JSONDocument.h"
 
 namespace CORE {
@@ -50,8 +51,12 @@ UTILS::BoolResult MessageProcessor::ProcessMessage(const std::shared_ptr<JSONDoc
 	const auto msgType = GetMessageType(message);
 	if (auto handler = FindMessageHandler(msgType))
 	{
-		Enqueue(message, handler);
-		return true;
+		if (!m_running.load(std::memory_order_relaxed))
+		{
+			return UTILS::BoolResult(false, "Message processor is not running");
+		}
+		Item item { message, handler };
+		return Push(item, std::chrono::steady_clock::now() + MAX_QUEUE_WAIT);
 	}
 	return UTILS::BoolResult(false, "Not supported message: '%s'", msgType);
 }
@@ -71,19 +76,29 @@ size_t MessageProcessor::Size() const
 /*! \brief Starts message processor. It must be started before processing any messages */
 void MessageProcessor::Start()
 {
-	m_messageQueue.Start("MessageProcessorQueue", [](const std::shared_ptr<JSONDocument> &message, const TMessageHandler handler)
+	if (!m_thread.joinable())
 	{
-		if (message && handler)
-		{
-			handler(message);
-		}
-	});
+		m_running = true;
+		m_thread = std::thread([this]() { Loop(); });
+	}
 }
 
-/*! \brief Stops message processor */
+/*! \brief Stops message processor (messages not yet processed are dropped) */
 void MessageProcessor::Stop()
 {
-	m_messageQueue.Stop(true);
+	if (m_thread.joinable())
+	{
+		m_running = false;
+		{
+			std::lock_guard lock { m_wakeMtx };
+			m_wakeCond.notify_one();
+		}
+		m_thread.join();
+		Item item;
+		while (m_messageQueue.TryDequeue(item)) // releases the documents
+		{
+		}
+	}
 }
 
 UTILS::BoolResult MessageProcessor::Enqueue(const std::shared_ptr<JSONDocument> message, const TMessageHandler handler)
@@ -96,8 +111,107 @@ UTILS::BoolResult MessageProcessor::Enqueue(const std::shared_ptr<JSONDocument>
 	{
 		return UTILS::BoolResult(false, "NULL message handler ignored");
 	}
+	if (!m_running.load(std::memory_order_relaxed))
+	{
+		return UTILS::BoolResult(false, "Message processor is not running");
+	}
+	
+	Item item { message, handler };
+	return Push(item, std::chrono::steady_clock::time_point::min());
+}
+
+UTILS::BoolResult MessageProcessor::Push(Item &item, std::chrono::steady_clock::time_point deadline)
+{
+	while (!m_messageQueue.TryEnqueue(item))
+	{
+		if (!m_running.load(std::memory_order_relaxed))
+		{
+			return UTILS::BoolResult(false, "Message processor stopped");
+		}
+		if (std::chrono::steady_clock::now() >= deadline)
+		{
+			if (item.message)
+			{
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+			return UTILS::BoolResult(false, "Message queue full (%s messages)", std::to_string(m_messageQueue.Capacity()));
+		}
+		std::this_thread::yield(); // back-pressure: the caller waits for the processor to make room
+	}
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_sleeping.load(std::memory_order_relaxed))
+	{
+		std::lock_guard lock { m_wakeMtx };
+		m_wakeCond.notify_one();
+	}
+	return true;
+}
+
+UTILS::BoolResult MessageProcessor::Run(const std::function<void()> &task)
+{
+	if (!m_running.load(std::memory_order_relaxed) || std::this_thread::get_id() == m_thread.get_id())
+	{
+		task();
+		return true;
+	}
+	
+	// the promise is owned by the queued handler: if the processor drops it, the future reports a broken promise
+	auto done = std::make_shared<std::promise<void>>();
+	std::future<void> future { done->get_future() };
+	Item item { nullptr, [task, done](const std::shared_ptr<JSONDocument>)
+	{
+		task();
+		done->set_value();
+	} };
+	const auto pushed = Push(item, std::chrono::steady_clock::time_point::max());
+	if (!pushed)
+	{
+		return pushed;
+	}
+	try
+	{
+		future.get();
+	}
+	catch (const std::future_error &)
+	{
+		return UTILS::BoolResult(false, "Message processor stopped");
+	}
+	return true;
+}
+
+void MessageProcessor::Loop()
+{
+	constexpr int IDLE_SPINS { 2000 }; // polls of an empty queue before the thread goes to sleep
+	constexpr auto MAX_SLEEP { std::chrono::milliseconds(1) }; // bounds the latency of a missed wake-up
 	
-	return m_messageQueue.Enqueue(message, handler);
+	UTILS::SetThreadName("MessageProcessorQueue");
+	Item item;
+	int idle { 0 };
+	while (m_running.load(std::memory_order_relaxed))
+	{
+		if (m_messageQueue.TryDequeue(item))
+		{
+			item.handler(item.message);
+			item = Item(); // releases the document, e.g. a receive slot
+			idle = 0;
+		}
+		else if (++idle < IDLE_SPINS)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			std::unique_lock lock { m_wakeMtx };
+			m_sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_messageQueue.Empty() && m_running.load(std::memory_order_relaxed))
+			{
+				m_wakeCond.wait_for(lock, MAX_SLEEP);
+			}
+			m_sleeping.store(false, std::memory_order_relaxed);
+			idle = 0;
+		}
+	}
 }
 
 }
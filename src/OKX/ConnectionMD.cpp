@@ -1,8 +1,101 @@
+#include <Poco/Checksum.h>
+
+#include "Utils/Decimal.h"
 #include "Utils/FixTypes.h"
 #include "OKX/ConnectionMD.h"
 
 using namespace UTILS;
 
+namespace {
+/*! \brief CRC32 of the top levels in the format of OKX: "bid1price:bid1size:ask1price:ask1size:bid2price:..."
+ *
+ * The levels are fed to the checksum piece by piece, without building the string.
+ * Note: the SSE4.2 crc32 instruction computes CRC-32C, not the CRC-32 used by OKX,
+ * so the table-driven zlib implementation behind Poco::Checksum is used.
+ * */
+template <typename B, typename A>
+int32_t LevelChecksum(const B &bids, const A &asks, size_t depth)
+{
+	Poco::Checksum crc(Poco::Checksum::TYPE_CRC32);
+	bool first = true;
+	const auto add = [&crc, &first](const auto &level)
+	{
+		if (!first)
+		{
+			crc.update(':');
+		}
+		crc.update(level.Price().data(), static_cast<unsigned int>(level.Price().size()));
+		crc.update(':');
+		crc.update(level.Size().data(), static_cast<unsigned int>(level.Size().size()));
+		first = false;
+	};
+	auto bid = bids.begin();
+	auto ask = asks.begin();
+	for (size_t i = 0; i < depth && (bid != bids.end() || ask != asks.end()); ++i)
+	{
+		if (bid != bids.end())
+		{
+			add(*bid++);
+		}
+		if (ask != asks.end())
+		{
+			add(*ask++);
+		}
+	}
+	return static_cast<int32_t>(crc.checksum());
+}
+
+/*! \brief Applies the levels of a message to one side of a level book (sorted best first)
+ * @return: false if a level cannot be kept (the others are applied)
+ * */
+template <typename L>
+bool ApplySide(std::vector<L> &levels, bool bid, const CORE::CRYPTO::PriceMessage::Levels &update, int64_t cpipFactor)
+{
+	bool applied = true;
+	for (const auto &level: update)
+	{
+		const auto price = UTILS::ParseDecimal(level.price, cpipFactor);
+		if (!price)
+		{
+			applied = false;
+			continue;
+		}
+		const auto it = std::lower_bound(levels.begin(), levels.end(), *price, [bid](const L &kept, int64_t p)
+		{
+			return bid ? kept.cpipPrice > p : kept.cpipPrice < p;
+		});
+		const bool found = it != levels.end() && it->cpipPrice == *price;
+		if (level.size.find_first_not_of("0.") == std::string_view::npos) // size 0 -> level deleted
+		{
+			if (found)
+			{
+				levels.erase(it);
+			}
+		}
+		else
+		{
+			auto &kept = found ? *it : *levels.emplace(it);
+			kept.cpipPrice = *price;
+			applied = kept.SetText(level.price, level.size) && applied;
+		}
+	}
+	return applied;
+}
+
+/*! \brief Returns deletions (size 0) of all levels of a side (referring to the prices in @a levels) */
+template <typename L>
+CORE::CRYPTO::PriceMessage::Levels DeletedLevels(const std::vector<L> &levels)
+{
+	CORE::CRYPTO::PriceMessage::Levels deleted;
+	deleted.reserve(levels.size());
+	for (const auto &level: levels)
+	{
+		deleted.emplace_back(level.Price(), "0");
+	}
+	return deleted;
+}
+}
+
 namespace CORE {
 namespace OKX {
 
@@ -12,91 +105,159 @@ ConnectionMD::ConnectionMD(const CRYPTO::Settings &settings, const std::string &
 {
 	GetMessageProcessor().Register([](const std::shared_ptr<CRYPTO::JSONDocument> jd)
 								   {
+									   const auto root = jd->Root();
 									   // Try checking type field 'action'
-									   auto msgType = jd->GetValue<std::string>("action");
+									   auto msgType = root["action"].Text();
 									   if (!msgType.empty())
 									   {
-										   return msgType;
+										   return std::string(msgType);
 									   } // it was simple - type was in the field
 
 									   // Try checking type field 'event'
-									   msgType = jd->GetValue<std::string>("event");
+									   msgType = root["event"].Text();
 									   if (!msgType.empty())
 									   {
-										   return msgType;
+										   return std::string(msgType);
 									   }
 									   return MSGTYPE_Unknown;
 								   });
 	// Register messages
 	GetMessageProcessor().Register(MSGTYPE_Snapshot, [this](const std::shared_ptr<CRYPTO::JSONDocument> jd)
 	{
-		auto arg = jd->GetSubObject("arg");
-		if (!arg)
+		const auto arg = jd->Root()["arg"];
+		if (!arg.IsObject())
 		{
 			poco_error(logger(), "QT_SNAPSHOT Invalid (or not supported) arg not found");
 			return;
 		}
 
-		const auto inst = TranslateSymbol(arg->get("instId").toString());
+		const auto instId = arg["instId"].ToString();
+		const auto inst = TranslateSymbol(instId);
 		const auto update = ParseMessage(jd, "bids", "asks");
-		PublishQuotes(ParseQuote(update->Bids, QuoteType::BID, inst));
-		PublishQuotes(ParseQuote(update->Asks, QuoteType::OFFER, inst));
+		auto &book = m_levelBooks[instId];
+		ClearLevels(instId, book); // a snapshot replaces all levels (first subscription, resync or reconnect)
+		book.resyncing = false;
+		if (!ApplyLevels(instId, update, jd))
+		{
+			poco_error_f1(logger(), "QT_SNAPSHOT %s does not match its checksum", inst);
+			Resync(instId);
+			return;
+		}
 
-		poco_information_f2(logger(), "QT_SNAPSHOT %s bid Levels: %d ", inst, int(update->Bids.size()));
-		poco_information_f2(logger(), "QT_SNAPSHOT %s ask Levels: %d ", inst, int(update->Asks.size()));
+		poco_information_f2(logger(), "QT_SNAPSHOT %s bid Levels: %d ", inst, int(update.Bids.size()));
+		poco_information_f2(logger(), "QT_SNAPSHOT %s ask Levels: %d ", inst, int(update.Asks.size()));
 	});
 
 	GetMessageProcessor().Register(MSGTYPE_Update, [this](const std::shared_ptr<CRYPTO::JSONDocument> jd)
 	{
-		auto arg = jd->GetSubObject("arg");
-		if (!arg)
+		const auto arg = jd->Root()["arg"];
+		if (!arg.IsObject())
 		{
 			poco_error(logger(), "QT_UPDATE Invalid (or not supported) arg not found");
 			return;
 		}
 
-		const auto inst = TranslateSymbol(arg->get("instId").toString());
+		const auto instId = arg["instId"].ToString();
+		if (m_levelBooks[instId].resyncing)
+		{
+			return; // waiting for the snapshot of the new subscription
+		}
 		const auto update = ParseMessage(jd, "bids", "asks");
-		PublishQuotes(ParseQuote(update->Bids, QuoteType::BID, inst));
-		PublishQuotes(ParseQuote(update->Asks, QuoteType::OFFER, inst));
+		if (!ApplyLevels(instId, update, jd))
+		{
+			Resync(instId);
+		}
 	});
 
 	GetMessageProcessor().Register(MSGTYPE_Subscribe, [this](const std::shared_ptr<CRYPTO::JSONDocument> jd)
 	{
-		auto arg = jd->GetSubObject("arg");
-		poco_information_f1(logger(), "Subscribed '%s'", arg->get("instId").toString());
+		poco_information_f1(logger(), "Subscribed '%s'", jd->Root()["arg"]["instId"].ToString());
 	});
 
 	GetMessageProcessor().Register(MSGTYPE_Unsubscribe, [this](const std::shared_ptr<CRYPTO::JSONDocument> jd)
 	{
-		auto arg = jd->GetSubObject("arg");
-		poco_information_f1(logger(), "Unsubscribed '%s'", arg->get("instId").toString());
+		poco_information_f1(logger(), "Unsubscribed '%s'", jd->Root()["arg"]["instId"].ToString());
 	});
 }
 
 // Helper: translates levels from snapshot or incremental update
 void ConnectionMD::SideTranslator(const char *side, CRYPTO::PriceMessage::Levels &depth, const std::shared_ptr<CRYPTO::JSONDocument> jd) const
 {
-	if (auto data = jd->GetArray("data"))
+	for (const auto item: jd->Root()["data"])
 	{
-		Poco::Dynamic::Array dynArray = *data;
-		for (size_t i = 0; i < data->size(); ++i)
+		for (const auto level: item[side])
 		{
-			const auto &s = dynArray[i];
-			const auto prices = s[side];
-			if (prices.isArray())
-			{
-				for (size_t i = 0; i < prices.size(); ++i)
-				{
-					depth.emplace_back(std::make_shared<CRYPTO::Level>());
-					depth.back()->price = prices[i][0].toString();
-					depth.back()->size = prices[i][1].toString();
-				}
-			}
+			depth.emplace_back(level[0].Text(), level[1].Text());
 		}
 	}
 }
 
+//------------------------------------------------------------------------------
+bool ConnectionMD::ApplyLevels(const std::string &instId, const CRYPTO::PriceMessage &update, const std::shared_ptr<CRYPTO::JSONDocument> jd)
+{
+	const auto inst = TranslateSymbol(instId);
+	auto &book = m_levelBooks[instId];
+	const int64_t cpipFactor = GetCurrencyPair(inst).CpipFactor();
+	const bool applied = ApplySide(book.bids, true, update.Bids, cpipFactor) & ApplySide(book.asks, false, update.Asks, cpipFactor);
+	PublishQuotes(ParseQuotes(update, inst));
+	if (!applied)
+	{
+		poco_error_f1(logger(), "Levels of '%s' cannot be kept", instId);
+		return false;
+	}
+
+	const auto checksum = jd->Root()["data"][0]["checksum"].Int64();
+	if (!checksum)
+	{
+		return true; // nothing to verify
+	}
+	const auto expected = static_cast<int32_t>(*checksum);
+	const auto actual = LevelChecksum(book.bids, book.asks, CHECKSUM_DEPTH);
+	if (expected != actual)
+	{
+		poco_error_f3(logger(), "Checksum mismatch for '%s': expected %s, calculated %s", instId, std::to_string(expected), std::to_string(actual));
+		return false;
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+void ConnectionMD::ClearLevels(const std::string &instId, LevelBook &book)
+{
+	if (book.bids.empty() && book.asks.empty())
+	{
+		return;
+	}
+	const auto inst = TranslateSymbol(instId);
+	CRYPTO::PriceMessage deleted;
+	deleted.Bids = DeletedLevels(book.bids);
+	deleted.Asks = DeletedLevels(book.asks);
+	PublishQuotes(ParseQuotes(deleted, inst));
+	book.bids.clear();
+	book.asks.clear();
+}
+
+//------------------------------------------------------------------------------
+void ConnectionMD::PrepareInstruments(const CRYPTO::ConnectionBase::TInstruments &instruments)
+{
+	CRYPTO::ConnectionBase::PrepareInstruments(instruments);
+	for (const auto &instId: instruments)
+	{
+		m_levelBooks.erase(instId); // its levels have just been removed from the order book
+	}
+}
+
+//------------------------------------------------------------------------------
+void ConnectionMD::Resync(const std::string &instId)
+{
+	poco_warning_f1(logger(), "Resubscribing '%s' to rebuild its book", instId);
+	auto &book = m_levelBooks[instId];
+	ClearLevels(instId, book);
+	book.resyncing = true;
+	Subscribe({ instId }, "unsubscribe");
+	Subscribe({ instId }, "subscribe");
+}
+
 //------------------------------------------------------------------------------
 /*! \brief subscribe/unsubscribe helper
 * @param instruments: list of instruments separated by comma
@@ -0,0 +1,47 @@
+//
+// Created by james on 16/10/2026.
+//
+
+#include <atomic>
+
+#include "ReceiveRing.h"
+
+namespace CORE {
+namespace CRYPTO {
+
+ReceiveRing::ReceiveRing(size_t slots, size_t slotSize)
+		: m_slotSize(slotSize)
+{
+	m_slots.resize(slots);
+	for (auto &slot: m_slots)
+	{
+		slot.buffer.reset(new char[slotSize]); // not initialised: pages are only touched by the frames received
+		slot.document = std::make_shared<JSONDocument>();
+	}
+}
+
+std::optional<size_t> ReceiveRing::Acquire()
+{
+	for (size_t i { 0 }; i < m_slots.size(); ++i)
+	{
+		const size_t slot { (m_next + i) % m_slots.size() };
+		if (m_slots[slot].document.use_count() == 1)
+		{
+			// pairs with the release of the last other reference, so its reads of the buffer are complete
+			std::atomic_thread_fence(std::memory_order_acquire);
+			m_next = slot + 1;
+			return slot;
+		}
+	}
+	return std::nullopt;
+}
+
+std::shared_ptr<JSONDocument> ReceiveRing::Commit(size_t slot, size_t bytes)
+{
+	Slot &s { m_slots[slot] };
+	s.document->Reset(std::string_view(s.buffer.get(), bytes));
+	return s.document;
+}
+
+}
+}
@@ -21,30 +21,27 @@ ConnectionMD::ConnectionMD(const CRYPTO::Settings &settings, const std::string &
 	
 	GetMessageProcessor().Register([](const std::shared_ptr<CRYPTO::JSONDocument> jd)
 								   {
+									   const auto root = jd->Root();
 									   // Try checking type field 'e'
-									   auto msgType = jd->GetValue<std::string>("e");
+									   const auto msgType = root["e"].Text();
 									   if (!msgType.empty())
 									   {
-										   return msgType;
+										   return std::string(msgType);
 									   } // it was simple - type was in the field
-									   else
+									   else if (root.Has("lastUpdateId")) //Incremental updates contain field 'lastUpdateId'
 									   {
-										   msgType = jd->GetValue<std::string>("lastUpdateId"); //Incremental updates contain field 'lastUpdateId'
-										   if (!msgType.empty())
-										   {
-											   return MSGTYPE_DepthNUpdate;
-										   }
+										   return MSGTYPE_DepthNUpdate;
 									   }
 									   // Try error message
 									   // {"error":{"code":3,"msg":"Invalid JSON: expected `,` or `]` at line 4 column 6"}}
-									   if (jd->Has(MSGTYPE_Error))
+									   if (root.Has(MSGTYPE_Error))
 									   {
 										   return MSGTYPE_Error;
 									   }
 		
 									   // Try result message
 									   // {"result":null,"id":1}
-									   if (jd->Has(MSGTYPE_Result) && jd->Has("id"))
+									   if (root.Has(MSGTYPE_Result) && root.Has("id"))
 									   {
 										   return MSGTYPE_Result;
 									   }
@@ -56,109 +53,106 @@ ConnectionMD::ConnectionMD(const CRYPTO::Settings &settings, const std::string &
 	//For unlimited depth we use the following msg
 	GetMessageProcessor().Register(MSGTYPE_DepthUpdate, [this](const std::shared_ptr<CRYPTO::JSONDocument> jd)
 	{
-		auto snapshot = m_snapshot.find(UTILS::CurrencyPair(jd->GetValue<std::string>("s")));
-		if (!snapshot->second)
-		{
-			m_messages.emplace_back(jd); //snapshot has not completed so cache msgs..
-			return;
-		}
-		
-		while (!m_messages.empty())
-		{
-			DepthUpdate(m_messages.front());  //flush cached msgs as snapshot download is now completed..
-			m_messages.pop_front();
-		}
-		
-		DepthUpdate(jd); //process incoming msg
+		DepthUpdate(jd);
 	});
 	
 	//For limited depth 'n' levels we use the following msg
 	GetMessageProcessor().Register(MSGTYPE_DepthNUpdate, [this](const std::shared_ptr<CRYPTO::JSONDocument> jd)
 	{
-		auto snapshot = m_snapshot.find(UTILS::CurrencyPair(jd->GetValue<std::string>("s")));
-		if (!snapshot->second)
-		{
-			m_messages.emplace_back(jd);
-			return;
-		}
-		
-		while (!m_messages.empty())
-		{
-			DepthNUpdate(m_messages.front());  //flush cached msgs as snapshot download is now completed..
-			m_messages.pop_front();
-		}
-		
-		DepthNUpdate(jd); //process incoming msg
+		DepthNUpdate(jd);
 	});
 	
 	GetMessageProcessor().Register(MSGTYPE_Result, [this](const std::shared_ptr<CRYPTO::JSONDocument> jd)
 	{
-		OnMsgResult(jd->GetValue<std::string>("result"), jd->GetValue<int>("id"), true);
+		const auto root = jd->Root();
+		OnMsgResult(root["result"].ToString(), int(root["id"].GetInt64()), true);
 	});
 	
 	GetMessageProcessor().Register(MSGTYPE_Error, [this](const std::shared_ptr<CRYPTO::JSONDocument> jd)
 	{
-		try
+		const auto errDesc = jd->Root()["error"];
+		const auto code = errDesc["code"].Int64();
+		if (errDesc.IsObject() && code)
 		{
-			auto errDesc = jd->GetSubObject("error");
-			if (errDesc)
-			{
-				OnMsgError(errDesc->get("code").convert<int>(), errDesc->get("msg").toString(), true);
-			}
-			else
-			{
-				OnMsgError(0, "", UTILS::BoolResult(false, "Invalid error message descriptor"));
-			}
+			OnMsgError(int(*code), errDesc["msg"].ToString(), true);
 		}
-		catch (std::exception &e)
+		else
 		{
-			OnMsgError(0, "", UTILS::BoolResult(false, "Invalid error message descriptor: %s", std::string(e.what())));
+			OnMsgError(0, "", UTILS::BoolResult(false, "Invalid error message descriptor: %s", std::string(errDesc.Text())));
 		}
 	});
 }
 
 void ConnectionMD::DepthUpdate(const std::shared_ptr<CRYPTO::JSONDocument> jd)
 {
-	static bool stale(true); // On startup check for old/stale msgs to be dropped.
-	
-	int64_t u = stol(jd->GetValue<std::string>("u"));
-	if (stale)
+	const auto root = jd->Root();
+	const std::string instrument { root["s"].Text() };
+	auto it = m_sync.find(instrument);
+	if (it == m_sync.end())
 	{
-		if (u <= m_lastUpdateId)
-		{
-			poco_warning_f2(logger(), "Snapshot '%ld' dropping stale msg %ld", m_lastUpdateId, u);
-			return;
-		}
-		stale = false; //Now receiving fresh msgs..
+		poco_warning_f1(logger(), "Diff for unknown instrument '%s' dropped", instrument);
+		return;
 	}
-		
-	int64_t U = stol(jd->GetValue<std::string>("U"));
-	if (U <= m_lastUpdateId + 1 && u >= m_lastUpdateId)
+	auto &sync = it->second;
+	if (sync.state == SyncState::Buffering || sync.state == SyncState::Resyncing)
 	{
-		const auto update = ParseMessage(jd, "b", "a");
-		PublishQuotes(ParseQuote(update->Bids, QuoteType::BID, jd->GetValue<std::string>("s")));
-		PublishQuotes(ParseQuote(update->Asks, QuoteType::OFFER, jd->GetValue<std::string>("s")));
-		m_lastUpdateId = u + 1;
+		sync.buffered.emplace_back(jd); //snapshot has not been applied yet so buffer msgs..
+		return;
 	}
-	else
+	
+	const int64_t U = root["U"].GetInt64();
+	const int64_t u = root["u"].GetInt64();
+	if (u <= sync.lastUpdateId)
 	{
-		poco_error_f3(logger(), "Snapshot SKIPPING '%ld' sequence U %ld u", m_lastUpdateId, U, u);
+		return; // already contained in the snapshot
 	}
+	// the first diff after a snapshot has to cover lastUpdateId + 1, the following ones have to be contiguous
+	const bool inSequence { sync.state == SyncState::Live ? U == sync.lastUpdateId + 1 : U <= sync.lastUpdateId + 1 };
+	if (!inSequence)
+	{
+		poco_warning_f3(logger(), "Gap in diffs of '%s': last update %s, next diff starts at %s", instrument,
+						std::to_string(sync.lastUpdateId), std::to_string(U));
+		Resync(instrument, sync, jd);
+		return;
+	}
+	
+	const auto update = ParseMessage(jd, "b", "a");
+	PublishQuotes(ParseQuotes(update, instrument));
+	SetUpdateId(GetCurrencyPair(instrument), u);
+	sync.lastUpdateId = u;
+	sync.state = SyncState::Live;
 }
 
 
 void ConnectionMD::DepthNUpdate(const std::shared_ptr<CRYPTO::JSONDocument> jd)
 {
-	int64_t lastUpdateId = stol(jd->GetValue<std::string>("lastUpdateId"));
-	if (m_lastUpdateId <= lastUpdateId)
+	const std::string instrument { jd->Root()["s"].Text() };
+	auto it = m_sync.find(instrument);
+	if (it == m_sync.end())
+	{
+		poco_warning_f1(logger(), "Depth for unknown instrument '%s' dropped", instrument);
+		return;
+	}
+	auto &sync = it->second;
+	if (sync.state == SyncState::Buffering || sync.state == SyncState::Resyncing)
+	{
+		sync.buffered.emplace_back(jd);
+		return;
+	}
+	
+	// partial depth messages carry the complete top levels, so there are no gaps to detect
+	const int64_t lastUpdateId = jd->Root()["lastUpdateId"].GetInt64();
+	if (sync.lastUpdateId <= lastUpdateId)
 	{
 		const auto update = ParseMessage(jd, "bids", "asks");
-		PublishQuotes(ParseQuote(update->Bids, QuoteType::BID, jd->GetValue<std::string>("s")));
-		PublishQuotes(ParseQuote(update->Asks, QuoteType::OFFER, jd->GetValue<std::string>("s")));
+		PublishQuotes(ParseQuotes(update, instrument));
+		SetUpdateId(GetCurrencyPair(instrument), lastUpdateId);
+		sync.lastUpdateId = lastUpdateId;
+		sync.state = SyncState::Live;
 	}
 	else
 	{
-		poco_information_f2(logger(), "Snapshot '%ld' ignoring msg %ld", m_lastUpdateId, lastUpdateId);
+		poco_information_f2(logger(), "Snapshot '%ld' ignoring msg %ld", sync.lastUpdateId, lastUpdateId);
 	}
 }
 
@@ -187,50 +181,142 @@ void ConnectionMD::OnMsgError(const int errCode, const std::string &errMsg, cons
 
 
 //------------------------------------------------------------------------------
-/*! \brief Processing snapshot for each instrument */
+void ConnectionMD::PrepareInstruments(const TInstruments &instruments)
+{
+	for (const auto &inst: instruments)
+	{
+		auto &sync = m_sync[inst];
+		sync = InstrumentSync(); // a reconnect starts over
+		// warm restart: continue from the book restored from the snapshot file, the stream fills the gap
+		const int64_t restoredId = RestoreQuotes(GetCurrencyPair(inst));
+		if (restoredId > 0)
+		{
+			sync.lastUpdateId = restoredId;
+			sync.state = SyncState::SnapshotApplied;
+			poco_information_f2(logger(), "'%s' restored at update %s", inst, std::to_string(restoredId));
+		}
+	}
+}
+
+
+//------------------------------------------------------------------------------
+/*! \brief Requests the snapshot of each instrument that is still buffering */
 void ConnectionMD::Snapshot(const TInstruments &instruments)
 {
-	std::condition_variable_any cv;
-	std:: mutex mtx;
+	if (!m_snapshotFetcher.Running())
+	{
+		const auto result = m_snapshotFetcher.Start("BinanceSnapshot", SNAPSHOT_FETCH_THREADS);
+		if (!result)
+		{
+			poco_error_f1(logger(), "Cannot start the snapshot fetcher: %s", result.ErrorMessage());
+			return;
+		}
+	}
+	// the sync states are owned by the message processor thread
+	const auto result = GetMessageProcessor().Run([this, instruments]()
+	{
+		for (const auto &inst: instruments)
+		{
+			const auto it = m_sync.find(inst);
+			if (it != m_sync.end() && it->second.state == SyncState::Buffering)
+			{
+				FetchSnapshot(inst);
+			}
+		}
+	});
+	if (!result)
+	{
+		poco_error_f1(logger(), "Snapshots not requested: %s", result.ErrorMessage());
+	}
+}
 
-	for (const auto &inst: instruments)
+
+//------------------------------------------------------------------------------
+void ConnectionMD::FetchSnapshot(const std::string &instrument, std::chrono::nanoseconds delay)
+{
+	std::string url = m_settings.m_snapshot_http;
+	Poco::replaceInPlace(url, std::string("INSTRUMENT"), instrument);
+	const auto result = m_snapshotFetcher.Schedule("snapshot_" + instrument, [this, instrument, url](UTILS::Timer::Task &)
 	{
-		Poco::replaceInPlace(m_settings.m_snapshot_http, std::string("INSTRUMENT"), inst);
-		poco_information_f1(logger(), "Start SNAPSHOT for '%s'...", inst);
+		poco_information_f1(logger(), "Start SNAPSHOT for '%s'...", instrument);
+		std::shared_ptr<CRYPTO::JSONDocument> jd;
 		try
 		{
-			const auto msg = m_connectionSS->GetSnapshot(m_settings.m_snapshot_http);
-			if (msg.empty())
-			{
-				return;
-			} // nothing to do
-			
-			// Create json and push in the queue
-			auto jd = std::make_shared<CRYPTO::JSONDocument>(msg);
-			m_lastUpdateId = stol(jd->GetValue<std::string>("lastUpdateId"));
-			
-			GetMessageProcessor().Enqueue(jd, [this, inst, &cv](const std::shared_ptr<CRYPTO::JSONDocument> jd)
+			const auto msg = m_connectionSS->GetSnapshot(url);
+			if (!msg.empty())
 			{
-				const auto update = ParseMessage(jd, "bids", "asks");
-				PublishQuotes(ParseQuote(update->Bids, QuoteType::BID, inst));
-				PublishQuotes(ParseQuote(update->Asks, QuoteType::OFFER, inst));
-				
-				poco_information_f2(logger(), "QT_SNAPSHOT %s bid Levels: %d ", inst, int(update->Bids.size()));
-				poco_information_f2(logger(), "QT_SNAPSHOT %s ask Levels: %d ", inst, int(update->Asks.size()));
-				cv.notify_one();
-			});
+				jd = std::make_shared<CRYPTO::JSONDocument>(msg);
+			}
+		}
+		catch (...)
+		{
+			poco_error_f2(logger(), "Exception during SNAPSHOT for '%s' %s", instrument, GetMessage(std::current_exception()));
+		}
+		if (!jd || !jd->Root()["lastUpdateId"].Int64())
+		{
+			poco_error_f1(logger(), "No SNAPSHOT received for '%s', retrying", instrument);
+			FetchSnapshot(instrument, SNAPSHOT_RETRY_DELAY);
+			return;
+		}
+		const auto enqueued = GetMessageProcessor().Enqueue(jd, [this, instrument](const std::shared_ptr<CRYPTO::JSONDocument> jd)
+		{
+			OnSnapshot(instrument, jd);
+		});
+		if (!enqueued)
+		{
+			poco_error_f2(logger(), "SNAPSHOT for '%s' not processed: %s, retrying", instrument, enqueued.ErrorMessage());
+			FetchSnapshot(instrument, SNAPSHOT_RETRY_DELAY);
+		}
+	}, delay);
+	if (!result)
+	{
+		poco_error_f2(logger(), "Cannot request the SNAPSHOT for '%s': %s", instrument, result.ErrorMessage());
+	}
+}
 
-			cv.wait(mtx);
-			poco_information_f1(logger(), "Finished SNAPSHOT for '%s'", inst);
 
-			auto snapshot = m_snapshot.find(UTILS::CurrencyPair(inst));
-			snapshot->second = true;
+//------------------------------------------------------------------------------
+void ConnectionMD::OnSnapshot(const std::string &instrument, const std::shared_ptr<CRYPTO::JSONDocument> jd)
+{
+	auto &sync = m_sync.at(instrument);
+	const auto cp = GetCurrencyPair(instrument);
+	const int64_t lastUpdateId = jd->Root()["lastUpdateId"].GetInt64();
+	
+	RemoveQuotes(cp); // levels missing from the snapshot must not survive a resync
+	const auto update = ParseMessage(jd, "bids", "asks");
+	PublishQuotes(ParseQuotes(update, instrument));
+	SetUpdateId(cp, lastUpdateId);
+	sync.lastUpdateId = lastUpdateId;
+	sync.state = SyncState::SnapshotApplied;
+	
+	poco_information_f2(logger(), "QT_SNAPSHOT %s bid Levels: %d ", instrument, int(update.Bids.size()));
+	poco_information_f2(logger(), "QT_SNAPSHOT %s ask Levels: %d ", instrument, int(update.Asks.size()));
+	
+	// replay the diffs buffered meanwhile (a gap among them starts another resync)
+	auto buffered = std::move(sync.buffered);
+	sync.buffered.clear();
+	for (const auto &diff: buffered)
+	{
+		if (diff->Has("lastUpdateId"))
+		{
+			DepthNUpdate(diff);
 		}
-		catch (...)
+		else
 		{
-			poco_error_f2(logger(), "Exception during SNAPSHOT for '%s' %s", inst, GetMessage(std::current_exception()));
+			DepthUpdate(diff);
 		}
-	} // for
+	}
+	poco_information_f2(logger(), "Finished SNAPSHOT for '%s', %s buffered diffs replayed", instrument, std::to_string(buffered.size()));
+}
+
+
+//------------------------------------------------------------------------------
+void ConnectionMD::Resync(const std::string &instrument, InstrumentSync &sync, const std::shared_ptr<CRYPTO::JSONDocument> jd)
+{
+	sync.state = SyncState::Resyncing;
+	sync.buffered.clear();
+	sync.buffered.emplace_back(jd);
+	FetchSnapshot(instrument);
 }
 
 
@@ -245,8 +331,6 @@ void ConnectionMD::Subscribe(const CRYPTO::ConnectionBase::TInstruments &instrum
 	std::string depth { levels > 0 ? std::to_string(levels) : "" };
 	for (const auto &inst: instruments)
 	{
-		m_snapshot.insert(std::make_pair<UTILS::CurrencyPair, bool>(UTILS::CurrencyPair(inst), false));
-		
 		depthStr += (depthStr.empty() ? "" : ",") + std::string("\"") + UTILS::tolower(inst) + // note: instrument must be in lower case for feed
 					"@depth" + depth + "@100ms\"";
 	}
@@ -17,7 +17,7 @@ namespace CORE {
 
             GetMessageProcessor().Register([](const std::shared_ptr<CRYPTO::JSONDocument> message)
                                             {
-                                                return message->GetValue<std::string>("type");
+                                                return std::string(message->Root()["type"].Text());
                                             });
 
             // Register messages
@@ -28,11 +28,10 @@ namespace CORE {
                     return;
                 }
                 const auto update = ParseMessage(jd, "bids", "asks");
-                PublishQuotes(ParseQuote(update->Bids, QuoteType::BID, cp));
-                PublishQuotes(ParseQuote(update->Asks, QuoteType::OFFER, cp));
+                PublishQuotes(ParseQuotes(update, cp));
 
-                poco_information_f2(logger(), "QT_SNAPSHOT %s bid Levels: %d ", cp.ToString(), int(update->Bids.size()));
-                poco_information_f2(logger(), "QT_SNAPSHOT %s ask Levels: %d ", cp.ToString(), int(update->Asks.size()));
+                poco_information_f2(logger(), "QT_SNAPSHOT %s bid Levels: %d ", cp.ToString(), int(update.Bids.size()));
+                poco_information_f2(logger(), "QT_SNAPSHOT %s ask Levels: %d ", cp.ToString(), int(update.Asks.size()));
             });
 
             GetMessageProcessor().Register(MSG_TYPE_L2UPDATE, [this](const std::shared_ptr<CRYPTO::JSONDocument> jd) {
@@ -41,11 +40,13 @@ namespace CORE {
                     poco_error(logger(), "Invalid (or not supported) instrument - ignored");
                     return;
                 }
-                const auto publishFunc = [&cp, this](const std::vector<change::Ptr> changes) {
+                // all changes of the message are published as one change of the book
+                const auto publishFunc = [&cp, &jd, this](const std::pmr::vector<change> &changes) {
+                    CRYPTO::PriceMessage update(&jd->GetArena());
                     for (const auto &iter: changes) {
-                        std::vector level{std::make_shared<CORE::CRYPTO::Level>(iter->price, iter->size)};
-                        PublishQuotes(ParseQuote(level, (iter->side == "buy" ? QuoteType::BID : QuoteType::OFFER), cp));
+                        (iter.side == "buy" ? update.Bids : update.Asks).emplace_back(iter.price, iter.size);
                     }
+                    PublishQuotes(ParseQuotes(update, cp));
                 };
 
                 publishFunc(L2Update(jd).GetChanges());
@@ -67,7 +68,7 @@ namespace CORE {
 
         //----------------------------------------------------------------------
         UTILS::CurrencyPair ConnectionMD::GetCurrency(const std::shared_ptr<CRYPTO::JSONDocument> msg) const {
-            return GetCurrencyPair(TranslateSymbol(msg->GetValue<std::string>("product_id")));
+            return GetCurrencyPair(TranslateSymbol(std::string(msg->Root()["product_id"].Text())));
         }
 
         //Create a Market Data authentication signature
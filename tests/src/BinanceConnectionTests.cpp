@@ -0,0 +1,217 @@
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <Utils/FixDefs.h>
+#include "ConnectionManager.h"
+#include "binance/ConnectionMD.h"
+
+#include "TestHelpers.h"
+
+namespace TEST::BINANCE {
+
+namespace {
+const std::string Session { "BINANCE_MD_01" };
+const std::string Symbol { "BTCUSDT" };
+const std::string BookPath { ::testing::TempDir() + "BinanceConnectionTests_book.bin" };
+
+//--------------------------------------------------------------------------
+/*! \brief Binance connection whose snapshot requests are recorded instead of sent */
+//--------------------------------------------------------------------------
+class SyncConnection : public TestConnectionMD<CORE::BINANCE::ConnectionMD>
+{
+public:
+	using TestConnectionMD::TestConnectionMD;
+
+	using CORE::BINANCE::ConnectionMD::PrepareInstruments;
+	using CORE::BINANCE::ConnectionMD::OnSnapshot;
+
+	// Instruments whose snapshot has been requested (message processor thread)
+	std::vector<std::string> m_fetched;
+
+protected:
+	void FetchSnapshot(const std::string &instrument, std::chrono::nanoseconds /* delay */) override
+	{
+		m_fetched.emplace_back(instrument);
+	}
+};
+
+std::string Diff(int64_t firstId, int64_t lastId, const std::string &bids, const std::string &asks = "")
+{
+	return "{\"e\":\"depthUpdate\",\"E\":1658154416696,\"s\":\"" + Symbol + "\",\"U\":" + std::to_string(firstId) +
+		   ",\"u\":" + std::to_string(lastId) + ",\"b\":[" + bids + "],\"a\":[" + asks + "]}";
+}
+
+std::string Snapshot(int64_t lastUpdateId, const std::string &bids, const std::string &asks = "")
+{
+	return "{\"lastUpdateId\":" + std::to_string(lastUpdateId) + ",\"bids\":[" + bids + "],\"asks\":[" + asks + "]}";
+}
+
+/*! \brief Hands a diff to the message processor, as the listener thread does */
+void Receive(SyncConnection &conn, const std::string &msg)
+{
+	ASSERT_TRUE(conn.GetMessageProcessor().ProcessMessage(std::make_shared<CORE::CRYPTO::JSONDocument>(msg)));
+}
+
+/*! \brief Applies a snapshot on the message processor thread, after the diffs received before */
+void ApplySnapshot(SyncConnection &conn, const std::string &msg)
+{
+	const auto jd = std::make_shared<CORE::CRYPTO::JSONDocument>(msg);
+	ASSERT_TRUE(conn.GetMessageProcessor().Run([&conn, jd]() { conn.OnSnapshot(Symbol, jd); }));
+}
+
+/*! \brief Waits until the message processor has worked off the diffs received so far */
+void WorkOff(SyncConnection &conn)
+{
+	ASSERT_TRUE(conn.GetMessageProcessor().Run([]() { }));
+}
+
+/*! \brief Prepares the instrument and starts the message processor (the stream is not subscribed) */
+void Start(SyncConnection &conn, CORE::BOOK::OrderBook &book, UTILS::CurrencyPair cp)
+{
+	book.RegisterInstrument(cp);
+	conn.RegisterVenue();
+	conn.GetMessageProcessor().Start();
+	ASSERT_TRUE(conn.GetMessageProcessor().Run([&conn]() { conn.PrepareInstruments({ Symbol }); }));
+}
+
+CORE::CRYPTO::Settings SessionSettings()
+{
+	CORE::CRYPTO::Settings settings;
+	settings.m_name = Session;
+	return settings;
+}
+} // anon ns
+
+//--------------------------------------------------------------------------
+TEST(BinanceConnection, Test_Sync_FirstDiffStraddlesSnapshot)
+{
+	// Arrange
+	RegisterTestCurrencies();
+	const UTILS::CurrencyPair cp("BTC/USDT");
+	auto orderBook = std::make_shared<CORE::BOOK::OrderBook>(1);
+	CORE::ConnectionManager manager(ConfigPath, LoggingProperties, orderBook);
+	SyncConnection conn(SessionSettings(), manager);
+	Start(conn, *orderBook, cp);
+
+	// Act - diffs are buffered until the snapshot arrives
+	Receive(conn, Diff(95, 99, "[\"29990.00\",\"9.0\"]")); // contained in the snapshot
+	Receive(conn, Diff(99, 103, "[\"30001.00\",\"1.0\"]")); // covers update 101
+	Receive(conn, Diff(104, 105, "[\"30002.00\",\"1.0\"]"));
+	WorkOff(conn);
+	ASSERT_EQ(0, orderBook->GetUpdateId(cp));
+	ApplySnapshot(conn, Snapshot(100, "[\"30000.00\",\"1.0\"]", "[\"30010.00\",\"1.0\"]"));
+	orderBook->Sync();
+
+	// Check
+	ASSERT_EQ(105, orderBook->GetUpdateId(cp));
+	ASSERT_TRUE(conn.m_fetched.empty()); // no gap, no resync
+	ASSERT_EQ(30002.0, cp.CpipToDbl(orderBook->GetBestPrice(cp, true)));
+	ASSERT_EQ(3, orderBook->GetQuoteCount(cp, true)); // the diff contained in the snapshot is dropped
+	ASSERT_EQ(1, orderBook->GetQuoteCount(cp, false));
+}
+
+//--------------------------------------------------------------------------
+TEST(BinanceConnection, Test_Sync_GapWhileLive_Resyncs)
+{
+	// Arrange
+	RegisterTestCurrencies();
+	const UTILS::CurrencyPair cp("BTC/USDT");
+	auto orderBook = std::make_shared<CORE::BOOK::OrderBook>(1);
+	CORE::ConnectionManager manager(ConfigPath, LoggingProperties, orderBook);
+	SyncConnection conn(SessionSettings(), manager);
+	Start(conn, *orderBook, cp);
+	ApplySnapshot(conn, Snapshot(100, "[\"30000.00\",\"1.0\"],[\"29999.00\",\"1.0\"]"));
+	Receive(conn, Diff(101, 102, "[\"30001.00\",\"1.0\"]"));
+	WorkOff(conn);
+	ASSERT_EQ(102, orderBook->GetUpdateId(cp));
+
+	// Act - updates 103 and 104 are missing
+	Receive(conn, Diff(105, 106, "[\"30003.00\",\"1.0\"]"));
+	Receive(conn, Diff(107, 108, "[\"30004.00\",\"1.0\"]")); // buffered until the new snapshot is applied
+	WorkOff(conn);
+
+	// Check - a new snapshot is requested, the book stays at the last diff in sequence
+	ASSERT_EQ(std::vector<std::string> { Symbol }, conn.m_fetched);
+	ASSERT_EQ(102, orderBook->GetUpdateId(cp));
+
+	// Act - the new snapshot replaces the levels of the session, the buffered diffs follow it
+	ApplySnapshot(conn, Snapshot(106, "[\"30003.00\",\"1.0\"]"));
+	orderBook->Sync();
+
+	// Check
+	ASSERT_EQ(1, conn.m_fetched.size());
+	ASSERT_EQ(108, orderBook->GetUpdateId(cp));
+	ASSERT_EQ(30004.0, cp.CpipToDbl(orderBook->GetBestPrice(cp, true)));
+	ASSERT_EQ(2, orderBook->GetQuoteCount(cp, true)); // the levels missing from the snapshot are gone
+}
+
+//--------------------------------------------------------------------------
+TEST(BinanceConnection, Test_Sync_SnapshotOlderThanBufferedDiffs)
+{
+	// Arrange
+	RegisterTestCurrencies();
+	const UTILS::CurrencyPair cp("BTC/USDT");
+	auto orderBook = std::make_shared<CORE::BOOK::OrderBook>(1);
+	CORE::ConnectionManager manager(ConfigPath, LoggingProperties, orderBook);
+	SyncConnection conn(SessionSettings(), manager);
+	Start(conn, *orderBook, cp);
+	Receive(conn, Diff(201, 205, "[\"30001.00\",\"1.0\"]"));
+	Receive(conn, Diff(206, 210, "[\"30002.00\",\"1.0\"]"));
+
+	// Act - the snapshot ends before the first buffered diff starts
+	ApplySnapshot(conn, Snapshot(100, "[\"30000.00\",\"1.0\"]"));
+
+	// Check - the diffs cannot follow it: another snapshot is requested, the diffs are kept
+	ASSERT_EQ(std::vector<std::string> { Symbol }, conn.m_fetched);
+	ASSERT_EQ(100, orderBook->GetUpdateId(cp));
+
+	// Act
+	ApplySnapshot(conn, Snapshot(204, "[\"30000.50\",\"1.0\"]"));
+	orderBook->Sync();
+
+	// Check
+	ASSERT_EQ(1, conn.m_fetched.size());
+	ASSERT_EQ(210, orderBook->GetUpdateId(cp));
+	ASSERT_EQ(30002.0, cp.CpipToDbl(orderBook->GetBestPrice(cp, true)));
+	ASSERT_EQ(3, orderBook->GetQuoteCount(cp, true)); // the level of the older snapshot is gone
+}
+
+//--------------------------------------------------------------------------
+TEST(BinanceConnection, Test_Sync_WarmStartFromRestoredBook)
+{
+	// Arrange - a book of the session saved at update 4711
+	RegisterTestCurrencies();
+	const UTILS::CurrencyPair cp("BTC/USDT");
+	{
+		CORE::BOOK::OrderBook saved { 1 };
+		UTILS::NormalizedMDData::Entry entry;
+		entry.updateType = QT_NEW;
+		entry.entryType = GetSide(true);
+		entry.price = 30000.0;
+		entry.volume = 1.0;
+		saved.AddEntry(1, 0, 0, cp, entry, saved.RegisterVenue(Session));
+		saved.SetUpdateId(cp, 4711);
+		saved.Sync();
+		ASSERT_TRUE(saved.SaveSnapshot(BookPath));
+	}
+	auto orderBook = std::make_shared<CORE::BOOK::OrderBook>(1);
+	ASSERT_TRUE(orderBook->LoadSnapshot(BookPath));
+	std::remove(BookPath.c_str());
+	CORE::ConnectionManager manager(ConfigPath, LoggingProperties, orderBook);
+	SyncConnection conn(SessionSettings(), manager);
+
+	// Act - the stream continues from the restored book, no snapshot is needed
+	Start(conn, *orderBook, cp);
+	Receive(conn, Diff(4700, 4710, "[\"29999.00\",\"1.0\"]")); // contained in the restored book
+	Receive(conn, Diff(4705, 4712, "[\"30001.00\",\"1.0\"]"));
+	Receive(conn, Diff(4713, 4713, "[\"30000.00\",\"0.0\"]"));
+	WorkOff(conn);
+	orderBook->Sync();
+
+	// Check
+	ASSERT_TRUE(conn.m_fetched.empty());
+	ASSERT_EQ(4713, orderBook->GetUpdateId(cp));
+	ASSERT_EQ(30001.0, cp.CpipToDbl(orderBook->GetBestPrice(cp, true)));
+	ASSERT_EQ(1, orderBook->GetQuoteCount(cp, true)); // the restored level is deleted by the stream
+}
+
+} // namespace TEST::BINANCE
@@ -0,0 +1,169 @@
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <Utils/FixDefs.h>
+#include "ConnectionManager.h"
+#include "binance/ConnectionMD.h"
+
+#include "TestHelpers.h"
+
+namespace TEST {
+
+using TestBinanceConnectionMD = TestConnectionMD<CORE::BINANCE::ConnectionMD>;
+
+namespace {
+const std::string Session { "BINANCE_TR_01" };
+const std::string OtherSession { "COINBASE_TR_01" };
+const std::string BookPath { ::testing::TempDir() + "ConnectionBaseTests_book.bin" };
+
+void AddQuote(CORE::BOOK::OrderBook &book, UTILS::CurrencyPair cp, bool bid, int64_t key, double price, int venue)
+{
+	UTILS::NormalizedMDData::Entry entry;
+	entry.updateType = QT_NEW;
+	entry.entryType = GetSide(bid);
+	entry.price = price;
+	entry.volume = 0.5;
+	book.AddEntry(key, 0, 0, cp, entry, venue);
+}
+
+/*! \brief Saves a book with 3 quotes of the session and 2 of another one, then loads it into @a book */
+void RestoreBook(CORE::BOOK::OrderBook &book, UTILS::CurrencyPair cp)
+{
+	CORE::BOOK::OrderBook saved { 1 };
+	const int own = saved.RegisterVenue(Session);
+	const int other = saved.RegisterVenue(OtherSession);
+	AddQuote(saved, cp, true, 1, 30000.0, own);
+	AddQuote(saved, cp, true, 2, 29999.0, own);
+	AddQuote(saved, cp, false, 3, 30001.0, own);
+	AddQuote(saved, cp, true, 4, 30000.0, other);
+	AddQuote(saved, cp, false, 5, 30002.0, other);
+	saved.SetUpdateId(cp, 4711);
+	saved.Sync();
+	ASSERT_TRUE(saved.SaveSnapshot(BookPath));
+	ASSERT_TRUE(book.LoadSnapshot(BookPath));
+	std::remove(BookPath.c_str());
+}
+
+/*! \brief Counts the quotes of a session on both sides */
+size_t CountQuotes(const CORE::BOOK::OrderBook &book, UTILS::CurrencyPair cp, const std::string &session)
+{
+	size_t count = 0;
+	for (bool bid: { true, false })
+	{
+		book.IterateQuotes(cp, bid, [&book, &session, &count](const CORE::BOOK::Quote &quote, bool &)
+		{
+			count += book.VenueName(quote.Venue()) == session ? 1 : 0;
+		});
+	}
+	return count;
+}
+
+CORE::CRYPTO::Settings SessionSettings()
+{
+	CORE::CRYPTO::Settings settings;
+	settings.m_name = Session;
+	return settings;
+}
+} // anon ns
+
+//--------------------------------------------------------------------------
+TEST(ConnectionBase, Test_RestoreQuotes_ClaimsRestoredQuotes)
+{
+	// Arrange
+	RegisterTestCurrencies();
+	const UTILS::CurrencyPair cp("BTC/USDT");
+	auto orderBook = std::make_shared<CORE::BOOK::OrderBook>(1);
+	RestoreBook(*orderBook, cp);
+	CORE::ConnectionManager manager(ConfigPath, LoggingProperties, orderBook);
+	TestBinanceConnectionMD conn(SessionSettings(), manager);
+	conn.RegisterVenue();
+	
+	// Act
+	const int64_t updateId = conn.RestoreQuotes(cp);
+	const size_t removed = orderBook->RemoveUnclaimedQuotes();
+	orderBook->Sync();
+	
+	// Check
+	ASSERT_EQ(4711, updateId); // the book is current to the saved update id
+	ASSERT_EQ(2, removed); // the quotes of the other session are not claimed
+	ASSERT_EQ(3, CountQuotes(*orderBook, cp, Session));
+	ASSERT_EQ(0, CountQuotes(*orderBook, cp, OtherSession));
+}
+
+//--------------------------------------------------------------------------
+TEST(ConnectionBase, Test_RestoreQuotes_NothingRestored)
+{
+	// Arrange
+	RegisterTestCurrencies();
+	const UTILS::CurrencyPair cp("BTC/USDT");
+	auto orderBook = std::make_shared<CORE::BOOK::OrderBook>(1);
+	CORE::ConnectionManager manager(ConfigPath, LoggingProperties, orderBook);
+	TestBinanceConnectionMD conn(SessionSettings(), manager);
+	conn.RegisterVenue();
+	orderBook->SetUpdateId(cp, 815); // an update id without quotes of the session
+	
+	// Act
+	const int64_t updateId = conn.RestoreQuotes(cp);
+	
+	// Check
+	ASSERT_EQ(0, updateId);
+}
+
+//--------------------------------------------------------------------------
+TEST(ConnectionBase, Test_RemoveQuotes_RestoredQuotesOfTheSession)
+{
+	// Arrange
+	RegisterTestCurrencies();
+	const UTILS::CurrencyPair cp("BTC/USDT");
+	auto orderBook = std::make_shared<CORE::BOOK::OrderBook>(1);
+	RestoreBook(*orderBook, cp);
+	CORE::ConnectionManager manager(ConfigPath, LoggingProperties, orderBook);
+	TestBinanceConnectionMD conn(SessionSettings(), manager);
+	conn.RegisterVenue();
+	ASSERT_EQ(4711, conn.RestoreQuotes(cp));
+	
+	// Act
+	conn.RemoveQuotes(cp);
+	orderBook->Sync();
+	
+	// Check - the restored quotes are found by price, the other session keeps its quotes
+	ASSERT_EQ(0, CountQuotes(*orderBook, cp, Session));
+	ASSERT_EQ(2, CountQuotes(*orderBook, cp, OtherSession));
+	ASSERT_EQ(30000.0, cp.CpipToDbl(orderBook->GetBestPrice(cp, true)));
+	ASSERT_EQ(30002.0, cp.CpipToDbl(orderBook->GetBestPrice(cp, false)));
+}
+
+//--------------------------------------------------------------------------
+TEST(ConnectionBase, Test_RemoveQuotes_PublishedQuotes)
+{
+	// Arrange
+	RegisterTestCurrencies();
+	const UTILS::CurrencyPair cp("BTC/USDT");
+	auto orderBook = std::make_shared<CORE::BOOK::OrderBook>(1);
+	CORE::ConnectionManager manager(ConfigPath, LoggingProperties, orderBook);
+	TestBinanceConnectionMD conn(SessionSettings(), manager);
+	conn.RegisterVenue();
+	auto nmd = std::make_shared<UTILS::NormalizedMDData>();
+	for (const auto &[bid, price]: { std::pair { true, 30000.0 }, std::pair { true, 29999.5 }, std::pair { false, 30000.5 } })
+	{
+		auto &entry = nmd->entries.emplace_back();
+		entry.instrument = cp;
+		entry.entryType = GetSide(bid);
+		entry.price = price;
+		entry.volume = 1.0;
+		entry.updateType = QT_NEW;
+	}
+	conn.PublishQuotes(nmd);
+	orderBook->Sync();
+	ASSERT_EQ(3, CountQuotes(*orderBook, cp, Session));
+	
+	// Act
+	conn.RemoveQuotes(cp);
+	orderBook->Sync();
+	
+	// Check
+	ASSERT_EQ(0, CountQuotes(*orderBook, cp, Session));
+	ASSERT_EQ(0, orderBook->GetQuoteCount(cp, true));
+	ASSERT_EQ(0, orderBook->GetQuoteCount(cp, false));
+}
+
+} // namespace TEST
@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include "JsonView.h"
+
+namespace TEST {
+using namespace CORE::CRYPTO;
+
+namespace {
+/*! \brief Nests a value in @a depth arrays */
+std::string Nested(size_t depth)
+{
+	return std::string(depth, '[') + "1" + std::string(depth, ']');
+}
+} // anon ns
+
+//--------------------------------------------------------------------------
+TEST(JsonIndex, Test_Parse_Document)
+{
+	// Arrange
+	const std::string json = R"({"e":"depthUpdate","E":1700000000123,"b":[["16850.12","0.5"],["16850.11","1.25"]],"a":[],"x":{},"ok":true,"n":null})";
+	JsonIndex index;
+
+	// Act
+	const auto res = index.Parse(json);
+
+	// Check
+	ASSERT_TRUE(res);
+	const JsonValue root = index.Root();
+	ASSERT_TRUE(root.IsObject());
+	ASSERT_EQ(7, root.Size());
+	ASSERT_EQ("depthUpdate", root["e"].ToString());
+	ASSERT_EQ(1700000000123, root["E"].GetInt64());
+	ASSERT_EQ(2, root["b"].Size());
+	ASSERT_EQ("16850.11", root["b"][1][0].Text());
+	ASSERT_EQ(1.25, root["b"][1][1].Double());
+	ASSERT_TRUE(root["a"].IsArray());
+	ASSERT_EQ(0, root["a"].Size());
+	ASSERT_TRUE(root["x"].IsObject());
+	ASSERT_EQ(0, root["x"].Size());
+	ASSERT_EQ(JsonType::True, root["ok"].Type());
+	ASSERT_TRUE(root["n"].IsNull());
+	ASSERT_FALSE(root["missing"].Valid());
+	ASSERT_FALSE(root["b"][2][0].Valid()); // chained lookups of missing values stay invalid
+
+	// members are iterated in order, nested values are skipped over
+	std::string names;
+	for (auto it = root.begin(); it != root.end(); ++it)
+	{
+		names += std::string(it.Name()) + ",";
+	}
+	ASSERT_EQ("e,E,b,a,x,ok,n,", names);
+}
+
+//--------------------------------------------------------------------------
+TEST(JsonIndex, Test_Parse_Escapes)
+{
+	// Arrange
+	const std::string json = R"({"s":"a\"b\\c\/d\n\t\r\b\f","q":"x\"}","k\"ey":1})";
+	JsonIndex index;
+
+	// Act
+	const auto res = index.Parse(json);
+
+	// Check
+	ASSERT_TRUE(res);
+	const JsonValue root = index.Root();
+	ASSERT_EQ(R"(a\"b\\c\/d\n\t\r\b\f)", root["s"].Text()); // as written
+	ASSERT_EQ("a\"b\\c/d\n\t\r\b\f", root["s"].ToString()); // decoded
+	ASSERT_EQ("x\"}", root["q"].ToString()); // an escaped quote does not end the string
+	ASSERT_EQ(3, root.Size());
+}
+
+//--------------------------------------------------------------------------
+TEST(JsonIndex, Test_Parse_UnicodeEscapes)
+{
+	// Arrange
+	const std::string json = R"(["A","é","€","😀","\ud83d","\u12"])";
+	JsonIndex index;
+
+	// Act
+	const auto res = index.Parse(json);
+
+	// Check
+	ASSERT_TRUE(res);
+	const JsonValue root = index.Root();
+	ASSERT_EQ("A", root[0].ToString());
+	ASSERT_EQ("\xC3\xA9", root[1].ToString()); // 2 bytes
+	ASSERT_EQ("\xE2\x82\xAC", root[2].ToString()); // 3 bytes
+	ASSERT_EQ("\xF0\x9F\x98\x80", root[3].ToString()); // surrogate pair -> one code point, 4 bytes
+	ASSERT_EQ("\xED\xA0\xBD", root[4].ToString()); // lone high surrogate is encoded as it is
+	ASSERT_EQ("\\u12", root[5].ToString()); // incomplete escape is kept
+}
+
+//--------------------------------------------------------------------------
+TEST(JsonIndex, Test_Parse_NestingLimit)
+{
+	// Arrange
+	JsonIndex index;
+
+	// Act
+	const auto deepest = index.Parse(Nested(JsonIndex::MAX_DEPTH));
+	const JsonValue inner = index.Root()[0][0];
+	const std::string tooDeepJson = Nested(JsonIndex::MAX_DEPTH + 1);
+	const auto tooDeep = index.Parse(tooDeepJson);
+
+	// Check
+	ASSERT_TRUE(deepest);
+	ASSERT_TRUE(inner.IsArray());
+	ASSERT_FALSE(tooDeep);
+	ASSERT_EQ("Invalid JSON at offset 64: document nested too deeply", tooDeep.ErrorMessage());
+	ASSERT_FALSE(index.Root().Valid());
+}
+
+//--------------------------------------------------------------------------
+TEST(JsonIndex, Test_Parse_TruncatedInput)
+{
+	// Arrange
+	const std::vector<std::string> truncated = {
+			"", "   ", "{", R"({"a")", R"({"a":)", R"({"a":1)", R"({"a":1,)", "[1,", "[1,2", R"(["abc)", R"(["ab\)", "tru", "nul",
+			R"({"a":{"b":[1]})" };
+	JsonIndex index;
+
+	for (const auto &json : truncated)
+	{
+		// Act
+		const auto res = index.Parse(json);
+
+		// Check
+		ASSERT_FALSE(res) << json;
+		ASSERT_FALSE(index.Root().Valid()) << json;
+	}
+	ASSERT_EQ("Invalid JSON at offset 7: unexpected end of document", index.Parse(R"({"a":1,)").ErrorMessage());
+	ASSERT_EQ("Invalid JSON at offset 1: unterminated string", index.Parse(R"(["abc)").ErrorMessage());
+}
+
+//--------------------------------------------------------------------------
+TEST(JsonIndex, Test_Parse_Numbers)
+{
+	// Arrange
+	const std::vector<std::string> valid = { "0", "-0", "7", "-12", "1.5", "-0.25", "1e3", "1E+3", "2.5e-3", "10.00100" };
+	const std::vector<std::string> invalid = { "-", "1-2", "--1", "+1", "01", "-01", "1.", ".5", "1.e3", "1e", "1e+", "1.2.3",
+												"0x1F", "1-", "[1-2]", R"({"a":-})" };
+	JsonIndex index;
+
+	// Act / Check
+	for (const auto &json : valid)
+	{
+		ASSERT_TRUE(index.Parse(json)) << json;
+		ASSERT_TRUE(index.Root().IsNumber()) << json;
+		ASSERT_EQ(json, index.Root().Text());
+	}
+	for (const auto &json : invalid)
+	{
+		ASSERT_FALSE(index.Parse(json)) << json;
+	}
+	ASSERT_EQ("Invalid JSON at offset 0: invalid number", index.Parse("-").ErrorMessage());
+	ASSERT_EQ("Invalid JSON at offset 1: end of document expected", index.Parse("1-2").ErrorMessage());
+}
+
+//--------------------------------------------------------------------------
+TEST(JsonIndex, Test_Values_Conversions)
+{
+	// Arrange
+	const std::string json = R"([42,"43",-7,1.5,"abc",9223372036854775808,true])";
+	JsonIndex index;
+
+	// Act
+	ASSERT_TRUE(index.Parse(json));
+	const JsonValue root = index.Root();
+
+	// Check
+	ASSERT_EQ(42, root[0].Int64());
+	ASSERT_EQ(43, root[1].Int64()); // number in a string
+	ASSERT_EQ(-7, root[2].Int64());
+	ASSERT_FALSE(root[3].Int64()); // not an integer
+	ASSERT_EQ(1.5, root[3].Double());
+	ASSERT_FALSE(root[4].Int64());
+	ASSERT_EQ(-1, root[4].GetInt64(-1));
+	ASSERT_FALSE(root[5].Int64()); // out of range
+	ASSERT_FALSE(root[6].Int64());
+	ASSERT_EQ("true", root[6].ToString());
+}
+
+//--------------------------------------------------------------------------
+TEST(JsonIndex, Test_Parse_ReusesIndex)
+{
+	// Arrange
+	JsonIndex index;
+	ASSERT_TRUE(index.Parse(R"({"a":[1,2,3]})"));
+
+	// Act - a failed parse discards the previous document, the next one is indexed from scratch
+	const auto failed = index.Parse("[1,");
+	const bool rootAfterFailure = index.Root().Valid();
+	const auto res = index.Parse(R"({"b":"c"})");
+
+	// Check
+	ASSERT_FALSE(failed);
+	ASSERT_FALSE(rootAfterFailure);
+	ASSERT_TRUE(res);
+	ASSERT_EQ("c", index.Root()["b"].ToString());
+	ASSERT_FALSE(index.Root()["a"].Valid());
+}
+
+} // namespace TEST
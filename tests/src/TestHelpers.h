@@ -43,6 +43,10 @@ public:
 	TestConnectionMD(const CORE::CRYPTO::Settings &settings)
 			: TConnection(settings, PATH_TEST_LOGGINGPROPERTIES) { }
 	
+	/*! \brief Connection publishing to the order book of @a connectionManager */
+	TestConnectionMD(const CORE::CRYPTO::Settings &settings, const CORE::ConnectionManager &connectionManager)
+			: TConnection(settings, PATH_TEST_LOGGINGPROPERTIES, connectionManager) { }
+	
 	// Containers of received quotes and topics
 	std::atomic<size_t> m_numberOfOnPublishQuoteBufferCalls { 0 };
 	std::vector<std::string> m_webSocketSentPayloads;
@@ -53,6 +57,10 @@ public:
 		return TConnection::GetMessageProcessor();
 	}
 	
+	using TConnection::RegisterVenue;
+	using TConnection::RestoreQuotes;
+	using TConnection::RemoveQuotes;
+	
 	/*! \brief Looks for a published quote in the internal buffer
 	* @param symbol: currency pair like 'BTCUSDT'
 	* @param qt: quote type UTILS::QuoteType::BID or UTILS::QuoteType::ASK